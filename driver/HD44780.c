@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include "driver/i2c.h"
 #include "esp_log.h"
 #include "esp_check.h"
@@ -6,11 +7,23 @@
 #include "freertos/task.h"
 #include "sdkconfig.h"
 #include "rom/ets_sys.h"
+#include "esp_timer.h"
 #include "lcd.h"
 #include "hd44780/handle.h"
 #include "hd44780.h"
+#include "hd44780_refresh.h"
+#include "hd44780_pacing.h"
+#include "hd44780_warm.h"
+#include "hd44780_sleep.h"
+#include "hd44780_stats.h"
+#include "hd44780_trace.h"
+#include "hd44780_fault.h"
+#include "hd44780_error.h"
+#include "hd44780_pinmap.h"
 
 // Pin mappings
+// Set with menuconfig or per handle, see lcd_pinmap_t. Most backpacks are
+// wired as the defaults:
 // P0 -> RS
 // P1 -> RW
 // P2 -> E
@@ -19,6 +32,8 @@
 // P5 -> D5
 // P6 -> D6
 // P7 -> D7
+// Expander bytes come from the handle's encoding, lcd_encoding(), which has
+// them laid out for every byte value.
 
 // When the display powers up, it is configured as follows:
 //
@@ -43,14 +58,48 @@
 
 static const char *TAG = "LCD Driver";
 
+#define LCD_INIT_PENDING ((esp_err_t)-2) /*!< lcd_init_begin() result of a display that needs the reset sequence */
+#define LCD_INIT_RESUMED ((esp_err_t)-3) /*!< lcd_init_many() state of a display resumed without a reset */
+
+const uint8_t lcd_row_offsets[] = {LCD_LINEONE, LCD_LINETWO, LCD_LINETHREE, LCD_LINEFOUR};
+
+// Reset by instruction. The delays are minimums counted from the last
+// display's nibble, so lcd_init_many() waits once per step for every display.
+static const struct
+{
+    uint8_t nibble;
+    uint32_t delay_us;
+} lcd_reset_steps[] = {
+    {LCD_FUNCTION_SET | LCD_8BIT_MODE, 10000},               // 4.1 ms (min)
+    {LCD_FUNCTION_SET | LCD_8BIT_MODE, 200},                 // 100 us (min)
+    {LCD_FUNCTION_SET | LCD_8BIT_MODE, LCD_STD_EXEC_TIME_US}, // Third time's a charm
+    {LCD_FUNCTION_SET | LCD_4BIT_MODE, 80},                  // Activate 4-bit mode, 40 us (min)
+};
+
+// Sent once the busy flag is available: Function Set (mode, lines and font),
+// Display Control (display on, with the configured cursor and blink), Entry
+// Mode Set (cursor move direction and display shift), Clear and Home. The
+// controller state is unknown, so all of them are sent.
+static const uint8_t lcd_setup_steps[] = {
+    LCD_FUNCTION_SET, LCD_DISPLAY_CONTROL, LCD_ENTRY_MODE_SET, LCD_CLEAR, LCD_HOME,
+};
+
 /**
- * @brief Transmit 4 bits of data to the LCD panel
+ * @brief Send half of an encoded byte
  *
  * @param[in] handle The LCD handle
- * @param[in] nibble The 4 bits of data to be sent.
- * @param[in] mode [** to be defined **]
+ * @param[in] seq Three bytes of an encoding sequence: the nibble, with E raised, with E dropped
+ * @param[in] ctrl RS, RW and backlight lines to OR in
+ */
+static esp_err_t lcd_write_nibble(const lcd_handle_t *handle, const uint8_t *seq, uint8_t ctrl);
+
+/**
+ * @brief Transmit one half of a byte to each of several controllers, settling them together
+ *
+ * @param[inout] xfers Bytes being sent. Entries whose result is not ESP_OK are skipped.
+ * @param[in] half LCD_ENCODING_HIGH or LCD_ENCODING_LOW
  */
-static esp_err_t lcd_write_nibble(const lcd_handle_t *handle, uint8_t nibble, uint8_t mode);
+static void lcd_write_nibble_many(lcd_hw_xfer_t *xfers, size_t count, int half);
 
 /**
  * @brief Manage incrementing the cursor column of the LCD handle
@@ -82,16 +131,245 @@ static esp_err_t lcd_handle_increment_cursor(lcd_handle_t *handle);
  */
 static esp_err_t lcd_handle_decrement_cursor(lcd_handle_t *handle);
 
-static esp_err_t lcd_null_operation(lcd_handle_t *handle);
+/**
+ * @brief Act on a change of the display control or entry mode flags of the handle
+ *
+ * @details A change that leaves the controller state as it is sends nothing.
+ *          With CONFIG_LCD_DEFER_CONTROL the change is only recorded and is sent,
+ *          merged with any other change made meanwhile, ahead of the next
+ *          instruction, at the next refresh flush or by lcd_flush().
+ *
+ * @param[inout] handle The LCD handle
+ */
+static esp_err_t lcd_state_changed(lcd_handle_t *handle);
+
+/**
+ * @brief Drive the backlight line of the expander to the state in the handle
+ *
+ * @details A single expander byte is written with E low, so the controller
+ *          sees no instruction and the address counter is left alone.
+ *
+ * @param[in] handle The LCD handle
+ */
+static esp_err_t lcd_backlight_update(lcd_handle_t *handle);
 static esp_err_t lcd_write_byte(const lcd_handle_t *handle, uint8_t data, uint8_t mode);
-static esp_err_t lcd_pulse_enable(const lcd_handle_t *handle, uint8_t nibble);
-static esp_err_t lcd_i2c_detect(i2c_port_t port, uint8_t address);
-static esp_err_t lcd_i2c_write(i2c_port_t port, uint8_t address, uint8_t data);
+
+/**
+ * @brief Resume a controller left configured by the previous boot
+ *
+ * @details Completes a byte the previous boot was cut off in the middle of,
+ *          checks the controller answers a busy flag read sensibly, and sends
+ *          only the Function Set, Display Control and Entry Mode Set flags that
+ *          differ from what the warm start record says it holds. The display
+ *          content is left as it is.
+ *
+ * @param[inout] handle The LCD handle, linked to a valid warm start record
+ */
+static esp_err_t lcd_warm_resume(lcd_handle_t *handle);
+static esp_err_t lcd_init_begin(lcd_handle_t *handle);
+
+/**
+ * @brief Resume a display from its deep sleep snapshot
+ *
+ * @details The handle is restored from the snapshot. Nothing is sent unless
+ *          the controller fails the busy flag check, apart from placing the
+ *          address counter at the restored cursor.
+ *
+ * @param[inout] handle The LCD handle, linked to a valid snapshot
+ */
+static esp_err_t lcd_sleep_resume(lcd_handle_t *handle);
+
+/**
+ * @brief Check that the controller is in 4-bit mode and in nibble step
+ *
+ * @details A controller out of nibble step or in 8-bit mode does not answer a
+ *          status read with an idle busy flag and an address counter inside DDRAM.
+ */
+static esp_err_t lcd_hw_check_in_step(const lcd_handle_t *handle);
+static esp_err_t lcd_read_nibble(const lcd_handle_t *handle, uint8_t *nibble);
+static esp_err_t lcd_hw_transfer(lcd_handle_t *handle, uint8_t data, uint8_t mode, uint32_t exec_us);
+static esp_err_t lcd_i2c_detect(const lcd_handle_t *handle);
+
+/**
+ * @brief Write a run of expander bytes that may go out back to back
+ *
+ * @details A transport gets the whole run at once. On the I2C driver each
+ *          byte is a transaction of its own, and a byte that raises E is held
+ *          for the minimum enable pulse width before the next one. Fails with
+ *          ESP_ERR_NOT_FOUND without using the bus while the display is
+ *          offline, see fault.h.
+ */
+static esp_err_t lcd_bus_write(const lcd_handle_t *handle, const uint8_t *data, size_t len);
+
+/**
+ * @brief Read the expander pins, unless the display is offline
+ */
+static esp_err_t lcd_bus_read(const lcd_handle_t *handle, uint8_t *data);
+static esp_err_t lcd_i2c_write(const lcd_handle_t *handle, uint8_t data);
+static esp_err_t lcd_i2c_read(const lcd_handle_t *handle, uint8_t *data);
+static esp_err_t lcd_transport_write(const lcd_handle_t *handle, const uint8_t *data, size_t len);
+static esp_err_t lcd_bus_write_bulk(const lcd_handle_t *handle, const uint8_t *data, size_t len, uint32_t wire_us);
+static esp_err_t lcd_i2c_write_bulk(const lcd_handle_t *handle, const uint8_t *data, size_t len, uint32_t wire_us);
+static esp_err_t lcd_transport_read(const lcd_handle_t *handle, uint8_t *data);
 
 esp_err_t lcd_init(lcd_handle_t *handle)
+{
+    return lcd_init_many(&handle, 1);
+}
+
+esp_err_t lcd_init_many(lcd_handle_t **handles, size_t count)
+{
+    esp_err_t ret = lcd_hw_init(handles, count);
+
+#if CONFIG_LCD_REFRESH_IN_INIT
+    // Every display that came up gets its scheduler, even if another failed
+    for (size_t i = 0; handles && i < count; ++i)
+    {
+        lcd_refresh_config_t config = LCD_REFRESH_DEFAULT_CONFIG();
+        esp_err_t result;
+
+        if (!handles[i] || !handles[i]->initialized || handles[i]->refresh)
+            continue;
+        result = lcd_refresh_enable(handles[i], &config);
+        if (ret == ESP_OK)
+            ret = result;
+    }
+#endif
+    return ret;
+}
+
+esp_err_t lcd_hw_init(lcd_handle_t **handles, size_t count)
 {
     esp_err_t ret = ESP_OK;
+    lcd_hw_xfer_t *xfers = NULL;
+    int64_t start_us = lcd_stats_start();
+
+    ESP_RETURN_ON_FALSE(handles && count, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    // Before any display is touched, so that none is left half initialised
+    for (size_t i = 0; i < count; ++i)
+        ESP_RETURN_ON_FALSE(handles[i], ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    xfers = calloc(count, sizeof(lcd_hw_xfer_t));
+    ESP_RETURN_ON_FALSE(xfers, ESP_ERR_NO_MEM, TAG, "Unable to allocate init state");
+
+    // Displays that resume from a previous boot are done here. The others
+    // go through the rest in lockstep, each nibble settling on all at once.
+    for (size_t i = 0; i < count; ++i)
+    {
+        esp_err_t result = lcd_init_begin(handles[i]);
+
+        xfers[i].handle = handles[i];
+        xfers[i].result = result == LCD_INIT_PENDING ? ESP_OK : result == ESP_OK ? LCD_INIT_RESUMED : result;
+    }
+
+    for (size_t s = 0; s < sizeof(lcd_reset_steps) / sizeof(lcd_reset_steps[0]); ++s)
+    {
+        lcd_handle_t *last = NULL;
 
+        for (size_t i = 0; i < count; ++i)
+        {
+            xfers[i].data = lcd_reset_steps[s].nibble;
+            xfers[i].mode = LCD_COMMAND;
+            xfers[i].admitted = xfers[i].result == ESP_OK;
+            if (xfers[i].admitted)
+                lcd_error_begin(handles[i], xfers[i].data, LCD_COMMAND);
+        }
+        lcd_write_nibble_many(xfers, count, LCD_ENCODING_HIGH);
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (xfers[i].admitted)
+                lcd_error_end(handles[i]);
+            xfers[i].admitted = false;
+            if (xfers[i].result == ESP_OK)
+                last = handles[i];
+        }
+        if (last)
+            lcd_delay_us(last, lcd_reset_steps[s].delay_us);
+    }
+
+    // --- Busy flag now available ---
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (xfers[i].result != ESP_OK)
+            continue;
+        handles[i]->display_control |= LCD_DISPLAY_ON;
+        handles[i]->hw_display_function = LCD_HW_STATE_UNKNOWN;
+        handles[i]->hw_display_control = LCD_HW_STATE_UNKNOWN;
+        handles[i]->hw_display_mode = LCD_HW_STATE_UNKNOWN;
+    }
+    for (size_t s = 0; s < sizeof(lcd_setup_steps); ++s)
+    {
+        uint8_t step = lcd_setup_steps[s];
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            lcd_handle_t *handle = handles[i];
+
+            if (xfers[i].result != ESP_OK)
+                continue;
+            xfers[i].data = step;
+            xfers[i].mode = LCD_COMMAND;
+            xfers[i].exec_us = LCD_STD_EXEC_TIME_US;
+            if (step == LCD_FUNCTION_SET)
+                xfers[i].data |= handle->display_function;
+            else if (step == LCD_DISPLAY_CONTROL)
+                xfers[i].data |= handle->display_control;
+            else if (step == LCD_ENTRY_MODE_SET)
+                xfers[i].data |= handle->display_mode;
+            else
+                xfers[i].exec_us = LCD_HOME_EXEC_TIME_US; // Clear and Home take 1.52 ms
+        }
+        lcd_hw_transfer_many(xfers, count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            lcd_handle_t *handle = handles[i];
+
+            if (xfers[i].result != ESP_OK)
+                continue;
+            lcd_hw_state_sent(handle, xfers[i].data);
+            // This instruction also sets I/D bit to 1 (increment mode)
+            if (step == LCD_CLEAR)
+                handle->display_mode |= LCD_ENTRY_INCREMENT;
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (xfers[i].result == ESP_OK)
+        {
+            handles[i]->cursor_row = 0;
+            handles[i]->cursor_column = 0;
+            handles[i]->initialized = true;
+            continue;
+        }
+        if (xfers[i].result == LCD_INIT_RESUMED)
+            continue;
+        if (xfers[i].result == ESP_ERR_INVALID_STATE && !handles[i]->initialized)
+        {
+            ESP_LOGE(TAG, "I2C driver must be installed before attempting to initalize LCD.");
+        }
+        lcd_error_report(handles[i], LCD_STATS_API_INIT, xfers[i].result);
+        if (ret == ESP_OK)
+            ret = xfers[i].result;
+    }
+    for (size_t i = 0; i < count; ++i)
+        lcd_stats_call(handles[i], LCD_STATS_API_INIT, start_us);
+    free(xfers);
+    return ret;
+}
+
+/**
+ * @brief Checks and resume paths of lcd_init() that are done one display at a time
+ *
+ * @return
+ *          - ESP_OK                Display resumed, nothing left to do
+ *          - LCD_INIT_PENDING      Display needs the reset by instruction
+ *          - Otherwise, the error that stopped its initialisation
+ */
+static esp_err_t lcd_init_begin(lcd_handle_t *handle)
+{
+    esp_err_t ret = ESP_OK;
+
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
     ESP_LOGD(TAG,
              "Initialising LCD with:\n\ti2c_port: %d\n\tAddress: 0x%0x\n\tColumns: %d\n\tRows: %d\n\tDisplay Function: 0x%0x\n\tDisplay Control: 0x%0x\n\tDisplay Mode: 0x%0x\n\tCursor Column: %d\n\tCursor Row: %d\n\tBacklight: %d\n\tInitialised: %d",
              handle->i2c_port, handle->address, handle->columns, handle->rows,
@@ -111,84 +389,76 @@ esp_err_t lcd_init(lcd_handle_t *handle)
         return ESP_ERR_INVALID_STATE;
     }
 
-    // Initialise the LCD controller by instruction for 4-bit interface
-    // First part of reset sequence
-    ESP_GOTO_ON_ERROR(
-        lcd_write_nibble(handle, LCD_FUNCTION_SET | LCD_8BIT_MODE, LCD_COMMAND),
-        err, TAG, "Unable to complete Reset by Instruction. Part 1.");
-    // 4.1 ms delay (min)
-    vTaskDelay(pdMS_TO_TICKS(10));
-    // second part of reset sequence
-    ESP_GOTO_ON_ERROR(
-        lcd_write_nibble(handle, LCD_FUNCTION_SET | LCD_8BIT_MODE, LCD_COMMAND),
-        err, TAG, "Unable to complete Reset by Instruction. Part 2.");
-    // 100 us delay (min)
-    ets_delay_us(200);
-    // Third time's a charm
-    ESP_GOTO_ON_ERROR(
-        lcd_write_nibble(handle, LCD_FUNCTION_SET | LCD_8BIT_MODE, LCD_COMMAND),
-        err, TAG, "Unable to complete Reset by Instruction. Part 3.");
-    // Activate 4-bit mode
-    ESP_GOTO_ON_ERROR(
-        lcd_write_nibble(handle, LCD_FUNCTION_SET | LCD_4BIT_MODE, LCD_COMMAND),
-        err, TAG, "Unable to activate 4-bit mode.");
-    // 40 us delay (min)
-    ets_delay_us(80);
-
-    // --- Busy flag now available ---
-    // Set Display Function: # line, font size, etc.
-    // 37us max execution time with 270kHz clock
-    // Set mode, lines, and font
-    ESP_GOTO_ON_ERROR(
-        lcd_write_byte(handle, LCD_FUNCTION_SET | handle->display_function, LCD_COMMAND),
-        err, TAG, "Unable to perform Set Display Function instruction.");
-    ets_delay_us(LCD_STD_EXEC_TIME_US);
-
-    // turn the display on with no cursor or blinking default
-    ESP_GOTO_ON_ERROR(
-        lcd_display(handle),
-        err, TAG, "Error with lcd_display()");
-
-    // Clear Display instruction
-    ESP_GOTO_ON_ERROR(
-        lcd_clear_screen(handle),
-        err, TAG, "Error with lcd_clear_screen()");
-
-    // Entry Mode Set instruction.
-    // Sets cursor move direction and specifies display shift
-    // 37us max execution time with 270kHz clock
-    ESP_GOTO_ON_ERROR(
-        lcd_write_byte(handle, LCD_ENTRY_MODE_SET | handle->display_mode, LCD_COMMAND),
-        err, TAG, "Unable to perform Entry Mode Set instruction.");
-    ets_delay_us(LCD_STD_EXEC_TIME_US);
-
-    ESP_GOTO_ON_ERROR(
-        lcd_home(handle),
-        err, TAG, "Error with lcd_home()");
-    handle->initialized = true;
-
-    return ret;
-err:
-    if (ret == ESP_ERR_INVALID_STATE)
+    handle->busy_until_us = 0;
+    ESP_RETURN_ON_ERROR(
+        lcd_encoding_create(handle),
+        TAG, "Unable to encode pin map");
+    ESP_RETURN_ON_ERROR(
+        lcd_pacer_create(handle),
+        TAG, "Unable to create wait timer");
+    ESP_RETURN_ON_ERROR(
+        lcd_counters_create(handle),
+        TAG, "Unable to create counters");
+    ESP_RETURN_ON_ERROR(
+        lcd_fault_create(handle),
+        TAG, "Unable to create fault state");
+
+    // Woken from deep sleep with a snapshot of this display: carry on from it
+    if (lcd_sleep_attach(handle) == ESP_OK)
     {
-        ESP_LOGE(TAG, "I2C driver must be installed before attempting to initalize LCD.");
+        lcd_warm_attach(handle);
+        if (lcd_sleep_resume(handle) == ESP_OK)
+        {
+            ESP_LOGD(TAG, "LCD 0x%x resumed from deep sleep", handle->address);
+            handle->initialized = true;
+            return ESP_OK;
+        }
+        ESP_LOGW(TAG, "Unable to resume LCD 0x%x from deep sleep, resetting it", handle->address);
+        lcd_sleep_invalidate(handle);
+        lcd_warm_invalidate(handle);
     }
+    // Resetting the ESP32 does not reset the LCD. If the previous boot left a
+    // record of how it configured the controller, carry on from there.
+    else if (lcd_warm_attach(handle) == ESP_OK)
+    {
+        if (lcd_warm_resume(handle) == ESP_OK)
+        {
+            ESP_LOGD(TAG, "LCD 0x%x resumed without reset", handle->address);
+            handle->initialized = true;
+            return ESP_OK;
+        }
+        ESP_LOGW(TAG, "Unable to resume LCD 0x%x, resetting it", handle->address);
+        lcd_warm_invalidate(handle);
+    }
+
+    ret = LCD_INIT_PENDING;
     return ret;
 }
 
 esp_err_t lcd_write_char(lcd_handle_t *handle, char c)
 {
     esp_err_t ret = ESP_OK;
+    int64_t start_us = lcd_stats_start();
 
     ESP_GOTO_ON_FALSE(handle, ESP_ERR_INVALID_ARG, err, TAG, "Invalid argument");
     // ESP_GOTO_ON_FALSE(c, ESP_ERR_INVALID_ARG, err, TAG, "Invalid argument"); // dont block null char, which might be assigned in CGRAM
 
-    // Write data to DDRAM
-    ESP_GOTO_ON_ERROR(
-        lcd_write_byte(handle, c, LCD_WRITE),
-        err, TAG, "Error with lcd_write_byte()");
-    // 37us + 4us execution time for 270kHz oscillator frequency
-    ets_delay_us(LCD_STD_EXEC_TIME_US);
+    // Checked under the lock, so lcd_refresh_disable() cannot free the
+    // frame buffer between the check and the store
+    lcd_lock(handle);
+    if (handle->refresh)
+    {
+        // Only the frame buffer is updated. The refresh scheduler sends it.
+        ESP_GOTO_ON_ERROR(
+            lcd_refresh_put(handle, c),
+            unlock, TAG, "Cursor outside the frame buffer");
+    }
+    else
+    {
+        // Write data to DDRAM
+        LCD_GOTO_ON_ERROR(lcd_hw_write_data(handle, c), unlock);
+    }
+    lcd_unlock(handle);
 
     // Update the cursor position details in the LCD handle
     if (handle->display_mode & LCD_ENTRY_INCREMENT)
@@ -199,43 +469,68 @@ esp_err_t lcd_write_char(lcd_handle_t *handle, char c)
     {
         lcd_handle_decrement_cursor(handle);
     }
+    lcd_stats_call(handle, LCD_STATS_API_WRITE_CHAR, start_us);
     return ret;
+unlock:
+    lcd_unlock(handle);
 err:
+    lcd_error_report(handle, LCD_STATS_API_WRITE_CHAR, ret);
+    lcd_stats_call(handle, LCD_STATS_API_WRITE_CHAR, start_us);
     return ret;
 }
 
-esp_err_t lcd_write_str(lcd_handle_t *handle, char *str)
+esp_err_t lcd_write_str(lcd_handle_t *handle, const char *str)
 {
     esp_err_t ret = ESP_OK;
+    int64_t start_us = lcd_stats_start();
 
     while (*str) // automatically stops when null
     {
-        ESP_GOTO_ON_ERROR(
-            lcd_write_char(handle, *str++),
-            err, TAG, "Error with lcd_write_char()");
+        // lcd_write_char() reports its own failure
+        LCD_GOTO_ON_ERROR(lcd_write_char(handle, *str++), err);
     }
+    lcd_stats_call(handle, LCD_STATS_API_WRITE_STR, start_us);
     return ret;
 err:
+    lcd_stats_call(handle, LCD_STATS_API_WRITE_STR, start_us);
+    return ret;
+}
+
+esp_err_t lcd_write_chars(lcd_handle_t *handle, const char *chars, size_t len)
+{
+    esp_err_t ret = ESP_OK;
+    int64_t start_us = lcd_stats_start();
+
+    ESP_GOTO_ON_FALSE(chars || !len, ESP_ERR_INVALID_ARG, err, TAG, "Invalid argument");
+    for (size_t i = 0; i < len; ++i)
+    {
+        // lcd_write_char() reports its own failure
+        LCD_GOTO_ON_ERROR(lcd_write_char(handle, chars[i]), err);
+    }
+    lcd_stats_call(handle, LCD_STATS_API_WRITE_STR, start_us);
+    return ret;
+err:
+    lcd_stats_call(handle, LCD_STATS_API_WRITE_STR, start_us);
     return ret;
 }
 
 esp_err_t lcd_home(lcd_handle_t *handle)
 {
     esp_err_t ret = ESP_OK;
+    int64_t start_us = lcd_stats_start();
 
     ESP_GOTO_ON_FALSE(handle, ESP_ERR_INVALID_ARG, err, TAG, "Invalid argument");
 
-    ESP_GOTO_ON_ERROR(
-        lcd_write_byte(handle, LCD_HOME, LCD_COMMAND),
-        err, TAG, "Error with lcd_write_byte()");
     // 1.52ms execution time for 270kHz oscillator frequency
-    vTaskDelay(pdMS_TO_TICKS(LCD_HOME_EXEC_TIME_US / 1000));
+    LCD_GOTO_ON_ERROR(lcd_hw_command(handle, LCD_HOME, LCD_HOME_EXEC_TIME_US), err);
     handle->cursor_row = 0;
     handle->cursor_column = 0;
+    lcd_stats_call(handle, LCD_STATS_API_HOME, start_us);
 
     return ESP_OK;
 err:
-    ESP_LOGE(TAG, "lcd_home:%s", esp_err_to_name(ret));
+    lcd_error_report(handle, LCD_STATS_API_HOME, ret);
+    lcd_stats_call(handle, LCD_STATS_API_HOME, start_us);
     return ret;
 }
 
@@ -243,7 +538,7 @@ esp_err_t lcd_set_cursor(lcd_handle_t *handle, uint8_t column, uint8_t row)
 {
     esp_err_t ret;
     bool valid_arg = false;
-    uint8_t row_offsets[] = {LCD_LINEONE, LCD_LINETWO, LCD_LINETHREE, LCD_LINEFOUR};
+    int64_t start_us = lcd_stats_start();
 
     ESP_GOTO_ON_FALSE(handle, ESP_ERR_INVALID_ARG, err, TAG, "Invalid argument");
 
@@ -253,37 +548,53 @@ esp_err_t lcd_set_cursor(lcd_handle_t *handle, uint8_t column, uint8_t row)
     valid_arg = ((row < handle->rows) ? true : false);
     ESP_GOTO_ON_FALSE(valid_arg, ESP_ERR_INVALID_ARG, err, TAG, "Invalid row argument");
 
-    // Why is this not using Cursor/Display Shift Instruction??
-    ESP_GOTO_ON_ERROR(
-        lcd_write_byte(handle, LCD_SET_DDRAM_ADDR | (column + row_offsets[row]), LCD_COMMAND),
-        err, TAG, "Error with lcd_write_byte()");
-    // 37us execution time for 270kHz oscillator frequency
-    ets_delay_us(LCD_STD_EXEC_TIME_US);
+    // With the refresh scheduler enabled only the logical cursor moves.
+    if (!handle->refresh)
+    {
+        LCD_GOTO_ON_ERROR(lcd_hw_set_ddram_address(handle, column, row), err);
+    }
     handle->cursor_column = column;
     handle->cursor_row = row;
+    lcd_stats_call(handle, LCD_STATS_API_SET_CURSOR, start_us);
     return ESP_OK;
 err:
-    ESP_LOGE(TAG, "lcd_set_cursor:%s", esp_err_to_name(ret));
+    lcd_error_report(handle, LCD_STATS_API_SET_CURSOR, ret);
+    lcd_stats_call(handle, LCD_STATS_API_SET_CURSOR, start_us);
     return ret;
 }
 
 esp_err_t lcd_clear_screen(lcd_handle_t *handle)
 {
     esp_err_t ret = ESP_OK;
+    int64_t start_us = lcd_stats_start();
 
     ESP_GOTO_ON_FALSE(handle, ESP_ERR_INVALID_ARG, err, TAG, "Invalid argument");
 
-    // Max execution time not specified. Assume it is 0
-    ESP_GOTO_ON_ERROR(
-        lcd_write_byte(handle, LCD_CLEAR, LCD_COMMAND),
-        err, TAG, "Error with lcd_write_byte()");
+    lcd_lock(handle);
+    if (handle->refresh)
+    {
+        // Blank the frame buffer. The refresh scheduler only rewrites the
+        // cells that were not already blank, and the entry mode is left alone.
+        ret = lcd_refresh_clear(handle);
+        lcd_unlock(handle);
+        ESP_GOTO_ON_ERROR(ret, err, TAG, "Error with lcd_refresh_clear()");
+        handle->cursor_row = 0;
+        handle->cursor_column = 0;
+        lcd_stats_call(handle, LCD_STATS_API_CLEAR_SCREEN, start_us);
+        return ESP_OK;
+    }
+    lcd_unlock(handle);
+
+    LCD_GOTO_ON_ERROR(lcd_hw_clear(handle), err);
     handle->cursor_row = 0;
     handle->cursor_column = 0;
     // This instruction also sets I/D bit to 1 (increment mode)
     handle->display_mode |= LCD_ENTRY_INCREMENT;
+    lcd_stats_call(handle, LCD_STATS_API_CLEAR_SCREEN, start_us);
     return ESP_OK;
 err:
-    ESP_LOGE(TAG, "lcd_clear_screen:%s", esp_err_to_name(ret));
+    lcd_error_report(handle, LCD_STATS_API_CLEAR_SCREEN, ret);
+    lcd_stats_call(handle, LCD_STATS_API_CLEAR_SCREEN, start_us);
     return ret;
 }
 
@@ -291,18 +602,14 @@ esp_err_t lcd_no_display(lcd_handle_t *handle)
 {
     esp_err_t ret = ESP_OK;
 
-    ret = lcd_write_byte(handle,
-                         LCD_DISPLAY_CONTROL | (handle->display_control & ~LCD_DISPLAY_ON),
-                         LCD_COMMAND);
-    // 37us execution time for 270kHz oscillator frequency
-    ets_delay_us(LCD_STD_EXEC_TIME_US);
+    handle->display_control &= ~LCD_DISPLAY_ON;
+    ret = lcd_state_changed(handle);
     if (ret != ESP_OK)
         goto err;
-    handle->display_control &= ~LCD_DISPLAY_ON;
 
     return ESP_OK;
 err:
-    ESP_LOGE(TAG, "lcd_no_display:%s", esp_err_to_name(ret));
+    lcd_error_report(handle, LCD_STATS_API_CONTROL, ret);
     return ret;
 }
 
@@ -310,18 +617,14 @@ esp_err_t lcd_display(lcd_handle_t *handle)
 {
     esp_err_t ret = ESP_OK;
 
-    ret = lcd_write_byte(handle,
-                         LCD_DISPLAY_CONTROL | (handle->display_control | LCD_DISPLAY_ON),
-                         LCD_COMMAND);
-    // 37us max execution time with 270kHz clock
-    ets_delay_us(LCD_STD_EXEC_TIME_US);
+    handle->display_control |= LCD_DISPLAY_ON;
+    ret = lcd_state_changed(handle);
     if (ret != ESP_OK)
         goto err;
-    handle->display_control |= LCD_DISPLAY_ON;
 
     return ESP_OK;
 err:
-    ESP_LOGE(TAG, "lcd_display:%s", esp_err_to_name(ret));
+    lcd_error_report(handle, LCD_STATS_API_CONTROL, ret);
     return ret;
 }
 
@@ -329,18 +632,14 @@ esp_err_t lcd_no_cursor(lcd_handle_t *handle)
 {
     esp_err_t ret = ESP_OK;
 
-    ret = lcd_write_byte(handle,
-                         LCD_DISPLAY_CONTROL | (handle->display_control & ~LCD_CURSOR_ON),
-                         LCD_COMMAND);
-    // 37us execution time for 270kHz oscillator frequency
-    ets_delay_us(LCD_STD_EXEC_TIME_US);
+    handle->display_control &= ~LCD_CURSOR_ON;
+    ret = lcd_state_changed(handle);
     if (ret != ESP_OK)
         goto err;
-    handle->display_control &= ~LCD_CURSOR_ON;
 
     return ESP_OK;
 err:
-    ESP_LOGE(TAG, "lcd_no_cursor:%s", esp_err_to_name(ret));
+    lcd_error_report(handle, LCD_STATS_API_CONTROL, ret);
     return ret;
 }
 
@@ -348,18 +647,14 @@ esp_err_t lcd_cursor(lcd_handle_t *handle)
 {
     esp_err_t ret = ESP_OK;
 
-    ret = lcd_write_byte(handle,
-                         LCD_DISPLAY_CONTROL | (handle->display_control | LCD_CURSOR_ON),
-                         LCD_COMMAND);
-    // 37us execution time for 270kHz oscillator frequency
-    ets_delay_us(LCD_STD_EXEC_TIME_US);
+    handle->display_control |= LCD_CURSOR_ON;
+    ret = lcd_state_changed(handle);
     if (ret != ESP_OK)
         goto err;
-    handle->display_control |= LCD_CURSOR_ON;
 
     return ESP_OK;
 err:
-    ESP_LOGE(TAG, "lcd_cursor:%s", esp_err_to_name(ret));
+    lcd_error_report(handle, LCD_STATS_API_CONTROL, ret);
     return ret;
 }
 
@@ -367,18 +662,14 @@ esp_err_t lcd_no_blink(lcd_handle_t *handle)
 {
     esp_err_t ret = ESP_OK;
 
-    ret = lcd_write_byte(handle,
-                         LCD_DISPLAY_CONTROL | (handle->display_control & ~LCD_BLINK_ON),
-                         LCD_COMMAND);
-    // 37us execution time for 270kHz oscillator frequency
-    ets_delay_us(LCD_STD_EXEC_TIME_US);
+    handle->display_control &= ~LCD_BLINK_ON;
+    ret = lcd_state_changed(handle);
     if (ret != ESP_OK)
         goto err;
-    handle->display_control &= ~LCD_BLINK_ON;
 
     return ESP_OK;
 err:
-    ESP_LOGE(TAG, "lcd_no_blink:%s", esp_err_to_name(ret));
+    lcd_error_report(handle, LCD_STATS_API_CONTROL, ret);
     return ret;
 }
 
@@ -386,52 +677,54 @@ esp_err_t lcd_blink(lcd_handle_t *handle)
 {
     esp_err_t ret = ESP_OK;
 
-    ret = lcd_write_byte(handle,
-                         LCD_DISPLAY_CONTROL | (handle->display_control | LCD_BLINK_ON),
-                         LCD_COMMAND);
-    // 37us execution time for 270kHz oscillator frequency
-    ets_delay_us(LCD_STD_EXEC_TIME_US);
+    handle->display_control |= LCD_BLINK_ON;
+    ret = lcd_state_changed(handle);
     if (ret != ESP_OK)
         goto err;
-    handle->display_control |= LCD_BLINK_ON;
 
     return ESP_OK;
 err:
-    ESP_LOGE(TAG, "lcd_blink:%s", esp_err_to_name(ret));
+    lcd_error_report(handle, LCD_STATS_API_CONTROL, ret);
     return ret;
 }
 
 esp_err_t lcd_display_shift_left(lcd_handle_t *handle)
 {
     esp_err_t ret = ESP_OK;
+    int64_t start_us = lcd_stats_start();
 
-    ret = lcd_write_byte(handle,
-                         LCD_CURSOR_OR_DISPLAY_SHIFT | LCD_DISPLAY_MOVE | LCD_MOVE_LEFT,
-                         LCD_COMMAND);
     // 37us execution time for 270kHz oscillator frequency
-    ets_delay_us(LCD_STD_EXEC_TIME_US);
+    ret = lcd_hw_command(handle,
+                         LCD_CURSOR_OR_DISPLAY_SHIFT | LCD_DISPLAY_MOVE | LCD_MOVE_LEFT,
+                         LCD_STD_EXEC_TIME_US);
     if (ret != ESP_OK)
         goto err;
-    return lcd_handle_decrement_cursor(handle);
+    ret = lcd_handle_decrement_cursor(handle);
+    lcd_stats_call(handle, LCD_STATS_API_SHIFT, start_us);
+    return ret;
 err:
-    ESP_LOGE(TAG, "lcd_display_shift_left:%s", esp_err_to_name(ret));
+    lcd_error_report(handle, LCD_STATS_API_SHIFT, ret);
+    lcd_stats_call(handle, LCD_STATS_API_SHIFT, start_us);
     return ret;
 }
 
 esp_err_t lcd_display_shift_right(lcd_handle_t *handle)
 {
     esp_err_t ret = ESP_OK;
+    int64_t start_us = lcd_stats_start();
 
-    ret = lcd_write_byte(handle,
-                         LCD_CURSOR_OR_DISPLAY_SHIFT | LCD_DISPLAY_MOVE | LCD_MOVE_RIGHT,
-                         LCD_COMMAND);
     // 37us execution time for 270kHz oscillator frequency
-    ets_delay_us(LCD_STD_EXEC_TIME_US);
+    ret = lcd_hw_command(handle,
+                         LCD_CURSOR_OR_DISPLAY_SHIFT | LCD_DISPLAY_MOVE | LCD_MOVE_RIGHT,
+                         LCD_STD_EXEC_TIME_US);
     if (ret != ESP_OK)
         goto err;
-    return lcd_handle_increment_cursor(handle);
+    ret = lcd_handle_increment_cursor(handle);
+    lcd_stats_call(handle, LCD_STATS_API_SHIFT, start_us);
+    return ret;
 err:
-    ESP_LOGE(TAG, "lcd_display_shift_right:%s", esp_err_to_name(ret));
+    lcd_error_report(handle, LCD_STATS_API_SHIFT, ret);
+    lcd_stats_call(handle, LCD_STATS_API_SHIFT, start_us);
     return ret;
 }
 
@@ -440,18 +733,14 @@ esp_err_t lcd_left_to_right(lcd_handle_t *handle)
 {
     esp_err_t ret = ESP_OK;
 
-    ret = lcd_write_byte(handle,
-                         LCD_ENTRY_MODE_SET | (handle->display_mode | LCD_ENTRY_INCREMENT),
-                         LCD_COMMAND);
-    // 37us execution time for 270kHz oscillator frequency
-    ets_delay_us(LCD_STD_EXEC_TIME_US);
+    handle->display_mode |= LCD_ENTRY_INCREMENT;
+    ret = lcd_state_changed(handle);
     if (ret != ESP_OK)
         goto err;
-    handle->display_mode |= LCD_ENTRY_INCREMENT;
 
     return ESP_OK;
 err:
-    ESP_LOGE(TAG, "lcd_left_to_right:%s", esp_err_to_name(ret));
+    lcd_error_report(handle, LCD_STATS_API_CONTROL, ret);
     return ret;
 }
 
@@ -460,18 +749,14 @@ esp_err_t lcd_right_to_left(lcd_handle_t *handle)
 {
     esp_err_t ret = ESP_OK;
 
-    ret = lcd_write_byte(handle,
-                         LCD_ENTRY_MODE_SET | (handle->display_mode & ~LCD_ENTRY_INCREMENT),
-                         LCD_COMMAND);
-    // 37us execution time for 270kHz oscillator frequency
-    ets_delay_us(LCD_STD_EXEC_TIME_US);
+    handle->display_mode &= ~LCD_ENTRY_INCREMENT;
+    ret = lcd_state_changed(handle);
     if (ret != ESP_OK)
         goto err;
-    handle->display_mode &= ~LCD_ENTRY_INCREMENT;
 
     return ESP_OK;
 err:
-    ESP_LOGE(TAG, "lcd_right_to_left:%s", esp_err_to_name(ret));
+    lcd_error_report(handle, LCD_STATS_API_CONTROL, ret);
     return ret;
 }
 
@@ -482,17 +767,13 @@ esp_err_t lcd_autoscroll(lcd_handle_t *handle)
     ret = ESP_ERR_NOT_SUPPORTED;
     goto err;
 
-    ret = lcd_write_byte(handle,
-                         LCD_ENTRY_MODE_SET | (handle->display_mode | LCD_ENTRY_DISPLAY_SHIFT),
-                         LCD_COMMAND);
-    // 37us execution time for 270kHz oscillator frequency
-    ets_delay_us(LCD_STD_EXEC_TIME_US);
+    handle->display_mode |= LCD_ENTRY_DISPLAY_SHIFT;
+    ret = lcd_state_changed(handle);
     if (ret != ESP_OK)
         goto err;
-    handle->display_mode |= LCD_ENTRY_DISPLAY_SHIFT;
     return ESP_OK;
 err:
-    ESP_LOGE(TAG, "lcd_autoscroll:%s", esp_err_to_name(ret));
+    lcd_error_report(handle, LCD_STATS_API_CONTROL, ret);
     return ret;
 }
 
@@ -500,41 +781,78 @@ esp_err_t lcd_no_autoscroll(lcd_handle_t *handle)
 {
     esp_err_t ret = ESP_OK;
 
-    ret = lcd_write_byte(handle,
-                         LCD_ENTRY_MODE_SET | (handle->display_mode & ~LCD_ENTRY_DISPLAY_SHIFT),
-                         LCD_COMMAND);
-    // 37us execution time for 270kHz oscillator frequency
-    ets_delay_us(LCD_STD_EXEC_TIME_US);
+    handle->display_mode &= ~LCD_ENTRY_DISPLAY_SHIFT;
+    ret = lcd_state_changed(handle);
     if (ret != ESP_OK)
         goto err;
-    handle->display_mode &= ~LCD_ENTRY_DISPLAY_SHIFT;
     return ESP_OK;
 err:
-    ESP_LOGE(TAG, "lcd_no_autoscroll:%s", esp_err_to_name(ret));
+    lcd_error_report(handle, LCD_STATS_API_CONTROL, ret);
     return ret;
 }
 
 esp_err_t lcd_backlight(lcd_handle_t *handle)
 {
+    if (handle->backlight_pwm)
+        return lcd_backlight_set_level(handle, LCD_BACKLIGHT_LEVEL_MAX);
     handle->backlight = LCD_BACKLIGHT_ON;
-    // Closest thing we have to a noop. We need an instruction to effect the backlight change
-    // return (lcd_set_cursor(handle, handle->cursor_column, handle->cursor_row));
-    return lcd_null_operation(handle);
+    return lcd_backlight_update(handle);
 }
 
 esp_err_t lcd_no_backlight(lcd_handle_t *handle)
 {
+    if (handle->backlight_pwm)
+        return lcd_backlight_set_level(handle, 0);
     handle->backlight = LCD_BACKLIGHT_OFF;
-    // Closest thing we have to a noop. We need an instruction to effect the backlight change
-    // return (lcd_set_cursor(handle, handle->cursor_column, handle->cursor_row));
-    return lcd_null_operation(handle);
+    return lcd_backlight_update(handle);
+}
+
+esp_err_t lcd_flush(lcd_handle_t *handle)
+{
+    esp_err_t ret = ESP_OK;
+    int64_t start_us = lcd_stats_start();
+
+    ESP_GOTO_ON_FALSE(handle, ESP_ERR_INVALID_ARG, err, TAG, "Invalid argument");
+    lcd_lock(handle);
+    if (handle->refresh)
+        ret = lcd_refresh_flush(handle);
+    else
+        ret = lcd_hw_apply_state(handle);
+    lcd_unlock(handle);
+    if (ret != ESP_OK)
+        goto err;
+    lcd_stats_call(handle, LCD_STATS_API_FLUSH, start_us);
+    return ESP_OK;
+err:
+    lcd_error_report(handle, LCD_STATS_API_FLUSH, ret);
+    lcd_stats_call(handle, LCD_STATS_API_FLUSH, start_us);
+    return ret;
+}
+
+static esp_err_t lcd_state_changed(lcd_handle_t *handle)
+{
+    esp_err_t ret = ESP_OK;
+    int64_t start_us = lcd_stats_start();
+
+#if CONFIG_LCD_DEFER_CONTROL
+    // Sent ahead of the next instruction. Have the refresh scheduler send it
+    // even if no cell changes.
+    lcd_lock(handle);
+    lcd_refresh_wake(handle);
+    lcd_unlock(handle);
+#else
+    ret = lcd_hw_apply_state(handle);
+#endif
+    lcd_stats_call(handle, LCD_STATS_API_CONTROL, start_us);
+    return ret;
 }
 
 /************ CGRAM manipulation **********/
 
-esp_err_t lcd_write_cgram(lcd_handle_t *handle, uint8_t location, uint8_t *charmap)
+esp_err_t lcd_write_cgram(lcd_handle_t *handle, uint8_t location, const uint8_t *charmap)
 {
     esp_err_t ret;
+    int64_t start_us = lcd_stats_start();
 
     ESP_GOTO_ON_FALSE(handle, ESP_ERR_INVALID_ARG, err, TAG, "Invalid argument");
     ESP_GOTO_ON_FALSE(charmap, ESP_ERR_INVALID_ARG, err, TAG, "Invalid argument");
@@ -542,23 +860,39 @@ esp_err_t lcd_write_cgram(lcd_handle_t *handle, uint8_t location, uint8_t *charm
     location &= 0x7; // we only have 8 locations (or 4 with 5x10, lowest bit doesnt matter)
     uint8_t len = (handle->display_function & LCD_5x10DOTS) ? 10 : 8;
 
-    ESP_GOTO_ON_ERROR(
-        lcd_write_byte(handle, LCD_SET_CGRAM_ADDR | (location << 3), LCD_COMMAND),
-        err, TAG, "Error with lcd_write_byte()");
-
-    for (uint8_t i = 0; i < len; ++i)
+    // The glyph survived deep sleep in the controller, skip the upload
+    if (lcd_sleep_cgram_matches(handle, location, charmap, len))
     {
-        ESP_GOTO_ON_ERROR(
-            lcd_write_byte(handle, charmap[i], LCD_WRITE),
-            err, TAG, "Error with lcd_write_byte()");
+        handle->cursor_column = 0;
+        handle->cursor_row = 0;
+        if (!handle->refresh)
+            ret = lcd_hw_set_ddram_address(handle, 0, 0);
+        else
+            ret = ESP_OK;
+        lcd_error_report(handle, LCD_STATS_API_WRITE_CGRAM, ret);
+        lcd_stats_call(handle, LCD_STATS_API_WRITE_CGRAM, start_us);
+        return ret;
     }
-    ESP_GOTO_ON_ERROR(
-        lcd_set_cursor(handle, 0, 0),
-        err, TAG, "Error with lcd_set_cursor()");
+
+    // Hold the bus for the whole upload so that no DDRAM write lands in CGRAM
+    lcd_lock(handle);
+    LCD_GOTO_ON_ERROR(lcd_hw_command(handle, LCD_SET_CGRAM_ADDR | (location << 3), LCD_STD_EXEC_TIME_US), unlock);
+    for (uint8_t i = 0; i < len; ++i)
+        LCD_GOTO_ON_ERROR(lcd_hw_write_data(handle, charmap[i]), unlock);
+    // Return the address counter to DDRAM
+    LCD_GOTO_ON_ERROR(lcd_hw_set_ddram_address(handle, 0, 0), unlock);
+    lcd_sleep_cgram_store(handle, location, charmap, len);
+    lcd_unlock(handle);
+    handle->cursor_column = 0;
+    handle->cursor_row = 0;
+    lcd_stats_call(handle, LCD_STATS_API_WRITE_CGRAM, start_us);
 
     return ESP_OK;
+unlock:
+    lcd_unlock(handle);
 err:
-    ESP_LOGE(TAG, "lcd_set_cursor:%s", esp_err_to_name(ret));
+    lcd_error_report(handle, LCD_STATS_API_WRITE_CGRAM, ret);
+    lcd_stats_call(handle, LCD_STATS_API_WRITE_CGRAM, start_us);
     return ret;
 }
 
@@ -704,89 +1038,568 @@ err:
 
 /************ low level data pushing commands **********/
 
-static esp_err_t lcd_null_operation(lcd_handle_t *handle)
+void lcd_lock(lcd_handle_t *handle)
+{
+    if (handle->lock)
+        xSemaphoreTakeRecursive(handle->lock, portMAX_DELAY);
+}
+
+void lcd_unlock(lcd_handle_t *handle)
+{
+    // A dimming edge may have fallen while the lock was held
+    if (handle->backlight_pwm)
+        lcd_backlight_pwm_sync(handle);
+    if (handle->lock)
+        xSemaphoreGiveRecursive(handle->lock);
+}
+
+void lcd_hw_wait_ready(const lcd_handle_t *handle)
+{
+    int64_t remaining = handle->busy_until_us - esp_timer_get_time();
+
+    if (remaining > 0)
+        lcd_delay_us(handle, remaining);
+}
+
+/**
+ * @brief Write one byte once the controller is ready and record when it will
+ *        have executed it
+ */
+static esp_err_t lcd_hw_transfer(lcd_handle_t *handle, uint8_t data, uint8_t mode, uint32_t exec_us)
+{
+    esp_err_t ret = ESP_OK;
+
+    lcd_lock(handle);
+    // Names the instruction in a failure recorded meanwhile
+    lcd_error_begin(handle, data, mode);
+    // An offline display gets no instruction, at most a probe
+    ret = lcd_fault_admit(handle);
+    if (ret == ESP_OK)
+    {
+        lcd_hw_wait_ready(handle);
+        ret = lcd_write_byte(handle, data, mode);
+        handle->busy_until_us = esp_timer_get_time() + exec_us;
+        if (ret == ESP_OK)
+            lcd_stats_sent(handle, data, mode);
+    }
+    lcd_error_end(handle);
+    lcd_unlock(handle);
+    return ret;
+}
+
+void lcd_hw_transfer_many(lcd_hw_xfer_t *xfers, size_t count)
+{
+    // Without a settle time to share, each byte is best sent as one run
+    if (!LCD_PRE_PULSE_DELAY_US || count == 1)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (xfers[i].result == ESP_OK)
+                xfers[i].result = lcd_hw_transfer(xfers[i].handle, xfers[i].data, xfers[i].mode, xfers[i].exec_us);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        lcd_handle_t *handle = xfers[i].handle;
+
+        xfers[i].admitted = false;
+        if (xfers[i].result != ESP_OK)
+            continue;
+        lcd_lock(handle);
+        // Names the instruction in a failure recorded meanwhile
+        lcd_error_begin(handle, xfers[i].data, xfers[i].mode);
+        // An offline display gets no instruction, at most a probe
+        xfers[i].result = lcd_fault_admit(handle);
+        if (xfers[i].result != ESP_OK)
+        {
+            lcd_error_end(handle);
+            lcd_unlock(handle);
+            continue;
+        }
+        xfers[i].admitted = true;
+        // Lets the next boot finish the byte if the CPU resets between nibbles
+        if (handle->warm)
+        {
+            handle->warm->pending_data = xfers[i].data;
+            handle->warm->pending_mode = xfers[i].mode;
+        }
+    }
+
+    lcd_write_nibble_many(xfers, count, LCD_ENCODING_HIGH);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (xfers[i].result == ESP_OK && xfers[i].handle->warm)
+            xfers[i].handle->warm->half_sent = 1;
+    }
+    lcd_write_nibble_many(xfers, count, LCD_ENCODING_LOW);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        lcd_handle_t *handle = xfers[i].handle;
+
+        if (!xfers[i].admitted)
+            continue;
+        xfers[i].admitted = false;
+        handle->busy_until_us = esp_timer_get_time() + xfers[i].exec_us;
+        if (xfers[i].result == ESP_OK)
+        {
+            if (handle->warm)
+                handle->warm->half_sent = 0;
+            if (handle->pacer)
+                handle->pacer->stats.bytes++;
+            lcd_stats_sent(handle, xfers[i].data, xfers[i].mode);
+        }
+        lcd_error_end(handle);
+        lcd_unlock(handle);
+    }
+}
+
+bool lcd_hw_state_pending(const lcd_handle_t *handle)
+{
+    return handle->display_function != handle->hw_display_function ||
+           handle->display_control != handle->hw_display_control ||
+           handle->display_mode != handle->hw_display_mode;
+}
+
+bool lcd_hw_state_next(const lcd_handle_t *handle, uint8_t *instruction)
+{
+    if (handle->display_function != handle->hw_display_function)
+        *instruction = LCD_FUNCTION_SET | handle->display_function;
+    else if (handle->display_control != handle->hw_display_control)
+        *instruction = LCD_DISPLAY_CONTROL | handle->display_control;
+    else if (handle->display_mode != handle->hw_display_mode)
+        *instruction = LCD_ENTRY_MODE_SET | handle->display_mode;
+    else
+        return false;
+    return true;
+}
+
+void lcd_hw_state_sent(lcd_handle_t *handle, uint8_t instruction)
+{
+    if (instruction & LCD_SET_DDRAM_ADDR)
+        return;
+    if (instruction & LCD_FUNCTION_SET)
+        handle->hw_display_function = instruction & ~LCD_FUNCTION_SET;
+    else if (instruction & LCD_CURSOR_OR_DISPLAY_SHIFT)
+        return;
+    else if (instruction & LCD_DISPLAY_CONTROL)
+        handle->hw_display_control = instruction & ~LCD_DISPLAY_CONTROL;
+    else if (instruction & LCD_ENTRY_MODE_SET)
+        handle->hw_display_mode = instruction & ~LCD_ENTRY_MODE_SET;
+    else if (instruction == LCD_CLEAR)
+        handle->hw_display_mode |= LCD_ENTRY_INCREMENT; // Clear also sets I/D to 1 (increment mode)
+    else
+        return;
+    lcd_warm_save(handle);
+}
+
+esp_err_t lcd_hw_apply_state(lcd_handle_t *handle)
+{
+    esp_err_t ret = ESP_OK;
+    uint8_t instruction;
+
+    lcd_lock(handle);
+    // 37us execution time for 270kHz oscillator frequency, for all three
+    while (ret == ESP_OK && lcd_hw_state_next(handle, &instruction))
+    {
+        ret = lcd_hw_transfer(handle, instruction, LCD_COMMAND, LCD_STD_EXEC_TIME_US);
+        if (ret == ESP_OK)
+            lcd_hw_state_sent(handle, instruction);
+    }
+    lcd_warm_save(handle);
+    lcd_unlock(handle);
+    return ret;
+}
+
+esp_err_t lcd_hw_command(lcd_handle_t *handle, uint8_t instruction, uint32_t exec_us)
+{
+    esp_err_t ret = ESP_OK;
+
+    lcd_lock(handle);
+    // Deferred state changes go out first, so instructions keep their order
+    ret = lcd_hw_apply_state(handle);
+    if (ret == ESP_OK)
+        ret = lcd_hw_transfer(handle, instruction, LCD_COMMAND, exec_us);
+    lcd_unlock(handle);
+    return ret;
+}
+
+esp_err_t lcd_hw_write_data(lcd_handle_t *handle, uint8_t data)
 {
     esp_err_t ret = ESP_OK;
 
-    ret = lcd_write_byte(handle,
-                         LCD_DISPLAY_CONTROL | handle->display_control,
-                         LCD_COMMAND);
+    lcd_lock(handle);
+    ret = lcd_hw_apply_state(handle);
+    // 37us + 4us execution time for 270kHz oscillator frequency
+    if (ret == ESP_OK)
+        ret = lcd_hw_transfer(handle, data, LCD_WRITE, LCD_STD_EXEC_TIME_US);
+    lcd_unlock(handle);
+    return ret;
+}
+
+esp_err_t lcd_hw_set_ddram_address(lcd_handle_t *handle, uint8_t column, uint8_t row)
+{
+    // Why is this not using Cursor/Display Shift Instruction??
     // 37us execution time for 270kHz oscillator frequency
-    ets_delay_us(LCD_STD_EXEC_TIME_US);
+    return lcd_hw_command(handle,
+                          LCD_SET_DDRAM_ADDR | (column + lcd_row_offsets[row]),
+                          LCD_STD_EXEC_TIME_US);
+}
+
+/**
+ * @brief Note the instruction whose expander bytes start at seq, so a failure
+ *        in a compiled run can name it
+ */
+static void lcd_hw_stream_begin(lcd_handle_t *handle, const uint8_t *seq)
+{
+    const lcd_encoding_t *encoding = lcd_encoding(handle);
+    uint8_t mode = (seq[0] & encoding->mode[LCD_WRITE]) ? LCD_WRITE : LCD_COMMAND;
+
+    lcd_error_begin(handle, lcd_encoding_nibble(encoding, seq[0]) | lcd_encoding_nibble(encoding, seq[3]) >> 4, mode);
+}
+
+esp_err_t lcd_hw_write_stream(lcd_handle_t *handle, const uint8_t *data, size_t len, uint8_t backlight,
+                              uint32_t wire_us, uint32_t settle_us)
+{
+    esp_err_t ret = ESP_OK;
+    uint8_t flip;
+    uint8_t chunk[64];
+    size_t n;
+
+    // A run sent as one transaction is named by its first instruction
+    if (len >= LCD_ENCODING_SEQ_LEN)
+        lcd_hw_stream_begin(handle, data);
+    // An offline display gets no instruction, at most a probe
+    ret = lcd_fault_admit(handle);
+    if (ret != ESP_OK)
+    {
+        lcd_error_end(handle);
+        return ret;
+    }
+    lcd_hw_wait_ready(handle);
+    flip = lcd_backlight_bits(handle) ^ backlight;
+    if (settle_us)
+    {
+        // The data byte of the first nibble, then each enable pulse after the
+        // settle time together with the data byte of the nibble after it
+        for (size_t sent = 0; sent < len && ret == ESP_OK; sent += n)
+        {
+            size_t nibble = sent / (LCD_ENCODING_SEQ_LEN / 2);
+            size_t seq = sent - sent % LCD_ENCODING_SEQ_LEN;
+
+            // The instruction the enable pulse belongs to
+            if (seq + LCD_ENCODING_SEQ_LEN <= len)
+                lcd_hw_stream_begin(handle, &data[seq]);
+            n = sent ? LCD_ENCODING_SEQ_LEN / 2 : 1;
+            n = len - sent < n ? len - sent : n;
+            for (size_t i = 0; i < n; ++i)
+                chunk[i] = data[sent + i] ^ flip;
+            if (sent)
+                lcd_delay_us(handle, nibble % 2 || settle_us > LCD_STD_EXEC_TIME_US ? settle_us
+                                                                                    : LCD_STD_EXEC_TIME_US);
+            ret = lcd_bus_write_bulk(handle, chunk, n, 0);
+        }
+    }
+    else if (!flip)
+    {
+        ret = lcd_bus_write_bulk(handle, data, len, wire_us);
+    }
+    else
+    {
+        // Toggled since the run was compiled. Fewer bytes in a transaction
+        // only leave the controller more time.
+        for (size_t sent = 0; sent < len && ret == ESP_OK; sent += n)
+        {
+            n = len - sent < sizeof(chunk) ? len - sent : sizeof(chunk);
+            for (size_t i = 0; i < n; ++i)
+                chunk[i] = data[sent + i] ^ flip;
+            ret = lcd_bus_write_bulk(handle, chunk, n, wire_us);
+        }
+    }
+    handle->busy_until_us = esp_timer_get_time() + LCD_STD_EXEC_TIME_US;
+    lcd_error_end(handle);
+    return ret;
+}
+
+esp_err_t lcd_hw_clear(lcd_handle_t *handle)
+{
+    esp_err_t ret = ESP_OK;
+
+    lcd_lock(handle);
+    // 1.52ms execution time for 270kHz oscillator frequency
+    ret = lcd_hw_command(handle, LCD_CLEAR, LCD_HOME_EXEC_TIME_US);
+    if (ret == ESP_OK)
+        lcd_hw_state_sent(handle, LCD_CLEAR);
+    lcd_unlock(handle);
+    return ret;
+}
+
+esp_err_t lcd_hw_reset(lcd_handle_t *handle)
+{
+    esp_err_t ret = ESP_OK;
+
+    lcd_lock(handle);
+    // A display that comes back after a re-probe may have lost power, which
+    // leaves its CGRAM undefined. The glyphs the deep sleep snapshot says it
+    // holds can no longer be trusted, or lcd_write_cgram() would skip an
+    // upload as a match and leave garbage on the glass. Forgotten first, as a
+    // reset that fails part way leaves CGRAM no better known.
+    lcd_sleep_cgram_forget(handle);
+    // The expander answers as soon as it has power, the controller not yet
+    lcd_delay_us(handle, LCD_POWER_ON_TIME_US);
+    for (size_t s = 0; s < sizeof(lcd_reset_steps) / sizeof(lcd_reset_steps[0]); ++s)
+    {
+        LCD_GOTO_ON_ERROR(lcd_write_nibble(handle, lcd_encoding(handle)->seq[lcd_reset_steps[s].nibble],
+                                           lcd_backlight_bits(handle)),
+                          unlock);
+        lcd_delay_us(handle, lcd_reset_steps[s].delay_us);
+    }
+    handle->busy_until_us = 0;
+    handle->hw_display_function = LCD_HW_STATE_UNKNOWN;
+    handle->hw_display_control = LCD_HW_STATE_UNKNOWN;
+    handle->hw_display_mode = LCD_HW_STATE_UNKNOWN;
+    LCD_GOTO_ON_ERROR(lcd_hw_apply_state(handle), unlock);
+    // A display that did not lose power still shows what it did, so it is
+    // cleared either way
+    LCD_GOTO_ON_ERROR(lcd_hw_clear(handle), unlock);
+    LCD_GOTO_ON_ERROR(lcd_hw_set_ddram_address(handle, handle->cursor_column, handle->cursor_row), unlock);
+    if (handle->refresh)
+        lcd_refresh_invalidate(handle);
+unlock:
+    lcd_unlock(handle);
+    return ret;
+}
+
+static esp_err_t lcd_backlight_update(lcd_handle_t *handle)
+{
+    esp_err_t ret = ESP_OK;
+    int64_t start_us = lcd_stats_start();
+
+    // The lock keeps the byte from landing between a nibble and its enable pulse
+    lcd_lock(handle);
+    ret = lcd_hw_write_backlight(handle);
+    lcd_unlock(handle);
     if (ret != ESP_OK)
         goto err;
 
+    lcd_stats_call(handle, LCD_STATS_API_BACKLIGHT, start_us);
     return ESP_OK;
 err:
-    ESP_LOGE(TAG, "lcd_cursor:%s", esp_err_to_name(ret));
+    lcd_error_report(handle, LCD_STATS_API_BACKLIGHT, ret);
+    lcd_stats_call(handle, LCD_STATS_API_BACKLIGHT, start_us);
     return ret;
 }
 
-static esp_err_t lcd_write_nibble(const lcd_handle_t *handle, uint8_t nibble, uint8_t mode)
+esp_err_t lcd_hw_write_backlight(lcd_handle_t *handle)
+{
+    // E stays low, so the controller ignores the byte and may even be busy
+    uint8_t data = lcd_backlight_bits(handle);
+
+    return lcd_bus_write(handle, &data, 1);
+}
+
+static esp_err_t lcd_write_nibble(const lcd_handle_t *handle, const uint8_t *seq, uint8_t ctrl)
 {
     esp_err_t ret = ESP_OK;
-    uint8_t data = 0;
+    uint8_t data = seq[0] | ctrl;
+    uint8_t run[] = {seq[1] | ctrl, seq[2] | ctrl};
+
+    LCD_GOTO_ON_ERROR(lcd_bus_write(handle, &data, 1), err);
+
+    lcd_delay_us(handle, LCD_PRE_PULSE_DELAY_US); // Need a decent delay here, else display won't work
+
+    // Clock the data into the LCD. The execution time is not waited for
+    // here. Callers record it in handle->busy_until_us so the bus is free for
+    // other displays meanwhile.
+    LCD_GOTO_ON_ERROR(lcd_bus_write(handle, run, sizeof(run)), err);
+
+    return ESP_OK;
+err:
+    return ret;
+}
+
+static void lcd_write_nibble_many(lcd_hw_xfer_t *xfers, size_t count, int half)
+{
+    const lcd_handle_t *last = NULL;
 
-    if (handle->backlight)
+    // The data lines of every controller first. E stays low, so a controller
+    // still executing its last instruction ignores them.
+    for (size_t i = 0; i < count; ++i)
     {
-        data = (nibble & 0xF0) | mode | LCD_BACKLIGHT_CONTROL_ON;
+        const lcd_handle_t *handle = xfers[i].handle;
+        uint8_t data;
+
+        if (xfers[i].result != ESP_OK)
+            continue;
+        data = lcd_encoding(handle)->seq[xfers[i].data][half] |
+               lcd_encoding(handle)->mode[xfers[i].mode] | lcd_backlight_bits(handle);
+        xfers[i].result = lcd_bus_write(handle, &data, 1);
+        if (xfers[i].result == ESP_OK)
+            last = handle;
     }
-    else
+    if (!last)
+        return;
+
+    // The first set settles while the others are written, so one wait after
+    // the last covers all of them
+    lcd_delay_us(last, LCD_PRE_PULSE_DELAY_US);
+
+    for (size_t i = 0; i < count; ++i)
     {
-        data = (nibble & 0xF0) | mode | LCD_BACKLIGHT_CONTROL_OFF;
+        const lcd_handle_t *handle = xfers[i].handle;
+        const uint8_t *seq = lcd_encoding(handle)->seq[xfers[i].data] + half;
+        uint8_t ctrl = lcd_encoding(handle)->mode[xfers[i].mode] | lcd_backlight_bits(handle);
+        uint8_t run[2];
+
+        if (xfers[i].result != ESP_OK)
+            continue;
+        run[0] = seq[1] | ctrl;
+        run[1] = seq[2] | ctrl;
+        lcd_hw_wait_ready(handle);
+        xfers[i].result = lcd_bus_write(handle, run, sizeof(run));
     }
+}
 
-    ESP_GOTO_ON_ERROR(
-        lcd_i2c_write(I2C_MASTER_NUM, handle->address, data),
-        err, TAG, "Error with lcd_i2c_write()");
+static esp_err_t lcd_write_byte(const lcd_handle_t *handle, uint8_t data, uint8_t mode)
+{
+    esp_err_t ret;
+    lcd_warm_t *warm = handle->warm;
+    const uint8_t *seq = lcd_encoding(handle)->seq[data];
+    // The backlight line follows the dimming PWM phase, if enabled
+    uint8_t ctrl = lcd_encoding(handle)->mode[mode] | lcd_backlight_bits(handle);
 
-    ets_delay_us(LCD_PRE_PULSE_DELAY_US); // Need a decent delay here, else display won't work
+    // Lets the next boot finish the byte if the CPU resets between nibbles
+    if (warm)
+    {
+        warm->pending_data = data;
+        warm->pending_mode = mode;
+    }
+    if (handle->transport && !LCD_PRE_PULSE_DELAY_US)
+    {
+        // No settle time to wait for, so the whole byte is one run. half_sent
+        // stays clear; a reset in the middle of the run leaves the controller
+        // out of step, which the warm start check finds.
+        uint8_t run[LCD_ENCODING_SEQ_LEN];
+
+        for (int i = 0; i < LCD_ENCODING_SEQ_LEN; ++i)
+            run[i] = seq[i] | ctrl;
+        LCD_GOTO_ON_ERROR(lcd_bus_write(handle, run, sizeof(run)), err);
+        if (handle->pacer)
+            handle->pacer->stats.bytes++;
+        return ESP_OK;
+    }
+    LCD_GOTO_ON_ERROR(lcd_write_nibble(handle, seq + LCD_ENCODING_HIGH, ctrl), err);
+    if (warm)
+        warm->half_sent = 1;
 
-    // Clock the data into the LCD
-    ESP_GOTO_ON_ERROR(
-        lcd_pulse_enable(handle, data),
-        err, TAG, "Error with lcd_pulse_enable()");
+    LCD_GOTO_ON_ERROR(lcd_write_nibble(handle, seq + LCD_ENCODING_LOW, ctrl), err);
+    if (warm)
+        warm->half_sent = 0;
+    if (handle->pacer)
+        handle->pacer->stats.bytes++;
 
     return ESP_OK;
 err:
-    ESP_LOGE(TAG, "lcd_write_nibble:%s", esp_err_to_name(ret));
     return ret;
 }
 
-static esp_err_t lcd_write_byte(const lcd_handle_t *handle, uint8_t data, uint8_t mode)
+esp_err_t lcd_hw_read_status(const lcd_handle_t *handle, uint8_t *status)
 {
-    esp_err_t ret;
+    esp_err_t ret = ESP_OK;
+    uint8_t high = 0;
+    uint8_t low = 0;
 
-    ESP_GOTO_ON_ERROR(
-        lcd_write_nibble(handle, data & 0xF0, mode),
-        err, TAG, "Error with lcd_write_nibble()");
+    LCD_GOTO_ON_ERROR(lcd_read_nibble(handle, &high), err);
+    LCD_GOTO_ON_ERROR(lcd_read_nibble(handle, &low), err);
+    *status = high | (low >> 4);
+    return ESP_OK;
+err:
+    return ret;
+}
+
+static esp_err_t lcd_read_nibble(const lcd_handle_t *handle, uint8_t *nibble)
+{
+    esp_err_t ret = ESP_OK;
+    const lcd_encoding_t *encoding = lcd_encoding(handle);
+    // Data lines high so the PCF8574's weak outputs let the controller drive them
+    uint8_t data = encoding->seq[0xFF][0] | encoding->mode[LCD_READ] | lcd_backlight_bits(handle);
+    uint8_t run[] = {data, data | encoding->enable};
+    uint8_t value = 0;
+
+    LCD_GOTO_ON_ERROR(lcd_bus_write(handle, run, sizeof(run)), err);
+    LCD_GOTO_ON_ERROR(lcd_bus_read(handle, &value), err);
+    LCD_GOTO_ON_ERROR(lcd_bus_write(handle, &data, 1), err);
+    *nibble = lcd_encoding_nibble(encoding, value);
+    return ESP_OK;
+err:
+    return ret;
+}
+
+static esp_err_t lcd_warm_resume(lcd_handle_t *handle)
+{
+    esp_err_t ret = ESP_OK;
+    lcd_warm_t *warm = handle->warm;
+
+    if (warm->half_sent)
+    {
+        uint8_t data = warm->pending_data;
+        bool slow = warm->pending_mode == LCD_COMMAND && data < LCD_ENTRY_MODE_SET;
+        uint8_t ctrl = lcd_encoding(handle)->mode[warm->pending_mode & (LCD_WRITE | LCD_READ)] |
+                       lcd_backlight_bits(handle);
+
+        LCD_GOTO_ON_ERROR(lcd_write_nibble(handle, lcd_encoding(handle)->seq[data] + LCD_ENCODING_LOW, ctrl), err);
+        warm->half_sent = 0;
+        lcd_delay_us(handle, slow ? LCD_HOME_EXEC_TIME_US : LCD_STD_EXEC_TIME_US);
+    }
 
-    ESP_GOTO_ON_ERROR(
-        lcd_write_nibble(handle, (data << 4) & 0xF0, mode),
-        err, TAG, "Error with lcd_write_nibble()");
+    LCD_GOTO_ON_ERROR(lcd_hw_check_in_step(handle), err);
 
+    handle->hw_display_function = warm->display_function;
+    handle->hw_display_control = warm->display_control;
+    handle->hw_display_mode = warm->display_mode;
+    handle->display_control |= LCD_DISPLAY_ON;
+    LCD_GOTO_ON_ERROR(lcd_hw_apply_state(handle), err);
+    // Set DDRAM Address takes 37 us where Return Home takes 1.52 ms
+    LCD_GOTO_ON_ERROR(lcd_hw_set_ddram_address(handle, 0, 0), err);
+    handle->cursor_column = 0;
+    handle->cursor_row = 0;
     return ESP_OK;
 err:
-    ESP_LOGE(TAG, "lcd_write_byte:%s", esp_err_to_name(ret));
     return ret;
 }
 
-static esp_err_t lcd_pulse_enable(const lcd_handle_t *handle, uint8_t data)
+static esp_err_t lcd_sleep_resume(lcd_handle_t *handle)
 {
     esp_err_t ret = ESP_OK;
 
-    ESP_GOTO_ON_ERROR(
-        lcd_i2c_write(I2C_MASTER_NUM, handle->address, data | LCD_ENABLE),
-        err, TAG, "Error with lcd_i2c_write()");
-    ets_delay_us(1); // enable pulse must be >450ns
-    ESP_GOTO_ON_ERROR(
-        lcd_i2c_write(I2C_MASTER_NUM, handle->address, data & ~LCD_ENABLE),
-        err, TAG, "Error with lcd_i2c_write()");
-    // 37us + 4us execution time for 270kHz oscillator frequency
-    ets_delay_us(LCD_STD_EXEC_TIME_US);
+    lcd_sleep_restore(handle);
+    LCD_GOTO_ON_ERROR(lcd_hw_check_in_step(handle), err);
+    lcd_warm_save(handle);
+    LCD_GOTO_ON_ERROR(lcd_hw_set_ddram_address(handle, handle->cursor_column, handle->cursor_row), err);
+    return ESP_OK;
+err:
+    return ret;
+}
+
+static esp_err_t lcd_hw_check_in_step(const lcd_handle_t *handle)
+{
+    esp_err_t ret = ESP_OK;
+    uint8_t status = 0;
+    uint8_t address;
+
+    LCD_GOTO_ON_ERROR(lcd_hw_read_status(handle, &status), err);
+    address = status & ~LCD_BUSY_FLAG;
+    if ((status & LCD_BUSY_FLAG) ||
+        !(address <= LCD_LINEONE + 0x27 || (address >= LCD_LINETWO && address <= LCD_LINETWO + 0x27)))
+    {
+        ret = ESP_ERR_INVALID_RESPONSE;
+        lcd_error_record(handle, LCD_ERROR_LAYER_CONTROLLER, ret, status);
+        goto err;
+    }
     return ESP_OK;
 err:
-    ESP_LOGE(TAG, "lcd_pulse_enable:%s", esp_err_to_name(ret));
     return ret;
 }
 
@@ -795,77 +1608,285 @@ esp_err_t lcd_probe(const lcd_handle_t *handle)
     esp_err_t ret = ESP_OK;
 
     ESP_GOTO_ON_FALSE(handle, ESP_ERR_INVALID_ARG, err, TAG, "Invalid argument");
-    return lcd_i2c_detect(handle->i2c_port, handle->address);
+    ret = lcd_hw_probe(handle);
+    switch (ret)
+    {
+    case ESP_OK:
+        ESP_LOGD(TAG, "LCD found at address 0x%x", handle->address);
+        return ESP_OK;
+
+    case ESP_ERR_NOT_FOUND:
+        ESP_LOGE(TAG, "LCD not found at address 0x%x", handle->address);
+        return ret;
+
+    default:
+        break;
+    }
 err:
     ESP_LOGE(TAG, "lcd_probe:%s", esp_err_to_name(ret));
     return ret;
 }
 
+esp_err_t lcd_hw_probe(const lcd_handle_t *handle)
+{
+    if (handle->transport)
+        return handle->transport->probe(handle->transport->ctx, handle->address);
+    return lcd_i2c_detect(handle);
+}
+
+/**
+ * @brief Run a command link once the port is free of other displays
+ */
+static esp_err_t lcd_i2c_run(const lcd_handle_t *handle, i2c_cmd_handle_t cmd, TickType_t ticks)
+{
+    esp_err_t ret = lcd_fault_port_take(handle);
+
+    if (ret != ESP_OK)
+        return ret;
+    ret = i2c_master_cmd_begin(handle->i2c_port, cmd, ticks);
+    lcd_fault_port_give(handle);
+    return ret;
+}
+
 /**
  * @brief check if LCD exists on the I2C bus
  *
- * @param[in] port I2C controller port
- * @param[in] address LCD address
+ * @param[in] handle LCD handle, giving the port, address and timeout
  * @return  - ESP_OK                Success
  *          - ESP_ERR_NOT_FOUND     LCD not found
  *          - ESP_ERR_INVALID_ARG   Parameter error
  *          - ESP_ERR_INVALID_STATE I2C driver not installed or not in master mode
  *          - ESP_ERR_TIMEOUT       Operation timeout because the bus is busy
  */
-static esp_err_t lcd_i2c_detect(i2c_port_t port, uint8_t address)
+static esp_err_t lcd_i2c_detect(const lcd_handle_t *handle)
 {
     esp_err_t ret = ESP_OK;
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
 
-    ret = lcd_i2c_write(port, address, 0);
-    switch (ret)
+    // Address only, so the expander outputs are left as they are
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (handle->address << 1) | WRITE_BIT, ACK_CHECK_EN);
+    i2c_master_stop(cmd);
+    ret = lcd_i2c_run(handle, cmd, lcd_fault_ticks(handle));
+    i2c_cmd_link_delete(cmd);
+    // Slave hasn't ACK the transfer
+    return ret == ESP_FAIL ? ESP_ERR_NOT_FOUND : ret;
+}
+
+static esp_err_t lcd_bus_write(const lcd_handle_t *handle, const uint8_t *data, size_t len)
+{
+    esp_err_t ret = ESP_OK;
+    size_t i = 0;
+
+    if (lcd_fault_offline(handle))
     {
-    case ESP_OK:
-        ESP_LOGD(TAG, "LCD found at address 0x%x", address);
-        break;
+        lcd_error_record(handle, LCD_ERROR_LAYER_OFFLINE, ESP_ERR_NOT_FOUND, data[0]);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (handle->transport)
+    {
+        // The run fails as a whole, and is recorded by its first byte
+        ret = lcd_transport_write(handle, data, len);
+    }
+    else
+    {
+        for (i = 0; i < len; ++i)
+        {
+            ret = lcd_i2c_write(handle, data[i]);
+            if (ret != ESP_OK)
+                break;
+            if ((data[i] & lcd_encoding(handle)->enable) && i + 1 < len)
+                ets_delay_us(1); // enable pulse must be >450ns
+        }
+    }
+    if (ret != ESP_OK)
+        lcd_error_record(handle, LCD_ERROR_LAYER_BUS_WRITE, ret, data[i]);
+    lcd_fault_result(handle, ret);
+    return ret;
+}
+
+/**
+ * @brief Write a run of expander bytes in one I2C transaction, or as one run
+ *        of the transport
+ */
+static esp_err_t lcd_bus_write_bulk(const lcd_handle_t *handle, const uint8_t *data, size_t len, uint32_t wire_us)
+{
+    esp_err_t ret = ESP_OK;
 
-    case ESP_FAIL: // Slave hasn't ACK the transfer
-        ESP_LOGE(TAG, "LCD not found at address 0x%x", address);
+    if (lcd_fault_offline(handle))
+    {
+        lcd_error_record(handle, LCD_ERROR_LAYER_OFFLINE, ESP_ERR_NOT_FOUND, data[0]);
         return ESP_ERR_NOT_FOUND;
+    }
+    if (handle->transport)
+        ret = lcd_transport_write(handle, data, len);
+    else
+        ret = lcd_i2c_write_bulk(handle, data, len, wire_us);
+    // Recorded by its first byte, as a transport run is
+    if (ret != ESP_OK)
+        lcd_error_record(handle, LCD_ERROR_LAYER_BUS_WRITE, ret, data[0]);
+    lcd_fault_result(handle, ret);
+    return ret;
+}
 
-    default:
-        ESP_LOGE(TAG, "ic2_detect:%s", esp_err_to_name(ret));
-        break;
+static esp_err_t lcd_bus_read(const lcd_handle_t *handle, uint8_t *data)
+{
+    esp_err_t ret = ESP_OK;
+
+    if (lcd_fault_offline(handle))
+    {
+        lcd_error_record(handle, LCD_ERROR_LAYER_OFFLINE, ESP_ERR_NOT_FOUND, 0);
+        return ESP_ERR_NOT_FOUND;
     }
+    if (handle->transport)
+        ret = lcd_transport_read(handle, data);
+    else
+        ret = lcd_i2c_read(handle, data);
+    if (ret != ESP_OK)
+        lcd_error_record(handle, LCD_ERROR_LAYER_BUS_READ, ret, 0);
+    lcd_fault_result(handle, ret);
     return ret;
 }
 
-static esp_err_t lcd_i2c_write(i2c_port_t port, uint8_t address, uint8_t data)
+/**
+ * @brief One attempt at reading the expander pins on the I2C driver
+ */
+static esp_err_t lcd_i2c_read_once(const lcd_handle_t *handle, uint8_t *data)
 {
     esp_err_t ret = ESP_OK;
+    int64_t start_us = lcd_stats_start();
     i2c_cmd_handle_t cmd = i2c_cmd_link_create();
 
-    ESP_GOTO_ON_ERROR(
-        i2c_master_start(cmd),
-        err, TAG, "Error with i2c_master_start()");
+    LCD_GOTO_ON_ERROR(i2c_master_start(cmd), err);
+    LCD_GOTO_ON_ERROR(i2c_master_write_byte(cmd, (handle->address << 1) | READ_BIT, ACK_CHECK_EN), err);
+    LCD_GOTO_ON_ERROR(i2c_master_read_byte(cmd, data, I2C_MASTER_LAST_NACK), err);
+    LCD_GOTO_ON_ERROR(i2c_master_stop(cmd), err);
+    ret = lcd_i2c_run(handle, cmd, lcd_fault_ticks(handle));
+    if (ret != ESP_OK)
+        goto err;
 
-    ESP_GOTO_ON_ERROR(
-        i2c_master_write_byte(cmd, (address << 1) | WRITE_BIT, ACK_CHECK_EN),
-        err, TAG, "Error with i2c_master_write_byte()");
+    i2c_cmd_link_delete(cmd);
+    lcd_stats_i2c(handle, ESP_OK, start_us, 1);
+    lcd_trace_record(handle, *data, LCD_TRACE_READ);
 
-    if (data != 0)
-    {
-        ESP_GOTO_ON_ERROR(
-            i2c_master_write_byte(cmd, data, ACK_CHECK_EN),
-            err, TAG, "Error with i2c_master_write_byte()");
-    }
+    return ESP_OK;
+err:
+    i2c_cmd_link_delete(cmd);
+    lcd_stats_i2c(handle, ret, start_us, 1);
+    lcd_trace_record(handle, 0, LCD_TRACE_READ | LCD_TRACE_ERROR);
+    return ret;
+}
 
-    ESP_GOTO_ON_ERROR(
-        i2c_master_stop(cmd),
-        err, TAG, "Error with i2c_master_stop()");
+static esp_err_t lcd_i2c_read(const lcd_handle_t *handle, uint8_t *data)
+{
+    esp_err_t ret;
+    uint8_t attempt = 0;
 
-    ESP_GOTO_ON_ERROR(
-        i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, 1000 / portTICK_PERIOD_MS),
-        err, TAG, "Error with i2c_master_cmd_begin()");
+    while ((ret = lcd_i2c_read_once(handle, data)) != ESP_OK && lcd_fault_retry(handle, ret, attempt++))
+        ;
+    return ret;
+}
+
+/**
+ * @brief One attempt at writing an expander byte on the I2C driver
+ */
+static esp_err_t lcd_i2c_write_once(const lcd_handle_t *handle, uint8_t data)
+{
+    esp_err_t ret = ESP_OK;
+    int64_t start_us = lcd_stats_start();
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+
+    LCD_GOTO_ON_ERROR(i2c_master_start(cmd), err);
+    LCD_GOTO_ON_ERROR(i2c_master_write_byte(cmd, (handle->address << 1) | WRITE_BIT, ACK_CHECK_EN), err);
+    // Every byte is significant, including 0: it is the state of all eight pins
+    LCD_GOTO_ON_ERROR(i2c_master_write_byte(cmd, data, ACK_CHECK_EN), err);
+    LCD_GOTO_ON_ERROR(i2c_master_stop(cmd), err);
+    ret = lcd_i2c_run(handle, cmd, lcd_fault_ticks(handle));
+    if (ret != ESP_OK)
+        goto err;
 
     i2c_cmd_link_delete(cmd);
+    lcd_stats_i2c(handle, ESP_OK, start_us, 1);
+    lcd_trace_record(handle, data, 0);
 
     return ESP_OK;
 err:
-    ESP_LOGE(TAG, "lcd_i2c_write:%s", esp_err_to_name(ret));
+    i2c_cmd_link_delete(cmd);
+    lcd_stats_i2c(handle, ret, start_us, 1);
+    lcd_trace_record(handle, data, LCD_TRACE_ERROR);
+    return ret;
+}
+
+static esp_err_t lcd_i2c_write(const lcd_handle_t *handle, uint8_t data)
+{
+    esp_err_t ret;
+    uint8_t attempt = 0;
+
+    // Writing the same pin state twice is harmless, whether or not the
+    // failed attempt reached the expander
+    while ((ret = lcd_i2c_write_once(handle, data)) != ESP_OK && lcd_fault_retry(handle, ret, attempt++))
+        ;
+    return ret;
+}
+
+/**
+ * @brief Write a run of expander bytes in one transaction on the I2C driver
+ *
+ * @details The PCF8574 sets its pins as it acknowledges each byte, so every
+ *          byte still lasts a byte time on the wire. A run that failed part
+ *          way is not sent again, as with a transport.
+ */
+static esp_err_t lcd_i2c_write_bulk(const lcd_handle_t *handle, const uint8_t *data, size_t len, uint32_t wire_us)
+{
+    esp_err_t ret = ESP_OK;
+    int64_t start_us = esp_timer_get_time();
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+
+    LCD_GOTO_ON_ERROR(i2c_master_start(cmd), err);
+    LCD_GOTO_ON_ERROR(i2c_master_write_byte(cmd, (handle->address << 1) | WRITE_BIT, ACK_CHECK_EN), err);
+    LCD_GOTO_ON_ERROR(i2c_master_write(cmd, data, len, ACK_CHECK_EN), err);
+    LCD_GOTO_ON_ERROR(i2c_master_stop(cmd), err);
+    ret = lcd_i2c_run(handle, cmd, lcd_fault_ticks(handle) + pdMS_TO_TICKS(wire_us / 1000 + 1));
+err:
+    i2c_cmd_link_delete(cmd);
+    lcd_stats_i2c_bulk(handle, ret, start_us, len);
+    lcd_trace_record_run(handle, data, len, ret == ESP_OK ? 0 : LCD_TRACE_ERROR, start_us);
+    return ret;
+}
+
+static esp_err_t lcd_transport_write(const lcd_handle_t *handle, const uint8_t *data, size_t len)
+{
+    esp_err_t ret;
+    uint8_t attempt = 0;
+    int64_t start_us;
+
+    // A run that failed part way is not sent again: the bytes that got
+    // through would clock the same nibble into the controller twice
+    do
+    {
+        start_us = esp_timer_get_time();
+        ret = handle->transport->write(handle->transport->ctx, handle->address, data, len);
+        lcd_stats_i2c(handle, ret, start_us, len);
+        lcd_trace_record_run(handle, data, len, ret == ESP_OK ? 0 : LCD_TRACE_ERROR, start_us);
+    } while (ret != ESP_OK && len == 1 && lcd_fault_retry(handle, ret, attempt++));
+    return ret;
+}
+
+static esp_err_t lcd_transport_read(const lcd_handle_t *handle, uint8_t *data)
+{
+    esp_err_t ret;
+    uint8_t attempt = 0;
+    int64_t start_us;
+
+    do
+    {
+        start_us = lcd_stats_start();
+        ret = handle->transport->read(handle->transport->ctx, handle->address, data);
+        lcd_stats_i2c(handle, ret, start_us, 1);
+        if (ret == ESP_OK)
+            lcd_trace_record(handle, *data, LCD_TRACE_READ);
+        else
+            lcd_trace_record(handle, 0, LCD_TRACE_READ | LCD_TRACE_ERROR);
+    } while (ret != ESP_OK && lcd_fault_retry(handle, ret, attempt++));
     return ret;
 }
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <esp_err.h>
+
+#include "hd44780/transport.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Transport to displays on a Linux I2C bus, through the i2c-dev interface.
+// Adapters that do plain I2C get each run of expander bytes as one I2C_RDWR
+// ioctl of one-byte messages. SMBus-only adapters, such as the kernel's
+// i2c-stub, get one SMBus send byte per expander byte.
+
+/**
+ * @brief Open an I2C bus for the displays on it
+ *
+ * @details Waits from then on take real time, see mock_clock_set_realtime().
+ *          Point handle->transport of every display on the bus at the
+ *          transport before lcd_init().
+ *
+ * @param[in] path Character device of the bus, e.g. "/dev/i2c-1"
+ * @param[out] transport The transport. Free it with lcd_i2cdev_close().
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_NOT_FOUND     Unable to open path
+ *          - ESP_ERR_NOT_SUPPORTED The adapter can neither do I2C nor SMBus byte transfers
+ *          - ESP_ERR_NO_MEM        Unable to allocate the transport
+ */
+esp_err_t lcd_i2cdev_open(const char *path, lcd_transport_t **transport);
+
+/**
+ * @brief Close a bus opened with lcd_i2cdev_open()
+ *
+ * @details The displays on it must no longer be used.
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ */
+esp_err_t lcd_i2cdev_close(lcd_transport_t *transport);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,234 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "i2c_mock.h"
+#include "lcd_i2cdev.h"
+
+// A run of expander bytes becomes one I2C_RDWR ioctl with a one-byte message
+// per expander byte, so the kernel puts them on the wire joined by repeated
+// starts and the run costs a single system call. Runs longer than the
+// kernel's limit on messages per ioctl are split. The SMBus path for
+// adapters without I2C_FUNC_I2C needs the address set with I2C_SLAVE first,
+// so the mutex keeps displays on the same bus from interleaving there.
+
+static const char *TAG = "LCD i2c-dev";
+
+#define LCD_I2CDEV_MAX_MSGS I2C_RDWR_IOCTL_MAX_MSGS /*!< Messages the kernel accepts in one I2C_RDWR */
+
+typedef struct
+{
+    lcd_transport_t transport; /*!< Handed out to the caller, ctx points back here */
+    int fd;
+    bool rdwr;                 /*!< The adapter does plain I2C, else SMBus byte transfers */
+    bool quick;                /*!< The adapter does SMBus quick commands, used to probe */
+    int slave;                 /*!< Address last set with I2C_SLAVE, or -1 */
+    SemaphoreHandle_t lock;
+} lcd_i2cdev_t;
+
+static esp_err_t lcd_i2cdev_write(void *ctx, uint8_t address, const uint8_t *data, size_t len);
+static esp_err_t lcd_i2cdev_read(void *ctx, uint8_t address, uint8_t *data);
+static esp_err_t lcd_i2cdev_probe(void *ctx, uint8_t address);
+
+/**
+ * @brief Translate the errno of a failed transfer
+ *
+ * @details Adapters report a missing acknowledge as ENXIO, EREMOTEIO or EIO,
+ *          see Documentation/i2c/fault-codes in the kernel.
+ */
+static esp_err_t lcd_i2cdev_error(int error)
+{
+    switch (error)
+    {
+    case ENXIO:
+    case EREMOTEIO:
+    case EIO:
+        return ESP_FAIL;
+    case ETIMEDOUT:
+    case EAGAIN:
+    case EBUSY:
+        return ESP_ERR_TIMEOUT;
+    default:
+        return ESP_ERR_INVALID_STATE;
+    }
+}
+
+/**
+ * @brief Address the SMBus transfers that follow to address. Lock held.
+ */
+static esp_err_t lcd_i2cdev_set_slave(lcd_i2cdev_t *bus, uint8_t address)
+{
+    if (bus->slave == address)
+        return ESP_OK;
+    if (ioctl(bus->fd, I2C_SLAVE, (unsigned long)address) < 0)
+    {
+        ESP_LOGE(TAG, "Unable to address 0x%x: %s", address, strerror(errno));
+        return ESP_ERR_INVALID_STATE;
+    }
+    bus->slave = address;
+    return ESP_OK;
+}
+
+/**
+ * @brief One SMBus transfer to the current slave. Lock held.
+ */
+static esp_err_t lcd_i2cdev_smbus(lcd_i2cdev_t *bus, uint8_t read_write, uint8_t command, uint32_t size,
+                                  union i2c_smbus_data *data)
+{
+    struct i2c_smbus_ioctl_data args = {
+        .read_write = read_write,
+        .command = command,
+        .size = size,
+        .data = data,
+    };
+
+    if (ioctl(bus->fd, I2C_SMBUS, &args) < 0)
+        return lcd_i2cdev_error(errno);
+    return ESP_OK;
+}
+
+esp_err_t lcd_i2cdev_open(const char *path, lcd_transport_t **transport)
+{
+    esp_err_t ret = ESP_OK;
+    lcd_i2cdev_t *bus = NULL;
+    unsigned long funcs = 0;
+
+    ESP_RETURN_ON_FALSE(path && transport, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    bus = calloc(1, sizeof(lcd_i2cdev_t));
+    ESP_RETURN_ON_FALSE(bus, ESP_ERR_NO_MEM, TAG, "Unable to allocate transport");
+    bus->slave = -1;
+    bus->fd = open(path, O_RDWR);
+    ESP_GOTO_ON_FALSE(bus->fd >= 0, ESP_ERR_NOT_FOUND, err, TAG, "Unable to open %s: %s", path, strerror(errno));
+    ESP_GOTO_ON_FALSE(ioctl(bus->fd, I2C_FUNCS, &funcs) >= 0, ESP_ERR_NOT_SUPPORTED, close_fd, TAG,
+                      "Unable to read the functions of %s: %s", path, strerror(errno));
+    bus->rdwr = funcs & I2C_FUNC_I2C;
+    bus->quick = funcs & I2C_FUNC_SMBUS_QUICK;
+    ESP_GOTO_ON_FALSE(bus->rdwr || (funcs & I2C_FUNC_SMBUS_BYTE) == I2C_FUNC_SMBUS_BYTE, ESP_ERR_NOT_SUPPORTED,
+                      close_fd, TAG, "%s does neither I2C nor SMBus byte transfers", path);
+    bus->lock = xSemaphoreCreateMutex();
+    ESP_GOTO_ON_FALSE(bus->lock, ESP_ERR_NO_MEM, close_fd, TAG, "Unable to create lock");
+
+    bus->transport.write = lcd_i2cdev_write;
+    bus->transport.read = lcd_i2cdev_read;
+    bus->transport.probe = lcd_i2cdev_probe;
+    bus->transport.ctx = bus;
+    // The display's execution times must really pass between instructions
+    mock_clock_set_realtime(true);
+    ESP_LOGD(TAG, "Opened %s for %s transfers", path, bus->rdwr ? "I2C" : "SMBus");
+    *transport = &bus->transport;
+    return ESP_OK;
+close_fd:
+    close(bus->fd);
+err:
+    free(bus);
+    return ret;
+}
+
+esp_err_t lcd_i2cdev_close(lcd_transport_t *transport)
+{
+    lcd_i2cdev_t *bus;
+
+    ESP_RETURN_ON_FALSE(transport && transport->write == lcd_i2cdev_write, ESP_ERR_INVALID_ARG, TAG,
+                        "Invalid argument");
+    bus = transport->ctx;
+    close(bus->fd);
+    vSemaphoreDelete(bus->lock);
+    free(bus);
+    return ESP_OK;
+}
+
+static esp_err_t lcd_i2cdev_write(void *ctx, uint8_t address, const uint8_t *data, size_t len)
+{
+    lcd_i2cdev_t *bus = ctx;
+    esp_err_t ret = ESP_OK;
+
+    if (bus->rdwr)
+    {
+        struct i2c_msg msgs[LCD_I2CDEV_MAX_MSGS];
+        uint8_t bytes[LCD_I2CDEV_MAX_MSGS];
+
+        while (len && ret == ESP_OK)
+        {
+            size_t n = len < LCD_I2CDEV_MAX_MSGS ? len : LCD_I2CDEV_MAX_MSGS;
+            struct i2c_rdwr_ioctl_data rdwr = {.msgs = msgs, .nmsgs = n};
+
+            memcpy(bytes, data, n);
+            for (size_t i = 0; i < n; ++i)
+            {
+                msgs[i].addr = address;
+                msgs[i].flags = 0;
+                msgs[i].len = 1;
+                msgs[i].buf = &bytes[i];
+            }
+            if (ioctl(bus->fd, I2C_RDWR, &rdwr) < 0)
+                ret = lcd_i2cdev_error(errno);
+            data += n;
+            len -= n;
+        }
+        return ret;
+    }
+
+    xSemaphoreTake(bus->lock, portMAX_DELAY);
+    ret = lcd_i2cdev_set_slave(bus, address);
+    for (size_t i = 0; i < len && ret == ESP_OK; ++i)
+        ret = lcd_i2cdev_smbus(bus, I2C_SMBUS_WRITE, data[i], I2C_SMBUS_BYTE, NULL);
+    xSemaphoreGive(bus->lock);
+    return ret;
+}
+
+static esp_err_t lcd_i2cdev_read(void *ctx, uint8_t address, uint8_t *data)
+{
+    lcd_i2cdev_t *bus = ctx;
+    esp_err_t ret = ESP_OK;
+    union i2c_smbus_data value;
+
+    if (bus->rdwr)
+    {
+        struct i2c_msg msg = {.addr = address, .flags = I2C_M_RD, .len = 1, .buf = data};
+        struct i2c_rdwr_ioctl_data rdwr = {.msgs = &msg, .nmsgs = 1};
+
+        if (ioctl(bus->fd, I2C_RDWR, &rdwr) < 0)
+            return lcd_i2cdev_error(errno);
+        return ESP_OK;
+    }
+
+    xSemaphoreTake(bus->lock, portMAX_DELAY);
+    ret = lcd_i2cdev_set_slave(bus, address);
+    if (ret == ESP_OK)
+        ret = lcd_i2cdev_smbus(bus, I2C_SMBUS_READ, 0, I2C_SMBUS_BYTE, &value);
+    xSemaphoreGive(bus->lock);
+    if (ret == ESP_OK)
+        *data = value.byte;
+    return ret;
+}
+
+static esp_err_t lcd_i2cdev_probe(void *ctx, uint8_t address)
+{
+    lcd_i2cdev_t *bus = ctx;
+    esp_err_t ret = ESP_OK;
+    uint8_t pins;
+
+    // A quick write is the address alone. Without it, reading the pins is
+    // the next best thing: it leaves the outputs as they are too.
+    if (bus->quick)
+    {
+        xSemaphoreTake(bus->lock, portMAX_DELAY);
+        ret = lcd_i2cdev_set_slave(bus, address);
+        if (ret == ESP_OK)
+            ret = lcd_i2cdev_smbus(bus, I2C_SMBUS_WRITE, 0, I2C_SMBUS_QUICK, NULL);
+        xSemaphoreGive(bus->lock);
+    }
+    else
+        ret = lcd_i2cdev_read(ctx, address, &pins);
+    return ret == ESP_FAIL ? ESP_ERR_NOT_FOUND : ret;
+}
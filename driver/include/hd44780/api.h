@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stddef.h>
 #include <esp_err.h>
 
 #include "fwd.h"
@@ -15,15 +16,41 @@ extern "C" {
  * @param[inout] lcd_handle Handle to be used for future interaction with the LCD panel
  *
  * @details I2C driver must be configured and installed prior to calling lcd_init().
+ *          With CONFIG_LCD_REFRESH_IN_INIT the refresh scheduler is then
+ *          enabled with LCD_REFRESH_DEFAULT_CONFIG(), see refresh.h.
  *
  * @return
  *          - ESP_OK                Success
  *          - ESP_ERR_INVALID_ARG   if parameter is invalid
  *          - ESP_ERR_INVALID_STATE I2C driver not installed or not in master mode
  *          - ESP_ERR_NOT_FOUND     if LCD not found at the io handle
+ *          - ESP_ERR_NO_MEM        Unable to enable the refresh scheduler. The display is initialised.
 */
 esp_err_t lcd_init(lcd_handle_t *lcd_handle);
 
+/**
+ * @brief Initialise several LCD panels together
+ *
+ * @details Equivalent to calling lcd_init() on each handle, but the displays
+ *          are stepped through the initialisation nibble by nibble in lockstep:
+ *          the reset delays, the execution times and the pre-pulse settle time
+ *          of each nibble are waited once for all of them rather than once per
+ *          display. Each extra display costs little more than its bytes on the
+ *          wire. Displays that fail are left uninitialised and do not stop the
+ *          others. I2C driver(s) must be configured and installed prior to
+ *          calling lcd_init_many().
+ *
+ * @param[inout] handles Handles to initialise
+ * @param[in] count Number of handles
+ *
+ * @return
+ *          - ESP_OK                Every display initialised
+ *          - ESP_ERR_INVALID_ARG   if parameter is invalid
+ *          - ESP_ERR_NO_MEM        Unable to allocate working state
+ *          - Otherwise, the error of the first display that failed, as lcd_init() reports it
+*/
+esp_err_t lcd_init_many(lcd_handle_t **handles, size_t count);
+
 /**
  * @brief Probe for existence of LCD at the specified address on the I2C bus
  *
@@ -84,7 +111,25 @@ esp_err_t lcd_write_char(lcd_handle_t *handle, char c);
  *          - ESP_ERR_INVALID_SIZE Write would cause screen display overflow
  *          - ESP error code propagated from error source
 */
-esp_err_t lcd_write_str(lcd_handle_t *handle, char *str);
+esp_err_t lcd_write_str(lcd_handle_t *handle, const char *str);
+
+/**
+ * @brief Write a run of characters to the LCD
+ *
+ * @details As lcd_write_str(), for characters that need not end in a NUL,
+ *          such as part of a longer string. A NUL among them is written as
+ *          CGRAM glyph 0.
+ *
+ * @param[inout] handle LCD handle. Cursor position details are updated
+ * @param[in] chars Characters to be written to the LCD starting at the current
+ *          cursor position
+ * @param[in] len Number of characters
+ *
+ * @return
+ *          - ESP_OK     Success
+ *          - ESP error code propagated from error source
+*/
+esp_err_t lcd_write_chars(lcd_handle_t *handle, const char *chars, size_t len);
 
 /**
  * @brief Move the cursor to a specified row and column
@@ -267,6 +312,25 @@ esp_err_t lcd_autoscroll(lcd_handle_t *handle);
 */
 esp_err_t lcd_no_autoscroll(lcd_handle_t *handle);
 
+/**
+ * @brief Send pending changes to the display
+ *
+ * @details Display control and entry mode changes (lcd_cursor(), lcd_blink(),
+ *          lcd_left_to_right() and friends) that leave the controller state as it
+ *          is are never sent. With CONFIG_LCD_DEFER_CONTROL the others are held in
+ *          the handle and sent as one instruction per flag group ahead of the next
+ *          instruction, or by this function. With the refresh scheduler enabled
+ *          this also flushes the frame buffer.
+ *
+ * @param[inout] handle LCD handle
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP error code propagated from error source
+*/
+esp_err_t lcd_flush(lcd_handle_t *handle);
+
 /*
 void lcd_createChar(uint8_t location, uint8_t charmap[]);
 */
@@ -274,6 +338,9 @@ void lcd_createChar(uint8_t location, uint8_t charmap[]);
 /**
  * @brief Enables backlight.
  *
+ * @details Only the backlight line of the I2C expander changes. No instruction
+ *          is sent to the controller, so this is cheap enough to call often.
+ *
  * @param[inout] handle Backlight element of the handle is updated.
  *
  * @return
@@ -285,6 +352,9 @@ esp_err_t lcd_backlight(lcd_handle_t *handle);
 /**
  * @brief Disables backlight.
  *
+ * @details Only the backlight line of the I2C expander changes. No instruction
+ *          is sent to the controller, so this is cheap enough to call often.
+ *
  * @param[inout] handle Backlight element of the handle is updated.
  *
  * @return
@@ -308,7 +378,7 @@ esp_err_t lcd_no_backlight(lcd_handle_t *handle);
  *          - ESP_ERR_INVALID_ARG   Invalid parameter
  *          - ESP error code propagated from error source
 */
-esp_err_t lcd_write_cgram(lcd_handle_t *handle, uint8_t location, uint8_t *charmap);
+esp_err_t lcd_write_cgram(lcd_handle_t *handle, uint8_t location, const uint8_t *charmap);
 
 
 #ifdef __cplusplus
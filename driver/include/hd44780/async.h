@@ -0,0 +1,152 @@
+#pragma once
+
+#include <stdint.h>
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "sdkconfig.h"
+
+#include "fwd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LCD_ASYNC_MAX_OPS CONFIG_LCD_ASYNC_MAX_OPS /*!< Number of operation tokens that can be outstanding at once. Set with menuconfig. */
+
+/**
+ * @brief Completion callback of an asynchronous operation
+ *
+ * @details Runs on whichever task drops the last reference to the token:
+ *          usually the display service task, but the submitting task when
+ *          the command was executed before the submitting call returned or
+ *          could not be queued, a task whose post discarded the command
+ *          under the drop-oldest policy, or the task deleting the service.
+ *          It must not block, and must not assume the service task's
+ *          context. The token is still valid while the callback runs.
+ *
+ * @param[in] op Operation token
+ * @param[in] result Result of the operation
+ * @param[in] arg User argument from lcd_async_completion_t
+ */
+typedef void (*lcd_async_cb_t)(lcd_async_op_t *op, esp_err_t result, void *arg);
+
+/**
+ * @brief How the completion of an asynchronous operation is signalled
+ *
+ * @details Any combination may be used. Whether or not any is set, the result
+ *          can always be collected with lcd_async_wait() while the token is held.
+ */
+typedef struct
+{
+    lcd_async_cb_t callback;  /*!< Called on completion, or NULL. */
+    void *arg;                /*!< Passed to callback. */
+    TaskHandle_t notify_task; /*!< Task notified on completion, or NULL. */
+    uint32_t notify_bits;     /*!< Bits set in the notification value of notify_task (eSetBits). */
+} lcd_async_completion_t;
+
+/**
+ * @brief Queue a string write and return immediately
+ *
+ * @details The handle must be attached to a display service. The operation
+ *          completes once the service task has executed every part of the
+ *          string, or with the first error met. With the refresh scheduler
+ *          enabled, completion means the frame buffer has been updated.
+ *
+ * @param[in] handle Attached LCD handle
+ * @param[in] str NUL terminated string to write at the current cursor position
+ * @param[in] completion Completion signalling, or NULL
+ * @param[out] op Operation token, to be released with lcd_async_release(). If
+ *                NULL, the token is released automatically on completion.
+ *
+ * @return
+ *          - ESP_OK                Operation accepted. Later errors are reported through the token.
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE Handle is not attached to a service
+ *          - ESP_ERR_NO_MEM        No free operation token
+ */
+esp_err_t lcd_write_str_async(lcd_handle_t *handle, const char *str,
+                              const lcd_async_completion_t *completion, lcd_async_op_t **op);
+
+/**
+ * @brief Queue a cursor move and return immediately
+ *
+ * @param[in] handle Attached LCD handle
+ * @param[in] col The column number to move the cursor to.
+ * @param[in] row The row number to move the cursor to.
+ * @param[in] completion Completion signalling, or NULL
+ * @param[out] op Operation token, or NULL to release it automatically
+ *
+ * @return
+ *          - ESP_OK                Operation accepted. Later errors are reported through the token.
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE Handle is not attached to a service
+ *          - ESP_ERR_NO_MEM        No free operation token
+ */
+esp_err_t lcd_set_cursor_async(lcd_handle_t *handle, uint8_t col, uint8_t row,
+                               const lcd_async_completion_t *completion, lcd_async_op_t **op);
+
+/**
+ * @brief Queue a display clear and return immediately
+ *
+ * @param[in] handle Attached LCD handle
+ * @param[in] completion Completion signalling, or NULL
+ * @param[out] op Operation token, or NULL to release it automatically
+ *
+ * @return
+ *          - ESP_OK                Operation accepted. Later errors are reported through the token.
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE Handle is not attached to a service
+ *          - ESP_ERR_NO_MEM        No free operation token
+ */
+esp_err_t lcd_clear_screen_async(lcd_handle_t *handle,
+                                 const lcd_async_completion_t *completion, lcd_async_op_t **op);
+
+/**
+ * @brief Queue a CGRAM write and return immediately
+ *
+ * @details The character bitmap is copied before the function returns.
+ *
+ * @param[in] handle Attached LCD handle
+ * @param[in] location The location in CGRAM.
+ * @param[in] charmap The character bitmap in form of byte array[8] (array[10] for 5x10 fonts).
+ * @param[in] completion Completion signalling, or NULL
+ * @param[out] op Operation token, or NULL to release it automatically
+ *
+ * @return
+ *          - ESP_OK                Operation accepted. Later errors are reported through the token.
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE Handle is not attached to a service
+ *          - ESP_ERR_NO_MEM        No free operation token
+ */
+esp_err_t lcd_write_cgram_async(lcd_handle_t *handle, uint8_t location, const uint8_t *charmap,
+                                const lcd_async_completion_t *completion, lcd_async_op_t **op);
+
+/**
+ * @brief Wait for an operation to complete
+ *
+ * @param[in] op Operation token
+ * @param[in] timeout_ms Maximum time to wait. 0 polls.
+ *
+ * @return
+ *          - ESP_ERR_TIMEOUT       Operation still in progress
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_NO_MEM        Operation discarded by the drop-oldest overflow policy
+ *          - ESP_ERR_INVALID_STATE Service deleted before the operation ran
+ *          - Otherwise, the result of the operation
+ */
+esp_err_t lcd_async_wait(lcd_async_op_t *op, uint32_t timeout_ms);
+
+/**
+ * @brief Return a token to the pool
+ *
+ * @details A token released before its operation completes is returned once the
+ *          operation completes; the completion callback and notification still fire.
+ *
+ * @param[in] op Operation token
+ */
+void lcd_async_release(lcd_async_op_t *op);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include "sdkconfig.h"
+
+#include "fwd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LCD_BACKLIGHT_LEVEL_MAX 255 /*!< Full brightness. 0 is off. */
+
+/**
+ * @brief Backlight dimming configuration
+ */
+typedef struct
+{
+    uint32_t period_us;  /*!< PWM period. Every period costs up to two expander writes. */
+    uint8_t level;       /*!< Brightness level to start at, 0 to LCD_BACKLIGHT_LEVEL_MAX. */
+    bool create_task;    /*!< Create a task that writes edges falling while the display is idle. Leave false when another component drives lcd_backlight_pwm_flush(). */
+    int core_id;         /*!< Core the dimming task is pinned to, or tskNO_AFFINITY. */
+    uint8_t priority;    /*!< FreeRTOS priority of the dimming task. */
+    uint32_t stack_size; /*!< Stack size of the dimming task in bytes. */
+} lcd_backlight_pwm_config_t;
+
+/**
+ * @brief Macro to set default backlight dimming configuration
+ *
+ * @details
+ *          - period_us = CONFIG_LCD_BACKLIGHT_PWM_PERIOD_US
+ *          - level = LCD_BACKLIGHT_LEVEL_MAX
+ *          - create_task = true
+ *          - core_id = tskNO_AFFINITY
+ *          - priority = CONFIG_LCD_BACKLIGHT_TASK_PRIORITY
+ *          - stack_size = CONFIG_LCD_BACKLIGHT_TASK_STACK_SIZE
+ */
+#define LCD_BACKLIGHT_PWM_DEFAULT_CONFIG()                  \
+    {                                                       \
+        .period_us = CONFIG_LCD_BACKLIGHT_PWM_PERIOD_US,    \
+        .level = LCD_BACKLIGHT_LEVEL_MAX,                   \
+        .create_task = true,                                \
+        .core_id = tskNO_AFFINITY,                          \
+        .priority = CONFIG_LCD_BACKLIGHT_TASK_PRIORITY,     \
+        .stack_size = CONFIG_LCD_BACKLIGHT_TASK_STACK_SIZE, \
+    }
+
+/**
+ * @brief Bus cost of the backlight dimming of a handle
+ *
+ * @details Edges that fall while the handle is busy sending text are not
+ *          written on their own. They ride on the next byte the text stream
+ *          writes to the expander, which carries the backlight bit anyway.
+ */
+typedef struct
+{
+    uint32_t edges;       /*!< Backlight line transitions since the statistics were reset */
+    uint32_t writes;      /*!< Expander writes made only to move the backlight line */
+    uint32_t piggybacked; /*!< Transitions carried by text writes instead */
+    uint64_t bus_us;      /*!< Time spent on the writes counted in writes */
+    uint64_t elapsed_us;  /*!< Time since the statistics were reset */
+} lcd_backlight_pwm_stats_t;
+
+/**
+ * @brief Enable software PWM dimming of the backlight
+ *
+ * @details The backlight bit (P3) of the I2C expander is switched by an
+ *          esp_timer at the start and in the middle of every period. At level 0
+ *          and LCD_BACKLIGHT_LEVEL_MAX the timer stops and the bus is not used.
+ *          lcd_backlight() and lcd_no_backlight() set these two levels.
+ *
+ *          The timer callback never touches the bus, so it does not hold up
+ *          other esp_timer callbacks. An edge is carried by the next byte the
+ *          driver writes, or by lcd_unlock(). Edges that fall while the display
+ *          is idle are written by the dimming task, or by
+ *          lcd_backlight_pwm_flush() when create_task is false.
+ *
+ * @param[inout] handle Initialised LCD handle
+ * @param[in] config Dimming configuration
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE LCD not initialised or dimming already enabled
+ *          - ESP_ERR_NO_MEM        Unable to allocate the dimming state or create the task
+ *          - ESP error code propagated from error source
+ */
+esp_err_t lcd_backlight_pwm_enable(lcd_handle_t *handle, const lcd_backlight_pwm_config_t *config);
+
+/**
+ * @brief Disable software PWM dimming
+ *
+ * @details The backlight is left fully on if the level was above 0, off otherwise.
+ *
+ * @param[inout] handle LCD handle
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP error code propagated from error source
+ */
+esp_err_t lcd_backlight_pwm_disable(lcd_handle_t *handle);
+
+/**
+ * @brief Write a dimming edge that has not reached the expander yet
+ *
+ * @details Only needed with create_task false. Call it at least twice per PWM
+ *          period, for instance from a loop that already services the display,
+ *          or the duty cycle follows the calls instead of the level.
+ *
+ * @param[inout] handle LCD handle with dimming enabled
+ *
+ * @return
+ *          - ESP_OK                Success, or no edge pending
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE Dimming not enabled
+ *          - ESP error code propagated from error source
+ */
+esp_err_t lcd_backlight_pwm_flush(lcd_handle_t *handle);
+
+/**
+ * @brief Set the backlight brightness at once, cancelling any fade in progress
+ *
+ * @param[inout] handle LCD handle with dimming enabled
+ * @param[in] level 0 (off) to LCD_BACKLIGHT_LEVEL_MAX (fully on)
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE Dimming not enabled
+ */
+esp_err_t lcd_backlight_set_level(lcd_handle_t *handle, uint8_t level);
+
+/**
+ * @brief Ramp the backlight brightness linearly to a new level
+ *
+ * @details Returns at once. The level is stepped at the start of each PWM
+ *          period by the dimming timer, so text updates are not held up.
+ *
+ * @param[inout] handle LCD handle with dimming enabled
+ * @param[in] level Level at the end of the fade
+ * @param[in] duration_ms Length of the fade. 0 behaves like lcd_backlight_set_level().
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE Dimming not enabled
+ */
+esp_err_t lcd_backlight_fade(lcd_handle_t *handle, uint8_t level, uint32_t duration_ms);
+
+/**
+ * @brief Current backlight brightness, including the progress of a fade
+ *
+ * @param[in] handle LCD handle
+ *
+ * @return The level, or 0 / LCD_BACKLIGHT_LEVEL_MAX from the on/off state if dimming is not enabled
+ */
+uint8_t lcd_backlight_get_level(const lcd_handle_t *handle);
+
+/**
+ * @brief Read and optionally reset the bus cost of the dimming
+ *
+ * @details Resetting, then reading again after a while at a fixed level,
+ *          measures the bus overhead of that level as bus_us / elapsed_us.
+ *
+ * @param[in] handle LCD handle with dimming enabled
+ * @param[out] stats Statistics since the last reset
+ * @param[in] reset Start a new measurement after reading
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE Dimming not enabled
+ */
+esp_err_t lcd_backlight_pwm_get_stats(lcd_handle_t *handle, lcd_backlight_pwm_stats_t *stats, bool reset);
+
+#ifdef __cplusplus
+}
+#endif
@@ -21,6 +21,8 @@
 #ifdef CONFIG_LCD_BACKLIGHT_OFF
 #define LCD_BACKLIGHT LCD_BACKLIGHT_OFF
 #endif
+#define LCD_I2C_TIMEOUT_MS CONFIG_LCD_I2C_TIMEOUT_MS /*!< Longest one I2C transaction may take. Set with menuconfig. */
+#define LCD_ERROR_BUDGET CONFIG_LCD_ERROR_BUDGET     /*!< Failed transactions in a row before a display is taken offline. Set with menuconfig. */
 
 /**
  * @brief Macro to set default LCD configuration
@@ -37,6 +39,25 @@
  *          - cursor_row = 0
  *          - backlight = LCD_BACKLIGHT
  *          - initialized = false
+ *          - service = NULL
+ *          - service_queued = 0
+ *          - refresh = NULL
+ *          - lock = NULL
+ *          - hw_display_function = 0
+ *          - hw_display_control = 0
+ *          - hw_display_mode = 0
+ *          - busy_until_us = 0
+ *          - backlight_pwm = NULL
+ *          - pacer = NULL
+ *          - warm = NULL
+ *          - sleep = NULL
+ *          - counters = NULL
+ *          - transport = NULL
+ *          - timeout_ms = LCD_I2C_TIMEOUT_MS
+ *          - error_budget = LCD_ERROR_BUDGET
+ *          - fault = NULL
+ *          - pinmap = NULL
+ *          - encoding = NULL
  */
 #define LCD_HANDLE_DEFAULT_CONFIG()                                         \
     {                                                                       \
@@ -51,4 +72,23 @@
         .cursor_row = 0,                                                    \
         .backlight = LCD_BACKLIGHT,                                         \
         .initialized = false,                                               \
+        .service = NULL,                                                    \
+        .service_queued = 0,                                                \
+        .refresh = NULL,                                                    \
+        .lock = NULL,                                                       \
+        .hw_display_function = 0,                                           \
+        .hw_display_control = 0,                                            \
+        .hw_display_mode = 0,                                               \
+        .busy_until_us = 0,                                                 \
+        .backlight_pwm = NULL,                                              \
+        .pacer = NULL,                                                      \
+        .warm = NULL,                                                       \
+        .sleep = NULL,                                                      \
+        .counters = NULL,                                                   \
+        .transport = NULL,                                                  \
+        .timeout_ms = LCD_I2C_TIMEOUT_MS,                                   \
+        .error_budget = LCD_ERROR_BUDGET,                                   \
+        .fault = NULL,                                                      \
+        .pinmap = NULL,                                                     \
+        .encoding = NULL,                                                   \
     }
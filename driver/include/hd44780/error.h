@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+#include "fwd.h"
+#include "stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Where a failure was found
+ */
+typedef enum
+{
+    LCD_ERROR_LAYER_NONE,       /*!< No failure recorded */
+    LCD_ERROR_LAYER_BUS_WRITE,  /*!< Writing an expander byte, retries included */
+    LCD_ERROR_LAYER_BUS_READ,   /*!< Reading the expander pins, retries included */
+    LCD_ERROR_LAYER_OFFLINE,    /*!< The display is offline, the bus was left alone */
+    LCD_ERROR_LAYER_CONTROLLER, /*!< The controller answered a status read out of step */
+} lcd_error_layer_t;
+
+/**
+ * @brief The failure behind a failed call
+ *
+ * @details The first failure of a call is recorded with what the driver was
+ *          doing at the time; what follows from it, like the display going
+ *          offline, is only counted.
+ */
+typedef struct
+{
+    esp_err_t code;          /*!< What the failing layer returned */
+    lcd_error_layer_t layer; /*!< Where it failed */
+    lcd_stats_api_t api;     /*!< Call that reported it, LCD_STATS_API_MAX while not yet reported */
+    uint8_t address;         /*!< I2C address of the display */
+    bool in_instruction;     /*!< An instruction or character was being sent */
+    bool data;               /*!< It was a character (RS high), else an instruction */
+    uint8_t instruction;     /*!< The instruction or character */
+    uint8_t expander;        /*!< The expander byte written, or the status read for LCD_ERROR_LAYER_CONTROLLER */
+    int64_t time_us;         /*!< esp_timer time of the failure */
+    uint32_t count;          /*!< Failures recorded since lcd_init(), those only counted included */
+} lcd_error_t;
+
+/**
+ * @brief Get the last failure recorded on a display
+ *
+ * @details The driver logs a failed call once, when it returns to the
+ *          application, and at most once per CONFIG_LCD_ERROR_LOG_INTERVAL_MS
+ *          for each display. Failures of an offline display are not logged.
+ *          The record is kept whether or not it was logged.
+ *
+ * @param[in] handle Initialised LCD handle
+ * @param[out] error The failure
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE LCD not initialised
+ *          - ESP_ERR_NOT_FOUND     Nothing has failed since lcd_init()
+ */
+esp_err_t lcd_get_last_error(lcd_handle_t *handle, lcd_error_t *error);
+
+/**
+ * @brief Name of an error layer, for logs and test output
+ */
+const char *lcd_error_layer_name(lcd_error_layer_t layer);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdbool.h>
+#include <driver/gpio.h>
+#include <driver/i2c.h>
+#include <esp_err.h>
+
+#include "fwd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Check whether a display is online
+ *
+ * @details A display goes offline when handle->error_budget transactions in a
+ *          row have failed. Calls that would use the bus then fail at once
+ *          with ESP_ERR_NOT_FOUND. Once CONFIG_LCD_REPROBE_INTERVAL_MS has
+ *          passed, the next instruction sent to it probes it instead. If it
+ *          answers, it is reset, set up as the handle says and cleared, and
+ *          is online again. The call that brought it back still fails, as
+ *          the display was reset under it. The contents of DDRAM and CGRAM
+ *          are lost, but a handle with the refresh scheduler enabled redraws
+ *          its frame.
+ *
+ * @param[in] handle LCD handle
+ *
+ * @return true if the display is online, or the handle is not initialised
+ */
+bool lcd_is_online(const lcd_handle_t *handle);
+
+/**
+ * @brief Probe an offline display now, and bring it back if it answers
+ *
+ * @details For applications that rather check on a display from a task of
+ *          their own than wait for its next use.
+ *
+ * @param[in] handle Initialised LCD handle
+ *
+ * @return
+ *          - ESP_OK                The display is online
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE LCD not initialised
+ *          - ESP_ERR_NOT_FOUND     The display is still offline
+ */
+esp_err_t lcd_reprobe(lcd_handle_t *handle);
+
+/**
+ * @brief Set the pins clocked to free a stuck bus on an I2C port
+ *
+ * @details With CONFIG_LCD_BUS_RECOVERY, a transaction that times out has
+ *          SCL clocked through the GPIO matrix until SDA is released. The
+ *          pins of I2C_MASTER_NUM are those set in menuconfig; other ports
+ *          are only recovered once their pins are set here.
+ *
+ * @param[in] port I2C controller port
+ * @param[in] sda_io_num GPIO of SDA, or -1 to leave the port alone
+ * @param[in] scl_io_num GPIO of SCL
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid port
+ */
+esp_err_t lcd_set_recovery_pins(i2c_port_t port, gpio_num_t sda_io_num, gpio_num_t scl_io_num);
+
+#ifdef __cplusplus
+}
+#endif
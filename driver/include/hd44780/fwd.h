@@ -1,5 +1,35 @@
 #pragma once
 
 struct lcd_handle_t;
+struct lcd_service_t;
+struct lcd_refresh_t;
+struct lcd_manager_t;
+struct lcd_async_op_t;
+struct lcd_backlight_pwm_t;
+struct lcd_pacer_t;
+struct lcd_warm_t;
+struct lcd_sleep_t;
+struct lcd_counters_t;
+struct lcd_transport_t;
+struct lcd_fault_t;
+struct lcd_pinmap_t;
+struct lcd_encoding_t;
+struct lcd_screen_t;
+struct lcd_glyph_pack_t;
 
-typedef struct lcd_handle_t lcd_handle_t;
\ No newline at end of file
+typedef struct lcd_handle_t lcd_handle_t;
+typedef struct lcd_service_t lcd_service_t;
+typedef struct lcd_refresh_t lcd_refresh_t;
+typedef struct lcd_manager_t lcd_manager_t;
+typedef struct lcd_async_op_t lcd_async_op_t;
+typedef struct lcd_backlight_pwm_t lcd_backlight_pwm_t;
+typedef struct lcd_pacer_t lcd_pacer_t;
+typedef struct lcd_warm_t lcd_warm_t;
+typedef struct lcd_sleep_t lcd_sleep_t;
+typedef struct lcd_counters_t lcd_counters_t;
+typedef struct lcd_transport_t lcd_transport_t;
+typedef struct lcd_fault_t lcd_fault_t;
+typedef struct lcd_pinmap_t lcd_pinmap_t;
+typedef struct lcd_encoding_t lcd_encoding_t;
+typedef struct lcd_screen_t lcd_screen_t;
+typedef struct lcd_glyph_pack_t lcd_glyph_pack_t;
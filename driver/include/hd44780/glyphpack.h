@@ -0,0 +1,171 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+#include "fwd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LCD_GLYPH_NAME_LEN 16 /*!< Longest glyph set name, terminator included */
+
+/**
+ * @brief Kind of content of a glyph set
+ */
+typedef enum
+{
+    LCD_GLYPH_SET_GLYPHS = 1,     /*!< CGRAM glyphs loaded together */
+    LCD_GLYPH_SET_BIG_DIGITS = 2, /*!< CGRAM glyphs and the cells that draw each symbol with them */
+    LCD_GLYPH_SET_ANIMATION = 3,  /*!< Frames of CGRAM glyphs, loaded one frame at a time */
+    LCD_GLYPH_SET_ROM_MAP = 4,    /*!< Character ROM code of each of the 256 byte values */
+} lcd_glyph_set_type_t;
+
+/**
+ * @brief A glyph set of a glyph pack
+ *
+ * @details Filled by lcd_glyph_pack_find(). The pointers are into the pack
+ *          itself, in flash for a pack in a partition, and stay valid until
+ *          the pack is closed.
+ */
+typedef struct
+{
+    lcd_glyph_set_type_t type; /*!< Kind of content */
+    uint8_t rows;              /*!< Rows of each glyph, 8 or 10. 0 for a ROM map. */
+    uint8_t glyphs;            /*!< Glyphs of the set, or of each frame of an animation */
+    uint8_t first;             /*!< CGRAM location the first glyph is loaded at */
+    uint8_t width;             /*!< Big digits: cells across each symbol */
+    uint8_t height;            /*!< Big digits: cells down each symbol */
+    uint16_t count;            /*!< Frames of an animation, symbols of big digits, 1 otherwise */
+    const uint8_t *bitmaps;    /*!< glyphs * rows bytes, count times for an animation. NULL for a ROM map. */
+    const char *symbols;       /*!< Big digits: the character each symbol draws, count of them */
+    const uint8_t *cells;      /*!< Big digits: width * height character codes per symbol, row by row. ROM map: 256 codes. */
+} lcd_glyph_set_t;
+
+/**
+ * @brief Map the glyph pack flashed into a data partition
+ *
+ * @details The pack is read where it is, through the flash cache, rather than
+ *          copied: glyph bitmaps cost no RAM and can be reflashed without
+ *          rebuilding the application. Its header, directory and checksum
+ *          are checked first. Packs are written by tools/lcd_glyph_pack.py.
+ *
+ * @param[in] label Label of the partition
+ * @param[out] pack Glyph pack, closed with lcd_glyph_pack_close()
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid argument
+ *          - ESP_ERR_NOT_FOUND     No data partition with that label
+ *          - ESP_ERR_INVALID_SIZE  The pack does not fit in the partition
+ *          - ESP_ERR_INVALID_VERSION Not a glyph pack, or one of another version
+ *          - ESP_ERR_INVALID_CRC   The pack is corrupt
+ *          - ESP_ERR_NO_MEM        Unable to allocate the pack
+ *          - ESP_ERR_NOT_SUPPORTED Glyph pack partitions disabled in menuconfig
+ *          - ESP error code propagated from error source
+ */
+esp_err_t lcd_glyph_pack_open(const char *label, lcd_glyph_pack_t **pack);
+
+/**
+ * @brief Use a glyph pack held in memory
+ *
+ * @details For a pack embedded in the application with EMBED_FILES or read
+ *          from a file system. The pack is checked as by lcd_glyph_pack_open()
+ *          and used in place, so data must outlive it.
+ *
+ * @param[in] data Glyph pack, 4-byte aligned
+ * @param[in] size Bytes at data, at least the size of the pack
+ * @param[out] pack Glyph pack, closed with lcd_glyph_pack_close()
+ *
+ * @return As lcd_glyph_pack_open()
+ */
+esp_err_t lcd_glyph_pack_open_buffer(const void *data, size_t size, lcd_glyph_pack_t **pack);
+
+/**
+ * @brief Close a glyph pack, unmapping its partition
+ *
+ * @details Glyph sets found in the pack are no longer valid.
+ *
+ * @param[in] pack Glyph pack, may be NULL
+ */
+void lcd_glyph_pack_close(lcd_glyph_pack_t *pack);
+
+/**
+ * @brief Find a glyph set by name
+ *
+ * @param[in] pack Glyph pack
+ * @param[in] name Name of the set
+ * @param[out] set The set
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid argument
+ *          - ESP_ERR_NOT_FOUND     No set of that name in the pack
+ */
+esp_err_t lcd_glyph_pack_find(const lcd_glyph_pack_t *pack, const char *name, lcd_glyph_set_t *set);
+
+/**
+ * @brief Load the glyphs of a set into CGRAM
+ *
+ * @details The glyphs go to CGRAM from the set's first location on, straight
+ *          from the pack, each with lcd_write_cgram(). The cursor is put back
+ *          where it was afterwards. Loading the next frame of an animation
+ *          changes every cell showing its glyphs at once.
+ *
+ * @param[inout] handle Initialised LCD handle, with a font of the set's glyph rows
+ * @param[in] set Glyph set other than a ROM map
+ * @param[in] frame Frame of an animation, 0 for other sets
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid argument, a ROM map, a frame out of range or glyphs of another font
+ *          - ESP error code propagated from error source
+ */
+esp_err_t lcd_glyph_set_load(lcd_handle_t *handle, const lcd_glyph_set_t *set, uint16_t frame);
+
+/**
+ * @brief Draw a big digit
+ *
+ * @details Writes the width * height cells of the symbol with its top left
+ *          cell at column, row. The set's glyphs must have been loaded with
+ *          lcd_glyph_set_load(). The cursor is left after the top right cell.
+ *
+ * @param[inout] handle Initialised LCD handle
+ * @param[in] set Big digit set
+ * @param[in] symbol Character to draw, one of the set's symbols
+ * @param[in] column Column of the top left cell
+ * @param[in] row Row of the top left cell
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid argument, not a big digit set, or a symbol that would not fit
+ *          - ESP_ERR_NOT_FOUND     The set has no such symbol
+ *          - ESP error code propagated from error source
+ */
+esp_err_t lcd_glyph_set_write_big(lcd_handle_t *handle, const lcd_glyph_set_t *set, char symbol, uint8_t column,
+                                  uint8_t row);
+
+/**
+ * @brief Write a string through a ROM map
+ *
+ * @details Each character is written as the character ROM code the map gives
+ *          it, so text in Latin-1 reaches a display whose ROM orders its
+ *          accented letters and symbols otherwise. UTF-8 sequences of code
+ *          points up to U+00FF count as the Latin-1 character.
+ *
+ * @param[inout] handle Initialised LCD handle
+ * @param[in] set ROM map
+ * @param[in] str String to write
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid argument or not a ROM map
+ *          - ESP error code propagated from error source
+ */
+esp_err_t lcd_glyph_set_write_str(lcd_handle_t *handle, const lcd_glyph_set_t *set, const char *str);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,6 +1,10 @@
 #pragma once
 
 #include <driver/i2c.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include "fwd.h"
 
 /**
  * @brief LCD handle
@@ -10,16 +14,35 @@
  */
 typedef struct lcd_handle_t
 {
-    i2c_port_t i2c_port;      /*!< I2C controller used. Must be populated prior to calling lcd_init(). */
-    uint8_t address;          /*!< Address of the LCD on the I2C bus. Must be populated prior to calling lcd_init(). */
-    uint8_t columns;          /*!< Number of columns. Must be populated prior to calling lcd_init(). */
-    uint8_t rows;             /*!< Number of rows. Must be populated prior to calling lcd_init(). */
-    uint8_t display_function; /*!< Current state of display function flag. Must be populated prior to calling lcd_init(). */
-    uint8_t display_control;  /*!< Current state of display control flag. Must be populated prior to calling lcd_init(). */
-    uint8_t display_mode;     /*!< Current state of display mode flag. Must be populated prior to calling lcd_init(). */
-    uint8_t cursor_column;    /*!< Current column position of cursor. First column is position 0. */
-    uint8_t cursor_row;       /*!< Current row position of cursor. First row is position 0. */
-    uint8_t backlight;        /*!< Current state of backlight. */
-    bool initialized;         /*!< Private flag to reflect initialization state. */
+    i2c_port_t i2c_port;                /*!< I2C controller used. Must be populated prior to calling lcd_init(). */
+    uint8_t address;                    /*!< Address of the LCD on the I2C bus. Must be populated prior to calling lcd_init(). */
+    uint8_t columns;                    /*!< Number of columns. Must be populated prior to calling lcd_init(). */
+    uint8_t rows;                       /*!< Number of rows. Must be populated prior to calling lcd_init(). */
+    uint8_t display_function;           /*!< Current state of display function flag. Must be populated prior to calling lcd_init(). */
+    uint8_t display_control;            /*!< Current state of display control flag. Must be populated prior to calling lcd_init(). */
+    uint8_t display_mode;               /*!< Current state of display mode flag. Must be populated prior to calling lcd_init(). */
+    uint8_t cursor_column;              /*!< Current column position of cursor. First column is position 0. */
+    uint8_t cursor_row;                 /*!< Current row position of cursor. First row is position 0. */
+    uint8_t backlight;                  /*!< Current state of backlight. */
+    bool initialized;                   /*!< Private flag to reflect initialization state. */
+    lcd_service_t *service;             /*!< Display service the handle is attached to, or NULL. See lcd_service_attach(). */
+    unsigned int service_queued;        /*!< Private. Commands of the handle queued on its service or being run. */
+    lcd_refresh_t *refresh;             /*!< Refresh scheduler state, or NULL. See lcd_refresh_enable(). */
+    SemaphoreHandle_t lock;             /*!< Private. Serialises bus access when the handle is shared between tasks. */
+    uint8_t hw_display_function;        /*!< Private. Display function flags last sent to the controller. */
+    uint8_t hw_display_control;         /*!< Private. Display control flags last sent to the controller. */
+    uint8_t hw_display_mode;            /*!< Private. Entry mode flags last sent to the controller. */
+    int64_t busy_until_us;              /*!< Private. Time at which the controller will have executed the last instruction sent. */
+    lcd_backlight_pwm_t *backlight_pwm; /*!< Backlight dimming state, or NULL. See lcd_backlight_pwm_enable(). */
+    lcd_pacer_t *pacer;                 /*!< Private. Wait timer and pacing statistics, created by lcd_init(). */
+    lcd_warm_t *warm;                   /*!< Private. Warm start record in RTC memory, or NULL. */
+    lcd_sleep_t *sleep;                 /*!< Private. Deep sleep snapshot in RTC memory, or NULL. */
+    lcd_counters_t *counters;           /*!< Private. Performance counters, or NULL. See lcd_get_stats(). */
+    const lcd_transport_t *transport;   /*!< Bus to the expander, or NULL for the I2C driver on i2c_port. Must outlive the handle. See transport.h. */
+    uint16_t timeout_ms;                /*!< Longest one I2C transaction may take. 0 takes CONFIG_LCD_I2C_TIMEOUT_MS. */
+    uint8_t error_budget;               /*!< Transactions in a row that may fail before the display is taken offline, 0 never. See fault.h. */
+    lcd_fault_t *fault;                 /*!< Private. Failure count, offline state and last error, created by lcd_init(). */
+    const lcd_pinmap_t *pinmap;         /*!< Wiring of the expander, or NULL for the menuconfig pin map. Read by lcd_init(). See pinmap.h. */
+    const lcd_encoding_t *encoding;     /*!< Private. Expander bytes of every byte value, built by lcd_init() from the pin map. */
 
 } lcd_handle_t;
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <stdint.h>
+#include <esp_err.h>
+#include <driver/i2c.h>
+#include <freertos/FreeRTOS.h>
+#include "sdkconfig.h"
+
+#include "fwd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LCD_MANAGER_MAX_DISPLAYS CONFIG_LCD_MANAGER_MAX_DISPLAYS /*!< Maximum number of displays one manager can own. Set with menuconfig. */
+
+/**
+ * @brief Display manager configuration
+ */
+typedef struct
+{
+    uint8_t max_fps;          /*!< Maximum number of flush passes per second on each bus. */
+    uint16_t display_budget;  /*!< Default number of cells a display may send per round-robin turn. */
+    bool create_task;         /*!< Create a flush task per I2C port in use. Leave false to drive the buses with lcd_manager_flush(). */
+    int core_id;              /*!< Core the bus tasks are pinned to, or tskNO_AFFINITY. */
+    uint8_t priority;         /*!< FreeRTOS priority of the bus tasks. */
+    uint32_t stack_size;      /*!< Stack size of each bus task in bytes. */
+} lcd_manager_config_t;
+
+/**
+ * @brief Macro to set default display manager configuration
+ *
+ * @details
+ *          - max_fps = CONFIG_LCD_REFRESH_MAX_FPS
+ *          - display_budget = CONFIG_LCD_MANAGER_DISPLAY_BUDGET
+ *          - create_task = true
+ *          - core_id = tskNO_AFFINITY
+ *          - priority = CONFIG_LCD_MANAGER_TASK_PRIORITY
+ *          - stack_size = CONFIG_LCD_MANAGER_TASK_STACK_SIZE
+ */
+#define LCD_MANAGER_DEFAULT_CONFIG()                            \
+    {                                                           \
+        .max_fps = CONFIG_LCD_REFRESH_MAX_FPS,                  \
+        .display_budget = CONFIG_LCD_MANAGER_DISPLAY_BUDGET,    \
+        .create_task = true,                                    \
+        .core_id = tskNO_AFFINITY,                              \
+        .priority = CONFIG_LCD_MANAGER_TASK_PRIORITY,           \
+        .stack_size = CONFIG_LCD_MANAGER_TASK_STACK_SIZE,       \
+    }
+
+/**
+ * @brief Per display scheduling status
+ */
+typedef struct
+{
+    i2c_port_t i2c_port;    /*!< I2C controller the display is on */
+    uint8_t address;        /*!< Address of the display on the I2C bus */
+    uint16_t budget;        /*!< Cells the display may send per round-robin turn */
+    uint16_t pending;       /*!< Cells whose latest value has not reached the display yet */
+    int64_t staleness_us;   /*!< Age of the oldest change not yet on the display, 0 if none */
+    uint32_t cells_sent;    /*!< Cells sent since the display was added */
+    uint32_t turns;         /*!< Round-robin turns in which the display sent at least one cell */
+    esp_err_t last_error;   /*!< Result of the most recent flush */
+} lcd_manager_status_t;
+
+/**
+ * @brief Create a display manager
+ *
+ * @details The manager owns the handles of the displays added to it, initialises
+ *          them, and runs one flush task per I2C port in use. Each bus task serves
+ *          its displays round-robin, letting every display send at most its budget
+ *          of cells per turn, so that one busy display cannot starve the others.
+ *
+ * @param[in] config Manager configuration
+ * @param[out] manager Created manager
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_NO_MEM        Unable to allocate the manager
+ */
+esp_err_t lcd_manager_create(const lcd_manager_config_t *config, lcd_manager_t **manager);
+
+/**
+ * @brief Remove every display, stop the bus tasks and release the manager
+ *
+ * @param[in] manager Manager to delete
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ */
+esp_err_t lcd_manager_delete(lcd_manager_t *manager);
+
+/**
+ * @brief Initialise a display and place it under the manager's control
+ *
+ * @details The configuration is copied into a handle owned by the manager. The
+ *          display is initialised and its refresh scheduler enabled, so the
+ *          returned handle can be used with lcd_write_str() and friends, which only
+ *          update its frame buffer. The manager sends the changes.
+ *
+ * @param[in] manager Manager
+ * @param[in] config LCD configuration, e.g. from LCD_HANDLE_DEFAULT_CONFIG()
+ * @param[in] budget Cells the display may send per turn. 0 selects the manager default.
+ * @param[out] handle Handle owned by the manager
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE A display with the same port and address is already managed
+ *          - ESP_ERR_NO_MEM        Manager full or unable to start the bus task
+ *          - ESP error code propagated from lcd_init()
+ */
+esp_err_t lcd_manager_add(lcd_manager_t *manager, const lcd_handle_t *config, uint16_t budget,
+                          lcd_handle_t **handle);
+
+/**
+ * @brief Send the pending changes of the displays on one I2C port
+ *
+ * @details Serves the displays of the port in rounds, as a bus task does,
+ *          until a round sends nothing. For managers created with create_task
+ *          false, which have no bus tasks. Failures are reported per display
+ *          by lcd_manager_get_status().
+ *
+ * @param[in] manager Manager
+ * @param[in] port I2C controller
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ */
+esp_err_t lcd_manager_flush(lcd_manager_t *manager, i2c_port_t port);
+
+/**
+ * @brief Flush a display and release it from the manager
+ *
+ * @param[in] manager Manager
+ * @param[in] handle Handle returned by lcd_manager_add()
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_NOT_FOUND     Handle not owned by this manager
+ */
+esp_err_t lcd_manager_remove(lcd_manager_t *manager, lcd_handle_t *handle);
+
+/**
+ * @brief Find a managed display by bus location
+ *
+ * @param[in] manager Manager
+ * @param[in] port I2C controller
+ * @param[in] address Address of the display on the I2C bus
+ *
+ * @return The managed handle, or NULL if there is none
+ */
+lcd_handle_t *lcd_manager_find(lcd_manager_t *manager, i2c_port_t port, uint8_t address);
+
+/**
+ * @brief Change the number of cells a display may send per turn
+ *
+ * @param[in] manager Manager
+ * @param[in] handle Managed handle
+ * @param[in] budget Cells per turn. 0 selects the manager default.
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_NOT_FOUND     Handle not owned by this manager
+ */
+esp_err_t lcd_manager_set_budget(lcd_manager_t *manager, lcd_handle_t *handle, uint16_t budget);
+
+/**
+ * @brief Report queue depth, staleness and throughput of a managed display
+ *
+ * @param[in] manager Manager
+ * @param[in] handle Managed handle
+ * @param[out] status Display status
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_NOT_FOUND     Handle not owned by this manager
+ */
+esp_err_t lcd_manager_get_status(lcd_manager_t *manager, const lcd_handle_t *handle,
+                                 lcd_manager_status_t *status);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+#include "fwd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Where the time a handle waited on the display went
+ *
+ * @details Waits shorter than the yield threshold spin and keep the CPU.
+ *          Longer ones block the calling task and leave the CPU to others.
+ *          spin_us / bytes is the CPU time spent waiting per byte sent.
+ */
+typedef struct
+{
+    uint32_t bytes;    /*!< Bytes (characters and instructions) sent to the controller */
+    uint32_t spins;    /*!< Waits spent spinning */
+    uint32_t yields;   /*!< Waits spent blocked */
+    uint64_t spin_us;  /*!< CPU time spent spinning */
+    uint64_t yield_us; /*!< Time spent blocked, CPU free for other tasks */
+} lcd_pacing_stats_t;
+
+/**
+ * @brief Read and optionally reset the pacing statistics of a handle
+ *
+ * @param[in] handle Initialised LCD handle
+ * @param[out] stats Statistics since lcd_init() or the last reset
+ * @param[in] reset Start a new measurement after reading
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE LCD not initialised
+ */
+esp_err_t lcd_pacing_get_stats(lcd_handle_t *handle, lcd_pacing_stats_t *stats, bool reset);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include "sdkconfig.h"
+
+#include "fwd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Wiring of the PCF8574 to the LCD
+ *
+ * @details Each field is the expander pin, 0 for P0 to 7 for P7, wired to
+ *          an LCD line. Every line needs a pin of its own. Most backpacks are
+ *          wired as LCD_PINMAP_DEFAULT_CONFIG() with the menuconfig defaults;
+ *          point handle->pinmap at one of these before lcd_init() for a
+ *          display that is wired otherwise. lcd_init() builds the expander
+ *          bytes of all 256 byte values from it once, so the pin map costs
+ *          nothing per character.
+ */
+typedef struct lcd_pinmap_t
+{
+    uint8_t rs; /*!< Register select */
+    uint8_t rw; /*!< Read/write */
+    uint8_t en; /*!< Enable */
+    uint8_t bl; /*!< Backlight */
+    uint8_t d4; /*!< Data line D4 */
+    uint8_t d5; /*!< Data line D5 */
+    uint8_t d6; /*!< Data line D6 */
+    uint8_t d7; /*!< Data line D7 */
+} lcd_pinmap_t;
+
+/**
+ * @brief Pin map set with menuconfig, the one used by handles without a pin map
+ */
+#define LCD_PINMAP_DEFAULT_CONFIG() \
+    {                               \
+        .rs = CONFIG_LCD_PIN_RS,    \
+        .rw = CONFIG_LCD_PIN_RW,    \
+        .en = CONFIG_LCD_PIN_E,     \
+        .bl = CONFIG_LCD_PIN_BL,    \
+        .d4 = CONFIG_LCD_PIN_D4,    \
+        .d5 = CONFIG_LCD_PIN_D5,    \
+        .d6 = CONFIG_LCD_PIN_D6,    \
+        .d7 = CONFIG_LCD_PIN_D7,    \
+    }
+
+#ifdef __cplusplus
+}
+#endif
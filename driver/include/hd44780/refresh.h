@@ -0,0 +1,128 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include "sdkconfig.h"
+
+#include "fwd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LCD_REFRESH_PRIORITY_NORMAL 0                                /*!< Default priority of every cell */
+#define LCD_REFRESH_PRIORITY_URGENT CONFIG_LCD_REFRESH_URGENT_PRIORITY /*!< Cells at or above this priority bypass the frame-rate cap */
+
+/**
+ * @brief Refresh scheduler configuration
+ */
+typedef struct
+{
+    uint8_t max_fps;     /*!< Maximum number of flushes per second. */
+    bool create_task;    /*!< Create a flush task for this handle. Leave false when another component drives lcd_refresh_flush(). */
+    int core_id;         /*!< Core the flush task is pinned to, or tskNO_AFFINITY. */
+    uint8_t priority;    /*!< FreeRTOS priority of the flush task. */
+    uint32_t stack_size; /*!< Stack size of the flush task in bytes. */
+} lcd_refresh_config_t;
+
+/**
+ * @brief Macro to set default refresh scheduler configuration
+ *
+ * @details
+ *          - max_fps = CONFIG_LCD_REFRESH_MAX_FPS
+ *          - create_task = true
+ *          - core_id = tskNO_AFFINITY
+ *          - priority = CONFIG_LCD_REFRESH_TASK_PRIORITY
+ *          - stack_size = CONFIG_LCD_REFRESH_TASK_STACK_SIZE
+ */
+#define LCD_REFRESH_DEFAULT_CONFIG()                        \
+    {                                                       \
+        .max_fps = CONFIG_LCD_REFRESH_MAX_FPS,              \
+        .create_task = true,                                \
+        .core_id = tskNO_AFFINITY,                          \
+        .priority = CONFIG_LCD_REFRESH_TASK_PRIORITY,       \
+        .stack_size = CONFIG_LCD_REFRESH_TASK_STACK_SIZE,   \
+    }
+
+/**
+ * @brief Enable the refresh scheduler on an initialised LCD handle
+ *
+ * @details Once enabled, lcd_write_char(), lcd_write_str(), lcd_set_cursor() and
+ *          lcd_clear_screen() only update a frame buffer held beside the handle and
+ *          return without touching the bus. Repeated writes to the same cell are
+ *          coalesced so that only the latest value is sent, and the display is
+ *          updated at most max_fps times per second with the cells that actually
+ *          changed. The display is cleared once when the scheduler is enabled.
+ *
+ * @param[inout] handle LCD handle
+ * @param[in] config Refresh scheduler configuration
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE LCD not initialised or scheduler already enabled
+ *          - ESP_ERR_NO_MEM        Unable to allocate the frame buffer or task
+ *          - ESP error code propagated from error source
+ */
+esp_err_t lcd_refresh_enable(lcd_handle_t *handle, const lcd_refresh_config_t *config);
+
+/**
+ * @brief Flush outstanding changes and disable the refresh scheduler
+ *
+ * @param[inout] handle LCD handle
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP error code propagated from error source
+ */
+esp_err_t lcd_refresh_disable(lcd_handle_t *handle);
+
+/**
+ * @brief Assign a priority to a run of cells
+ *
+ * @details Dirty cells are flushed in descending priority order. Writing to a cell
+ *          whose priority is at least LCD_REFRESH_PRIORITY_URGENT wakes the flush
+ *          task immediately instead of waiting for the next frame slot.
+ *
+ * @param[inout] handle LCD handle
+ * @param[in] col First column of the region
+ * @param[in] row Row of the region
+ * @param[in] len Number of cells in the region. Clipped at the end of the row.
+ * @param[in] priority Priority of the region
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE Refresh scheduler not enabled
+ */
+esp_err_t lcd_refresh_set_region_priority(lcd_handle_t *handle, uint8_t col, uint8_t row,
+                                          uint8_t len, uint8_t priority);
+
+/**
+ * @brief Send every pending change to the display now
+ *
+ * @param[inout] handle LCD handle
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE Refresh scheduler not enabled
+ *          - ESP error code propagated from error source
+ */
+esp_err_t lcd_refresh_flush(lcd_handle_t *handle);
+
+/**
+ * @brief Number of cells whose latest value has not reached the display yet
+ *
+ * @param[in] handle LCD handle
+ *
+ * @return Number of dirty cells, 0 if the refresh scheduler is not enabled
+ */
+uint16_t lcd_refresh_pending(const lcd_handle_t *handle);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+#include "fwd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LCD_SCREEN_MAX_ROWS 4           /*!< Rows an HD44780 display has at most */
+#define LCD_SCREEN_CGRAM_ALIAS 8        /*!< Codes 8 to 15 show CGRAM glyphs 0 to 7 and, unlike 0, fit in a C string */
+
+/**
+ * @brief Content of a constant screen, such as a menu page or a splash screen
+ */
+typedef struct
+{
+    const char *lines[LCD_SCREEN_MAX_ROWS]; /*!< Text of each row, or NULL for a blank row. Short rows are padded with blanks, long ones cut. Use LCD_SCREEN_CGRAM_ALIAS + n for glyph n. */
+    const uint8_t *glyphs;                  /*!< glyph_count glyphs of 8 rows each, 10 with the 5x10 font, loaded into CGRAM from glyph 0 on. May be NULL. */
+    uint8_t glyph_count;                    /*!< Number of glyphs, at most 8 */
+    uint8_t cursor_column;                  /*!< Where the cursor is left */
+    uint8_t cursor_row;                     /*!< Where the cursor is left */
+    bool cursor;                            /*!< Show the underline cursor */
+    bool blink;                             /*!< Blink the cursor cell */
+    uint32_t clk_speed;                     /*!< I2C clock the screen is shown at, 0 for CONFIG_I2C_CLK_FREQ. See lcd_screen_compile(). */
+} lcd_screen_desc_t;
+
+/**
+ * @brief Compile a screen into the expander bytes that draw it
+ *
+ * @details The whole screen, every cell of every row, the glyphs and the
+ *          cursor, is encoded once for the wiring and geometry of the handle,
+ *          six expander bytes per instruction. Compile the screens of a menu
+ *          once, at start up or the first time each is shown, and keep them.
+ *
+ *          With a settle time (CONFIG_LCD_PRE_PULSE_DELAY_US, 1000 us by
+ *          default), lcd_screen_show() sends one short write per nibble, the
+ *          enable pulse of one and the data byte of the next, and waits the
+ *          settle time on the pacing timer in between, which also covers the
+ *          execution time. That is one transaction per nibble where
+ *          lcd_write_str() takes three, and the bus and the CPU are free
+ *          while it waits, but the settle times still set the pace and a 20x4
+ *          screen takes nearly as long as with lcd_write_str(). clk_speed is
+ *          then not used.
+ *
+ *          Only with the settle time set to 0 does lcd_screen_show() send the
+ *          screen in a single I2C transaction with no waits, as fast as the
+ *          bus clock allows. The controller needs about 40 us to execute
+ *          each byte. At clk_speed the expander bytes of the next instruction
+ *          take at least that long; above about 450 kHz pad bytes, repeating
+ *          the pins as they are, are added to make up the difference. A
+ *          screen compiled for a clock is only safe at that clock or slower.
+ *
+ *          The handle need not be initialised, but one with its own pin map
+ *          must be, so that the pin map is checked and encoded.
+ *
+ * @param[in] handle Display the screen is for, or one like it
+ * @param[in] desc Content of the screen, not needed afterwards
+ * @param[out] screen Compiled screen, freed with lcd_screen_free()
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid argument, cursor or glyph count
+ *          - ESP_ERR_INVALID_STATE A pin map that lcd_init() has not encoded yet
+ *          - ESP_ERR_NO_MEM        Unable to allocate the screen
+ */
+esp_err_t lcd_screen_compile(const lcd_handle_t *handle, const lcd_screen_desc_t *desc, lcd_screen_t **screen);
+
+/**
+ * @brief Show a compiled screen
+ *
+ * @details Sends the screen nibble by nibble with the settle time waited in
+ *          between, or without a settle time as one I2C transaction or one
+ *          run of the handle's transport, see lcd_screen_compile(). The display is left in left-to-right entry
+ *          mode without autoscroll, with the cursor of the screen. A display
+ *          shift is not undone, call lcd_home() first if the display was
+ *          shifted. With the refresh scheduler enabled the frame buffer takes
+ *          the screen's content, so only cells written afterwards are sent.
+ *
+ *          A transaction that fails part way is not sent again. A display
+ *          that stops answering in the middle of one is reset when it comes
+ *          back, see fault.h.
+ *
+ * @param[in] handle Initialised LCD handle
+ * @param[in] screen Screen compiled for a display of the same geometry and wiring
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid argument, or a screen compiled for another geometry or wiring
+ *          - ESP_ERR_INVALID_STATE LCD not initialised
+ *          - ESP error code propagated from error source
+ */
+esp_err_t lcd_screen_show(lcd_handle_t *handle, const lcd_screen_t *screen);
+
+/**
+ * @brief Expander bytes of a compiled screen
+ *
+ * @return Bytes sent by lcd_screen_show(), pad bytes included, or 0 for NULL
+ */
+size_t lcd_screen_size(const lcd_screen_t *screen);
+
+/**
+ * @brief Free a screen compiled by lcd_screen_compile()
+ *
+ * @param[in] screen Screen, may be NULL
+ */
+void lcd_screen_free(lcd_screen_t *screen);
+
+#ifdef __cplusplus
+}
+#endif
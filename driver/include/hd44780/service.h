@@ -0,0 +1,282 @@
+#pragma once
+
+#include <stdint.h>
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include "sdkconfig.h"
+
+#include "fwd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LCD_SERVICE_TEXT_LEN 20 /*!< Maximum number of characters carried by a single queued write command */
+
+/**
+ * @brief Behaviour of the service queue when a producer finds it full
+ */
+typedef enum
+{
+    LCD_SERVICE_OVERFLOW_DROP_OLDEST = 0, /*!< Discard the oldest queued command to make room */
+    LCD_SERVICE_OVERFLOW_BLOCK,           /*!< Wait (up to block_timeout_ms) for the service task to make room */
+} lcd_service_overflow_t;
+
+/**
+ * @brief Display service configuration
+ */
+typedef struct
+{
+    uint16_t queue_depth;            /*!< Number of command slots. Rounded up to a power of two. */
+    lcd_service_overflow_t overflow; /*!< Policy applied when the queue is full. */
+    uint32_t block_timeout_ms;       /*!< Maximum time a producer waits for room with LCD_SERVICE_OVERFLOW_BLOCK. */
+    bool create_task;                /*!< Create the service task. Leave false to run the queued commands with lcd_service_flush(). */
+    int core_id;                     /*!< Core the service task is pinned to, or tskNO_AFFINITY. */
+    uint8_t priority;                /*!< FreeRTOS priority of the service task. */
+    uint32_t stack_size;             /*!< Stack size of the service task in bytes. */
+} lcd_service_config_t;
+
+#ifdef CONFIG_LCD_SERVICE_OVERFLOW_BLOCK
+#define LCD_SERVICE_OVERFLOW LCD_SERVICE_OVERFLOW_BLOCK /*!< Queue overflow policy. Set with menuconfig. */
+#else
+#define LCD_SERVICE_OVERFLOW LCD_SERVICE_OVERFLOW_DROP_OLDEST /*!< Queue overflow policy. Set with menuconfig. */
+#endif
+
+#if CONFIG_LCD_SERVICE_TASK_CORE < 0
+#define LCD_SERVICE_TASK_CORE tskNO_AFFINITY /*!< Core affinity of the service task. Set with menuconfig. */
+#else
+#define LCD_SERVICE_TASK_CORE CONFIG_LCD_SERVICE_TASK_CORE /*!< Core affinity of the service task. Set with menuconfig. */
+#endif
+
+/**
+ * @brief Macro to set default display service configuration
+ *
+ * @details
+ *          - queue_depth = CONFIG_LCD_SERVICE_QUEUE_DEPTH
+ *          - overflow = LCD_SERVICE_OVERFLOW
+ *          - block_timeout_ms = CONFIG_LCD_SERVICE_BLOCK_TIMEOUT_MS
+ *          - create_task = true
+ *          - core_id = LCD_SERVICE_TASK_CORE
+ *          - priority = CONFIG_LCD_SERVICE_TASK_PRIORITY
+ *          - stack_size = CONFIG_LCD_SERVICE_TASK_STACK_SIZE
+ */
+#define LCD_SERVICE_DEFAULT_CONFIG()                              \
+    {                                                             \
+        .queue_depth = CONFIG_LCD_SERVICE_QUEUE_DEPTH,            \
+        .overflow = LCD_SERVICE_OVERFLOW,                         \
+        .block_timeout_ms = CONFIG_LCD_SERVICE_BLOCK_TIMEOUT_MS,  \
+        .create_task = true,                                      \
+        .core_id = LCD_SERVICE_TASK_CORE,                         \
+        .priority = CONFIG_LCD_SERVICE_TASK_PRIORITY,             \
+        .stack_size = CONFIG_LCD_SERVICE_TASK_STACK_SIZE,         \
+    }
+
+/**
+ * @brief Create a display service task
+ *
+ * @details The service task owns the I2C traffic of every LCD handle attached to
+ *          it. Producers queue commands into a lock-free multi-producer ring and
+ *          return as soon as the command has been copied; the service task drains
+ *          the ring and performs the slow bus transfers.
+ *
+ * @param[in] config Service configuration
+ * @param[out] service Created service
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_NO_MEM        Unable to allocate the queue or task
+ */
+esp_err_t lcd_service_create(const lcd_service_config_t *config, lcd_service_t **service);
+
+/**
+ * @brief Stop the service task and release its resources
+ *
+ * @details Commands still queued are discarded, and their asynchronous operations
+ *          complete with ESP_ERR_INVALID_STATE. Attached handles must be detached
+ *          (or no longer used) before the service is deleted.
+ *
+ * @param[in] service Service to delete
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ */
+esp_err_t lcd_service_delete(lcd_service_t *service);
+
+/**
+ * @brief Attach an initialised LCD handle to a service
+ *
+ * @details Once attached, the handle should only be driven through the
+ *          lcd_service_*() producer functions so that the service task remains
+ *          the sole user of the handle.
+ *
+ * @param[in] service Service that will own the handle's bus traffic
+ * @param[inout] handle LCD handle
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE Handle already attached to a service
+ */
+esp_err_t lcd_service_attach(lcd_service_t *service, lcd_handle_t *handle);
+
+/**
+ * @brief Detach an LCD handle from its service
+ *
+ * @details Waits for the commands of the handle already queued to be run or
+ *          dropped first. Commands of other handles are not waited for, so
+ *          they may keep the service busy meanwhile. Without a service task
+ *          the caller runs the commands up to the handle's last one itself.
+ *
+ * @param[inout] handle LCD handle
+ * @param[in] timeout_ms Maximum time to wait for the commands of the handle
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_TIMEOUT       Commands of the handle still queued
+ */
+esp_err_t lcd_service_detach(lcd_handle_t *handle, uint32_t timeout_ms);
+
+/**
+ * @brief Wait for the service queue to drain
+ *
+ * @details For a service created with create_task false, runs the queued
+ *          commands in the calling task instead.
+ *
+ * @param[in] service Service
+ * @param[in] timeout_ms Maximum time to wait
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_TIMEOUT       Queue did not drain in time
+ */
+esp_err_t lcd_service_flush(lcd_service_t *service, uint32_t timeout_ms);
+
+/**
+ * @brief Number of commands discarded by the drop-oldest overflow policy
+ *
+ * @param[in] service Service
+ *
+ * @return Number of dropped commands since the service was created
+ */
+uint32_t lcd_service_get_dropped(const lcd_service_t *service);
+
+/**
+ * @brief Queue a string write
+ *
+ * @details Strings longer than LCD_SERVICE_TEXT_LEN are split across several
+ *          consecutive commands, which are queued and dropped together.
+ *
+ * @param[in] handle Attached LCD handle
+ * @param[in] str NUL terminated string to write at the current cursor position
+ *
+ * @return
+ *          - ESP_OK                Command queued
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE Handle is not attached to a service
+ *          - ESP_ERR_INVALID_SIZE  String needs more commands than the queue holds
+ *          - ESP_ERR_TIMEOUT       Queue full (LCD_SERVICE_OVERFLOW_BLOCK only)
+ */
+esp_err_t lcd_service_write_str(lcd_handle_t *handle, const char *str);
+
+/**
+ * @brief Queue a cursor move and a string write as one update
+ *
+ * @details The drop-oldest policy discards a queued lcd_service_set_cursor()
+ *          and lcd_service_write_str() separately, which leaves the text of
+ *          the second at the position meant for other text. This queues both
+ *          in one piece: the string is written where it was meant, or not at all.
+ *
+ * @param[in] handle Attached LCD handle
+ * @param[in] col The column number to move the cursor to.
+ * @param[in] row The row number to move the cursor to.
+ * @param[in] str NUL terminated string to write there
+ *
+ * @return
+ *          - ESP_OK                Command queued
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE Handle is not attached to a service
+ *          - ESP_ERR_INVALID_SIZE  String needs more commands than the queue holds
+ *          - ESP_ERR_TIMEOUT       Queue full (LCD_SERVICE_OVERFLOW_BLOCK only)
+ */
+esp_err_t lcd_service_write_str_at(lcd_handle_t *handle, uint8_t col, uint8_t row, const char *str);
+
+/**
+ * @brief Queue a character write
+ *
+ * @param[in] handle Attached LCD handle
+ * @param[in] c Character to write at the current cursor position
+ *
+ * @return
+ *          - ESP_OK                Command queued
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE Handle is not attached to a service
+ *          - ESP_ERR_TIMEOUT       Queue full (LCD_SERVICE_OVERFLOW_BLOCK only)
+ */
+esp_err_t lcd_service_write_char(lcd_handle_t *handle, char c);
+
+/**
+ * @brief Queue a cursor move
+ *
+ * @param[in] handle Attached LCD handle
+ * @param[in] col The column number to move the cursor to.
+ * @param[in] row The row number to move the cursor to.
+ *
+ * @return
+ *          - ESP_OK                Command queued
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE Handle is not attached to a service
+ *          - ESP_ERR_TIMEOUT       Queue full (LCD_SERVICE_OVERFLOW_BLOCK only)
+ */
+esp_err_t lcd_service_set_cursor(lcd_handle_t *handle, uint8_t col, uint8_t row);
+
+/**
+ * @brief Queue a display clear
+ *
+ * @param[in] handle Attached LCD handle
+ *
+ * @return
+ *          - ESP_OK                Command queued
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE Handle is not attached to a service
+ *          - ESP_ERR_TIMEOUT       Queue full (LCD_SERVICE_OVERFLOW_BLOCK only)
+ */
+esp_err_t lcd_service_clear_screen(lcd_handle_t *handle);
+
+/**
+ * @brief Queue a CGRAM write
+ *
+ * @details The character bitmap is copied into the queue.
+ *
+ * @param[in] handle Attached LCD handle
+ * @param[in] location The location in CGRAM.
+ * @param[in] charmap The character bitmap in form of byte array[8] (array[10] for 5x10 fonts).
+ *
+ * @return
+ *          - ESP_OK                Command queued
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE Handle is not attached to a service
+ *          - ESP_ERR_TIMEOUT       Queue full (LCD_SERVICE_OVERFLOW_BLOCK only)
+ */
+esp_err_t lcd_service_write_cgram(lcd_handle_t *handle, uint8_t location, const uint8_t *charmap);
+
+/**
+ * @brief Queue any argument-less API call, e.g. lcd_home() or lcd_cursor()
+ *
+ * @param[in] handle Attached LCD handle
+ * @param[in] fn API function to run on the service task
+ *
+ * @return
+ *          - ESP_OK                Command queued
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE Handle is not attached to a service
+ *          - ESP_ERR_TIMEOUT       Queue full (LCD_SERVICE_OVERFLOW_BLOCK only)
+ */
+esp_err_t lcd_service_call(lcd_handle_t *handle, esp_err_t (*fn)(lcd_handle_t *handle));
+
+#ifdef __cplusplus
+}
+#endif
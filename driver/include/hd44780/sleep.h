@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdbool.h>
+#include <esp_err.h>
+
+#include "fwd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Snapshot a display into RTC memory ahead of deep sleep
+ *
+ * @details Call this last thing before esp_deep_sleep_start(). Pending refresh
+ *          scheduler and display control changes are sent first, then the
+ *          handle state, the frame the display holds and the CGRAM content are
+ *          stored with a checksum. After wake-up, lcd_init() on a handle with
+ *          the same I2C port and address restores the handle from the snapshot
+ *          without resetting or clearing the display, and lcd_refresh_enable()
+ *          starts from the preserved frame, so only cells the application
+ *          changes are sent.
+ *
+ * @param[inout] handle Initialised LCD handle
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE LCD not initialised
+ *          - ESP_ERR_NOT_SUPPORTED Deep sleep persistence disabled in menuconfig, or no free snapshot slot
+ *          - ESP error code propagated from error source
+ */
+esp_err_t lcd_sleep_save(lcd_handle_t *handle);
+
+/**
+ * @brief Whether lcd_init() restored the handle from a deep sleep snapshot
+ *
+ * @param[in] handle LCD handle
+ *
+ * @return true if the display was resumed rather than reset
+ */
+bool lcd_sleep_resumed(const lcd_handle_t *handle);
+
+#ifdef __cplusplus
+}
+#endif
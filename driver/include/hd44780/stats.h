@@ -0,0 +1,112 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+#include "fwd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LCD_STATS_LATENCY_BUCKETS 24 /*!< Buckets of each latency histogram */
+
+/**
+ * @brief Public API calls with a latency histogram
+ */
+typedef enum
+{
+    LCD_STATS_API_INIT,         /*!< lcd_init(), lcd_init_many() */
+    LCD_STATS_API_WRITE_CHAR,   /*!< lcd_write_char() */
+    LCD_STATS_API_WRITE_STR,    /*!< lcd_write_str() and lcd_write_chars() */
+    LCD_STATS_API_SET_CURSOR,   /*!< lcd_set_cursor() */
+    LCD_STATS_API_CLEAR_SCREEN, /*!< lcd_clear_screen() */
+    LCD_STATS_API_HOME,         /*!< lcd_home() */
+    LCD_STATS_API_CONTROL,      /*!< lcd_display(), lcd_cursor(), lcd_blink(), lcd_left_to_right() and their opposites */
+    LCD_STATS_API_SHIFT,        /*!< lcd_display_shift_left(), lcd_display_shift_right() */
+    LCD_STATS_API_BACKLIGHT,    /*!< lcd_backlight(), lcd_no_backlight() without dimming */
+    LCD_STATS_API_WRITE_CGRAM,  /*!< lcd_write_cgram() */
+    LCD_STATS_API_FLUSH,        /*!< lcd_flush() */
+    LCD_STATS_API_SCREEN_SHOW,  /*!< lcd_screen_show() */
+    LCD_STATS_API_MAX,
+} lcd_stats_api_t;
+
+/**
+ * @brief HD44780 instructions counted separately
+ *
+ * @details An instruction is counted under the position of its highest set bit.
+ */
+typedef enum
+{
+    LCD_STATS_INSTR_CLEAR,           /*!< Clear Display */
+    LCD_STATS_INSTR_HOME,            /*!< Return Home */
+    LCD_STATS_INSTR_ENTRY_MODE,      /*!< Entry Mode Set */
+    LCD_STATS_INSTR_DISPLAY_CONTROL, /*!< Display On/Off Control */
+    LCD_STATS_INSTR_SHIFT,           /*!< Cursor or Display Shift */
+    LCD_STATS_INSTR_FUNCTION_SET,    /*!< Function Set */
+    LCD_STATS_INSTR_CGRAM_ADDR,      /*!< Set CGRAM Address */
+    LCD_STATS_INSTR_DDRAM_ADDR,      /*!< Set DDRAM Address */
+    LCD_STATS_INSTR_MAX,
+} lcd_stats_instr_t;
+
+/**
+ * @brief Performance counters of a handle
+ *
+ * @details Every I2C transaction of the driver puts two bytes on the wire,
+ *          the address and one expander byte, and each byte sent to the
+ *          controller takes six transactions. lcd_screen_show() is the
+ *          exception: one transaction per nibble, or the whole screen in one
+ *          without a settle time. transmit_us + wait_us against
+ *          elapsed_us shows whether a slow display is bus bound or waiting on
+ *          the controller.
+ *
+ *          latency[api][b] counts calls that took less than 2^b us and at
+ *          least 2^(b-1) us. Bucket 0 holds calls under 1 us and the last
+ *          bucket everything from 2^(LCD_STATS_LATENCY_BUCKETS-2) us on.
+ */
+typedef struct
+{
+    uint32_t i2c_transactions;                  /*!< I2C transactions started, including failed ones */
+    uint32_t wire_bytes;                        /*!< Bytes on the wire, address bytes included */
+    uint32_t instructions[LCD_STATS_INSTR_MAX]; /*!< Instructions sent, by type */
+    uint32_t chars;                             /*!< Data bytes written to DDRAM or CGRAM */
+    uint32_t nacks;                             /*!< Transactions the expander did not acknowledge */
+    uint32_t bus_errors;                        /*!< Transactions that failed otherwise: timeout, bus busy, driver error */
+    uint32_t retries;                           /*!< Transactions repeated after a failure */
+    uint64_t transmit_us;                       /*!< Time spent in I2C transactions */
+    uint64_t wait_us;                           /*!< Time spent waiting for settle and execution times */
+    uint64_t elapsed_us;                        /*!< Time since lcd_init() or the last reset */
+    uint32_t latency[LCD_STATS_API_MAX][LCD_STATS_LATENCY_BUCKETS]; /*!< log2 histograms of call latency, in us */
+} lcd_stats_t;
+
+/**
+ * @brief Read and optionally reset the performance counters of a handle
+ *
+ * @details Counting is enabled with CONFIG_LCD_STATS. Calls made before
+ *          lcd_init() are not counted.
+ *
+ * @param[in] handle Initialised LCD handle
+ * @param[out] stats Counters since lcd_init() or the last reset
+ * @param[in] reset Start a new measurement after reading
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_INVALID_STATE LCD not initialised
+ *          - ESP_ERR_NOT_SUPPORTED Statistics disabled in menuconfig
+ */
+esp_err_t lcd_get_stats(lcd_handle_t *handle, lcd_stats_t *stats, bool reset);
+
+/**
+ * @brief Name of a public API call, for printing histograms
+ *
+ * @param[in] api API call
+ *
+ * @return The name, or "unknown"
+ */
+const char *lcd_stats_api_name(lcd_stats_api_t api);
+
+#ifdef __cplusplus
+}
+#endif
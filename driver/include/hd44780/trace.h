@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <esp_err.h>
+
+#include "fwd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LCD_TRACE_READ 0x01  /*!< The byte was read from the expander */
+#define LCD_TRACE_ERROR 0x02 /*!< The transaction failed. data is what was meant to be written. */
+
+/**
+ * @brief One expander byte recorded by the wire trace
+ *
+ * @details data is the state of the PCF8574 pins:
+ *          P0 = RS, P1 = RW, P2 = E, P3 = backlight, P4-P7 = D4-D7.
+ *          A display wired otherwise, see lcd_pinmap_t, is recorded as if it
+ *          were wired that way.
+ */
+typedef struct
+{
+    uint32_t time_us; /*!< Low 32 bits of esp_timer_get_time() at the end of the transaction */
+    uint8_t i2c_port; /*!< I2C controller */
+    uint8_t address;  /*!< Expander address */
+    uint8_t data;     /*!< Expander pins */
+    uint8_t flags;    /*!< LCD_TRACE_READ, LCD_TRACE_ERROR */
+} lcd_trace_entry_t;
+
+/**
+ * @brief Copy the trace out, oldest entry first
+ *
+ * @details The trace holds every expander byte of every display written or
+ *          read since boot or lcd_trace_clear(), up to the last
+ *          CONFIG_LCD_TRACE_DEPTH of them.
+ *
+ * @param[out] entries Destination
+ * @param[in] max Room in entries
+ * @param[out] count Number of entries copied
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_NOT_SUPPORTED Trace disabled in menuconfig
+ */
+esp_err_t lcd_trace_read(lcd_trace_entry_t *entries, size_t max, size_t *count);
+
+/**
+ * @brief Stop or restart recording
+ *
+ * @details Pausing right after a glitch is noticed keeps the bytes that led
+ *          to it from being overwritten before they are dumped.
+ *
+ * @param[in] paused true to stop recording
+ */
+void lcd_trace_pause(bool paused);
+
+/**
+ * @brief Discard the recorded entries
+ */
+void lcd_trace_clear(void);
+
+/**
+ * @brief Print the trace as CSV, one line per expander byte, oldest first
+ *
+ * @details Columns: time_us, port, addr, dir, byte, then one 0/1 column per
+ *          expander pin (RS, RW, E, BL, D4, D5, D6, D7), then the decoded
+ *          meaning. Logic analyzer software that imports CSV can show the pin
+ *          columns as channels against the time_us column.
+ *
+ *          The meaning column marks the E edges and, on each falling edge,
+ *          the nibble latched. Every second nibble completes a byte, shown
+ *          as the instruction it encodes or as the character written. Nibble
+ *          pairing starts afresh at the oldest entry, so a trace that wrapped
+ *          in the middle of a byte is decoded one nibble out of step until
+ *          the next reset sequence.
+ *
+ * @param[in] stream Destination, stdout for the console
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   Invalid parameter
+ *          - ESP_ERR_NO_MEM        Unable to allocate a copy of the trace
+ *          - ESP_ERR_NOT_SUPPORTED Trace disabled in menuconfig
+ */
+esp_err_t lcd_trace_dump(FILE *stream);
+
+#ifdef __cplusplus
+}
+#endif
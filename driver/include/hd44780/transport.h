@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+#include "fwd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Bus the PCF8574 of a display is reached through
+ *
+ * @details By default a handle uses the ESP-IDF I2C master driver on
+ *          handle->i2c_port. Setting handle->transport before lcd_init()
+ *          sends the expander bytes through these callbacks instead, for
+ *          example to /dev/i2c-N on Linux, see lcd_i2cdev.h, or to a fake in
+ *          a test.
+ *
+ *          Each expander byte is a write of its own: start, address, the
+ *          byte, and a stop or repeated start. write() gets every run of bytes
+ *          that may go out back to back, and should send them in one go where
+ *          the bus allows it. The time each byte takes on the bus is what
+ *          holds the data lines before and E high during an enable pulse, so
+ *          nothing may be merged or reordered. With
+ *          CONFIG_LCD_PRE_PULSE_DELAY_US at 0 a run holds both nibbles of a
+ *          byte, six expander bytes, otherwise the settle time splits it.
+ *
+ *          Callbacks return ESP_FAIL when the expander does not acknowledge,
+ *          as i2c_master_cmd_begin() does, and another error code for any
+ *          other failure. They are called with the handle's bus lock held.
+ */
+typedef struct lcd_transport_t
+{
+    esp_err_t (*write)(void *ctx, uint8_t address, const uint8_t *data, size_t len); /*!< Write len expander bytes, each as a transaction of its own */
+    esp_err_t (*read)(void *ctx, uint8_t address, uint8_t *data);                   /*!< Read the expander pins */
+    esp_err_t (*probe)(void *ctx, uint8_t address);                                 /*!< Address the expander without changing its outputs. ESP_ERR_NOT_FOUND if it does not acknowledge. */
+    void *ctx;                                                                       /*!< Passed to the callbacks */
+} lcd_transport_t;
+
+#ifdef __cplusplus
+}
+#endif
@@ -4,3 +4,18 @@
 #include "hd44780/handle.h"
 #include "hd44780/control.h"
 #include "hd44780/config.h"
+#include "hd44780/service.h"
+#include "hd44780/async.h"
+#include "hd44780/refresh.h"
+#include "hd44780/manager.h"
+#include "hd44780/backlight.h"
+#include "hd44780/pacing.h"
+#include "hd44780/sleep.h"
+#include "hd44780/stats.h"
+#include "hd44780/trace.h"
+#include "hd44780/transport.h"
+#include "hd44780/fault.h"
+#include "hd44780/error.h"
+#include "hd44780/pinmap.h"
+#include "hd44780/screen.h"
+#include "hd44780/glyphpack.h"
@@ -0,0 +1,356 @@
+#pragma once
+
+// C++17 interface to the driver, header only.
+//
+// The geometry of a display is a template parameter, so cursor positions
+// given as template arguments are checked when the program is compiled and
+// text is clipped to lengths known at compile time. Text is taken as
+// std::string_view, or std::span with C++20, and written where it is,
+// without the copy a NUL-terminated string would need. Nothing is allocated
+// by the wrapper: a display and its frame live wherever they are declared,
+// typically in static storage.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#if __has_include(<version>)
+#include <version>
+#endif
+#if defined(__cpp_lib_span) && __cpp_lib_span >= 202002L
+#include <span>
+#endif
+
+#include "lcd.h"
+
+#if __cplusplus < 201703L
+#error "lcd.hpp needs C++17"
+#endif
+
+namespace hd44780
+{
+
+/**
+ * @brief Transport: the ESP-IDF I2C master driver on the handle's port
+ *
+ * @details A transport is a type with a static get() returning the
+ *          lcd_transport_t to set in the handle, or nullptr for the I2C
+ *          driver. See transport_ref for one declared in static storage.
+ */
+struct i2c_master
+{
+    static constexpr const lcd_transport_t *get() { return nullptr; }
+};
+
+/**
+ * @brief Transport: an lcd_transport_t in static storage
+ *
+ * @code
+ * static const lcd_transport_t bus = {my_write, my_read, my_probe, nullptr};
+ * static hd44780::display<20, 4, hd44780::transport_ref<bus>> lcd;
+ * @endcode
+ */
+template <const lcd_transport_t &Transport>
+struct transport_ref
+{
+    static constexpr const lcd_transport_t *get() { return &Transport; }
+};
+
+/**
+ * @brief Content of a display, held by the application
+ *
+ * @details Columns * Rows characters, blank when constructed. Draw into it
+ *          and hand it to display::show(), which sends the cells that
+ *          changed since the last frame shown.
+ */
+template <uint8_t Columns, uint8_t Rows>
+class frame
+{
+    static_assert(Columns > 0 && Rows > 0 && Rows <= 4 && Columns * Rows <= 80,
+                  "An HD44780 has at most 4 rows and 80 cells");
+
+public:
+    static constexpr uint8_t columns = Columns;
+    static constexpr uint8_t rows = Rows;
+
+    constexpr frame() : cells_{} { clear(); }
+
+    /**
+     * @brief Blank every cell
+     */
+    constexpr void clear()
+    {
+        for (char &c : cells_)
+            c = ' ';
+    }
+
+    /**
+     * @brief Put text at a position checked at compile time, clipped to the row
+     */
+    template <uint8_t Column, uint8_t Row>
+    constexpr void put(std::string_view text)
+    {
+        static_assert(Column < Columns && Row < Rows, "Position outside the display");
+        put_clipped(Row * Columns + Column, text.substr(0, Columns - Column));
+    }
+
+    /**
+     * @brief Put text at a position known at run time, clipped to the row
+     *
+     * @return false if the position is outside the display, nothing is put then
+     */
+    constexpr bool put(uint8_t column, uint8_t row, std::string_view text)
+    {
+        if (column >= Columns || row >= Rows)
+            return false;
+        put_clipped(row * Columns + column, text.substr(0, Columns - column));
+        return true;
+    }
+
+    /**
+     * @brief Put one character, such as a CGRAM glyph, at a position checked at compile time
+     */
+    template <uint8_t Column, uint8_t Row>
+    constexpr void put(char c)
+    {
+        static_assert(Column < Columns && Row < Rows, "Position outside the display");
+        cells_[Row * Columns + Column] = c;
+    }
+
+    /**
+     * @brief Characters of a row
+     */
+    constexpr std::string_view row(uint8_t r) const { return std::string_view(&cells_[r * Columns], Columns); }
+
+    constexpr char operator[](std::size_t cell) const { return cells_[cell]; }
+    constexpr bool operator==(const frame &other) const
+    {
+        for (std::size_t i = 0; i < cells_.size(); ++i)
+            if (cells_[i] != other.cells_[i])
+                return false;
+        return true;
+    }
+    constexpr bool operator!=(const frame &other) const { return !(*this == other); }
+
+private:
+    constexpr void put_clipped(std::size_t at, std::string_view text)
+    {
+        for (char c : text)
+            cells_[at++] = c;
+    }
+
+    std::array<char, Columns * Rows> cells_;
+};
+
+/**
+ * @brief An HD44780 display of a geometry known at compile time
+ *
+ * @details Wraps an lcd_handle_t set up for Columns x Rows and the transport.
+ *          Calls return the esp_err_t of the driver call they make. Declare
+ *          displays in static storage; the wrapper allocates nothing.
+ *
+ * @code
+ * static hd44780::display<20, 4> lcd;
+ *
+ * ESP_ERROR_CHECK(lcd.init());
+ * lcd.write_at<0, 1>("Temperature");
+ * @endcode
+ */
+template <uint8_t Columns, uint8_t Rows, typename Transport = i2c_master>
+class display
+{
+public:
+    using frame_type = frame<Columns, Rows>;
+    static constexpr uint8_t columns = Columns;
+    static constexpr uint8_t rows = Rows;
+
+    /**
+     * @param[in] port I2C controller, unused by other transports
+     * @param[in] address Address of the display on the bus
+     */
+    explicit display(i2c_port_t port = I2C_MASTER_NUM, uint8_t address = LCD_ADDR) : handle_(default_handle(port, address)) {}
+
+    display(const display &) = delete;
+    display &operator=(const display &) = delete;
+
+    /**
+     * @brief The handle, for the rest of the C API
+     *
+     * @details Set pinmap, error_budget or timeout_ms here before init().
+     *          show() does not see what is written through the C API: call
+     *          invalidate() afterwards, so the next frame is sent whole.
+     */
+    lcd_handle_t &handle() { return handle_; }
+
+    /**
+     * @brief Forget the last frame shown, so the next show() sends its whole frame
+     */
+    void invalidate() { shown_valid_ = false; }
+
+    /**
+     * @brief Initialise the display, see lcd_init()
+     */
+    esp_err_t init()
+    {
+        shown_valid_ = false;
+        return lcd_init(&handle_);
+    }
+
+    /**
+     * @brief Move the cursor to a position checked at compile time
+     */
+    template <uint8_t Column, uint8_t Row>
+    esp_err_t set_cursor()
+    {
+        static_assert(Column < Columns && Row < Rows, "Position outside the display");
+        return lcd_set_cursor(&handle_, Column, Row);
+    }
+
+    /**
+     * @brief Move the cursor to a position known at run time, see lcd_set_cursor()
+     */
+    esp_err_t set_cursor(uint8_t column, uint8_t row) { return lcd_set_cursor(&handle_, column, row); }
+
+    /**
+     * @brief Write text at the cursor, without copying it
+     */
+    esp_err_t write(std::string_view text)
+    {
+        shown_valid_ = false;
+        return lcd_write_chars(&handle_, text.data(), text.size());
+    }
+
+    /**
+     * @brief Write one character at the cursor
+     */
+    esp_err_t write(char c)
+    {
+        shown_valid_ = false;
+        return lcd_write_char(&handle_, c);
+    }
+
+#if defined(__cpp_lib_span) && __cpp_lib_span >= 202002L
+    /**
+     * @brief Write characters at the cursor, without copying them
+     *
+     * @details Takes spans of char or const char, of any extent.
+     */
+    esp_err_t write(std::span<const char> chars) { return write(std::string_view(chars.data(), chars.size())); }
+
+    /**
+     * @brief Write a string literal, a std::string or other text at the cursor
+     *
+     * @details These convert to a span as well as to a std::string_view, so
+     *          they are taken here and written as the std::string_view.
+     */
+    template <typename Text, std::enable_if_t<std::is_convertible_v<const Text &, std::string_view>, int> = 0>
+    esp_err_t write(const Text &text)
+    {
+        return write(std::string_view(text));
+    }
+#endif
+
+    /**
+     * @brief Write text at a position checked at compile time, clipped to the row
+     */
+    template <uint8_t Column, uint8_t Row>
+    esp_err_t write_at(std::string_view text)
+    {
+        esp_err_t ret = set_cursor<Column, Row>();
+
+        return ret == ESP_OK ? write(text.substr(0, Columns - Column)) : ret;
+    }
+
+    /**
+     * @brief Send the cells of a frame that differ from the last frame shown
+     *
+     * @details Each run of changed cells costs a Set DDRAM Address and its
+     *          characters. The first frame after init(), clear(), invalidate()
+     *          or any other write of the wrapper is sent whole. The cursor is left after the last cell
+     *          sent.
+     */
+    esp_err_t show(const frame_type &next)
+    {
+        esp_err_t ret = ESP_OK;
+
+        for (uint8_t row = 0; row < Rows && ret == ESP_OK; ++row)
+        {
+            const std::string_view want = next.row(row);
+            const std::string_view have = shown_.row(row);
+            uint8_t column = 0;
+
+            while (column < Columns && ret == ESP_OK)
+            {
+                if (shown_valid_ && want[column] == have[column])
+                {
+                    ++column;
+                    continue;
+                }
+                // Take in single unchanged cells, cheaper than a new address
+                uint8_t end = column + 1;
+                while (end < Columns && (!shown_valid_ || want[end] != have[end] ||
+                                         (end + 1 < Columns && want[end + 1] != have[end + 1])))
+                    ++end;
+                ret = lcd_set_cursor(&handle_, column, row);
+                if (ret == ESP_OK)
+                    ret = lcd_write_chars(&handle_, want.data() + column, end - column);
+                column = end;
+            }
+        }
+        shown_ = next;
+        shown_valid_ = ret == ESP_OK;
+        return ret;
+    }
+
+    /**
+     * @brief Load a 5x8 glyph into a CGRAM location checked at compile time
+     */
+    template <uint8_t Location>
+    esp_err_t write_cgram(const std::array<uint8_t, 8> &glyph)
+    {
+        static_assert(Location < 8, "CGRAM has 8 locations");
+        return lcd_write_cgram(&handle_, Location, glyph.data());
+    }
+
+    esp_err_t clear()
+    {
+        esp_err_t ret = lcd_clear_screen(&handle_);
+
+        shown_.clear();
+        shown_valid_ = ret == ESP_OK;
+        return ret;
+    }
+
+    esp_err_t home() { return lcd_home(&handle_); }
+    esp_err_t backlight(bool on) { return on ? lcd_backlight(&handle_) : lcd_no_backlight(&handle_); }
+    esp_err_t cursor(bool on) { return on ? lcd_cursor(&handle_) : lcd_no_cursor(&handle_); }
+    esp_err_t blink(bool on) { return on ? lcd_blink(&handle_) : lcd_no_blink(&handle_); }
+    esp_err_t flush() { return lcd_flush(&handle_); }
+
+private:
+    static lcd_handle_t default_handle(i2c_port_t port, uint8_t address)
+    {
+        // LCD_HANDLE_DEFAULT_CONFIG() with the geometry and transport of the template
+        lcd_handle_t handle = {};
+
+        handle.i2c_port = port;
+        handle.address = address;
+        handle.columns = Columns;
+        handle.rows = Rows;
+        handle.display_function = LCD_4BIT_MODE | (Rows > 1 ? LCD_2LINE : LCD_1LINE) | LCD_5x8DOTS;
+        handle.display_control = LCD_DISPLAY_ON | LCD_CURSOR_OFF | LCD_BLINK_OFF;
+        handle.display_mode = LCD_ENTRY_INCREMENT | LCD_ENTRY_DISPLAY_NO_SHIFT;
+        handle.backlight = LCD_BACKLIGHT;
+        handle.transport = Transport::get();
+        handle.timeout_ms = LCD_I2C_TIMEOUT_MS;
+        handle.error_budget = LCD_ERROR_BUDGET;
+        return handle;
+    }
+
+    lcd_handle_t handle_;
+    frame_type shown_;
+    bool shown_valid_ = false;
+};
+
+} // namespace hd44780
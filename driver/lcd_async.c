@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+#include "lcd.h"
+#include "hd44780.h"
+#include "hd44780_service.h"
+#include "hd44780_async.h"
+
+// Asynchronous operations ride on the display service. A token is taken
+// from a static pool and travels with the command(s) of the operation
+// through the service ring; the service task drops the command's reference
+// after executing it, and whoever drops the last reference completes the
+// token. Commands discarded by the drop-oldest policy or by deleting the
+// service complete their token with an error, so a token never hangs.
+//
+// A token is returned to the pool once it is both complete and released,
+// whichever happens last.
+
+static const char *TAG = "LCD Async";
+
+static lcd_async_op_t lcd_async_pool[LCD_ASYNC_MAX_OPS];
+static portMUX_TYPE lcd_async_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+static lcd_async_op_t *lcd_async_acquire(const lcd_async_completion_t *completion, bool owned);
+static void lcd_async_free(lcd_async_op_t *op);
+static esp_err_t lcd_async_submit(lcd_handle_t *handle, lcd_cmd_t *cmd,
+                                  const lcd_async_completion_t *completion, lcd_async_op_t **op);
+
+esp_err_t lcd_write_str_async(lcd_handle_t *handle, const char *str,
+                              const lcd_async_completion_t *completion, lcd_async_op_t **op)
+{
+    lcd_async_op_t *token;
+
+    ESP_RETURN_ON_FALSE(handle && str, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(handle->service, ESP_ERR_INVALID_STATE, TAG, "Handle not attached to a service");
+    token = lcd_async_acquire(completion, op != NULL);
+    ESP_RETURN_ON_FALSE(token, ESP_ERR_NO_MEM, TAG, "No free operation token");
+
+    // A failure to queue is recorded in the token by lcd_service_post_str()
+    lcd_service_post_str(handle, NULL, str, token);
+    if (op)
+        *op = token;
+    // Drop the producer's reference. Completes the token if nothing was queued.
+    lcd_async_complete(token, ESP_OK);
+    return ESP_OK;
+}
+
+esp_err_t lcd_set_cursor_async(lcd_handle_t *handle, uint8_t col, uint8_t row,
+                               const lcd_async_completion_t *completion, lcd_async_op_t **op)
+{
+    lcd_cmd_t cmd = {.type = LCD_CMD_SET_CURSOR, .handle = handle};
+
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(col < handle->columns && row < handle->rows,
+                        ESP_ERR_INVALID_ARG, TAG, "Invalid cursor position");
+    cmd.payload.cursor.col = col;
+    cmd.payload.cursor.row = row;
+    return lcd_async_submit(handle, &cmd, completion, op);
+}
+
+esp_err_t lcd_clear_screen_async(lcd_handle_t *handle,
+                                 const lcd_async_completion_t *completion, lcd_async_op_t **op)
+{
+    lcd_cmd_t cmd = {.type = LCD_CMD_CLEAR, .handle = handle};
+
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    return lcd_async_submit(handle, &cmd, completion, op);
+}
+
+esp_err_t lcd_write_cgram_async(lcd_handle_t *handle, uint8_t location, const uint8_t *charmap,
+                                const lcd_async_completion_t *completion, lcd_async_op_t **op)
+{
+    lcd_cmd_t cmd = {.type = LCD_CMD_WRITE_CGRAM, .handle = handle};
+
+    ESP_RETURN_ON_FALSE(handle && charmap, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    cmd.payload.cgram.location = location;
+    memcpy(cmd.payload.cgram.charmap, charmap,
+           (handle->display_function & LCD_5x10DOTS) ? 10 : 8);
+    return lcd_async_submit(handle, &cmd, completion, op);
+}
+
+esp_err_t lcd_async_wait(lcd_async_op_t *op, uint32_t timeout_ms)
+{
+    ESP_RETURN_ON_FALSE(op && op->in_use, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    if (atomic_load(&op->state) & LCD_ASYNC_DONE)
+        return atomic_load(&op->result);
+    if (xSemaphoreTake(op->done, pdMS_TO_TICKS(timeout_ms)) != pdTRUE)
+        return ESP_ERR_TIMEOUT;
+    // Let further waits return at once as well
+    xSemaphoreGive(op->done);
+    return atomic_load(&op->result);
+}
+
+void lcd_async_release(lcd_async_op_t *op)
+{
+    if (!op)
+        return;
+    if (atomic_fetch_or(&op->state, LCD_ASYNC_RELEASED) & LCD_ASYNC_DONE)
+        lcd_async_free(op);
+}
+
+void lcd_async_ref(lcd_async_op_t *op)
+{
+    atomic_fetch_add(&op->refs, 1);
+}
+
+void lcd_async_complete(lcd_async_op_t *op, esp_err_t result)
+{
+    int expected = ESP_OK;
+
+    if (result != ESP_OK)
+        atomic_compare_exchange_strong(&op->result, &expected, result);
+    if (atomic_fetch_sub(&op->refs, 1) != 1)
+        return;
+
+    result = atomic_load(&op->result);
+    if (op->completion.callback)
+        op->completion.callback(op, result, op->completion.arg);
+    if (op->completion.notify_task)
+        xTaskNotify(op->completion.notify_task, op->completion.notify_bits, eSetBits);
+    xSemaphoreGive(op->done);
+    if (atomic_fetch_or(&op->state, LCD_ASYNC_DONE) & LCD_ASYNC_RELEASED)
+        lcd_async_free(op);
+}
+
+/**
+ * @brief Take a token from the pool with one reference held by the producer
+ *
+ * @param[in] owned The caller keeps the token. Otherwise it is released on completion.
+ *
+ * @return The token, or NULL if the pool is exhausted
+ */
+static lcd_async_op_t *lcd_async_acquire(const lcd_async_completion_t *completion, bool owned)
+{
+    lcd_async_op_t *op = NULL;
+
+    portENTER_CRITICAL(&lcd_async_spinlock);
+    for (int i = 0; i < LCD_ASYNC_MAX_OPS && !op; ++i)
+    {
+        if (!lcd_async_pool[i].in_use)
+        {
+            op = &lcd_async_pool[i];
+            op->in_use = true;
+        }
+    }
+    portEXIT_CRITICAL(&lcd_async_spinlock);
+    if (!op)
+        return NULL;
+
+    if (!op->done)
+        op->done = xSemaphoreCreateBinaryStatic(&op->done_buffer);
+    // Discard a completion nobody waited for on the previous use
+    xSemaphoreTake(op->done, 0);
+    atomic_store(&op->state, owned ? 0 : LCD_ASYNC_RELEASED);
+    atomic_store(&op->refs, 1);
+    atomic_store(&op->result, ESP_OK);
+    if (completion)
+        op->completion = *completion;
+    else
+        memset(&op->completion, 0, sizeof(op->completion));
+    return op;
+}
+
+static void lcd_async_free(lcd_async_op_t *op)
+{
+    portENTER_CRITICAL(&lcd_async_spinlock);
+    op->in_use = false;
+    portEXIT_CRITICAL(&lcd_async_spinlock);
+}
+
+/**
+ * @brief Queue a single command carrying a new token
+ */
+static esp_err_t lcd_async_submit(lcd_handle_t *handle, lcd_cmd_t *cmd,
+                                  const lcd_async_completion_t *completion, lcd_async_op_t **op)
+{
+    lcd_async_op_t *token;
+
+    ESP_RETURN_ON_FALSE(handle->service, ESP_ERR_INVALID_STATE, TAG, "Handle not attached to a service");
+    token = lcd_async_acquire(completion, op != NULL);
+    ESP_RETURN_ON_FALSE(token, ESP_ERR_NO_MEM, TAG, "No free operation token");
+
+    cmd->op = token;
+    lcd_async_ref(token);
+    if (op)
+        *op = token;
+    // The command's reference carries the error when it cannot be queued
+    if (lcd_service_post(handle->service, cmd) != ESP_OK)
+        lcd_async_complete(token, ESP_ERR_TIMEOUT);
+    lcd_async_complete(token, ESP_OK);
+    return ESP_OK;
+}
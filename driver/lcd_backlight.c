@@ -0,0 +1,414 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+#include "lcd.h"
+#include "hd44780.h"
+#include "hd44780_backlight.h"
+#include "hd44780_error.h"
+#include "hd44780_pinmap.h"
+
+// The backlight is the P3 output of the I2C expander, so it can only be
+// dimmed by switching that bit in software. A one-shot esp_timer is placed
+// on each edge: the start of a period turns the line on for level/255 of
+// the period, the next edge turns it off for the rest.
+//
+// Every byte the driver writes to the expander carries the backlight bit,
+// and lcd_write_nibble() takes it from the current PWM phase. An edge that
+// falls while the handle's bus lock is held is therefore not written on its
+// own: the text stream carries it with its next byte, or lcd_unlock() writes
+// it if the holder has nothing left to send. Only edges that fall while the
+// display is idle cost a dedicated expander write.
+//
+// The timer callback runs in the esp_timer task, shared by every timer in
+// the system, so it only moves the phase and wakes the dimming task. The
+// task takes the bus lock like any other writer.
+
+static const char *TAG = "LCD Backlight";
+
+// Guards handle->backlight_pwm, closing and in_callback for the timer
+// callback, which may start before lcd_backlight_pwm_disable() and only
+// look at them after the state is freed. It outlives every state.
+static portMUX_TYPE lcd_backlight_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static void lcd_backlight_edge(void *arg);
+static uint8_t lcd_backlight_level_at(const lcd_backlight_pwm_t *pwm, int64_t now);
+static esp_err_t lcd_backlight_retarget(lcd_handle_t *handle, uint8_t level, uint32_t fade_us);
+static esp_err_t lcd_backlight_write_edge(lcd_handle_t *handle, lcd_backlight_pwm_t *pwm);
+static void lcd_backlight_task(void *arg);
+
+esp_err_t lcd_backlight_pwm_enable(lcd_handle_t *handle, const lcd_backlight_pwm_config_t *config)
+{
+    esp_err_t ret = ESP_OK;
+    lcd_backlight_pwm_t *pwm = NULL;
+
+    ESP_RETURN_ON_FALSE(handle && config && config->period_us, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(handle->initialized, ESP_ERR_INVALID_STATE, TAG, "LCD not initialized");
+    ESP_RETURN_ON_FALSE(!handle->backlight_pwm, ESP_ERR_INVALID_STATE, TAG, "Backlight dimming already enabled");
+
+    pwm = calloc(1, sizeof(lcd_backlight_pwm_t));
+    ESP_GOTO_ON_FALSE(pwm, ESP_ERR_NO_MEM, err, TAG, "Unable to allocate dimming state");
+    pwm->config = *config;
+    portMUX_INITIALIZE(&pwm->spinlock);
+    atomic_init(&pwm->phase, handle->backlight != 0);
+    atomic_init(&pwm->stale, false);
+    pwm->level = handle->backlight ? LCD_BACKLIGHT_LEVEL_MAX : 0;
+    pwm->fade_to = pwm->level;
+    pwm->stats_start_us = esp_timer_get_time();
+
+    if (!handle->lock)
+    {
+        handle->lock = xSemaphoreCreateRecursiveMutex();
+        ESP_GOTO_ON_FALSE(handle->lock, ESP_ERR_NO_MEM, err, TAG, "Unable to create handle lock");
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = lcd_backlight_edge,
+        .arg = handle,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "lcd_backlight",
+    };
+    ESP_GOTO_ON_ERROR(
+        esp_timer_create(&timer_args, &pwm->timer),
+        err, TAG, "Unable to create dimming timer");
+
+    pwm->idle = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(pwm->idle, ESP_ERR_NO_MEM, err, TAG, "Unable to create dimming semaphore");
+
+    handle->backlight_pwm = pwm;
+    if (config->create_task)
+    {
+        pwm->task_done = xSemaphoreCreateBinary();
+        if (!pwm->task_done ||
+            xTaskCreatePinnedToCore(lcd_backlight_task, "lcd_backlight", config->stack_size, handle,
+                                    config->priority, &pwm->task, config->core_id) != pdPASS)
+        {
+            handle->backlight_pwm = NULL;
+            ret = ESP_ERR_NO_MEM;
+            ESP_LOGE(TAG, "Unable to create dimming task");
+            goto err;
+        }
+    }
+    ESP_LOGD(TAG, "Backlight dimming enabled for LCD 0x%x, period %u us",
+             handle->address, (unsigned)config->period_us);
+    return lcd_backlight_retarget(handle, config->level, 0);
+err:
+    if (pwm && pwm->timer)
+        esp_timer_delete(pwm->timer);
+    if (pwm && pwm->idle)
+        vSemaphoreDelete(pwm->idle);
+    if (pwm && pwm->task_done)
+        vSemaphoreDelete(pwm->task_done);
+    free(pwm);
+    return ret;
+}
+
+esp_err_t lcd_backlight_pwm_disable(lcd_handle_t *handle)
+{
+    esp_err_t ret = ESP_OK;
+    lcd_backlight_pwm_t *pwm;
+    bool in_callback;
+
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    pwm = handle->backlight_pwm;
+    if (!pwm)
+        return ESP_OK;
+
+    portENTER_CRITICAL(&lcd_backlight_mux);
+    portENTER_CRITICAL(&pwm->spinlock);
+    pwm->closing = true;
+    portEXIT_CRITICAL(&pwm->spinlock);
+    in_callback = pwm->in_callback;
+    portEXIT_CRITICAL(&lcd_backlight_mux);
+    // A callback already running sees closing as it leaves and gives idle.
+    // One that starts from now on returns without touching the state.
+    if (in_callback)
+        xSemaphoreTake(pwm->idle, portMAX_DELAY);
+    esp_timer_stop(pwm->timer);
+    esp_timer_delete(pwm->timer);
+
+    if (pwm->task)
+    {
+        // closing is set: the task exits on this notification
+        xTaskNotifyGive(pwm->task);
+        xSemaphoreTake(pwm->task_done, portMAX_DELAY);
+        vSemaphoreDelete(pwm->task_done);
+    }
+
+    lcd_lock(handle);
+    handle->backlight = (pwm->fade_to > 0) ? LCD_BACKLIGHT_ON : LCD_BACKLIGHT_OFF;
+    portENTER_CRITICAL(&lcd_backlight_mux);
+    handle->backlight_pwm = NULL;
+    portEXIT_CRITICAL(&lcd_backlight_mux);
+    ret = lcd_hw_write_backlight(handle);
+    lcd_unlock(handle);
+    vSemaphoreDelete(pwm->idle);
+    free(pwm);
+    return ret;
+}
+
+esp_err_t lcd_backlight_pwm_flush(lcd_handle_t *handle)
+{
+    esp_err_t ret = ESP_OK;
+    lcd_backlight_pwm_t *pwm;
+
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    pwm = handle->backlight_pwm;
+    ESP_RETURN_ON_FALSE(pwm, ESP_ERR_INVALID_STATE, TAG, "Backlight dimming not enabled");
+
+    if (!atomic_load(&pwm->stale))
+        return ESP_OK;
+    lcd_lock(handle);
+    // A writer may have carried the edge while we waited for the lock
+    if (atomic_load(&pwm->stale))
+        ret = lcd_backlight_write_edge(handle, pwm);
+    lcd_unlock(handle);
+    return ret;
+}
+
+esp_err_t lcd_backlight_set_level(lcd_handle_t *handle, uint8_t level)
+{
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(handle->backlight_pwm, ESP_ERR_INVALID_STATE, TAG, "Backlight dimming not enabled");
+    return lcd_backlight_retarget(handle, level, 0);
+}
+
+esp_err_t lcd_backlight_fade(lcd_handle_t *handle, uint8_t level, uint32_t duration_ms)
+{
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(handle->backlight_pwm, ESP_ERR_INVALID_STATE, TAG, "Backlight dimming not enabled");
+    return lcd_backlight_retarget(handle, level, duration_ms * 1000);
+}
+
+uint8_t lcd_backlight_get_level(const lcd_handle_t *handle)
+{
+    lcd_backlight_pwm_t *pwm;
+    uint8_t level;
+
+    if (!handle)
+        return 0;
+    pwm = handle->backlight_pwm;
+    if (!pwm)
+        return handle->backlight ? LCD_BACKLIGHT_LEVEL_MAX : 0;
+
+    portENTER_CRITICAL(&pwm->spinlock);
+    level = lcd_backlight_level_at(pwm, esp_timer_get_time());
+    portEXIT_CRITICAL(&pwm->spinlock);
+    return level;
+}
+
+esp_err_t lcd_backlight_pwm_get_stats(lcd_handle_t *handle, lcd_backlight_pwm_stats_t *stats, bool reset)
+{
+    lcd_backlight_pwm_t *pwm;
+    int64_t now = esp_timer_get_time();
+
+    ESP_RETURN_ON_FALSE(handle && stats, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    pwm = handle->backlight_pwm;
+    ESP_RETURN_ON_FALSE(pwm, ESP_ERR_INVALID_STATE, TAG, "Backlight dimming not enabled");
+
+    *stats = pwm->stats;
+    stats->elapsed_us = now - pwm->stats_start_us;
+    if (reset)
+    {
+        memset(&pwm->stats, 0, sizeof(pwm->stats));
+        pwm->stats_start_us = now;
+    }
+    return ESP_OK;
+}
+
+uint8_t lcd_backlight_bits(const lcd_handle_t *handle)
+{
+    lcd_backlight_pwm_t *pwm = handle->backlight_pwm;
+    uint8_t line = lcd_encoding(handle)->backlight;
+
+    if (!pwm)
+        return handle->backlight ? line : 0;
+    // Whatever is written now carries the latest edge
+    if (atomic_exchange(&pwm->stale, false))
+        pwm->stats.piggybacked++;
+    return atomic_load(&pwm->phase) ? line : 0;
+}
+
+void lcd_backlight_pwm_sync(lcd_handle_t *handle)
+{
+    lcd_backlight_pwm_t *pwm = handle->backlight_pwm;
+
+    if (pwm && atomic_load(&pwm->stale))
+        lcd_backlight_write_edge(handle, pwm);
+}
+
+/**
+ * @brief Timer callback placed on every edge of the PWM waveform
+ *
+ * @details Runs in the esp_timer task and must not block: the bus is left
+ *          to the next writer or the dimming task.
+ */
+static void lcd_backlight_edge(void *arg)
+{
+    lcd_handle_t *handle = arg;
+    lcd_backlight_pwm_t *pwm;
+    int64_t now = esp_timer_get_time();
+    uint32_t period;
+    uint64_t next_us;
+    bool rearm = true;
+    bool closing;
+    bool phase;
+
+    // Nothing of the state is touched before it is known to stay allocated
+    portENTER_CRITICAL(&lcd_backlight_mux);
+    pwm = handle->backlight_pwm;
+    if (!pwm || pwm->closing)
+    {
+        portEXIT_CRITICAL(&lcd_backlight_mux);
+        return;
+    }
+    pwm->in_callback = true;
+    portEXIT_CRITICAL(&lcd_backlight_mux);
+
+    period = pwm->config.period_us;
+    next_us = period;
+    portENTER_CRITICAL(&pwm->spinlock);
+    if (pwm->in_period)
+    {
+        // End of the on time
+        phase = false;
+        next_us = period - pwm->on_us;
+        pwm->in_period = false;
+    }
+    else
+    {
+        // Start of a period. Fades step here.
+        pwm->level = lcd_backlight_level_at(pwm, now);
+        if (pwm->fade_us && now - pwm->fade_start_us >= pwm->fade_us)
+            pwm->fade_us = 0;
+        pwm->on_us = (uint64_t)period * pwm->level / LCD_BACKLIGHT_LEVEL_MAX;
+        phase = pwm->level > 0;
+        if (pwm->level > 0 && pwm->level < LCD_BACKLIGHT_LEVEL_MAX)
+        {
+            next_us = pwm->on_us;
+            pwm->in_period = true;
+        }
+        else if (!pwm->fade_us)
+        {
+            // Fully on or off: nothing to switch until the level changes
+            rearm = false;
+            pwm->running = false;
+        }
+    }
+    bool changed = phase != atomic_exchange(&pwm->phase, phase);
+    portEXIT_CRITICAL(&pwm->spinlock);
+
+    if (changed)
+    {
+        pwm->stats.edges++;
+        atomic_store(&pwm->stale, true);
+        if (pwm->task)
+            xTaskNotifyGive(pwm->task);
+    }
+
+    portENTER_CRITICAL(&pwm->spinlock);
+    if (pwm->closing)
+        rearm = false;
+    if (!rearm)
+        pwm->running = false;
+    portEXIT_CRITICAL(&pwm->spinlock);
+    if (rearm)
+        esp_timer_start_once(pwm->timer, next_us);
+
+    portENTER_CRITICAL(&lcd_backlight_mux);
+    pwm->in_callback = false;
+    closing = pwm->closing;
+    portEXIT_CRITICAL(&lcd_backlight_mux);
+    // The last access to the state: disable may free it once given
+    if (closing)
+        xSemaphoreGive(pwm->idle);
+}
+
+/**
+ * @brief Level at a given time, following a fade in progress
+ *
+ * @details Called with the spinlock held.
+ */
+static uint8_t lcd_backlight_level_at(const lcd_backlight_pwm_t *pwm, int64_t now)
+{
+    int64_t elapsed = now - pwm->fade_start_us;
+
+    if (!pwm->fade_us || elapsed >= pwm->fade_us)
+        return pwm->fade_to;
+    return pwm->fade_from + ((int)pwm->fade_to - pwm->fade_from) * elapsed / (int64_t)pwm->fade_us;
+}
+
+/**
+ * @brief Start a fade, or a step when fade_us is 0, from the current level
+ */
+static esp_err_t lcd_backlight_retarget(lcd_handle_t *handle, uint8_t level, uint32_t fade_us)
+{
+    lcd_backlight_pwm_t *pwm = handle->backlight_pwm;
+    int64_t now = esp_timer_get_time();
+    bool start = false;
+
+    portENTER_CRITICAL(&pwm->spinlock);
+    pwm->fade_from = lcd_backlight_level_at(pwm, now);
+    pwm->fade_to = level;
+    pwm->fade_start_us = now;
+    pwm->fade_us = fade_us;
+    if (!pwm->running && !pwm->closing)
+    {
+        pwm->running = true;
+        pwm->in_period = false;
+        start = true;
+    }
+    portEXIT_CRITICAL(&pwm->spinlock);
+
+    handle->backlight = (level > 0) ? LCD_BACKLIGHT_ON : LCD_BACKLIGHT_OFF;
+    // A running timer picks the new level up at the start of its next period
+    if (start)
+        return esp_timer_start_once(pwm->timer, 0);
+    return ESP_OK;
+}
+
+/**
+ * @brief Write the current phase on its own, with the bus lock held
+ */
+static esp_err_t lcd_backlight_write_edge(lcd_handle_t *handle, lcd_backlight_pwm_t *pwm)
+{
+    esp_err_t ret;
+    int64_t start = esp_timer_get_time();
+
+    // Not counted as piggybacked by lcd_backlight_bits()
+    atomic_store(&pwm->stale, false);
+    ret = lcd_hw_write_backlight(handle);
+    pwm->stats.bus_us += esp_timer_get_time() - start;
+    pwm->stats.writes++;
+    // Up to two edges a period: the report is rate limited
+    lcd_error_report(handle, LCD_STATS_API_BACKLIGHT, ret);
+    return ret;
+}
+
+/**
+ * @brief Write the edges that fall while no other writer holds the bus
+ */
+static void lcd_backlight_task(void *arg)
+{
+    lcd_handle_t *handle = arg;
+    lcd_backlight_pwm_t *pwm = handle->backlight_pwm;
+    bool closing = false;
+
+    while (!closing)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        portENTER_CRITICAL(&pwm->spinlock);
+        closing = pwm->closing;
+        portEXIT_CRITICAL(&pwm->spinlock);
+        if (!closing)
+            lcd_backlight_pwm_flush(handle);
+    }
+    xSemaphoreGive(pwm->task_done);
+    vTaskDelete(NULL);
+}
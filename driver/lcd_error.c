@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "lcd.h"
+#include "hd44780.h"
+#include "hd44780_error.h"
+#include "hd44780_fault.h"
+
+// A failing display used to log at every layer a failure passed through,
+// half a dozen lines for each expander byte, and did so again for every byte
+// while the bus stayed down: enough to slow the caller down more than the
+// timeouts did. Now the layers only return the error, and the lowest one
+// that sees it records where it was and what it was sending into the
+// handle's fault state. The public call logs that record on its way out, as
+// one line, and no more often than CONFIG_LCD_ERROR_LOG_INTERVAL_MS per
+// display.
+
+static const char *TAG = "LCD Driver";
+
+static const char *lcd_error_layer_names[] = {
+    [LCD_ERROR_LAYER_NONE] = "none",
+    [LCD_ERROR_LAYER_BUS_WRITE] = "bus_write",
+    [LCD_ERROR_LAYER_BUS_READ] = "bus_read",
+    [LCD_ERROR_LAYER_OFFLINE] = "offline",
+    [LCD_ERROR_LAYER_CONTROLLER] = "controller",
+};
+
+const char *lcd_error_layer_name(lcd_error_layer_t layer)
+{
+    if (layer >= sizeof(lcd_error_layer_names) / sizeof(lcd_error_layer_names[0]))
+        return "unknown";
+    return lcd_error_layer_names[layer];
+}
+
+esp_err_t lcd_get_last_error(lcd_handle_t *handle, lcd_error_t *error)
+{
+    ESP_RETURN_ON_FALSE(handle && error, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(handle->fault, ESP_ERR_INVALID_STATE, TAG, "LCD not initialized");
+
+    lcd_lock(handle);
+    *error = handle->fault->error.last;
+    lcd_unlock(handle);
+    return error->count ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+void lcd_error_reset(lcd_handle_t *handle)
+{
+    lcd_error_state_t *state = &handle->fault->error;
+
+    memset(state, 0, sizeof(lcd_error_state_t));
+    state->last.api = LCD_STATS_API_MAX;
+    // The first failure is always logged
+    state->logged_us = -LCD_ERROR_LOG_INTERVAL_US;
+}
+
+void lcd_error_begin(const lcd_handle_t *handle, uint8_t instruction, uint8_t mode)
+{
+    lcd_fault_t *fault = handle->fault;
+
+    if (!fault)
+        return;
+    fault->error.in_instruction = true;
+    fault->error.data = mode == LCD_WRITE;
+    fault->error.instruction = instruction;
+}
+
+void lcd_error_end(const lcd_handle_t *handle)
+{
+    if (handle->fault)
+        handle->fault->error.in_instruction = false;
+}
+
+void lcd_error_record(const lcd_handle_t *handle, lcd_error_layer_t layer, esp_err_t code, uint8_t expander)
+{
+    lcd_fault_t *fault = handle->fault;
+    lcd_error_state_t *state;
+
+    // A probe of an offline display is expected to fail, and the call
+    // it was made for fails as offline anyway
+    if (!fault || fault->reviving)
+        return;
+    state = &fault->error;
+    if (state->last.count < UINT32_MAX)
+        state->last.count++;
+    // The first failure explains the call. What follows from it, a failed
+    // clean up or the display going offline, is only counted.
+    if (state->pending)
+        return;
+    state->pending = true;
+    state->last.code = code;
+    state->last.layer = layer;
+    state->last.api = LCD_STATS_API_MAX;
+    state->last.address = handle->address;
+    state->last.in_instruction = state->in_instruction;
+    state->last.data = state->data;
+    state->last.instruction = state->instruction;
+    state->last.expander = expander;
+    state->last.time_us = esp_timer_get_time();
+}
+
+void lcd_error_report(lcd_handle_t *handle, lcd_stats_api_t api, esp_err_t result)
+{
+    lcd_error_state_t *state;
+    lcd_error_t error;
+    uint32_t suppressed = 0;
+    int64_t now;
+    bool log = false;
+    char what[48] = "";
+    char more[40] = "";
+
+    if (!handle || !handle->fault || !handle->fault->error.pending)
+        return;
+    state = &handle->fault->error;
+
+    lcd_lock(handle);
+    state->pending = false;
+    // A failure the call recovered from, like a resume that fell back to a reset
+    if (result == ESP_OK)
+    {
+        lcd_unlock(handle);
+        return;
+    }
+    state->last.api = api;
+    error = state->last;
+    // Going offline was logged once by the fault handling. Its calls
+    // failing from then on is what offline means.
+    if (error.layer != LCD_ERROR_LAYER_OFFLINE)
+    {
+        now = esp_timer_get_time();
+        if (now - state->logged_us >= LCD_ERROR_LOG_INTERVAL_US)
+        {
+            log = true;
+            suppressed = state->suppressed;
+            state->suppressed = 0;
+            state->logged_us = now;
+        }
+        else if (state->suppressed < UINT32_MAX)
+        {
+            state->suppressed++;
+        }
+    }
+    lcd_unlock(handle);
+    if (!log)
+        return;
+
+    switch (error.layer)
+    {
+    case LCD_ERROR_LAYER_BUS_WRITE:
+        snprintf(what, sizeof(what), "writing expander byte 0x%02x", error.expander);
+        break;
+    case LCD_ERROR_LAYER_BUS_READ:
+        snprintf(what, sizeof(what), "reading the expander");
+        break;
+    case LCD_ERROR_LAYER_CONTROLLER:
+        snprintf(what, sizeof(what), "on controller status 0x%02x", error.expander);
+        break;
+    default:
+        break;
+    }
+    if (suppressed)
+        snprintf(more, sizeof(more), " (%u failed calls not logged)", (unsigned)suppressed);
+    if (error.in_instruction)
+        ESP_LOGE(TAG, "LCD 0x%x lcd_%s: %s %s, sending %s 0x%02x%s", error.address, lcd_stats_api_name(api),
+                 esp_err_to_name(error.code), what, error.data ? "character" : "instruction", error.instruction,
+                 more);
+    else
+        ESP_LOGE(TAG, "LCD 0x%x lcd_%s: %s %s%s", error.address, lcd_stats_api_name(api),
+                 esp_err_to_name(error.code), what, more);
+}
@@ -0,0 +1,351 @@
+#include <stdlib.h>
+#include "driver/gpio.h"
+#include "driver/i2c.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+#include "rom/ets_sys.h"
+#include "lcd.h"
+#include "hd44780.h"
+#include "hd44780_fault.h"
+#include "hd44780_stats.h"
+
+// A display that stops answering costs its caller the timeout and retries of
+// each transaction, up to the error budget. From then on it is offline and
+// calls fail without touching the bus, so an unplugged display costs nothing
+// but a probe every CONFIG_LCD_REPROBE_INTERVAL_MS. The probe is made by
+// whichever task next sends the display an instruction, with the bus lock
+// held: for displays driven by the refresh scheduler, the display manager or
+// a service task, that is their own task, in the background. No task of its
+// own is needed, and none could safely reach a handle that has no lock.
+
+static const char *TAG = "LCD Fault";
+
+#define LCD_FAULT_CLEAR_CLOCKS 9     /*!< A byte and its acknowledge: as many clocks as a cut off device can want */
+#define LCD_FAULT_HALF_PERIOD_US 5   /*!< Half an SCL period while clearing the bus, 100 kHz */
+#define LCD_FAULT_SDA_SAMPLES 20     /*!< SDA samples, a byte and its acknowledge apart, that tell a stuck bus */
+
+typedef struct
+{
+    bool valid;
+    gpio_num_t sda;
+    gpio_num_t scl;
+} lcd_fault_pins_t;
+
+static lcd_fault_pins_t lcd_fault_pins[I2C_NUM_MAX] = {
+    [I2C_MASTER_NUM] = {true, I2C_MASTER_SDA_IO, I2C_MASTER_SCL_IO},
+};
+static portMUX_TYPE lcd_fault_spinlock = portMUX_INITIALIZER_UNLOCKED;
+// Displays on a port take turns here rather than in the I2C driver, whose
+// wait for the port shares the timeout of the transaction
+static SemaphoreHandle_t lcd_fault_port_locks[I2C_NUM_MAX];
+
+static bool lcd_fault_sda_held(const lcd_handle_t *handle);
+static esp_err_t lcd_fault_clear_bus(const lcd_handle_t *handle);
+static esp_err_t lcd_fault_revive(lcd_handle_t *handle);
+
+bool lcd_is_online(const lcd_handle_t *handle)
+{
+    return !handle || !handle->fault || !handle->fault->offline;
+}
+
+esp_err_t lcd_reprobe(lcd_handle_t *handle)
+{
+    esp_err_t ret = ESP_OK;
+
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(handle->initialized && handle->fault, ESP_ERR_INVALID_STATE, TAG, "LCD not initialized");
+
+    lcd_lock(handle);
+    if (handle->fault->offline)
+        ret = lcd_fault_revive(handle);
+    lcd_unlock(handle);
+    return ret;
+}
+
+esp_err_t lcd_set_recovery_pins(i2c_port_t port, gpio_num_t sda_io_num, gpio_num_t scl_io_num)
+{
+    ESP_RETURN_ON_FALSE(port >= 0 && port < I2C_NUM_MAX, ESP_ERR_INVALID_ARG, TAG, "Invalid I2C port");
+
+    portENTER_CRITICAL(&lcd_fault_spinlock);
+    lcd_fault_pins[port].valid = sda_io_num >= 0 && scl_io_num >= 0;
+    lcd_fault_pins[port].sda = sda_io_num;
+    lcd_fault_pins[port].scl = scl_io_num;
+    portEXIT_CRITICAL(&lcd_fault_spinlock);
+    return ESP_OK;
+}
+
+/**
+ * @brief Create the lock of an I2C port, once
+ */
+static esp_err_t lcd_fault_port_create(i2c_port_t port)
+{
+    SemaphoreHandle_t lock;
+
+    if (lcd_fault_port_locks[port])
+        return ESP_OK;
+    lock = xSemaphoreCreateMutex();
+    ESP_RETURN_ON_FALSE(lock, ESP_ERR_NO_MEM, TAG, "Unable to create port lock");
+    portENTER_CRITICAL(&lcd_fault_spinlock);
+    if (!lcd_fault_port_locks[port])
+    {
+        lcd_fault_port_locks[port] = lock;
+        lock = NULL;
+    }
+    portEXIT_CRITICAL(&lcd_fault_spinlock);
+    // Another display on the port got there first
+    if (lock)
+        vSemaphoreDelete(lock);
+    return ESP_OK;
+}
+
+esp_err_t lcd_fault_create(lcd_handle_t *handle)
+{
+    lcd_fault_t *fault = handle->fault;
+
+    if (!handle->transport && handle->i2c_port >= 0 && handle->i2c_port < I2C_NUM_MAX)
+        ESP_RETURN_ON_ERROR(lcd_fault_port_create(handle->i2c_port), TAG, "Unable to create port lock");
+    if (!fault)
+    {
+        fault = calloc(1, sizeof(lcd_fault_t));
+        ESP_RETURN_ON_FALSE(fault, ESP_ERR_NO_MEM, TAG, "Unable to allocate fault state");
+        handle->fault = fault;
+    }
+    fault->failures = 0;
+    fault->offline = false;
+    fault->reviving = false;
+    fault->port_busy = false;
+    lcd_error_reset(handle);
+    return ESP_OK;
+}
+
+void lcd_fault_free(lcd_handle_t *handle)
+{
+    lcd_fault_t *fault = handle->fault;
+
+    handle->fault = NULL;
+    free(fault);
+}
+
+TickType_t lcd_fault_ticks(const lcd_handle_t *handle)
+{
+    TickType_t ticks = pdMS_TO_TICKS(handle->timeout_ms ? handle->timeout_ms : LCD_I2C_TIMEOUT_MS);
+
+    // Rounded down to no ticks at all, a transaction could not even start
+    return ticks ? ticks : 1;
+}
+
+esp_err_t lcd_fault_port_take(const lcd_handle_t *handle)
+{
+    SemaphoreHandle_t lock = NULL;
+    bool busy;
+
+    if (handle->i2c_port >= 0 && handle->i2c_port < I2C_NUM_MAX)
+        lock = lcd_fault_port_locks[handle->i2c_port];
+    busy = lock && xSemaphoreTake(lock, pdMS_TO_TICKS(LCD_I2C_BUS_WAIT_MS)) != pdTRUE;
+    if (handle->fault)
+        handle->fault->port_busy = busy;
+    return busy ? ESP_ERR_TIMEOUT : ESP_OK;
+}
+
+void lcd_fault_port_give(const lcd_handle_t *handle)
+{
+    if (handle->i2c_port >= 0 && handle->i2c_port < I2C_NUM_MAX && lcd_fault_port_locks[handle->i2c_port])
+        xSemaphoreGive(lcd_fault_port_locks[handle->i2c_port]);
+}
+
+bool lcd_fault_offline(const lcd_handle_t *handle)
+{
+    const lcd_fault_t *fault = handle->fault;
+
+    return fault && fault->offline && !fault->reviving;
+}
+
+esp_err_t lcd_fault_admit(lcd_handle_t *handle)
+{
+    lcd_fault_t *fault = handle->fault;
+
+    if (!fault || !fault->offline || fault->reviving)
+        return ESP_OK;
+    // Recorded first, while the instruction is still the one the call sent
+    lcd_error_record(handle, LCD_ERROR_LAYER_OFFLINE, ESP_ERR_NOT_FOUND, 0);
+    // The instruction was meant for the controller as it was before the reset
+    if (esp_timer_get_time() >= fault->reprobe_us)
+        lcd_fault_revive(handle);
+    return ESP_ERR_NOT_FOUND;
+}
+
+bool lcd_fault_retry(const lcd_handle_t *handle, esp_err_t result, uint8_t attempt)
+{
+    // Neither a bad argument nor a missing I2C driver gets better by trying again.
+    // The bus is not cleared here: a timeout may only mean that another task
+    // has the port, and clearing would cut its transfer short.
+    if (attempt >= LCD_I2C_RETRIES || result == ESP_ERR_INVALID_ARG || result == ESP_ERR_INVALID_STATE)
+        return false;
+    lcd_stats_retry(handle);
+    return true;
+}
+
+void lcd_fault_result(const lcd_handle_t *handle, esp_err_t result)
+{
+    lcd_fault_t *fault = handle->fault;
+
+    if (!fault)
+        return;
+    if (result == ESP_OK)
+    {
+        fault->failures = 0;
+        return;
+    }
+    if (fault->offline || !handle->error_budget)
+        return;
+    // Waiting for other displays says nothing about this one
+    if (fault->port_busy)
+        return;
+    if (fault->failures < UINT8_MAX)
+        fault->failures++;
+    if (fault->failures < handle->error_budget)
+        return;
+    fault->offline = true;
+    fault->reprobe_us = esp_timer_get_time() + LCD_REPROBE_INTERVAL_US;
+    ESP_LOGW(TAG, "LCD 0x%x offline after %d failed transactions: %s", handle->address, fault->failures,
+             esp_err_to_name(result));
+}
+
+/**
+ * @brief Probe an offline display and reset it if it answers. Lock held.
+ */
+static esp_err_t lcd_fault_revive(lcd_handle_t *handle)
+{
+    lcd_fault_t *fault = handle->fault;
+    esp_err_t ret = ESP_OK;
+
+    fault->reprobe_us = esp_timer_get_time() + LCD_REPROBE_INTERVAL_US;
+    fault->reviving = true;
+    ret = lcd_hw_probe(handle);
+    if (ret == ESP_ERR_TIMEOUT && lcd_fault_sda_held(handle))
+        lcd_fault_clear_bus(handle);
+    else if (ret == ESP_OK)
+        ret = lcd_hw_reset(handle);
+    fault->reviving = false;
+    if (ret != ESP_OK)
+        return ESP_ERR_NOT_FOUND;
+
+    fault->offline = false;
+    fault->failures = 0;
+    ESP_LOGI(TAG, "LCD 0x%x back online", handle->address);
+    return ESP_OK;
+}
+
+#if CONFIG_LCD_BUS_RECOVERY
+
+/**
+ * @brief Recovery pins of the port of a handle driven by the I2C driver
+ */
+static bool lcd_fault_get_pins(const lcd_handle_t *handle, lcd_fault_pins_t *pins)
+{
+    // The kernel's I2C core recovers buses of its own adapters
+    if (handle->transport || handle->i2c_port < 0 || handle->i2c_port >= I2C_NUM_MAX)
+        return false;
+    portENTER_CRITICAL(&lcd_fault_spinlock);
+    *pins = lcd_fault_pins[handle->i2c_port];
+    portEXIT_CRITICAL(&lcd_fault_spinlock);
+    return pins->valid;
+}
+
+/**
+ * @brief Whether SDA stays low for as long as a byte and its acknowledge take
+ *
+ * @details Reads the pin without taking it from the peripheral, so a transfer
+ *          of another task on the port goes on undisturbed, and shows up here
+ *          as SDA going high at some point.
+ */
+static bool lcd_fault_sda_held(const lcd_handle_t *handle)
+{
+    lcd_fault_pins_t pins;
+
+    if (!lcd_fault_get_pins(handle, &pins))
+        return false;
+    for (int i = 0; i < LCD_FAULT_SDA_SAMPLES; ++i)
+    {
+        if (gpio_get_level(pins.sda))
+            return false;
+        ets_delay_us(LCD_FAULT_HALF_PERIOD_US);
+    }
+    return true;
+}
+
+/**
+ * @brief Clock SCL until SDA is released, then send a stop condition
+ *
+ * @details A device reset or cut off in the middle of a byte waits for the
+ *          clocks of the rest of it, holding SDA low whenever it sends a 0,
+ *          and no start condition gets through meanwhile. Other displays on
+ *          the port are failing too, so taking the pins from the peripheral
+ *          for a few tens of microseconds disturbs nothing that works.
+ */
+static esp_err_t lcd_fault_clear_bus(const lcd_handle_t *handle)
+{
+    lcd_fault_pins_t pins;
+    int clocks = 0;
+    bool released;
+
+    if (!lcd_fault_get_pins(handle, &pins))
+        return ESP_ERR_NOT_SUPPORTED;
+
+    // Open drain, so the device can still pull SDA low and be seen doing it
+    gpio_set_level(pins.sda, 1);
+    gpio_set_level(pins.scl, 1);
+    gpio_set_direction(pins.sda, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_direction(pins.scl, GPIO_MODE_INPUT_OUTPUT_OD);
+    ets_delay_us(LCD_FAULT_HALF_PERIOD_US);
+    while (!gpio_get_level(pins.sda) && clocks < LCD_FAULT_CLEAR_CLOCKS)
+    {
+        gpio_set_level(pins.scl, 0);
+        ets_delay_us(LCD_FAULT_HALF_PERIOD_US);
+        gpio_set_level(pins.scl, 1);
+        ets_delay_us(LCD_FAULT_HALF_PERIOD_US);
+        ++clocks;
+    }
+    released = gpio_get_level(pins.sda);
+
+    // Stop condition: SDA rises while SCL is high
+    gpio_set_level(pins.scl, 0);
+    ets_delay_us(LCD_FAULT_HALF_PERIOD_US);
+    gpio_set_level(pins.sda, 0);
+    ets_delay_us(LCD_FAULT_HALF_PERIOD_US);
+    gpio_set_level(pins.scl, 1);
+    ets_delay_us(LCD_FAULT_HALF_PERIOD_US);
+    gpio_set_level(pins.sda, 1);
+    ets_delay_us(LCD_FAULT_HALF_PERIOD_US);
+
+    // Back to the peripheral
+    ESP_RETURN_ON_ERROR(
+        i2c_set_pin(handle->i2c_port, pins.sda, pins.scl, GPIO_PULLUP_ENABLE, GPIO_PULLUP_ENABLE, I2C_MODE_MASTER),
+        TAG, "Error with i2c_set_pin()");
+    if (!released)
+    {
+        ESP_LOGW(TAG, "I2C port %d: SDA still held low after %d clocks", handle->i2c_port, clocks);
+        return ESP_ERR_TIMEOUT;
+    }
+    if (clocks)
+        ESP_LOGW(TAG, "I2C port %d: SDA released after %d clocks", handle->i2c_port, clocks);
+    return ESP_OK;
+}
+
+#else // CONFIG_LCD_BUS_RECOVERY
+
+static bool lcd_fault_sda_held(const lcd_handle_t *handle)
+{
+    return false;
+}
+
+static esp_err_t lcd_fault_clear_bus(const lcd_handle_t *handle)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif // CONFIG_LCD_BUS_RECOVERY
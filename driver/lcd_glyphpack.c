@@ -0,0 +1,237 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_rom_crc.h"
+#include "sdkconfig.h"
+#include "lcd.h"
+#include "hd44780_glyphpack.h"
+#include "hd44780_error.h"
+
+// Bitmaps compiled into the application sit in DRAM as soon as they are
+// copied into an array, and changing one means a new build. A glyph pack
+// keeps them in a partition of their own instead, mapped into the data
+// address space through the flash cache. The driver hands pointers into the
+// mapping to lcd_write_cgram(), so no glyph is ever copied to RAM, and the
+// artwork is updated by flashing the partition alone.
+
+static const char *TAG = "LCD Glyph Pack";
+
+/**
+ * @brief Bytes of data a directory entry must have, 0 if it makes no sense
+ */
+static size_t lcd_glyph_pack_entry_length(const lcd_glyph_pack_entry_t *entry)
+{
+    size_t bitmap = entry->glyphs * entry->rows;
+
+    if (entry->type == LCD_GLYPH_SET_ROM_MAP)
+        return entry->rows == 0 && entry->glyphs == 0 && entry->count == 1 ? 256 : 0;
+    if ((entry->rows != 8 && entry->rows != 10) || entry->glyphs == 0 || entry->first + entry->glyphs > 8 ||
+        entry->count == 0)
+        return 0;
+    switch (entry->type)
+    {
+    case LCD_GLYPH_SET_GLYPHS:
+        return entry->count == 1 ? bitmap : 0;
+    case LCD_GLYPH_SET_BIG_DIGITS:
+        if (entry->width == 0 || entry->height == 0)
+            return 0;
+        return bitmap + entry->count * (1 + entry->width * entry->height);
+    case LCD_GLYPH_SET_ANIMATION:
+        return entry->count * bitmap;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief Check a pack and make a handle for it
+ */
+static esp_err_t lcd_glyph_pack_attach(const uint8_t *data, size_t size, lcd_glyph_pack_t **pack)
+{
+    const lcd_glyph_pack_header_t *header = (const lcd_glyph_pack_header_t *)data;
+    const lcd_glyph_pack_entry_t *entries = (const lcd_glyph_pack_entry_t *)(header + 1);
+    lcd_glyph_pack_t *opened;
+
+    ESP_RETURN_ON_FALSE(size >= sizeof(*header), ESP_ERR_INVALID_SIZE, TAG, "Glyph pack truncated");
+    ESP_RETURN_ON_FALSE(header->magic == LCD_GLYPH_PACK_MAGIC && header->version == LCD_GLYPH_PACK_VERSION,
+                        ESP_ERR_INVALID_VERSION, TAG, "Not a glyph pack of version %d", LCD_GLYPH_PACK_VERSION);
+    ESP_RETURN_ON_FALSE(header->size <= size &&
+                            header->size >= sizeof(*header) + header->set_count * sizeof(*entries),
+                        ESP_ERR_INVALID_SIZE, TAG, "Glyph pack of %" PRIu32 " bytes truncated", header->size);
+    ESP_RETURN_ON_FALSE(esp_rom_crc32_le(0, data + sizeof(*header), header->size - sizeof(*header)) == header->crc,
+                        ESP_ERR_INVALID_CRC, TAG, "Glyph pack corrupt");
+    for (uint16_t i = 0; i < header->set_count; ++i)
+    {
+        const lcd_glyph_pack_entry_t *entry = &entries[i];
+        size_t length = lcd_glyph_pack_entry_length(entry);
+
+        ESP_RETURN_ON_FALSE(length && entry->length == length && entry->offset <= header->size &&
+                                entry->length <= header->size - entry->offset &&
+                                memchr(entry->name, '\0', sizeof(entry->name)),
+                            ESP_ERR_INVALID_VERSION, TAG, "Glyph set %d malformed", i);
+    }
+
+    opened = calloc(1, sizeof(lcd_glyph_pack_t));
+    ESP_RETURN_ON_FALSE(opened, ESP_ERR_NO_MEM, TAG, "Unable to allocate glyph pack");
+    opened->data = data;
+    opened->entries = entries;
+    opened->set_count = header->set_count;
+    *pack = opened;
+    return ESP_OK;
+}
+
+esp_err_t lcd_glyph_pack_open(const char *label, lcd_glyph_pack_t **pack)
+{
+#if CONFIG_LCD_GLYPH_PACK_PARTITION
+    esp_err_t ret;
+    const esp_partition_t *partition;
+    lcd_glyph_pack_header_t header;
+    const void *data;
+    lcd_glyph_pack_mmap_t mmap;
+
+    ESP_RETURN_ON_FALSE(label && pack, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    ESP_RETURN_ON_FALSE(partition, ESP_ERR_NOT_FOUND, TAG, "No partition %s", label);
+    // Map only as much as the pack takes
+    ESP_RETURN_ON_ERROR(
+        esp_partition_read(partition, 0, &header, sizeof(header)),
+        TAG, "Unable to read partition %s", label);
+    ESP_RETURN_ON_FALSE(header.magic == LCD_GLYPH_PACK_MAGIC && header.version == LCD_GLYPH_PACK_VERSION,
+                        ESP_ERR_INVALID_VERSION, TAG, "No glyph pack of version %d in partition %s",
+                        LCD_GLYPH_PACK_VERSION, label);
+    ESP_RETURN_ON_FALSE(header.size <= partition->size, ESP_ERR_INVALID_SIZE, TAG,
+                        "Glyph pack larger than partition %s", label);
+    ESP_RETURN_ON_ERROR(
+        esp_partition_mmap(partition, 0, header.size, LCD_GLYPH_PACK_MMAP_DATA, &data, &mmap),
+        TAG, "Unable to map partition %s", label);
+    ESP_GOTO_ON_ERROR(lcd_glyph_pack_attach(data, header.size, pack), err, TAG, "Invalid glyph pack in %s", label);
+    (*pack)->mapped = true;
+    (*pack)->mmap = mmap;
+    return ESP_OK;
+err:
+    lcd_glyph_pack_munmap(mmap);
+    return ret;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t lcd_glyph_pack_open_buffer(const void *data, size_t size, lcd_glyph_pack_t **pack)
+{
+    ESP_RETURN_ON_FALSE(data && pack && ((uintptr_t)data & 3) == 0, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    return lcd_glyph_pack_attach(data, size, pack);
+}
+
+void lcd_glyph_pack_close(lcd_glyph_pack_t *pack)
+{
+    if (!pack)
+        return;
+#if CONFIG_LCD_GLYPH_PACK_PARTITION
+    if (pack->mapped)
+        lcd_glyph_pack_munmap(pack->mmap);
+#endif
+    free(pack);
+}
+
+esp_err_t lcd_glyph_pack_find(const lcd_glyph_pack_t *pack, const char *name, lcd_glyph_set_t *set)
+{
+    ESP_RETURN_ON_FALSE(pack && name && set, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    for (uint16_t i = 0; i < pack->set_count; ++i)
+    {
+        const lcd_glyph_pack_entry_t *entry = &pack->entries[i];
+        const uint8_t *data = pack->data + entry->offset;
+
+        if (strncmp(entry->name, name, LCD_GLYPH_NAME_LEN) != 0)
+            continue;
+        *set = (lcd_glyph_set_t){
+            .type = entry->type,
+            .rows = entry->rows,
+            .glyphs = entry->glyphs,
+            .first = entry->first,
+            .width = entry->width,
+            .height = entry->height,
+            .count = entry->count,
+        };
+        if (entry->type == LCD_GLYPH_SET_ROM_MAP)
+        {
+            set->cells = data;
+        }
+        else
+        {
+            set->bitmaps = data;
+            if (entry->type == LCD_GLYPH_SET_BIG_DIGITS)
+            {
+                set->symbols = (const char *)data + entry->glyphs * entry->rows;
+                set->cells = (const uint8_t *)set->symbols + entry->count;
+            }
+        }
+        return ESP_OK;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t lcd_glyph_set_load(lcd_handle_t *handle, const lcd_glyph_set_t *set, uint16_t frame)
+{
+    const uint8_t *bitmaps;
+    uint8_t column;
+    uint8_t row;
+
+    ESP_RETURN_ON_FALSE(handle && set && set->bitmaps, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(frame < (set->type == LCD_GLYPH_SET_ANIMATION ? set->count : 1), ESP_ERR_INVALID_ARG, TAG,
+                        "No frame %d", frame);
+    ESP_RETURN_ON_FALSE(set->rows == ((handle->display_function & LCD_5x10DOTS) ? 10 : 8), ESP_ERR_INVALID_ARG,
+                        TAG, "Glyphs of %d rows for another font", set->rows);
+
+    // lcd_write_cgram() leaves the cursor at the home position
+    column = handle->cursor_column;
+    row = handle->cursor_row;
+    bitmaps = set->bitmaps + frame * set->glyphs * set->rows;
+    for (uint8_t i = 0; i < set->glyphs; ++i)
+        LCD_RETURN_ON_ERROR(lcd_write_cgram(handle, set->first + i, bitmaps + i * set->rows));
+    return lcd_set_cursor(handle, column, row);
+}
+
+esp_err_t lcd_glyph_set_write_big(lcd_handle_t *handle, const lcd_glyph_set_t *set, char symbol, uint8_t column,
+                                  uint8_t row)
+{
+    const uint8_t *cells;
+    const char *found;
+
+    ESP_RETURN_ON_FALSE(handle && set && set->type == LCD_GLYPH_SET_BIG_DIGITS, ESP_ERR_INVALID_ARG, TAG,
+                        "Invalid argument");
+    ESP_RETURN_ON_FALSE(column + set->width <= handle->columns && row + set->height <= handle->rows,
+                        ESP_ERR_INVALID_ARG, TAG, "Symbol at %d, %d does not fit", column, row);
+    found = memchr(set->symbols, symbol, set->count);
+    if (!found)
+        return ESP_ERR_NOT_FOUND;
+
+    cells = set->cells + (found - set->symbols) * set->width * set->height;
+    // Bottom row first, so the cursor ends up after the top row
+    for (uint8_t r = set->height; r-- > 0;)
+    {
+        LCD_RETURN_ON_ERROR(lcd_set_cursor(handle, column, row + r));
+        for (uint8_t c = 0; c < set->width; ++c)
+            LCD_RETURN_ON_ERROR(lcd_write_char(handle, cells[r * set->width + c]));
+    }
+    return ESP_OK;
+}
+
+esp_err_t lcd_glyph_set_write_str(lcd_handle_t *handle, const lcd_glyph_set_t *set, const char *str)
+{
+    ESP_RETURN_ON_FALSE(handle && set && str && set->type == LCD_GLYPH_SET_ROM_MAP, ESP_ERR_INVALID_ARG, TAG,
+                        "Invalid argument");
+
+    for (const uint8_t *s = (const uint8_t *)str; *s; ++s)
+    {
+        uint8_t code = *s;
+
+        // U+0080 to U+00FF in UTF-8
+        if ((code == 0xC2 || code == 0xC3) && (s[1] & 0xC0) == 0x80)
+            code = ((code & 0x03) << 6) | (*++s & 0x3F);
+        LCD_RETURN_ON_ERROR(lcd_write_char(handle, set->cells[code]));
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,584 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+#include "lcd.h"
+#include "hd44780.h"
+#include "hd44780_refresh.h"
+#include "hd44780_manager.h"
+#include "hd44780_pacing.h"
+#include "hd44780_warm.h"
+#include "hd44780_sleep.h"
+#include "hd44780_stats.h"
+#include "hd44780_fault.h"
+#include "hd44780_error.h"
+#include "hd44780_pinmap.h"
+
+// The manager keeps a fixed registry of displays and runs one task per I2C
+// port. Displays on different ports never wait for each other; displays on
+// the same port share the bus in rounds. In each round every dirty display
+// gets one turn of at most its budget of cells, and the display that starts
+// the round rotates, so a display that is rewritten continuously cannot
+// starve its neighbours. Rounds repeat until the bus is clean or a frame
+// period has been spent.
+//
+// Within a round the turns of the displays are interleaved instruction by
+// instruction. A Clear keeps its controller busy for 1.52 ms and a character
+// for 37 us; while one controller executes, the bus carries instructions for
+// the others instead of idling. The longest wait of all, the settle time of
+// every nibble, is shared too: the next instructions of all the displays that
+// are ready go out together, nibble by nibble in lockstep, so one settle time
+// serves every display on the bus rather than one.
+
+static const char *TAG = "LCD Manager";
+
+static void lcd_manager_bus_task(void *arg);
+static lcd_manager_display_t *lcd_manager_lookup(lcd_manager_t *manager, const lcd_handle_t *handle);
+static lcd_manager_display_t *lcd_manager_locate(lcd_manager_t *manager, i2c_port_t port, uint8_t address);
+static esp_err_t lcd_manager_start_bus(lcd_manager_t *manager, lcd_manager_bus_t *bus);
+static void lcd_manager_stop_bus(lcd_manager_bus_t *bus);
+static void lcd_manager_release(lcd_manager_t *manager, lcd_manager_display_t *display);
+static bool lcd_manager_bus_round(lcd_manager_t *manager, lcd_manager_bus_t *bus);
+
+esp_err_t lcd_manager_create(const lcd_manager_config_t *config, lcd_manager_t **manager)
+{
+    esp_err_t ret = ESP_OK;
+    lcd_manager_t *mgr = NULL;
+
+    ESP_RETURN_ON_FALSE(config && manager && config->max_fps && config->display_budget,
+                        ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    mgr = calloc(1, sizeof(lcd_manager_t));
+    ESP_RETURN_ON_FALSE(mgr, ESP_ERR_NO_MEM, TAG, "Unable to allocate manager");
+    mgr->config = *config;
+    mgr->lock = xSemaphoreCreateMutex();
+    ESP_GOTO_ON_FALSE(mgr->lock, ESP_ERR_NO_MEM, err, TAG, "Unable to create manager lock");
+    for (int p = 0; p < I2C_NUM_MAX; ++p)
+    {
+        mgr->buses[p].manager = mgr;
+        mgr->buses[p].port = p;
+        mgr->buses[p].lock = xSemaphoreCreateMutex();
+        ESP_GOTO_ON_FALSE(mgr->buses[p].lock, ESP_ERR_NO_MEM, err, TAG, "Unable to create bus lock");
+    }
+
+    *manager = mgr;
+    return ESP_OK;
+err:
+    for (int p = 0; p < I2C_NUM_MAX; ++p)
+    {
+        if (mgr->buses[p].lock)
+            vSemaphoreDelete(mgr->buses[p].lock);
+    }
+    if (mgr->lock)
+        vSemaphoreDelete(mgr->lock);
+    free(mgr);
+    return ret;
+}
+
+esp_err_t lcd_manager_delete(lcd_manager_t *manager)
+{
+    ESP_RETURN_ON_FALSE(manager, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    xSemaphoreTake(manager->lock, portMAX_DELAY);
+    for (int i = 0; i < LCD_MANAGER_MAX_DISPLAYS; ++i)
+    {
+        if (manager->displays[i].active)
+            lcd_manager_release(manager, &manager->displays[i]);
+    }
+    for (int p = 0; p < I2C_NUM_MAX; ++p)
+    {
+        lcd_manager_stop_bus(&manager->buses[p]);
+        vSemaphoreDelete(manager->buses[p].lock);
+    }
+    xSemaphoreGive(manager->lock);
+    vSemaphoreDelete(manager->lock);
+    free(manager);
+    return ESP_OK;
+}
+
+/**
+ * @brief Copy the public configuration of a handle into a cleared one
+ *
+ * @details Field by field, so that no private state of the caller's handle,
+ *          present or added later, is shared with the managed copy.
+ */
+static void lcd_manager_configure(lcd_handle_t *handle, const lcd_handle_t *config)
+{
+    handle->i2c_port = config->i2c_port;
+    handle->address = config->address;
+    handle->columns = config->columns;
+    handle->rows = config->rows;
+    handle->display_function = config->display_function;
+    handle->display_control = config->display_control;
+    handle->display_mode = config->display_mode;
+    handle->cursor_column = config->cursor_column;
+    handle->cursor_row = config->cursor_row;
+    handle->backlight = config->backlight;
+    handle->transport = config->transport;
+    handle->timeout_ms = config->timeout_ms;
+    handle->error_budget = config->error_budget;
+    handle->pinmap = config->pinmap;
+}
+
+esp_err_t lcd_manager_add(lcd_manager_t *manager, const lcd_handle_t *config, uint16_t budget,
+                          lcd_handle_t **handle)
+{
+    esp_err_t ret = ESP_OK;
+    lcd_manager_display_t *display = NULL;
+    lcd_handle_t *managed;
+    lcd_manager_bus_t *bus;
+    lcd_refresh_config_t refresh_config = LCD_REFRESH_DEFAULT_CONFIG();
+
+    ESP_RETURN_ON_FALSE(manager && config && handle, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(config->i2c_port >= 0 && config->i2c_port < I2C_NUM_MAX,
+                        ESP_ERR_INVALID_ARG, TAG, "Invalid I2C port");
+    bus = &manager->buses[config->i2c_port];
+
+    xSemaphoreTake(manager->lock, portMAX_DELAY);
+    ESP_GOTO_ON_FALSE(!lcd_manager_locate(manager, config->i2c_port, config->address),
+                      ESP_ERR_INVALID_STATE, err, TAG, "LCD 0x%x already managed", config->address);
+    for (int i = 0; i < LCD_MANAGER_MAX_DISPLAYS && !display; ++i)
+    {
+        if (!manager->displays[i].active)
+            display = &manager->displays[i];
+    }
+    ESP_GOTO_ON_FALSE(display, ESP_ERR_NO_MEM, err, TAG, "Manager full");
+
+    memset(display, 0, sizeof(lcd_manager_display_t));
+    managed = &display->handle;
+    lcd_manager_configure(managed, config);
+    display->budget = budget ? budget : manager->config.display_budget;
+
+    // Not lcd_init(), which may enable a scheduler of its own. A failed
+    // initialisation may leave its pacer, counters, fault state, encoding
+    // and RTC slots behind; release frees them.
+    ESP_GOTO_ON_ERROR(
+        lcd_hw_init(&managed, 1),
+        release, TAG, "Error with lcd_hw_init()");
+    refresh_config.max_fps = manager->config.max_fps;
+    refresh_config.create_task = false;
+    ESP_GOTO_ON_ERROR(
+        lcd_refresh_enable(&display->handle, &refresh_config),
+        release, TAG, "Error with lcd_refresh_enable()");
+    if (manager->config.create_task)
+    {
+        ESP_GOTO_ON_ERROR(
+            lcd_manager_start_bus(manager, bus),
+            release, TAG, "Error with lcd_manager_start_bus()");
+        lcd_refresh_set_notify(&display->handle, bus->task);
+    }
+
+    xSemaphoreTake(bus->lock, portMAX_DELAY);
+    display->active = true;
+    xSemaphoreGive(bus->lock);
+    xSemaphoreGive(manager->lock);
+
+    ESP_LOGD(TAG, "LCD 0x%x on I2C%d added with a budget of %d cells",
+             config->address, config->i2c_port, display->budget);
+    *handle = &display->handle;
+    return ESP_OK;
+release:
+    lcd_manager_release(manager, display);
+err:
+    xSemaphoreGive(manager->lock);
+    return ret;
+}
+
+esp_err_t lcd_manager_flush(lcd_manager_t *manager, i2c_port_t port)
+{
+    lcd_manager_bus_t *bus;
+
+    ESP_RETURN_ON_FALSE(manager && port >= 0 && port < I2C_NUM_MAX, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    bus = &manager->buses[port];
+
+    xSemaphoreTake(bus->lock, portMAX_DELAY);
+    while (lcd_manager_bus_round(manager, bus))
+        ;
+    xSemaphoreGive(bus->lock);
+    return ESP_OK;
+}
+
+esp_err_t lcd_manager_remove(lcd_manager_t *manager, lcd_handle_t *handle)
+{
+    lcd_manager_display_t *display;
+
+    ESP_RETURN_ON_FALSE(manager && handle, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    xSemaphoreTake(manager->lock, portMAX_DELAY);
+    display = lcd_manager_lookup(manager, handle);
+    if (!display)
+    {
+        xSemaphoreGive(manager->lock);
+        ESP_LOGE(TAG, "Handle not owned by this manager");
+        return ESP_ERR_NOT_FOUND;
+    }
+    lcd_manager_release(manager, display);
+    xSemaphoreGive(manager->lock);
+    return ESP_OK;
+}
+
+lcd_handle_t *lcd_manager_find(lcd_manager_t *manager, i2c_port_t port, uint8_t address)
+{
+    lcd_manager_display_t *display;
+
+    if (!manager)
+        return NULL;
+
+    xSemaphoreTake(manager->lock, portMAX_DELAY);
+    display = lcd_manager_locate(manager, port, address);
+    xSemaphoreGive(manager->lock);
+    return display ? &display->handle : NULL;
+}
+
+esp_err_t lcd_manager_set_budget(lcd_manager_t *manager, lcd_handle_t *handle, uint16_t budget)
+{
+    lcd_manager_display_t *display;
+
+    ESP_RETURN_ON_FALSE(manager && handle, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    xSemaphoreTake(manager->lock, portMAX_DELAY);
+    display = lcd_manager_lookup(manager, handle);
+    if (display)
+        display->budget = budget ? budget : manager->config.display_budget;
+    xSemaphoreGive(manager->lock);
+    ESP_RETURN_ON_FALSE(display, ESP_ERR_NOT_FOUND, TAG, "Handle not owned by this manager");
+    return ESP_OK;
+}
+
+esp_err_t lcd_manager_get_status(lcd_manager_t *manager, const lcd_handle_t *handle,
+                                 lcd_manager_status_t *status)
+{
+    lcd_manager_display_t *display;
+
+    ESP_RETURN_ON_FALSE(manager && handle && status, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    // Holding the lock keeps lcd_manager_remove() from releasing the display meanwhile
+    xSemaphoreTake(manager->lock, portMAX_DELAY);
+    display = lcd_manager_lookup(manager, handle);
+    if (display)
+    {
+        status->i2c_port = display->handle.i2c_port;
+        status->address = display->handle.address;
+        status->budget = display->budget;
+        status->pending = lcd_refresh_pending(&display->handle);
+        status->staleness_us = lcd_refresh_staleness_us(&display->handle);
+        status->cells_sent = display->cells_sent;
+        status->turns = display->turns;
+        status->last_error = display->last_error;
+    }
+    xSemaphoreGive(manager->lock);
+    ESP_RETURN_ON_FALSE(display, ESP_ERR_NOT_FOUND, TAG, "Handle not owned by this manager");
+    return ESP_OK;
+}
+
+/**
+ * @brief Active display with a handle, or NULL
+ *
+ * @details Caller holds manager->lock.
+ */
+static lcd_manager_display_t *lcd_manager_lookup(lcd_manager_t *manager, const lcd_handle_t *handle)
+{
+    for (int i = 0; i < LCD_MANAGER_MAX_DISPLAYS; ++i)
+    {
+        if (manager->displays[i].active && &manager->displays[i].handle == handle)
+            return &manager->displays[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Active display at a bus location, or NULL
+ *
+ * @details Caller holds manager->lock.
+ */
+static lcd_manager_display_t *lcd_manager_locate(lcd_manager_t *manager, i2c_port_t port, uint8_t address)
+{
+    for (int i = 0; i < LCD_MANAGER_MAX_DISPLAYS; ++i)
+    {
+        lcd_manager_display_t *display = &manager->displays[i];
+
+        if (display->active && display->handle.i2c_port == port && display->handle.address == address)
+            return display;
+    }
+    return NULL;
+}
+
+static esp_err_t lcd_manager_start_bus(lcd_manager_t *manager, lcd_manager_bus_t *bus)
+{
+    char name[configMAX_TASK_NAME_LEN];
+
+    if (bus->task)
+        return ESP_OK;
+
+    snprintf(name, sizeof(name), "lcd_bus%d", bus->port);
+    bus->running = true;
+    bus->last_pass_us = esp_timer_get_time();
+    if (xTaskCreatePinnedToCore(lcd_manager_bus_task, name, manager->config.stack_size, bus,
+                                manager->config.priority, &bus->task, manager->config.core_id) != pdPASS)
+    {
+        bus->running = false;
+        bus->task = NULL;
+        ESP_LOGE(TAG, "Unable to create bus task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+static void lcd_manager_stop_bus(lcd_manager_bus_t *bus)
+{
+    if (!bus->task)
+        return;
+
+    bus->running = false;
+    xTaskNotifyGive(bus->task);
+    // The task clears its handle just before deleting itself
+    while (*(volatile TaskHandle_t *)&bus->task != NULL)
+        vTaskDelay(1);
+}
+
+/**
+ * @brief Take a display out of its bus rotation, flush it and free its resources
+ *
+ * @details Caller holds manager->lock.
+ */
+static void lcd_manager_release(lcd_manager_t *manager, lcd_manager_display_t *display)
+{
+    lcd_manager_bus_t *bus = &manager->buses[display->handle.i2c_port];
+
+    xSemaphoreTake(bus->lock, portMAX_DELAY);
+    display->active = false;
+    xSemaphoreGive(bus->lock);
+
+    if (display->handle.refresh)
+        lcd_refresh_disable(&display->handle);
+    if (display->handle.backlight_pwm)
+        lcd_backlight_pwm_disable(&display->handle);
+    lcd_pacer_free(&display->handle);
+    lcd_counters_free(&display->handle);
+    lcd_fault_free(&display->handle);
+    lcd_encoding_free(&display->handle);
+    lcd_warm_detach(&display->handle);
+    lcd_sleep_detach(&display->handle);
+    if (display->handle.lock)
+        vSemaphoreDelete(display->handle.lock);
+    memset(display, 0, sizeof(lcd_manager_display_t));
+}
+
+/**
+ * @brief Check the displays of a bus for pending cells
+ *
+ * @param[out] urgent Set if any display has urgent cells pending
+ *
+ * @return true if any display has pending cells
+ */
+static bool lcd_manager_bus_pending(lcd_manager_t *manager, lcd_manager_bus_t *bus, bool *urgent)
+{
+    bool pending = false;
+
+    *urgent = false;
+    for (int i = 0; i < LCD_MANAGER_MAX_DISPLAYS; ++i)
+    {
+        lcd_manager_display_t *display = &manager->displays[i];
+
+        if (!display->active || display->handle.i2c_port != bus->port)
+            continue;
+        if (lcd_refresh_has_work(&display->handle))
+        {
+            pending = true;
+            *urgent |= lcd_refresh_is_urgent(&display->handle);
+        }
+    }
+    return pending;
+}
+
+/**
+ * @brief End the turn of a display and account for it
+ *
+ * @return true if the turn sent any cell
+ */
+static bool lcd_manager_end_turn(lcd_manager_display_t *display, uint16_t sent)
+{
+    if (display->last_error == ESP_OK)
+        display->last_error = lcd_refresh_end(&display->handle);
+    else
+        lcd_refresh_end(&display->handle);
+    lcd_error_report(&display->handle, LCD_STATS_API_FLUSH, display->last_error);
+    if (!sent)
+        return false;
+    display->cells_sent += sent;
+    display->turns++;
+    return true;
+}
+
+/**
+ * @brief Run one round: every dirty display of the bus sends up to its budget
+ *
+ * @details The turns of the displays advance together, one instruction each
+ *          at a time. The displays that will be ready by the time a nibble
+ *          has settled are sent their next instruction with
+ *          lcd_hw_transfer_many(), which waits the settle time once for all of
+ *          them. A display still executing a long instruction sits the batch
+ *          out rather than hold the others up, and the bus only waits when
+ *          every display with work left is busy.
+ *
+ * @return true if any cell was sent
+ */
+static bool lcd_manager_bus_round(lcd_manager_t *manager, lcd_manager_bus_t *bus)
+{
+    lcd_manager_display_t *open[LCD_MANAGER_MAX_DISPLAYS];
+    uint16_t sent[LCD_MANAGER_MAX_DISPLAYS];
+    lcd_hw_xfer_t xfers[LCD_MANAGER_MAX_DISPLAYS];
+    int batch[LCD_MANAGER_MAX_DISPLAYS];
+    int nopen = 0;
+    int first = -1;
+    bool progress = false;
+
+    for (int n = 0; n < LCD_MANAGER_MAX_DISPLAYS; ++n)
+    {
+        int slot = (bus->next + n) % LCD_MANAGER_MAX_DISPLAYS;
+        lcd_manager_display_t *display = &manager->displays[slot];
+
+        if (!display->active || display->handle.i2c_port != bus->port ||
+            !lcd_refresh_has_work(&display->handle))
+            continue;
+        if (first < 0)
+            first = slot;
+        lcd_refresh_begin(&display->handle, display->budget);
+        display->last_error = ESP_OK;
+        sent[nopen] = 0;
+        open[nopen++] = display;
+    }
+
+    while (nopen > 0)
+    {
+        int64_t now = esp_timer_get_time();
+        int earliest = -1;
+        int nbatch = 0;
+
+        for (int i = 0; i < nopen;)
+        {
+            lcd_manager_display_t *display = open[i];
+
+            // Its nibble is clocked after the settle time, not now
+            if (display->handle.busy_until_us > now + LCD_PRE_PULSE_DELAY_US)
+            {
+                if (earliest < 0 || display->handle.busy_until_us < open[earliest]->handle.busy_until_us)
+                    earliest = i;
+                ++i;
+                continue;
+            }
+            if (lcd_refresh_next(&display->handle, &xfers[nbatch]))
+            {
+                batch[nbatch++] = i++;
+                continue;
+            }
+
+            // Turn over. Close it and keep the remaining turns in order.
+            progress |= lcd_manager_end_turn(display, sent[i]);
+            if (earliest > i)
+                earliest--;
+            memmove(&open[i], &open[i + 1], (nopen - i - 1) * sizeof(open[0]));
+            memmove(&sent[i], &sent[i + 1], (nopen - i - 1) * sizeof(sent[0]));
+            nopen--;
+        }
+
+        if (nbatch)
+        {
+            lcd_hw_transfer_many(xfers, nbatch);
+            // Backwards, so closing a turn leaves the batch entries before it in place
+            for (int k = nbatch - 1; k >= 0; --k)
+            {
+                int i = batch[k];
+                lcd_manager_display_t *display = open[i];
+                bool done = false;
+
+                lcd_refresh_sent(&display->handle, &xfers[k], &done, &sent[i]);
+                display->last_error = xfers[k].result;
+                if (!done && display->last_error == ESP_OK)
+                    continue;
+                progress |= lcd_manager_end_turn(display, sent[i]);
+                memmove(&open[i], &open[i + 1], (nopen - i - 1) * sizeof(open[0]));
+                memmove(&sent[i], &sent[i + 1], (nopen - i - 1) * sizeof(sent[0]));
+                nopen--;
+            }
+        }
+        else if (earliest >= 0)
+        {
+            // Every display with work left is executing an instruction
+            int64_t wait = open[earliest]->handle.busy_until_us - LCD_PRE_PULSE_DELAY_US - now;
+
+            if (wait > 0)
+                lcd_delay_us(&open[earliest]->handle, wait);
+        }
+    }
+    // The next round starts with the display after the one that started this
+    // one, rather than at the next registry slot, which is most likely empty
+    if (first >= 0)
+        bus->next = (first + 1) % LCD_MANAGER_MAX_DISPLAYS;
+    return progress;
+}
+
+/**
+ * @brief Serve the displays of a bus in rounds until they are clean or a
+ *        frame period has been spent
+ *
+ * @details Caller holds bus->lock.
+ */
+static void lcd_manager_bus_pass(lcd_manager_t *manager, lcd_manager_bus_t *bus, int64_t period_us)
+{
+    int64_t start = esp_timer_get_time();
+
+    while ((esp_timer_get_time() - start) < period_us && lcd_manager_bus_round(manager, bus))
+        ;
+}
+
+static void lcd_manager_bus_task(void *arg)
+{
+    lcd_manager_bus_t *bus = arg;
+    lcd_manager_t *manager = bus->manager;
+    const int64_t period_us = 1000000 / manager->config.max_fps;
+    TickType_t wait = portMAX_DELAY;
+
+    while (bus->running)
+    {
+        bool pending;
+        bool urgent;
+        int64_t elapsed;
+
+        ulTaskNotifyTake(pdTRUE, wait);
+        if (!bus->running)
+            break;
+
+        xSemaphoreTake(bus->lock, portMAX_DELAY);
+        pending = lcd_manager_bus_pending(manager, bus, &urgent);
+        elapsed = esp_timer_get_time() - bus->last_pass_us;
+        if (pending && (urgent || elapsed >= period_us))
+        {
+            lcd_manager_bus_pass(manager, bus, period_us);
+            bus->last_pass_us = esp_timer_get_time();
+            elapsed = 0;
+            pending = lcd_manager_bus_pending(manager, bus, &urgent);
+        }
+        xSemaphoreGive(bus->lock);
+
+        if (pending)
+        {
+            wait = pdMS_TO_TICKS((period_us - elapsed) / 1000);
+            if (wait == 0)
+                wait = 1;
+        }
+        else
+        {
+            wait = portMAX_DELAY;
+        }
+    }
+
+    bus->task = NULL;
+    vTaskDelete(NULL);
+}
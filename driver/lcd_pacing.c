@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "rom/ets_sys.h"
+#include "sdkconfig.h"
+#include "lcd.h"
+#include "hd44780.h"
+#include "hd44780_pacing.h"
+#include "hd44780_stats.h"
+
+// Most of the time spent driving an HD44780 over I2C is waiting: for the
+// pre-pulse settle time of every nibble and for the controller to execute
+// each instruction. Waiting in ets_delay_us() keeps a core at 100 % for all
+// of it. Waits long enough to pay for two context switches block the task on
+// a one-shot esp_timer instead, so the CPU is free for other work meanwhile.
+// With the default settle time that is every nibble: two task switches per
+// character in place of 2 ms of spinning, see lcd_bench's cpu_pct.
+
+static const char *TAG = "LCD Pacing";
+
+static void lcd_pacer_expired(void *arg);
+
+esp_err_t lcd_pacing_get_stats(lcd_handle_t *handle, lcd_pacing_stats_t *stats, bool reset)
+{
+    ESP_RETURN_ON_FALSE(handle && stats, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(handle->pacer, ESP_ERR_INVALID_STATE, TAG, "LCD not initialized");
+
+    *stats = handle->pacer->stats;
+    if (reset)
+        memset(&handle->pacer->stats, 0, sizeof(handle->pacer->stats));
+    return ESP_OK;
+}
+
+esp_err_t lcd_pacer_create(lcd_handle_t *handle)
+{
+    esp_err_t ret = ESP_OK;
+    lcd_pacer_t *pacer;
+
+    if (handle->pacer)
+        return ESP_OK;
+    pacer = calloc(1, sizeof(lcd_pacer_t));
+    ESP_RETURN_ON_FALSE(pacer, ESP_ERR_NO_MEM, TAG, "Unable to allocate pacer");
+    pacer->done = xSemaphoreCreateBinaryStatic(&pacer->done_buffer);
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = lcd_pacer_expired,
+        .arg = pacer,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "lcd_pacer",
+    };
+    ESP_GOTO_ON_ERROR(
+        esp_timer_create(&timer_args, &pacer->timer),
+        err, TAG, "Unable to create wait timer");
+    handle->pacer = pacer;
+    return ESP_OK;
+err:
+    free(pacer);
+    return ret;
+}
+
+void lcd_pacer_free(lcd_handle_t *handle)
+{
+    lcd_pacer_t *pacer = handle->pacer;
+
+    if (!pacer)
+        return;
+    handle->pacer = NULL;
+    esp_timer_stop(pacer->timer);
+    esp_timer_delete(pacer->timer);
+    free(pacer);
+}
+
+void lcd_delay_us(const lcd_handle_t *handle, uint32_t us)
+{
+    lcd_pacer_t *pacer = handle->pacer;
+    int64_t start = esp_timer_get_time();
+
+    if (!us)
+        return;
+    if (LCD_PACING_YIELD && pacer && us >= LCD_YIELD_THRESHOLD_US &&
+        xTaskGetSchedulerState() == taskSCHEDULER_RUNNING &&
+        esp_timer_start_once(pacer->timer, us) == ESP_OK)
+    {
+        xSemaphoreTake(pacer->done, portMAX_DELAY);
+        pacer->stats.yields++;
+        pacer->stats.yield_us += esp_timer_get_time() - start;
+        lcd_stats_wait(handle, esp_timer_get_time() - start);
+        return;
+    }
+
+    ets_delay_us(us);
+    if (pacer)
+    {
+        pacer->stats.spins++;
+        pacer->stats.spin_us += esp_timer_get_time() - start;
+    }
+    lcd_stats_wait(handle, esp_timer_get_time() - start);
+}
+
+static void lcd_pacer_expired(void *arg)
+{
+    lcd_pacer_t *pacer = arg;
+
+    xSemaphoreGive(pacer->done);
+}
@@ -0,0 +1,163 @@
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "sdkconfig.h"
+#include "lcd.h"
+#include "hd44780.h"
+#include "hd44780_pinmap.h"
+
+// Sending a byte to the controller takes six expander bytes, each a mix of
+// the byte's bits scattered over the data pins, E, RS, RW and the
+// backlight. Rather than work out the scatter for every nibble, each pin map
+// has the data lines and E of all 256 byte values laid out once: at compile
+// time for the menuconfig pin map, by lcd_init() for a handle with a pin map
+// of its own. Encoding a byte is then a copy of its six bytes, with RS and
+// the backlight ORed in.
+
+static const char *TAG = "LCD Pin Map";
+
+_Static_assert(((1 << CONFIG_LCD_PIN_RS) | (1 << CONFIG_LCD_PIN_RW) | (1 << CONFIG_LCD_PIN_E) |
+                (1 << CONFIG_LCD_PIN_BL) | (1 << CONFIG_LCD_PIN_D4) | (1 << CONFIG_LCD_PIN_D5) |
+                (1 << CONFIG_LCD_PIN_D6) | (1 << CONFIG_LCD_PIN_D7)) == 0xFF,
+               "Every line of the expander pin map needs a pin of its own");
+
+#define LCD_PIN(line) (1 << CONFIG_LCD_PIN_##line)
+#define LCD_NIBBLE(n) ((((n) & 0x1) ? LCD_PIN(D4) : 0) | (((n) & 0x2) ? LCD_PIN(D5) : 0) | \
+                       (((n) & 0x4) ? LCD_PIN(D6) : 0) | (((n) & 0x8) ? LCD_PIN(D7) : 0))
+#define LCD_SEQ(b)                                                               \
+    {                                                                            \
+        LCD_NIBBLE((b) >> 4), LCD_NIBBLE((b) >> 4) | LCD_PIN(E), LCD_NIBBLE((b) >> 4), \
+            LCD_NIBBLE(b), LCD_NIBBLE(b) | LCD_PIN(E), LCD_NIBBLE(b)             \
+    }
+#define LCD_SEQ4(b) LCD_SEQ(b), LCD_SEQ((b) + 1), LCD_SEQ((b) + 2), LCD_SEQ((b) + 3)
+#define LCD_SEQ16(b) LCD_SEQ4(b), LCD_SEQ4((b) + 4), LCD_SEQ4((b) + 8), LCD_SEQ4((b) + 12)
+#define LCD_SEQ64(b) LCD_SEQ16(b), LCD_SEQ16((b) + 16), LCD_SEQ16((b) + 32), LCD_SEQ16((b) + 48)
+
+const lcd_encoding_t lcd_encoding_config = {
+    .seq = {LCD_SEQ64(0), LCD_SEQ64(64), LCD_SEQ64(128), LCD_SEQ64(192)},
+    .mode = {
+        [LCD_COMMAND] = 0,
+        [LCD_WRITE] = LCD_PIN(RS),
+        [LCD_READ] = LCD_PIN(RW),
+        [LCD_READ | LCD_WRITE] = LCD_PIN(RS) | LCD_PIN(RW),
+    },
+    .enable = LCD_PIN(E),
+    .backlight = LCD_PIN(BL),
+    .data = {LCD_PIN(D4), LCD_PIN(D5), LCD_PIN(D6), LCD_PIN(D7)},
+    .remapped = CONFIG_LCD_PIN_RS != 0 || CONFIG_LCD_PIN_RW != 1 || CONFIG_LCD_PIN_E != 2 ||
+                CONFIG_LCD_PIN_BL != 3 || CONFIG_LCD_PIN_D4 != 4 || CONFIG_LCD_PIN_D5 != 5 ||
+                CONFIG_LCD_PIN_D6 != 6 || CONFIG_LCD_PIN_D7 != 7,
+};
+
+static const lcd_pinmap_t lcd_pinmap_config = LCD_PINMAP_DEFAULT_CONFIG();
+
+/**
+ * @brief Lay out the expander bytes of a pin map checked by the caller
+ */
+static void lcd_encoding_build(lcd_encoding_t *encoding, const lcd_pinmap_t *map)
+{
+    const uint8_t pins[] = {map->rs, map->rw, map->en, map->bl, map->d4, map->d5, map->d6, map->d7};
+    uint8_t nibbles[16];
+
+    encoding->enable = 1 << map->en;
+    encoding->backlight = 1 << map->bl;
+    encoding->data[0] = 1 << map->d4;
+    encoding->data[1] = 1 << map->d5;
+    encoding->data[2] = 1 << map->d6;
+    encoding->data[3] = 1 << map->d7;
+    encoding->mode[LCD_COMMAND] = 0;
+    encoding->mode[LCD_WRITE] = 1 << map->rs;
+    encoding->mode[LCD_READ] = 1 << map->rw;
+    encoding->mode[LCD_READ | LCD_WRITE] = (1 << map->rs) | (1 << map->rw);
+    encoding->remapped = false;
+    for (int i = 0; i < 8; ++i)
+        encoding->remapped |= pins[i] != i;
+
+    for (int n = 0; n < 16; ++n)
+    {
+        nibbles[n] = 0;
+        for (int bit = 0; bit < 4; ++bit)
+        {
+            if (n & (1 << bit))
+                nibbles[n] |= encoding->data[bit];
+        }
+    }
+    for (int b = 0; b < 256; ++b)
+    {
+        uint8_t *seq = encoding->seq[b];
+
+        seq[0] = nibbles[b >> 4];
+        seq[1] = seq[0] | encoding->enable;
+        seq[2] = seq[0];
+        seq[3] = nibbles[b & 0xF];
+        seq[4] = seq[3] | encoding->enable;
+        seq[5] = seq[3];
+    }
+}
+
+esp_err_t lcd_encoding_create(lcd_handle_t *handle)
+{
+    const lcd_pinmap_t *map = handle->pinmap;
+    lcd_encoding_t *encoding;
+    uint8_t used = 0;
+
+    lcd_encoding_free(handle);
+    if (!map || !memcmp(map, &lcd_pinmap_config, sizeof(lcd_pinmap_t)))
+    {
+        handle->encoding = &lcd_encoding_config;
+        return ESP_OK;
+    }
+
+    const uint8_t pins[] = {map->rs, map->rw, map->en, map->bl, map->d4, map->d5, map->d6, map->d7};
+    for (int i = 0; i < 8; ++i)
+    {
+        ESP_RETURN_ON_FALSE(pins[i] < 8 && !(used & (1 << pins[i])), ESP_ERR_INVALID_ARG, TAG,
+                            "Invalid pin map: line %d on P%d", i, pins[i]);
+        used |= 1 << pins[i];
+    }
+    encoding = malloc(sizeof(lcd_encoding_t));
+    ESP_RETURN_ON_FALSE(encoding, ESP_ERR_NO_MEM, TAG, "Unable to allocate encoding");
+    lcd_encoding_build(encoding, map);
+    handle->encoding = encoding;
+    return ESP_OK;
+}
+
+void lcd_encoding_free(lcd_handle_t *handle)
+{
+    const lcd_encoding_t *encoding = handle->encoding;
+
+    handle->encoding = NULL;
+    if (encoding != &lcd_encoding_config)
+        free((void *)encoding);
+}
+
+uint8_t lcd_encoding_nibble(const lcd_encoding_t *encoding, uint8_t pins)
+{
+    uint8_t nibble = 0;
+
+    for (int bit = 0; bit < 4; ++bit)
+    {
+        if (pins & encoding->data[bit])
+            nibble |= 0x10 << bit;
+    }
+    return nibble;
+}
+
+uint8_t lcd_encoding_canonical(const lcd_encoding_t *encoding, uint8_t pins)
+{
+    uint8_t canonical;
+
+    if (!encoding->remapped)
+        return pins;
+    canonical = lcd_encoding_nibble(encoding, pins);
+    if (pins & encoding->mode[LCD_WRITE])
+        canonical |= LCD_WRITE;
+    if (pins & encoding->mode[LCD_READ])
+        canonical |= LCD_READ;
+    if (pins & encoding->enable)
+        canonical |= LCD_ENABLE;
+    if (pins & encoding->backlight)
+        canonical |= LCD_BACKLIGHT_CONTROL_ON;
+    return canonical;
+}
@@ -0,0 +1,660 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+#include "lcd.h"
+#include "hd44780.h"
+#include "hd44780_refresh.h"
+#include "hd44780_sleep.h"
+#include "hd44780_error.h"
+
+// The refresh scheduler keeps two frames per handle: the frame the
+// application wants (desired) and the frame the display holds (shown).
+// Writes only touch desired, so fifty writes of the same field between two
+// flushes cost fifty memory stores and one bus transfer.
+//
+// A flush snapshots desired, groups the dirty cells of each row into runs,
+// orders the runs by priority and sends each run with a single Set DDRAM
+// Address instruction followed by its characters. A clean cell sitting
+// between two dirty ones is rewritten rather than splitting the run, as
+// that costs the same single byte as the extra address instruction would.
+
+static const char *TAG = "LCD Refresh";
+
+static void lcd_refresh_task(void *arg);
+static void lcd_refresh_free(lcd_refresh_t *refresh);
+static uint16_t lcd_refresh_plan(const lcd_handle_t *handle, lcd_refresh_t *refresh);
+static esp_err_t lcd_refresh_place_cursor(lcd_handle_t *handle, lcd_refresh_t *refresh, bool disturbed);
+
+static inline uint32_t lcd_refresh_now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+esp_err_t lcd_refresh_enable(lcd_handle_t *handle, const lcd_refresh_config_t *config)
+{
+    esp_err_t ret = ESP_OK;
+    lcd_refresh_t *refresh = NULL;
+
+    ESP_RETURN_ON_FALSE(handle && config && config->max_fps, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(handle->initialized, ESP_ERR_INVALID_STATE, TAG, "LCD not initialized");
+    ESP_RETURN_ON_FALSE(!handle->refresh, ESP_ERR_INVALID_STATE, TAG, "Refresh scheduler already enabled");
+
+    refresh = calloc(1, sizeof(lcd_refresh_t));
+    ESP_GOTO_ON_FALSE(refresh, ESP_ERR_NO_MEM, err, TAG, "Unable to allocate refresh state");
+    refresh->config = *config;
+    refresh->cells = handle->columns * handle->rows;
+    refresh->desired = malloc(refresh->cells);
+    refresh->shown = malloc(refresh->cells);
+    refresh->snapshot = malloc(refresh->cells);
+    refresh->priority = calloc(refresh->cells, sizeof(uint8_t));
+    refresh->runs = calloc(refresh->cells, sizeof(lcd_refresh_run_t));
+    refresh->dirty_since = calloc(refresh->cells, sizeof(uint32_t));
+    ESP_GOTO_ON_FALSE(refresh->desired && refresh->shown && refresh->snapshot &&
+                          refresh->priority && refresh->runs && refresh->dirty_since,
+                      ESP_ERR_NO_MEM, err, TAG, "Unable to allocate frame buffer");
+    portMUX_INITIALIZE(&refresh->spinlock);
+
+    if (!handle->lock)
+    {
+        handle->lock = xSemaphoreCreateRecursiveMutex();
+        ESP_GOTO_ON_FALSE(handle->lock, ESP_ERR_NO_MEM, err, TAG, "Unable to create handle lock");
+    }
+
+    if (lcd_sleep_take_frame(handle, refresh->shown))
+    {
+        // Resumed from deep sleep: the display still shows the saved frame
+        memcpy(refresh->desired, refresh->shown, refresh->cells);
+    }
+    else
+    {
+        // Start from a known display content
+        ret = lcd_hw_clear(handle);
+        lcd_error_report(handle, LCD_STATS_API_CLEAR_SCREEN, ret);
+        if (ret != ESP_OK)
+            goto err;
+        memset(refresh->desired, ' ', refresh->cells);
+        memset(refresh->shown, ' ', refresh->cells);
+        handle->cursor_column = 0;
+        handle->cursor_row = 0;
+        handle->display_mode |= LCD_ENTRY_INCREMENT;
+    }
+    refresh->last_flush_us = esp_timer_get_time();
+    refresh->running = true;
+    handle->refresh = refresh;
+
+    if (config->create_task)
+    {
+        refresh->stopped = xSemaphoreCreateBinary();
+        if (!refresh->stopped ||
+            xTaskCreatePinnedToCore(lcd_refresh_task, "lcd_refresh", config->stack_size, handle,
+                                    config->priority, &refresh->task, config->core_id) != pdPASS)
+        {
+            handle->refresh = NULL;
+            ret = ESP_ERR_NO_MEM;
+            ESP_LOGE(TAG, "Unable to create refresh task");
+            goto err;
+        }
+        refresh->notify = refresh->task;
+    }
+    ESP_LOGD(TAG, "Refresh scheduler enabled for LCD 0x%x at %d fps", handle->address, config->max_fps);
+    return ESP_OK;
+err:
+    lcd_refresh_free(refresh);
+    return ret;
+}
+
+esp_err_t lcd_refresh_disable(lcd_handle_t *handle)
+{
+    esp_err_t ret = ESP_OK;
+    lcd_refresh_t *refresh;
+
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    refresh = handle->refresh;
+    if (!refresh)
+        return ESP_OK;
+
+    if (refresh->task)
+    {
+        refresh->running = false;
+        xTaskNotifyGive(refresh->task);
+        // The task gives the semaphore as its last access to the scheduler
+        xSemaphoreTake(refresh->stopped, portMAX_DELAY);
+        refresh->task = NULL;
+    }
+
+    // Writers check handle->refresh under the lock, so once it is cleared
+    // none can still be storing into the frame buffer
+    lcd_lock(handle);
+    ret = lcd_refresh_flush_cells(handle, UINT16_MAX, NULL);
+    // Leave the controller's address counter where direct writes expect it
+    if (ret == ESP_OK)
+        ret = lcd_hw_set_ddram_address(handle, handle->cursor_column, handle->cursor_row);
+    handle->refresh = NULL;
+    lcd_unlock(handle);
+    lcd_refresh_free(refresh);
+    return ret;
+}
+
+esp_err_t lcd_refresh_set_region_priority(lcd_handle_t *handle, uint8_t col, uint8_t row,
+                                          uint8_t len, uint8_t priority)
+{
+    esp_err_t ret = ESP_OK;
+    lcd_refresh_t *refresh;
+
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(col < handle->columns && row < handle->rows,
+                        ESP_ERR_INVALID_ARG, TAG, "Invalid region");
+
+    if (len > handle->columns - col)
+        len = handle->columns - col;
+    lcd_lock(handle);
+    refresh = handle->refresh;
+    ESP_GOTO_ON_FALSE(refresh, ESP_ERR_INVALID_STATE, unlock, TAG, "Refresh scheduler not enabled");
+    portENTER_CRITICAL(&refresh->spinlock);
+    memset(&refresh->priority[row * handle->columns + col], priority, len);
+    portEXIT_CRITICAL(&refresh->spinlock);
+unlock:
+    lcd_unlock(handle);
+    return ret;
+}
+
+esp_err_t lcd_refresh_flush(lcd_handle_t *handle)
+{
+    esp_err_t ret = ESP_OK;
+
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    lcd_lock(handle);
+    ESP_GOTO_ON_FALSE(handle->refresh, ESP_ERR_INVALID_STATE, unlock, TAG, "Refresh scheduler not enabled");
+    ret = lcd_refresh_flush_cells(handle, UINT16_MAX, NULL);
+unlock:
+    lcd_unlock(handle);
+    return ret;
+}
+
+uint16_t lcd_refresh_pending(const lcd_handle_t *handle)
+{
+    // The lock is not part of the display state the const promises to keep
+    lcd_handle_t *locked = (lcd_handle_t *)handle;
+    uint16_t pending = 0;
+
+    if (!handle)
+        return 0;
+    lcd_lock(locked);
+    if (handle->refresh)
+        pending = handle->refresh->dirty_count;
+    lcd_unlock(locked);
+    return pending;
+}
+
+esp_err_t lcd_refresh_put(lcd_handle_t *handle, char c)
+{
+    lcd_refresh_t *refresh = handle->refresh;
+    uint16_t idx = handle->cursor_row * handle->columns + handle->cursor_column;
+    bool wake = false;
+
+    if (idx >= refresh->cells)
+        return ESP_ERR_INVALID_STATE;
+
+    portENTER_CRITICAL(&refresh->spinlock);
+    bool was_dirty = refresh->desired[idx] != refresh->shown[idx];
+    bool is_dirty = c != refresh->shown[idx];
+    refresh->desired[idx] = c;
+    if (!was_dirty && is_dirty)
+    {
+        refresh->dirty_since[idx] = lcd_refresh_now_ms();
+        wake = (refresh->dirty_count++ == 0);
+    }
+    else if (was_dirty && !is_dirty)
+    {
+        refresh->dirty_count--;
+    }
+    if (is_dirty && refresh->priority[idx] >= LCD_REFRESH_PRIORITY_URGENT)
+    {
+        refresh->urgent = true;
+        wake = true;
+    }
+    portEXIT_CRITICAL(&refresh->spinlock);
+
+    if (wake && refresh->notify)
+        xTaskNotifyGive(refresh->notify);
+    return ESP_OK;
+}
+
+esp_err_t lcd_refresh_clear(lcd_handle_t *handle)
+{
+    lcd_refresh_t *refresh = handle->refresh;
+    uint32_t now = lcd_refresh_now_ms();
+    bool wake = false;
+
+    portENTER_CRITICAL(&refresh->spinlock);
+    memset(refresh->desired, ' ', refresh->cells);
+    refresh->dirty_count = 0;
+    for (uint16_t i = 0; i < refresh->cells; ++i)
+    {
+        if (refresh->shown[i] != ' ')
+        {
+            refresh->dirty_since[i] = now;
+            refresh->dirty_count++;
+        }
+    }
+    wake = refresh->dirty_count > 0;
+    // One instruction, whose execution time another display can use, beats
+    // rewriting every blanked cell
+    refresh->clear_pending = refresh->dirty_count >= LCD_REFRESH_CLEAR_MIN_CELLS;
+    portEXIT_CRITICAL(&refresh->spinlock);
+
+    if (wake && refresh->notify)
+        xTaskNotifyGive(refresh->notify);
+    return ESP_OK;
+}
+
+void lcd_refresh_invalidate(lcd_handle_t *handle)
+{
+    lcd_refresh_t *refresh = handle->refresh;
+    uint32_t now = lcd_refresh_now_ms();
+    bool wake = false;
+
+    portENTER_CRITICAL(&refresh->spinlock);
+    memset(refresh->shown, ' ', refresh->cells);
+    refresh->dirty_count = 0;
+    for (uint16_t i = 0; i < refresh->cells; ++i)
+    {
+        if (refresh->desired[i] != ' ')
+        {
+            refresh->dirty_since[i] = now;
+            refresh->dirty_count++;
+        }
+    }
+    wake = refresh->dirty_count > 0;
+    refresh->clear_pending = false;
+    portEXIT_CRITICAL(&refresh->spinlock);
+    refresh->placed_row = UINT8_MAX;
+
+    if (wake && refresh->notify)
+        xTaskNotifyGive(refresh->notify);
+}
+
+void lcd_refresh_adopt(lcd_handle_t *handle, const char *frame)
+{
+    lcd_refresh_t *refresh = handle->refresh;
+
+    portENTER_CRITICAL(&refresh->spinlock);
+    memcpy(refresh->desired, frame, refresh->cells);
+    memcpy(refresh->shown, frame, refresh->cells);
+    refresh->dirty_count = 0;
+    refresh->urgent = false;
+    refresh->clear_pending = false;
+    portEXIT_CRITICAL(&refresh->spinlock);
+    refresh->placed_column = handle->cursor_column;
+    refresh->placed_row = handle->cursor_row;
+}
+
+void lcd_refresh_begin(lcd_handle_t *handle, uint16_t max_cells)
+{
+    lcd_refresh_t *refresh = handle->refresh;
+
+    lcd_lock(handle);
+    portENTER_CRITICAL(&refresh->spinlock);
+    memcpy(refresh->snapshot, refresh->desired, refresh->cells);
+    refresh->urgent = false;
+    // Writes since the clear may have restored most of the old content
+    if (refresh->dirty_count < LCD_REFRESH_CLEAR_MIN_CELLS)
+        refresh->clear_pending = false;
+    portEXIT_CRITICAL(&refresh->spinlock);
+
+    // With a Clear Display pending the plan is made once the clear is done
+    refresh->nruns = refresh->clear_pending ? 0 : lcd_refresh_plan(handle, refresh);
+    refresh->run_index = 0;
+    refresh->run_offset = 0;
+    refresh->addressed = false;
+    refresh->disturbed = false;
+    refresh->budget = max_cells;
+}
+
+/**
+ * @brief True when the flush in progress has nothing more to send
+ */
+static bool lcd_refresh_step_done(const lcd_handle_t *handle, const lcd_refresh_t *refresh)
+{
+    return !refresh->clear_pending && !lcd_hw_state_pending(handle) &&
+           (refresh->run_index >= refresh->nruns || refresh->budget == 0);
+}
+
+/**
+ * @brief Mark every cell blank once the Clear Display was sent
+ */
+static void lcd_refresh_cleared(lcd_handle_t *handle, lcd_refresh_t *refresh)
+{
+    uint32_t now = lcd_refresh_now_ms();
+
+    refresh->disturbed = true;
+    refresh->clear_pending = false;
+
+    portENTER_CRITICAL(&refresh->spinlock);
+    for (uint16_t i = 0; i < refresh->cells; ++i)
+    {
+        bool was_dirty = refresh->desired[i] != refresh->shown[i];
+
+        refresh->shown[i] = ' ';
+        if (was_dirty && refresh->desired[i] == ' ')
+        {
+            refresh->dirty_count--;
+        }
+        else if (!was_dirty && refresh->desired[i] != ' ')
+        {
+            refresh->dirty_since[i] = now;
+            refresh->dirty_count++;
+        }
+    }
+    portEXIT_CRITICAL(&refresh->spinlock);
+
+    refresh->nruns = lcd_refresh_plan(handle, refresh);
+}
+
+bool lcd_refresh_next(lcd_handle_t *handle, lcd_hw_xfer_t *xfer)
+{
+    lcd_refresh_t *refresh = handle->refresh;
+    const lcd_refresh_run_t *run;
+
+    xfer->handle = handle;
+    xfer->mode = LCD_COMMAND;
+    xfer->exec_us = LCD_STD_EXEC_TIME_US;
+    xfer->result = ESP_OK;
+    // Deferred display control and entry mode changes go first, as ahead of
+    // any instruction, then the entry mode a Clear Display reset
+    if (lcd_hw_state_next(handle, &xfer->data))
+        return true;
+    if (refresh->clear_pending)
+    {
+        xfer->data = LCD_CLEAR;
+        xfer->exec_us = LCD_HOME_EXEC_TIME_US;
+        return true;
+    }
+    if (lcd_refresh_step_done(handle, refresh))
+        return false;
+    run = &refresh->runs[refresh->run_index];
+
+    if (!refresh->addressed)
+    {
+        xfer->data = LCD_SET_DDRAM_ADDR | (run->start % handle->columns + lcd_row_offsets[run->start / handle->columns]);
+        return true;
+    }
+    xfer->data = refresh->snapshot[run->start + refresh->run_offset];
+    xfer->mode = LCD_WRITE;
+    return true;
+}
+
+void lcd_refresh_sent(lcd_handle_t *handle, const lcd_hw_xfer_t *xfer, bool *done, uint16_t *sent)
+{
+    lcd_refresh_t *refresh = handle->refresh;
+    const lcd_refresh_run_t *run = &refresh->runs[refresh->run_index];
+    uint16_t idx;
+
+    if (xfer->result != ESP_OK)
+    {
+        *done = lcd_refresh_step_done(handle, refresh);
+        return;
+    }
+    if (xfer->mode == LCD_COMMAND)
+    {
+        lcd_hw_state_sent(handle, xfer->data);
+        if (xfer->data == LCD_CLEAR)
+        {
+            lcd_refresh_cleared(handle, refresh);
+        }
+        else if (xfer->data & LCD_SET_DDRAM_ADDR)
+        {
+            refresh->addressed = true;
+            refresh->disturbed = true;
+        }
+        *done = lcd_refresh_step_done(handle, refresh);
+        return;
+    }
+
+    idx = run->start + refresh->run_offset;
+    portENTER_CRITICAL(&refresh->spinlock);
+    bool was_dirty = refresh->desired[idx] != refresh->shown[idx];
+    refresh->shown[idx] = refresh->snapshot[idx];
+    if (was_dirty && refresh->desired[idx] == refresh->shown[idx])
+        refresh->dirty_count--;
+    else if (!was_dirty && refresh->desired[idx] != refresh->shown[idx])
+        refresh->dirty_count++;
+    portEXIT_CRITICAL(&refresh->spinlock);
+
+    refresh->budget--;
+    if (sent)
+        (*sent)++;
+    if (++refresh->run_offset == run->len)
+    {
+        refresh->run_index++;
+        refresh->run_offset = 0;
+        refresh->addressed = false;
+    }
+    *done = lcd_refresh_step_done(handle, refresh);
+}
+
+esp_err_t lcd_refresh_step(lcd_handle_t *handle, bool *done, uint16_t *sent)
+{
+    lcd_hw_xfer_t xfer;
+
+    if (!lcd_refresh_next(handle, &xfer))
+    {
+        *done = true;
+        return ESP_OK;
+    }
+    lcd_hw_transfer_many(&xfer, 1);
+    lcd_refresh_sent(handle, &xfer, done, sent);
+    return xfer.result;
+}
+
+esp_err_t lcd_refresh_end(lcd_handle_t *handle)
+{
+    esp_err_t ret;
+    lcd_refresh_t *refresh = handle->refresh;
+
+    refresh->last_flush_us = esp_timer_get_time();
+    ret = lcd_refresh_place_cursor(handle, refresh, refresh->disturbed);
+    lcd_unlock(handle);
+    return ret;
+}
+
+esp_err_t lcd_refresh_flush_cells(lcd_handle_t *handle, uint16_t max_cells, uint16_t *sent)
+{
+    esp_err_t ret = ESP_OK;
+    bool done = false;
+
+    if (sent)
+        *sent = 0;
+
+    lcd_refresh_begin(handle, max_cells);
+    while (!done && ret == ESP_OK)
+        ret = lcd_refresh_step(handle, &done, sent);
+    if (ret != ESP_OK)
+        lcd_refresh_end(handle);
+    else
+        ret = lcd_refresh_end(handle);
+    // The refresh task has no caller to hand the failure to
+    lcd_error_report(handle, LCD_STATS_API_FLUSH, ret);
+    return ret;
+}
+
+void lcd_refresh_wake(lcd_handle_t *handle)
+{
+    if (handle->refresh && handle->refresh->notify)
+        xTaskNotifyGive(handle->refresh->notify);
+}
+
+bool lcd_refresh_has_work(const lcd_handle_t *handle)
+{
+    return handle->refresh &&
+           (handle->refresh->dirty_count || handle->refresh->clear_pending || lcd_hw_state_pending(handle));
+}
+
+void lcd_refresh_set_notify(lcd_handle_t *handle, TaskHandle_t task)
+{
+    handle->refresh->notify = task;
+}
+
+bool lcd_refresh_is_urgent(const lcd_handle_t *handle)
+{
+    return handle->refresh && handle->refresh->urgent;
+}
+
+int64_t lcd_refresh_staleness_us(lcd_handle_t *handle)
+{
+    lcd_refresh_t *refresh = handle->refresh;
+    uint32_t now = lcd_refresh_now_ms();
+    uint32_t oldest = 0;
+
+    if (!refresh)
+        return 0;
+
+    portENTER_CRITICAL(&refresh->spinlock);
+    for (uint16_t i = 0; i < refresh->cells; ++i)
+    {
+        if (refresh->desired[i] != refresh->shown[i] && (now - refresh->dirty_since[i]) > oldest)
+            oldest = now - refresh->dirty_since[i];
+    }
+    portEXIT_CRITICAL(&refresh->spinlock);
+    return (int64_t)oldest * 1000;
+}
+
+/**
+ * @brief Build the list of runs to send, highest priority first
+ *
+ * @return Number of runs in refresh->runs
+ */
+static uint16_t lcd_refresh_plan(const lcd_handle_t *handle, lcd_refresh_t *refresh)
+{
+    // Runs can only span cells when the controller increments its address
+    bool merge = handle->display_mode & LCD_ENTRY_INCREMENT;
+    uint16_t nruns = 0;
+
+    for (uint8_t row = 0; row < handle->rows; ++row)
+    {
+        uint16_t base = row * handle->columns;
+        lcd_refresh_run_t *run = NULL;
+
+        for (uint8_t col = 0; col < handle->columns; ++col)
+        {
+            uint16_t idx = base + col;
+
+            if (refresh->snapshot[idx] == refresh->shown[idx])
+                continue;
+            // Extend the current run if this cell follows it directly or
+            // after a single clean cell
+            if (merge && run && (idx - (run->start + run->len)) <= 1)
+            {
+                run->len = idx - run->start + 1;
+            }
+            else
+            {
+                run = &refresh->runs[nruns++];
+                run->start = idx;
+                run->len = 1;
+                run->priority = 0;
+            }
+            if (refresh->priority[idx] > run->priority)
+                run->priority = refresh->priority[idx];
+        }
+    }
+
+    // Stable insertion sort, highest priority first. There are never more
+    // runs than cells, so this stays cheap.
+    for (uint16_t i = 1; i < nruns; ++i)
+    {
+        lcd_refresh_run_t tmp = refresh->runs[i];
+        uint16_t j = i;
+
+        while (j > 0 && refresh->runs[j - 1].priority < tmp.priority)
+        {
+            refresh->runs[j] = refresh->runs[j - 1];
+            j--;
+        }
+        refresh->runs[j] = tmp;
+    }
+    return nruns;
+}
+
+/**
+ * @brief Put the controller's address counter at the logical cursor so that a
+ *        visible cursor (or blink) shows where the application left it
+ *
+ * @param[in] disturbed The flush moved the controller's address counter
+ */
+static esp_err_t lcd_refresh_place_cursor(lcd_handle_t *handle, lcd_refresh_t *refresh, bool disturbed)
+{
+    bool visible = handle->display_control & (LCD_CURSOR_ON | LCD_BLINK_ON);
+    bool moved = (refresh->placed_column != handle->cursor_column) ||
+                 (refresh->placed_row != handle->cursor_row);
+
+    if (!visible)
+    {
+        if (disturbed)
+            refresh->placed_row = UINT8_MAX;
+        return ESP_OK;
+    }
+    if (!disturbed && !moved)
+        return ESP_OK;
+
+    refresh->placed_column = handle->cursor_column;
+    refresh->placed_row = handle->cursor_row;
+    return lcd_hw_set_ddram_address(handle, handle->cursor_column, handle->cursor_row);
+}
+
+static void lcd_refresh_task(void *arg)
+{
+    lcd_handle_t *handle = arg;
+    lcd_refresh_t *refresh = handle->refresh;
+    const int64_t period_us = 1000000 / refresh->config.max_fps;
+    TickType_t wait = portMAX_DELAY;
+
+    while (refresh->running)
+    {
+        ulTaskNotifyTake(pdTRUE, wait);
+        if (!refresh->running)
+            break;
+
+        int64_t elapsed = esp_timer_get_time() - refresh->last_flush_us;
+        if (lcd_refresh_has_work(handle) && (refresh->urgent || elapsed >= period_us))
+        {
+            lcd_refresh_flush_cells(handle, UINT16_MAX, NULL);
+            elapsed = 0;
+        }
+
+        if (lcd_refresh_has_work(handle))
+        {
+            wait = pdMS_TO_TICKS((period_us - elapsed) / 1000);
+            if (wait == 0)
+                wait = 1;
+        }
+        else
+        {
+            wait = portMAX_DELAY;
+        }
+    }
+    xSemaphoreGive(refresh->stopped);
+    vTaskDelete(NULL);
+}
+
+static void lcd_refresh_free(lcd_refresh_t *refresh)
+{
+    if (!refresh)
+        return;
+    free(refresh->desired);
+    free(refresh->shown);
+    free(refresh->snapshot);
+    free(refresh->priority);
+    free(refresh->runs);
+    free(refresh->dirty_since);
+    if (refresh->stopped)
+        vSemaphoreDelete(refresh->stopped);
+    free(refresh);
+}
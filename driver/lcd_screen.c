@@ -0,0 +1,211 @@
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "lcd.h"
+#include "hd44780.h"
+#include "hd44780_screen.h"
+#include "hd44780_pinmap.h"
+#include "hd44780_refresh.h"
+#include "hd44780_pacing.h"
+#include "hd44780_sleep.h"
+#include "hd44780_stats.h"
+#include "hd44780_error.h"
+
+// Menus and splash screens never change, yet drawing one with
+// lcd_write_str() encodes every character again and sends it as six I2C
+// transactions, each waiting out the settle time. A compiled screen is the
+// expander bytes of the whole screen, encoded once. Without a settle time
+// they go out in a single transaction, the controller's execution time
+// covered by the bus time of pad bytes. With one, they go out one write per
+// nibble, the enable pulse of one nibble and the data byte of the next, with
+// the settle time waited on the pacing timer in between rather than held by
+// repeated bytes that keep the bus busy.
+
+static const char *TAG = "LCD Screen";
+
+/**
+ * @brief Expander bytes of one byte for the controller, then pad bytes that
+ *        hold the pins while it executes
+ */
+static uint8_t *lcd_screen_emit(uint8_t *out, const lcd_encoding_t *encoding, uint8_t data, uint8_t ctrl,
+                                uint8_t pad)
+{
+    const uint8_t *seq = encoding->seq[data];
+
+    for (int i = 0; i < LCD_ENCODING_SEQ_LEN; ++i)
+        *out++ = seq[i] | ctrl;
+    for (int i = 0; i < pad; ++i)
+        *out++ = seq[LCD_ENCODING_SEQ_LEN - 1] | ctrl;
+    return out;
+}
+
+esp_err_t lcd_screen_compile(const lcd_handle_t *handle, const lcd_screen_desc_t *desc, lcd_screen_t **screen)
+{
+    const lcd_encoding_t *encoding;
+    lcd_screen_t *compiled;
+    uint32_t clk_speed;
+    uint32_t bytes_per_exec;
+    uint8_t glyph_len;
+    uint8_t cgram_addresses = 0;
+    uint8_t pad = 0;
+    uint8_t command_ctrl;
+    uint8_t write_ctrl;
+    size_t cells;
+    size_t instructions;
+    size_t len;
+    uint8_t *out;
+
+    ESP_RETURN_ON_FALSE(handle && desc && screen, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(handle->columns && handle->rows && handle->rows <= LCD_SCREEN_MAX_ROWS, ESP_ERR_INVALID_ARG,
+                        TAG, "Invalid geometry");
+    ESP_RETURN_ON_FALSE(desc->cursor_column < handle->columns && desc->cursor_row < handle->rows,
+                        ESP_ERR_INVALID_ARG, TAG, "Cursor outside the screen");
+    ESP_RETURN_ON_FALSE(desc->glyph_count <= 8 && (desc->glyphs || !desc->glyph_count), ESP_ERR_INVALID_ARG, TAG,
+                        "Invalid glyphs");
+    ESP_RETURN_ON_FALSE(!handle->pinmap || handle->encoding, ESP_ERR_INVALID_STATE, TAG,
+                        "Pin map not encoded, call lcd_init() first");
+
+    encoding = lcd_encoding(handle);
+    glyph_len = (handle->display_function & LCD_5x10DOTS) ? 10 : 8;
+    clk_speed = desc->clk_speed ? desc->clk_speed : I2C_MASTER_FREQ_HZ;
+    // The next byte's enable pulse starts two expander bytes after this
+    // one's ends. A settle time, waited out before each pulse, covers the
+    // execution time on its own.
+    bytes_per_exec = ((uint64_t)LCD_STD_EXEC_TIME_US * clk_speed + LCD_SCREEN_WIRE_CLOCKS * 1000000 - 1) /
+                     (LCD_SCREEN_WIRE_CLOCKS * 1000000);
+    if (!LCD_PRE_PULSE_DELAY_US && bytes_per_exec > 2)
+        pad = bytes_per_exec - 2;
+
+    // Glyphs are loaded where lcd_write_cgram() puts them
+    for (uint8_t i = 0, next = UINT8_MAX; i < desc->glyph_count; ++i)
+    {
+        if ((i << 3) != next)
+            cgram_addresses++;
+        next = (i << 3) + glyph_len;
+    }
+    cells = handle->columns * handle->rows;
+    instructions = cgram_addresses + desc->glyph_count * glyph_len + handle->rows * (1 + handle->columns) + 1;
+    len = instructions * (LCD_ENCODING_SEQ_LEN + pad) - pad;
+
+    compiled = calloc(1, sizeof(lcd_screen_t) + len + cells + desc->glyph_count * glyph_len);
+    ESP_RETURN_ON_FALSE(compiled, ESP_ERR_NO_MEM, TAG, "Unable to allocate screen");
+    compiled->stream = (uint8_t *)(compiled + 1);
+    compiled->len = len;
+    compiled->wire_us = (uint64_t)(len + 1) * LCD_SCREEN_WIRE_CLOCKS * 1000000 / clk_speed;
+    compiled->settle_us = LCD_PRE_PULSE_DELAY_US;
+    compiled->frame = (char *)compiled->stream + len;
+    compiled->glyphs = (uint8_t *)compiled->frame + cells;
+    compiled->glyph_count = desc->glyph_count;
+    compiled->glyph_len = glyph_len;
+    compiled->cgram_addresses = cgram_addresses;
+    compiled->columns = handle->columns;
+    compiled->rows = handle->rows;
+    lcd_encoding_lines(encoding, compiled->lines);
+    compiled->backlight = handle->backlight ? encoding->backlight : 0;
+    compiled->display_control = LCD_DISPLAY_ON | (desc->cursor ? LCD_CURSOR_ON : 0) | (desc->blink ? LCD_BLINK_ON : 0);
+    compiled->cursor_column = desc->cursor_column;
+    compiled->cursor_row = desc->cursor_row;
+    if (desc->glyph_count)
+        memcpy(compiled->glyphs, desc->glyphs, desc->glyph_count * glyph_len);
+    memset(compiled->frame, ' ', cells);
+    for (uint8_t row = 0; row < handle->rows; ++row)
+    {
+        const char *line = desc->lines[row];
+
+        for (uint8_t column = 0; line && line[column] && column < handle->columns; ++column)
+            compiled->frame[row * handle->columns + column] = line[column];
+    }
+
+    command_ctrl = encoding->mode[LCD_COMMAND] | compiled->backlight;
+    write_ctrl = encoding->mode[LCD_WRITE] | compiled->backlight;
+    out = compiled->stream;
+    for (uint8_t i = 0, next = UINT8_MAX; i < desc->glyph_count; ++i)
+    {
+        if ((i << 3) != next)
+            out = lcd_screen_emit(out, encoding, LCD_SET_CGRAM_ADDR | (i << 3), command_ctrl, pad);
+        next = (i << 3) + glyph_len;
+        for (uint8_t r = 0; r < glyph_len; ++r)
+            out = lcd_screen_emit(out, encoding, compiled->glyphs[i * glyph_len + r], write_ctrl, pad);
+    }
+    for (uint8_t row = 0; row < handle->rows; ++row)
+    {
+        out = lcd_screen_emit(out, encoding, LCD_SET_DDRAM_ADDR | lcd_row_offsets[row], command_ctrl, pad);
+        for (uint8_t column = 0; column < handle->columns; ++column)
+            out = lcd_screen_emit(out, encoding, compiled->frame[row * handle->columns + column], write_ctrl, pad);
+    }
+    lcd_screen_emit(out, encoding, LCD_SET_DDRAM_ADDR | (desc->cursor_column + lcd_row_offsets[desc->cursor_row]),
+                    command_ctrl, 0);
+
+    *screen = compiled;
+    return ESP_OK;
+}
+
+/**
+ * @brief Count what a screen sent, as if it had been sent byte by byte
+ */
+static void lcd_screen_count(lcd_handle_t *handle, const lcd_screen_t *screen)
+{
+    size_t cells = screen->columns * screen->rows;
+    size_t chars = cells + screen->glyph_count * screen->glyph_len;
+
+    for (uint8_t i = 0; i < screen->cgram_addresses; ++i)
+        lcd_stats_sent(handle, LCD_SET_CGRAM_ADDR, LCD_COMMAND);
+    for (uint8_t i = 0; i <= screen->rows; ++i)
+        lcd_stats_sent(handle, LCD_SET_DDRAM_ADDR, LCD_COMMAND);
+    for (size_t i = 0; i < chars; ++i)
+        lcd_stats_sent(handle, 0, LCD_WRITE);
+    if (handle->pacer)
+        handle->pacer->stats.bytes += screen->cgram_addresses + screen->rows + 1 + chars;
+}
+
+esp_err_t lcd_screen_show(lcd_handle_t *handle, const lcd_screen_t *screen)
+{
+    esp_err_t ret = ESP_OK;
+    int64_t start_us = lcd_stats_start();
+    uint8_t lines[8];
+
+    ESP_GOTO_ON_FALSE(handle && screen, ESP_ERR_INVALID_ARG, err, TAG, "Invalid argument");
+    ESP_GOTO_ON_FALSE(handle->initialized, ESP_ERR_INVALID_STATE, err, TAG, "LCD not initialized");
+    lcd_encoding_lines(lcd_encoding(handle), lines);
+    ESP_GOTO_ON_FALSE(screen->columns == handle->columns && screen->rows == handle->rows &&
+                          !memcmp(screen->lines, lines, sizeof(lines)),
+                      ESP_ERR_INVALID_ARG, err, TAG, "Screen compiled for another display");
+
+    lcd_lock(handle);
+    // Only what differs is sent, usually nothing
+    handle->display_control = screen->display_control;
+    handle->display_mode = LCD_ENTRY_INCREMENT | LCD_ENTRY_DISPLAY_NO_SHIFT;
+    LCD_GOTO_ON_ERROR(lcd_hw_apply_state(handle), unlock);
+    LCD_GOTO_ON_ERROR(lcd_hw_write_stream(handle, screen->stream, screen->len, screen->backlight, screen->wire_us,
+                                          screen->settle_us),
+                      unlock);
+    for (uint8_t i = 0; i < screen->glyph_count; ++i)
+        lcd_sleep_cgram_store(handle, i, &screen->glyphs[i * screen->glyph_len], screen->glyph_len);
+    handle->cursor_column = screen->cursor_column;
+    handle->cursor_row = screen->cursor_row;
+    if (handle->refresh)
+        lcd_refresh_adopt(handle, screen->frame);
+    lcd_screen_count(handle, screen);
+    lcd_unlock(handle);
+    lcd_stats_call(handle, LCD_STATS_API_SCREEN_SHOW, start_us);
+    return ESP_OK;
+unlock:
+    lcd_unlock(handle);
+err:
+    lcd_error_report(handle, LCD_STATS_API_SCREEN_SHOW, ret);
+    lcd_stats_call(handle, LCD_STATS_API_SCREEN_SHOW, start_us);
+    return ret;
+}
+
+size_t lcd_screen_size(const lcd_screen_t *screen)
+{
+    return screen ? screen->len : 0;
+}
+
+void lcd_screen_free(lcd_screen_t *screen)
+{
+    free(screen);
+}
@@ -0,0 +1,679 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+#include "lcd.h"
+#include "hd44780.h"
+#include "hd44780_service.h"
+#include "hd44780_async.h"
+
+// The command ring is a bounded multi-producer queue in the style of
+// Dmitry Vyukov's array based MPMC queue. Every slot carries a sequence
+// number:
+//
+//   sequence == pos          slot is free for the producer claiming pos
+//   sequence == pos + 1      slot holds the command published at pos
+//
+// Producers claim a position with a CAS on enqueue_pos, copy the command
+// in and publish it by bumping the slot sequence. No producer ever waits
+// on another producer or on the service task, so posting a command costs
+// a handful of atomic operations and a memcpy of sizeof(lcd_cmd_t).
+//
+// The drop-oldest overflow policy works because the dequeue side is also
+// CAS based: a producer that finds the ring full consumes (and discards)
+// the oldest command itself and then retries. When the oldest group is
+// still being published there is nothing it can take, and it sleeps until
+// the publishing producer is done instead of spinning on the ring.
+//
+// Commands that only make sense together, such as the pieces of a long
+// string and the cursor move ahead of them, are a group. A group claims
+// its run of positions with a single CAS on either side, so it is queued
+// in one piece, and the service task and a dropping producer can only
+// take all of it: text is never written at a position meant for other
+// text.
+//
+// Each handle counts its commands from the moment they are claimed until
+// they have run or been dropped, so that detaching one display waits for
+// its own commands only, however busy the others keep the service.
+
+static const char *TAG = "LCD Service";
+
+static void lcd_service_task(void *arg);
+static uint32_t lcd_service_run(lcd_service_t *service);
+static esp_err_t lcd_service_execute(const lcd_cmd_t *cmd);
+static esp_err_t lcd_service_reserve(lcd_service_t *service, uint32_t count, unsigned int *pos);
+static bool lcd_service_claim(lcd_service_t *service, uint32_t count, unsigned int *pos);
+static void lcd_service_publish(lcd_service_t *service, unsigned int pos, uint32_t group, const lcd_cmd_t *cmd);
+static uint32_t lcd_service_take(lcd_service_t *service, unsigned int *pos);
+static void lcd_service_release(lcd_service_t *service, unsigned int pos, lcd_cmd_t *cmd);
+static uint32_t lcd_service_drop_oldest(lcd_service_t *service);
+static void lcd_service_wake(lcd_service_t *service);
+static bool lcd_service_wait_progress(lcd_service_t *service, TickType_t start, TickType_t timeout);
+static void lcd_service_stop_waiting(lcd_service_t *service, bool done);
+static bool lcd_service_idle(lcd_service_t *service);
+static atomic_uint *lcd_service_queued(lcd_handle_t *handle);
+static void lcd_service_done(const lcd_cmd_t *cmd);
+static esp_err_t lcd_service_wait_idle(lcd_service_t *service, uint32_t timeout_ms);
+
+esp_err_t lcd_service_create(const lcd_service_config_t *config, lcd_service_t **service)
+{
+    esp_err_t ret = ESP_OK;
+    lcd_service_t *svc = NULL;
+    uint32_t depth = 2;
+
+    ESP_GOTO_ON_FALSE(config && service, ESP_ERR_INVALID_ARG, err, TAG, "Invalid argument");
+    ESP_GOTO_ON_FALSE(config->queue_depth >= 2, ESP_ERR_INVALID_ARG, err, TAG, "Queue depth must be at least 2");
+
+    while (depth < config->queue_depth)
+        depth <<= 1;
+
+    svc = calloc(1, sizeof(lcd_service_t));
+    ESP_GOTO_ON_FALSE(svc, ESP_ERR_NO_MEM, err, TAG, "Unable to allocate service");
+    svc->slots = calloc(depth, sizeof(lcd_service_slot_t));
+    svc->batch = calloc(depth, sizeof(lcd_cmd_t));
+    ESP_GOTO_ON_FALSE(svc->slots && svc->batch, ESP_ERR_NO_MEM, err, TAG,
+                      "Unable to allocate %" PRIu32 " queue slots", depth);
+
+    svc->config = *config;
+    svc->config.queue_depth = depth;
+    svc->mask = depth - 1;
+    for (uint32_t i = 0; i < depth; ++i)
+        atomic_init(&svc->slots[i].sequence, i);
+    atomic_init(&svc->enqueue_pos, 0);
+    atomic_init(&svc->dequeue_pos, 0);
+    atomic_init(&svc->dropped, 0);
+    atomic_init(&svc->executing, 0);
+    atomic_init(&svc->running, true);
+    atomic_init(&svc->waiters, 0);
+    svc->progress = xSemaphoreCreateBinary();
+    svc->stopped = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(svc->progress && svc->stopped, ESP_ERR_NO_MEM, err, TAG, "Unable to create service semaphores");
+
+    if (config->create_task)
+    {
+        ESP_GOTO_ON_FALSE(
+            xTaskCreatePinnedToCore(lcd_service_task, "lcd_service", config->stack_size, svc,
+                                    config->priority, &svc->task, config->core_id) == pdPASS,
+            ESP_ERR_NO_MEM, err, TAG, "Unable to create service task");
+    }
+
+    ESP_LOGD(TAG, "Service created with %" PRIu32 " slots on core %d", depth, config->core_id);
+    *service = svc;
+    return ESP_OK;
+err:
+    if (svc)
+    {
+        if (svc->progress)
+            vSemaphoreDelete(svc->progress);
+        if (svc->stopped)
+            vSemaphoreDelete(svc->stopped);
+        free(svc->slots);
+        free(svc->batch);
+        free(svc);
+    }
+    return ret;
+}
+
+esp_err_t lcd_service_delete(lcd_service_t *service)
+{
+    lcd_cmd_t cmd;
+    unsigned int pos;
+    uint32_t count;
+
+    ESP_RETURN_ON_FALSE(service, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    atomic_store(&service->running, false);
+    if (service->task)
+    {
+        xTaskNotifyGive(service->task);
+        // The task gives the semaphore as its last access to the service
+        xSemaphoreTake(service->stopped, portMAX_DELAY);
+    }
+
+    // Operations still queued will never run
+    while ((count = lcd_service_take(service, &pos)) != 0)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            lcd_service_release(service, pos + i, &cmd);
+            if (cmd.op)
+                lcd_async_complete(cmd.op, ESP_ERR_INVALID_STATE);
+            lcd_service_done(&cmd);
+        }
+    }
+    vSemaphoreDelete(service->progress);
+    vSemaphoreDelete(service->stopped);
+    free(service->slots);
+    free(service->batch);
+    free(service);
+    return ESP_OK;
+}
+
+esp_err_t lcd_service_attach(lcd_service_t *service, lcd_handle_t *handle)
+{
+    ESP_RETURN_ON_FALSE(service && handle, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(!handle->service, ESP_ERR_INVALID_STATE, TAG, "Handle already attached to a service");
+
+    atomic_init(lcd_service_queued(handle), 0);
+    handle->service = service;
+    return ESP_OK;
+}
+
+esp_err_t lcd_service_detach(lcd_handle_t *handle, uint32_t timeout_ms)
+{
+    lcd_service_t *service;
+    TickType_t start = xTaskGetTickCount();
+    bool drained;
+
+    ESP_RETURN_ON_FALSE(handle && handle->service, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    service = handle->service;
+    // The handle's last group runs after every group queued ahead of it
+    if (!service->task)
+    {
+        while (atomic_load(lcd_service_queued(handle)) && lcd_service_run(service))
+            ;
+    }
+    // Every group that leaves the ring or finishes running gives progress
+    atomic_fetch_add(&service->waiters, 1);
+    while (!(drained = atomic_load(lcd_service_queued(handle)) == 0) &&
+           lcd_service_wait_progress(service, start, pdMS_TO_TICKS(timeout_ms)))
+        ;
+    lcd_service_stop_waiting(service, drained);
+    ESP_RETURN_ON_FALSE(drained, ESP_ERR_TIMEOUT, TAG, "Timeout draining commands of LCD 0x%x", handle->address);
+    handle->service = NULL;
+    return ESP_OK;
+}
+
+esp_err_t lcd_service_flush(lcd_service_t *service, uint32_t timeout_ms)
+{
+    ESP_RETURN_ON_FALSE(service, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    if (!service->task)
+    {
+        while (lcd_service_run(service))
+            ;
+    }
+    return lcd_service_wait_idle(service, timeout_ms);
+}
+
+uint32_t lcd_service_get_dropped(const lcd_service_t *service)
+{
+    if (!service)
+        return 0;
+    return atomic_load(&((lcd_service_t *)service)->dropped);
+}
+
+esp_err_t lcd_service_post(lcd_service_t *service, const lcd_cmd_t *cmd)
+{
+    esp_err_t ret;
+    unsigned int pos;
+
+    atomic_fetch_add(lcd_service_queued(cmd->handle), 1);
+    ret = lcd_service_reserve(service, 1, &pos);
+    if (ret != ESP_OK)
+    {
+        lcd_service_done(cmd);
+        return ret;
+    }
+    lcd_service_publish(service, pos, 1, cmd);
+    // A dropping producer may be waiting for the group to be complete
+    lcd_service_wake(service);
+    if (service->task)
+        xTaskNotifyGive(service->task);
+    return ESP_OK;
+}
+
+esp_err_t lcd_service_post_str(lcd_handle_t *handle, const lcd_cmd_t *first, const char *str, lcd_async_op_t *op)
+{
+    esp_err_t ret = ESP_OK;
+    lcd_service_t *service = handle->service;
+    lcd_cmd_t cmd = {.type = LCD_CMD_WRITE_STR, .handle = handle, .op = op};
+    size_t chunks = (strlen(str) + LCD_SERVICE_TEXT_LEN - 1) / LCD_SERVICE_TEXT_LEN;
+    uint32_t group = chunks + (first ? 1 : 0);
+    unsigned int pos;
+
+    if (!group)
+        return ESP_OK;
+    // One reference per string command. The first also carries a failure.
+    if (op && chunks)
+        lcd_async_ref(op);
+    atomic_fetch_add(lcd_service_queued(handle), group);
+    ret = lcd_service_reserve(service, group, &pos);
+    if (ret != ESP_OK)
+    {
+        atomic_fetch_sub(lcd_service_queued(handle), group);
+        if (op && chunks)
+            lcd_async_complete(op, ret);
+        ESP_LOGE(TAG, "Unable to queue string:%s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    if (first)
+        lcd_service_publish(service, pos++, group, first);
+    for (size_t i = 0; i < chunks; ++i)
+    {
+        size_t len = strnlen(str, LCD_SERVICE_TEXT_LEN);
+
+        memcpy(cmd.payload.str.text, str, len);
+        cmd.payload.str.len = len;
+        if (op && i > 0)
+            lcd_async_ref(op);
+        lcd_service_publish(service, pos++, (i == 0 && !first) ? group : 0, &cmd);
+        str += len;
+    }
+    lcd_service_wake(service);
+    if (service->task)
+        xTaskNotifyGive(service->task);
+    return ret;
+}
+
+esp_err_t lcd_service_write_str(lcd_handle_t *handle, const char *str)
+{
+    ESP_RETURN_ON_FALSE(handle && str, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(handle->service, ESP_ERR_INVALID_STATE, TAG, "Handle not attached to a service");
+    return lcd_service_post_str(handle, NULL, str, NULL);
+}
+
+esp_err_t lcd_service_write_str_at(lcd_handle_t *handle, uint8_t col, uint8_t row, const char *str)
+{
+    lcd_cmd_t cursor = {.type = LCD_CMD_SET_CURSOR, .handle = handle};
+
+    ESP_RETURN_ON_FALSE(handle && str, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(handle->service, ESP_ERR_INVALID_STATE, TAG, "Handle not attached to a service");
+    ESP_RETURN_ON_FALSE(col < handle->columns && row < handle->rows,
+                        ESP_ERR_INVALID_ARG, TAG, "Invalid cursor position");
+    cursor.payload.cursor.col = col;
+    cursor.payload.cursor.row = row;
+    return lcd_service_post_str(handle, &cursor, str, NULL);
+}
+
+esp_err_t lcd_service_write_char(lcd_handle_t *handle, char c)
+{
+    lcd_cmd_t cmd = {.type = LCD_CMD_WRITE_CHAR, .handle = handle, .payload.c = c};
+
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(handle->service, ESP_ERR_INVALID_STATE, TAG, "Handle not attached to a service");
+    return lcd_service_post(handle->service, &cmd);
+}
+
+esp_err_t lcd_service_set_cursor(lcd_handle_t *handle, uint8_t col, uint8_t row)
+{
+    lcd_cmd_t cmd = {.type = LCD_CMD_SET_CURSOR, .handle = handle};
+
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(handle->service, ESP_ERR_INVALID_STATE, TAG, "Handle not attached to a service");
+    ESP_RETURN_ON_FALSE(col < handle->columns && row < handle->rows,
+                        ESP_ERR_INVALID_ARG, TAG, "Invalid cursor position");
+    cmd.payload.cursor.col = col;
+    cmd.payload.cursor.row = row;
+    return lcd_service_post(handle->service, &cmd);
+}
+
+esp_err_t lcd_service_clear_screen(lcd_handle_t *handle)
+{
+    lcd_cmd_t cmd = {.type = LCD_CMD_CLEAR, .handle = handle};
+
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(handle->service, ESP_ERR_INVALID_STATE, TAG, "Handle not attached to a service");
+    return lcd_service_post(handle->service, &cmd);
+}
+
+esp_err_t lcd_service_write_cgram(lcd_handle_t *handle, uint8_t location, const uint8_t *charmap)
+{
+    lcd_cmd_t cmd = {.type = LCD_CMD_WRITE_CGRAM, .handle = handle};
+
+    ESP_RETURN_ON_FALSE(handle && charmap, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(handle->service, ESP_ERR_INVALID_STATE, TAG, "Handle not attached to a service");
+    cmd.payload.cgram.location = location;
+    memcpy(cmd.payload.cgram.charmap, charmap,
+           (handle->display_function & LCD_5x10DOTS) ? 10 : 8);
+    return lcd_service_post(handle->service, &cmd);
+}
+
+esp_err_t lcd_service_call(lcd_handle_t *handle, esp_err_t (*fn)(lcd_handle_t *handle))
+{
+    lcd_cmd_t cmd = {.type = LCD_CMD_CALL, .handle = handle, .payload.fn = fn};
+
+    ESP_RETURN_ON_FALSE(handle && fn, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(handle->service, ESP_ERR_INVALID_STATE, TAG, "Handle not attached to a service");
+    return lcd_service_post(handle->service, &cmd);
+}
+
+static void lcd_service_task(void *arg)
+{
+    lcd_service_t *service = arg;
+
+    while (atomic_load(&service->running))
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (atomic_load(&service->running) && lcd_service_run(service))
+            ;
+    }
+    xSemaphoreGive(service->stopped);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Run the oldest group, in the service task or in the caller when
+ *        there is none
+ *
+ * @return Number of commands run, 0 if the ring was empty
+ */
+static uint32_t lcd_service_run(lcd_service_t *service)
+{
+    unsigned int pos;
+    uint32_t count;
+    esp_err_t ret;
+
+    atomic_store(&service->executing, 1);
+    count = lcd_service_take(service, &pos);
+    // Free the whole group before running it, so that producers are
+    // not held up by commands that take milliseconds each
+    for (uint32_t i = 0; i < count; ++i)
+        lcd_service_release(service, pos + i, &service->batch[i]);
+    if (count)
+        lcd_service_wake(service);
+    // A group is executed in full, even if deletion starts meanwhile
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ret = lcd_service_execute(&service->batch[i]);
+        if (service->batch[i].op)
+            lcd_async_complete(service->batch[i].op, ret);
+        lcd_service_done(&service->batch[i]);
+    }
+    atomic_store(&service->executing, 0);
+    lcd_service_wake(service);
+    return count;
+}
+
+static esp_err_t lcd_service_execute(const lcd_cmd_t *cmd)
+{
+    esp_err_t ret = ESP_OK;
+    char text[LCD_SERVICE_TEXT_LEN + 1];
+
+    switch (cmd->type)
+    {
+    case LCD_CMD_WRITE_STR:
+        memcpy(text, cmd->payload.str.text, cmd->payload.str.len);
+        text[cmd->payload.str.len] = '\0';
+        ret = lcd_write_str(cmd->handle, text);
+        break;
+    case LCD_CMD_WRITE_CHAR:
+        ret = lcd_write_char(cmd->handle, cmd->payload.c);
+        break;
+    case LCD_CMD_SET_CURSOR:
+        ret = lcd_set_cursor(cmd->handle, cmd->payload.cursor.col, cmd->payload.cursor.row);
+        break;
+    case LCD_CMD_CLEAR:
+        ret = lcd_clear_screen(cmd->handle);
+        break;
+    case LCD_CMD_WRITE_CGRAM:
+        ret = lcd_write_cgram(cmd->handle, cmd->payload.cgram.location,
+                              (uint8_t *)cmd->payload.cgram.charmap);
+        break;
+    case LCD_CMD_CALL:
+        ret = cmd->payload.fn(cmd->handle);
+        break;
+    default:
+        ret = ESP_ERR_INVALID_ARG;
+        break;
+    }
+    // The call has reported its own failure
+    if (ret != ESP_OK)
+        ESP_LOGD(TAG, "Command %d for LCD 0x%x failed:%s", cmd->type,
+                 cmd->handle->address, esp_err_to_name(ret));
+    return ret;
+}
+
+/**
+ * @brief Claim count consecutive positions, applying the overflow policy
+ */
+static esp_err_t lcd_service_reserve(lcd_service_t *service, uint32_t count, unsigned int *pos)
+{
+    TickType_t start = xTaskGetTickCount();
+    bool claimed;
+
+    ESP_RETURN_ON_FALSE(count <= service->mask + 1, ESP_ERR_INVALID_SIZE, TAG,
+                        "Group larger than the %" PRIu32 " slot queue", service->mask + 1);
+    if (service->config.overflow == LCD_SERVICE_OVERFLOW_DROP_OLDEST)
+    {
+        if (lcd_service_claim(service, count, pos))
+            return ESP_OK;
+        atomic_fetch_add(&service->waiters, 1);
+        while (!lcd_service_claim(service, count, pos))
+        {
+            // The oldest group is still being published. Let its producer
+            // run; the tick bound covers a wake that raced the count above.
+            if (!lcd_service_drop_oldest(service))
+                xSemaphoreTake(service->progress, 1);
+        }
+        lcd_service_stop_waiting(service, true);
+        return ESP_OK;
+    }
+
+    atomic_fetch_add(&service->waiters, 1);
+    while (!(claimed = lcd_service_claim(service, count, pos)) &&
+           lcd_service_wait_progress(service, start, pdMS_TO_TICKS(service->config.block_timeout_ms)))
+        ;
+    lcd_service_stop_waiting(service, claimed);
+    return claimed ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+/**
+ * @brief Claim count consecutive free slots without waiting
+ *
+ * @return false if the ring has no room for them
+ */
+static bool lcd_service_claim(lcd_service_t *service, uint32_t count, unsigned int *pos_out)
+{
+    unsigned int pos = atomic_load_explicit(&service->enqueue_pos, memory_order_relaxed);
+
+    for (;;)
+    {
+        int diff = 0;
+
+        // Every slot of the run must be free for this pass of the ring
+        for (uint32_t i = 0; i < count && diff == 0; ++i)
+        {
+            lcd_service_slot_t *slot = &service->slots[(pos + i) & service->mask];
+
+            diff = (int)(atomic_load_explicit(&slot->sequence, memory_order_acquire) - (pos + i));
+        }
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&service->enqueue_pos, &pos, pos + count,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            return false; // full
+        }
+        else
+        {
+            pos = atomic_load_explicit(&service->enqueue_pos, memory_order_relaxed);
+        }
+    }
+    *pos_out = pos;
+    return true;
+}
+
+/**
+ * @brief Fill a claimed slot and hand it to the consumer side
+ *
+ * @param[in] group Size of the group for its first slot, 0 for the others
+ */
+static void lcd_service_publish(lcd_service_t *service, unsigned int pos, uint32_t group, const lcd_cmd_t *cmd)
+{
+    lcd_service_slot_t *slot = &service->slots[pos & service->mask];
+
+    slot->group = group;
+    slot->cmd = *cmd;
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+}
+
+/**
+ * @brief Claim the oldest group once all of it is published
+ *
+ * @return Number of commands claimed from pos onwards, 0 if the ring is empty
+ */
+static uint32_t lcd_service_take(lcd_service_t *service, unsigned int *pos_out)
+{
+    unsigned int pos = atomic_load_explicit(&service->dequeue_pos, memory_order_relaxed);
+
+    for (;;)
+    {
+        lcd_service_slot_t *slot = &service->slots[pos & service->mask];
+        int diff = (int)(atomic_load_explicit(&slot->sequence, memory_order_acquire) - (pos + 1));
+        // Only trusted once the CAS below proves the slot was not taken meanwhile
+        uint32_t count = slot->group;
+
+        if (diff == 0 && count >= 1 && count <= service->mask + 1)
+        {
+            for (uint32_t i = 1; i < count && diff == 0; ++i)
+            {
+                lcd_service_slot_t *next = &service->slots[(pos + i) & service->mask];
+
+                diff = (int)(atomic_load_explicit(&next->sequence, memory_order_acquire) - (pos + i + 1));
+            }
+            // The producer is still filling the rest of the group
+            if (diff < 0)
+                return 0;
+        }
+        else if (diff == 0)
+        {
+            diff = 1; // read while another consumer recycled the slot
+        }
+
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&service->dequeue_pos, &pos, pos + count,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                *pos_out = pos;
+                return count;
+            }
+        }
+        else if (diff < 0)
+        {
+            return 0; // empty
+        }
+        else
+        {
+            pos = atomic_load_explicit(&service->dequeue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * @brief Copy a claimed command out and free its slot for producers
+ */
+static void lcd_service_release(lcd_service_t *service, unsigned int pos, lcd_cmd_t *cmd)
+{
+    lcd_service_slot_t *slot = &service->slots[pos & service->mask];
+
+    *cmd = slot->cmd;
+    atomic_store_explicit(&slot->sequence, pos + service->mask + 1, memory_order_release);
+}
+
+/**
+ * @brief Discard the oldest group to make room
+ *
+ * @return Number of commands discarded, 0 if none could be taken
+ */
+static uint32_t lcd_service_drop_oldest(lcd_service_t *service)
+{
+    lcd_cmd_t cmd;
+    unsigned int pos;
+    uint32_t count = lcd_service_take(service, &pos);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        lcd_service_release(service, pos + i, &cmd);
+        atomic_fetch_add(&service->dropped, 1);
+        if (cmd.op)
+            lcd_async_complete(cmd.op, ESP_ERR_NO_MEM);
+        lcd_service_done(&cmd);
+    }
+    if (count)
+        lcd_service_wake(service);
+    return count;
+}
+
+/**
+ * @brief Let one waiting producer or flusher look at the ring again
+ */
+static void lcd_service_wake(lcd_service_t *service)
+{
+    if (atomic_load(&service->waiters))
+        xSemaphoreGive(service->progress);
+}
+
+/**
+ * @brief Sleep until a group leaves the ring
+ *
+ * @details The caller must be counted in waiters.
+ *
+ * @return false once timeout ticks have passed since start
+ */
+static bool lcd_service_wait_progress(lcd_service_t *service, TickType_t start, TickType_t timeout)
+{
+    TickType_t elapsed = xTaskGetTickCount() - start;
+
+    return elapsed < timeout && xSemaphoreTake(service->progress, timeout - elapsed) == pdTRUE;
+}
+
+static void lcd_service_stop_waiting(lcd_service_t *service, bool done)
+{
+    // A single give wakes a single waiter. One whose wait is over passes it
+    // on, as the progress it saw may also be what the others wait for.
+    if (atomic_fetch_sub(&service->waiters, 1) > 1 && done)
+        xSemaphoreGive(service->progress);
+}
+
+static bool lcd_service_idle(lcd_service_t *service)
+{
+    return (atomic_load(&service->dequeue_pos) == atomic_load(&service->enqueue_pos)) &&
+           !atomic_load(&service->executing);
+}
+
+/**
+ * @brief Command count of a handle
+ *
+ * @details The field is a plain unsigned int in the public handle, which
+ *          does not include stdatomic.h. The atomic type has the same size
+ *          and representation on every target the driver builds for.
+ */
+static atomic_uint *lcd_service_queued(lcd_handle_t *handle)
+{
+    return (atomic_uint *)&handle->service_queued;
+}
+
+/**
+ * @brief A command has run or was dropped
+ *
+ * @details The last access to the handle on behalf of the command: a
+ *          detach waiting for the count to reach 0 may return right after.
+ */
+static void lcd_service_done(const lcd_cmd_t *cmd)
+{
+    atomic_fetch_sub(lcd_service_queued(cmd->handle), 1);
+}
+
+static esp_err_t lcd_service_wait_idle(lcd_service_t *service, uint32_t timeout_ms)
+{
+    TickType_t start = xTaskGetTickCount();
+    bool idle;
+
+    atomic_fetch_add(&service->waiters, 1);
+    while (!(idle = lcd_service_idle(service)) &&
+           lcd_service_wait_progress(service, start, pdMS_TO_TICKS(timeout_ms)))
+        ;
+    lcd_service_stop_waiting(service, idle);
+    return idle ? ESP_OK : ESP_ERR_TIMEOUT;
+}
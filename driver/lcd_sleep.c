@@ -0,0 +1,261 @@
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_attr.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+#if CONFIG_LCD_SLEEP_PERSIST
+#include "esp_system.h" // No reset reason on the linux target, where this is never enabled
+#endif
+#include "lcd.h"
+#include "hd44780.h"
+#include "hd44780_refresh.h"
+#include "hd44780_sleep.h"
+
+// Snapshots live in RTC slow memory, which stays powered in deep sleep.
+// Only a wake from deep sleep may use one; any other reset starts cold.
+// The snapshot is invalidated as soon as it is used, so a unit that goes
+// back to sleep without calling lcd_sleep_save() starts cold next time
+// rather than trusting a frame that no longer matches the display.
+
+static const char *TAG = "LCD Sleep";
+
+#if CONFIG_LCD_SLEEP_PERSIST
+
+static RTC_DATA_ATTR lcd_sleep_t lcd_sleep_records[CONFIG_LCD_SLEEP_SLOTS];
+static bool lcd_sleep_claimed[CONFIG_LCD_SLEEP_SLOTS];
+static portMUX_TYPE lcd_sleep_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t lcd_sleep_crc(const lcd_sleep_t *sleep)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)sleep, offsetof(lcd_sleep_t, crc));
+}
+
+static bool lcd_sleep_valid(const lcd_sleep_t *sleep)
+{
+    return sleep->magic == LCD_SLEEP_MAGIC && sleep->crc == lcd_sleep_crc(sleep);
+}
+
+esp_err_t lcd_sleep_save(lcd_handle_t *handle)
+{
+    esp_err_t ret = ESP_OK;
+    lcd_sleep_t *sleep;
+
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(handle->initialized, ESP_ERR_INVALID_STATE, TAG, "LCD not initialized");
+    sleep = handle->sleep;
+    ESP_RETURN_ON_FALSE(sleep, ESP_ERR_NOT_SUPPORTED, TAG, "No snapshot slot for LCD 0x%x", handle->address);
+
+    // The snapshot must describe what the controller really holds
+    ESP_RETURN_ON_ERROR(
+        lcd_flush(handle),
+        TAG, "Error with lcd_flush()");
+
+    lcd_lock(handle);
+    sleep->magic = 0;
+    sleep->display_function = handle->display_function;
+    sleep->display_control = handle->display_control;
+    sleep->display_mode = handle->display_mode;
+    sleep->cursor_column = handle->cursor_column;
+    sleep->cursor_row = handle->cursor_row;
+    sleep->backlight = handle->backlight;
+    sleep->frame_valid = handle->refresh && handle->refresh->cells <= LCD_SLEEP_MAX_CELLS;
+    if (sleep->frame_valid)
+        memcpy(sleep->frame, handle->refresh->shown, handle->refresh->cells);
+    sleep->resumed = false;
+    sleep->magic = LCD_SLEEP_MAGIC;
+    sleep->crc = lcd_sleep_crc(sleep);
+    lcd_unlock(handle);
+    return ret;
+}
+
+bool lcd_sleep_resumed(const lcd_handle_t *handle)
+{
+    return handle && handle->sleep && handle->sleep->resumed;
+}
+
+esp_err_t lcd_sleep_attach(lcd_handle_t *handle)
+{
+    lcd_sleep_t *sleep = NULL;
+    int slot = -1;
+    bool found = false;
+
+    portENTER_CRITICAL(&lcd_sleep_spinlock);
+    for (int i = 0; i < CONFIG_LCD_SLEEP_SLOTS && !found; ++i)
+    {
+        lcd_sleep_t *rec = &lcd_sleep_records[i];
+        if (lcd_sleep_claimed[i])
+            continue;
+        if (rec->i2c_port == handle->i2c_port && rec->address == handle->address)
+        {
+            slot = i;
+            found = lcd_sleep_valid(rec);
+        }
+        else if (slot < 0 && !lcd_sleep_valid(rec))
+        {
+            slot = i;
+        }
+    }
+    if (slot >= 0)
+    {
+        lcd_sleep_claimed[slot] = true;
+        sleep = &lcd_sleep_records[slot];
+    }
+    portEXIT_CRITICAL(&lcd_sleep_spinlock);
+
+    if (!sleep)
+    {
+        ESP_LOGW(TAG, "No free snapshot slot for LCD 0x%x", handle->address);
+        return ESP_ERR_NO_MEM;
+    }
+    handle->sleep = sleep;
+
+    if (found && esp_reset_reason() == ESP_RST_DEEPSLEEP &&
+        sleep->columns == handle->columns && sleep->rows == handle->rows)
+    {
+        return ESP_OK;
+    }
+
+    // Start a blank snapshot. The CGRAM shadow is only trusted after deep sleep.
+    memset(sleep, 0, sizeof(lcd_sleep_t));
+    sleep->i2c_port = handle->i2c_port;
+    sleep->address = handle->address;
+    sleep->columns = handle->columns;
+    sleep->rows = handle->rows;
+    return ESP_ERR_NOT_FOUND;
+}
+
+void lcd_sleep_detach(lcd_handle_t *handle)
+{
+    lcd_sleep_t *sleep = handle->sleep;
+
+    if (!sleep)
+        return;
+    handle->sleep = NULL;
+    portENTER_CRITICAL(&lcd_sleep_spinlock);
+    lcd_sleep_claimed[sleep - lcd_sleep_records] = false;
+    portEXIT_CRITICAL(&lcd_sleep_spinlock);
+}
+
+void lcd_sleep_restore(lcd_handle_t *handle)
+{
+    lcd_sleep_t *sleep = handle->sleep;
+
+    handle->display_function = sleep->display_function;
+    handle->display_control = sleep->display_control;
+    handle->display_mode = sleep->display_mode;
+    handle->hw_display_function = sleep->display_function;
+    handle->hw_display_control = sleep->display_control;
+    handle->hw_display_mode = sleep->display_mode;
+    handle->cursor_column = sleep->cursor_column;
+    handle->cursor_row = sleep->cursor_row;
+    handle->backlight = sleep->backlight;
+    // Used once. lcd_sleep_save() validates it again.
+    sleep->magic = 0;
+    sleep->resumed = true;
+}
+
+void lcd_sleep_invalidate(lcd_handle_t *handle)
+{
+    lcd_sleep_t *sleep = handle->sleep;
+
+    if (!sleep)
+        return;
+    sleep->magic = 0;
+    sleep->frame_valid = false;
+    sleep->cgram_valid = 0;
+    sleep->resumed = false;
+}
+
+bool lcd_sleep_take_frame(lcd_handle_t *handle, char *frame)
+{
+    lcd_sleep_t *sleep = handle->sleep;
+
+    if (!sleep || !sleep->resumed || !sleep->frame_valid)
+        return false;
+    memcpy(frame, sleep->frame, handle->columns * handle->rows);
+    sleep->frame_valid = false;
+    return true;
+}
+
+bool lcd_sleep_cgram_matches(const lcd_handle_t *handle, uint8_t location, const uint8_t *charmap, uint8_t len)
+{
+    lcd_sleep_t *sleep = handle->sleep;
+
+    return sleep && (sleep->cgram_valid & (1 << location)) &&
+           memcmp(sleep->cgram[location], charmap, len) == 0;
+}
+
+void lcd_sleep_cgram_store(lcd_handle_t *handle, uint8_t location, const uint8_t *charmap, uint8_t len)
+{
+    lcd_sleep_t *sleep = handle->sleep;
+
+    if (!sleep)
+        return;
+    memcpy(sleep->cgram[location], charmap, len);
+    sleep->cgram_valid |= 1 << location;
+    // A 5x10 glyph spills into the next location, and the one before spills into this one
+    if (len > 8 && location < LCD_SLEEP_CGRAM_LOCATIONS - 1)
+        sleep->cgram_valid &= ~(1 << (location + 1));
+    if (len > 8 && location > 0)
+        sleep->cgram_valid &= ~(1 << (location - 1));
+}
+
+void lcd_sleep_cgram_forget(lcd_handle_t *handle)
+{
+    if (handle->sleep)
+        handle->sleep->cgram_valid = 0;
+}
+
+#else // CONFIG_LCD_SLEEP_PERSIST
+
+esp_err_t lcd_sleep_save(lcd_handle_t *handle)
+{
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+bool lcd_sleep_resumed(const lcd_handle_t *handle)
+{
+    return false;
+}
+
+esp_err_t lcd_sleep_attach(lcd_handle_t *handle)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void lcd_sleep_detach(lcd_handle_t *handle)
+{
+}
+
+void lcd_sleep_restore(lcd_handle_t *handle)
+{
+}
+
+void lcd_sleep_invalidate(lcd_handle_t *handle)
+{
+}
+
+bool lcd_sleep_take_frame(lcd_handle_t *handle, char *frame)
+{
+    return false;
+}
+
+bool lcd_sleep_cgram_matches(const lcd_handle_t *handle, uint8_t location, const uint8_t *charmap, uint8_t len)
+{
+    return false;
+}
+
+void lcd_sleep_cgram_store(lcd_handle_t *handle, uint8_t location, const uint8_t *charmap, uint8_t len)
+{
+}
+
+void lcd_sleep_cgram_forget(lcd_handle_t *handle)
+{
+}
+
+#endif // CONFIG_LCD_SLEEP_PERSIST
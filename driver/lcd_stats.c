@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+#include "lcd.h"
+#include "hd44780.h"
+#include "hd44780_stats.h"
+
+// Counting costs a few increments per I2C transaction, which takes over
+// 200 us at 100 kHz, and two esp_timer_get_time() calls per API call. With
+// CONFIG_LCD_STATS disabled no counters are allocated and the hooks below
+// return at once.
+
+static const char *TAG = "LCD Stats";
+
+static const char *lcd_stats_api_names[LCD_STATS_API_MAX] = {
+    [LCD_STATS_API_INIT] = "init",
+    [LCD_STATS_API_WRITE_CHAR] = "write_char",
+    [LCD_STATS_API_WRITE_STR] = "write_str",
+    [LCD_STATS_API_SET_CURSOR] = "set_cursor",
+    [LCD_STATS_API_CLEAR_SCREEN] = "clear_screen",
+    [LCD_STATS_API_HOME] = "home",
+    [LCD_STATS_API_CONTROL] = "control",
+    [LCD_STATS_API_SHIFT] = "shift",
+    [LCD_STATS_API_BACKLIGHT] = "backlight",
+    [LCD_STATS_API_WRITE_CGRAM] = "write_cgram",
+    [LCD_STATS_API_FLUSH] = "flush",
+    [LCD_STATS_API_SCREEN_SHOW] = "screen_show",
+};
+
+const char *lcd_stats_api_name(lcd_stats_api_t api)
+{
+    if (api >= LCD_STATS_API_MAX)
+        return "unknown";
+    return lcd_stats_api_names[api];
+}
+
+#if CONFIG_LCD_STATS
+
+esp_err_t lcd_get_stats(lcd_handle_t *handle, lcd_stats_t *stats, bool reset)
+{
+    lcd_counters_t *counters;
+
+    ESP_RETURN_ON_FALSE(handle && stats, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    counters = handle->counters;
+    ESP_RETURN_ON_FALSE(counters, ESP_ERR_INVALID_STATE, TAG, "LCD not initialized");
+
+    // The lock keeps the bus counters consistent with each other
+    lcd_lock(handle);
+    portENTER_CRITICAL(&counters->spinlock);
+    *stats = counters->stats;
+    stats->elapsed_us = esp_timer_get_time() - counters->start_us;
+    if (reset)
+    {
+        memset(&counters->stats, 0, sizeof(counters->stats));
+        counters->start_us = esp_timer_get_time();
+    }
+    portEXIT_CRITICAL(&counters->spinlock);
+    lcd_unlock(handle);
+    return ESP_OK;
+}
+
+esp_err_t lcd_counters_create(lcd_handle_t *handle)
+{
+    lcd_counters_t *counters;
+
+    if (handle->counters)
+        return ESP_OK;
+    counters = calloc(1, sizeof(lcd_counters_t));
+    ESP_RETURN_ON_FALSE(counters, ESP_ERR_NO_MEM, TAG, "Unable to allocate counters");
+    portMUX_INITIALIZE(&counters->spinlock);
+    counters->start_us = esp_timer_get_time();
+    handle->counters = counters;
+    return ESP_OK;
+}
+
+void lcd_counters_free(lcd_handle_t *handle)
+{
+    lcd_counters_t *counters = handle->counters;
+
+    handle->counters = NULL;
+    free(counters);
+}
+
+int64_t lcd_stats_start(void)
+{
+    return esp_timer_get_time();
+}
+
+void lcd_stats_call(const lcd_handle_t *handle, lcd_stats_api_t api, int64_t start_us)
+{
+    lcd_counters_t *counters;
+    int64_t us = esp_timer_get_time() - start_us;
+    int bucket = 0;
+
+    if (!handle || !handle->counters || api >= LCD_STATS_API_MAX)
+        return;
+    counters = handle->counters;
+    // Position of the highest set bit, plus one
+    while (us > 0 && bucket < LCD_STATS_LATENCY_BUCKETS - 1)
+    {
+        us >>= 1;
+        ++bucket;
+    }
+    portENTER_CRITICAL(&counters->spinlock);
+    counters->stats.latency[api][bucket]++;
+    portEXIT_CRITICAL(&counters->spinlock);
+}
+
+void lcd_stats_i2c(const lcd_handle_t *handle, esp_err_t result, int64_t start_us, uint32_t count)
+{
+    lcd_counters_t *counters = handle->counters;
+
+    if (!counters)
+        return;
+    counters->stats.i2c_transactions += count;
+    counters->stats.wire_bytes += 2 * count;
+    counters->stats.transmit_us += esp_timer_get_time() - start_us;
+    if (result == ESP_FAIL) // Slave hasn't ACK the transfer
+        counters->stats.nacks++;
+    else if (result != ESP_OK)
+        counters->stats.bus_errors++;
+}
+
+void lcd_stats_i2c_bulk(const lcd_handle_t *handle, esp_err_t result, int64_t start_us, uint32_t len)
+{
+    lcd_counters_t *counters = handle->counters;
+
+    if (!counters)
+        return;
+    counters->stats.i2c_transactions++;
+    counters->stats.wire_bytes += 1 + len;
+    counters->stats.transmit_us += esp_timer_get_time() - start_us;
+    if (result == ESP_FAIL)
+        counters->stats.nacks++;
+    else if (result != ESP_OK)
+        counters->stats.bus_errors++;
+}
+
+void lcd_stats_retry(const lcd_handle_t *handle)
+{
+    if (handle->counters)
+        handle->counters->stats.retries++;
+}
+
+void lcd_stats_sent(const lcd_handle_t *handle, uint8_t data, uint8_t mode)
+{
+    lcd_counters_t *counters = handle->counters;
+    int type = LCD_STATS_INSTR_MAX - 1;
+
+    if (!counters)
+        return;
+    if (mode != LCD_COMMAND)
+    {
+        counters->stats.chars++;
+        return;
+    }
+    while (type > 0 && !(data & (1 << type)))
+        --type;
+    counters->stats.instructions[type]++;
+}
+
+void lcd_stats_wait(const lcd_handle_t *handle, int64_t us)
+{
+    if (handle->counters)
+        handle->counters->stats.wait_us += us;
+}
+
+#else // CONFIG_LCD_STATS
+
+esp_err_t lcd_get_stats(lcd_handle_t *handle, lcd_stats_t *stats, bool reset)
+{
+    ESP_RETURN_ON_FALSE(handle && stats, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t lcd_counters_create(lcd_handle_t *handle)
+{
+    return ESP_OK;
+}
+
+void lcd_counters_free(lcd_handle_t *handle)
+{
+}
+
+int64_t lcd_stats_start(void)
+{
+    return 0;
+}
+
+void lcd_stats_call(const lcd_handle_t *handle, lcd_stats_api_t api, int64_t start_us)
+{
+}
+
+void lcd_stats_i2c(const lcd_handle_t *handle, esp_err_t result, int64_t start_us, uint32_t count)
+{
+}
+
+void lcd_stats_i2c_bulk(const lcd_handle_t *handle, esp_err_t result, int64_t start_us, uint32_t len)
+{
+}
+
+void lcd_stats_retry(const lcd_handle_t *handle)
+{
+}
+
+void lcd_stats_sent(const lcd_handle_t *handle, uint8_t data, uint8_t mode)
+{
+}
+
+void lcd_stats_wait(const lcd_handle_t *handle, int64_t us)
+{
+}
+
+#endif // CONFIG_LCD_STATS
@@ -0,0 +1,349 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+#include "lcd.h"
+#include "hd44780.h"
+#include "hd44780_trace.h"
+#include "hd44780_pinmap.h"
+
+// The trace is one ring shared by every display, so bytes of displays on
+// the same bus interleave as they did on the wire. Recording is a copy of
+// eight bytes under a spinlock. Runs are recorded and the ring is read in
+// chunks of LCD_TRACE_CHUNK entries, dropping the spinlock in between, so
+// no display waits long on another's trace. Decoding happens only when the
+// trace is dumped, with a model of the controller's interface just detailed
+// enough to pair nibbles the way the controller does.
+
+static const char *TAG = "LCD Trace";
+
+#if CONFIG_LCD_TRACE
+
+#define LCD_TRACE_DEVICES 16 /*!< Displays decoded separately by lcd_trace_dump() */
+#define LCD_TRACE_CHUNK 32   /*!< Most entries recorded or copied per hold of the spinlock */
+
+/**
+ * @brief Interface state of one controller, as seen by the decoder
+ */
+typedef struct
+{
+    uint8_t i2c_port;
+    uint8_t address;
+    bool used;
+    bool enable;      /*!< E line after the last write */
+    bool eight_bit;   /*!< Every nibble is a whole instruction */
+    bool half;        /*!< high holds the first nibble of a byte */
+    uint8_t high;     /*!< First nibble of the byte being received */
+} lcd_trace_device_t;
+
+static lcd_trace_entry_t lcd_trace_ring[CONFIG_LCD_TRACE_DEPTH];
+static size_t lcd_trace_head;    /*!< Slot the next entry goes to */
+static size_t lcd_trace_held;    /*!< Entries in the ring, the newest just before lcd_trace_head */
+static uint32_t lcd_trace_total; /*!< Entries ever recorded, modulo 2^32. Tells a reader what was overwritten. */
+static bool lcd_trace_paused;
+static portMUX_TYPE lcd_trace_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+static lcd_trace_device_t *lcd_trace_device(lcd_trace_device_t *devices, const lcd_trace_entry_t *entry);
+static void lcd_trace_decode(lcd_trace_device_t *device, const lcd_trace_entry_t *entry, char *meaning, size_t len);
+static void lcd_trace_describe(uint8_t byte, bool data, char *meaning, size_t len);
+
+/**
+ * @brief Append an entry to the ring. Spinlock held.
+ */
+static void lcd_trace_append(const lcd_handle_t *handle, uint8_t data, uint8_t flags, uint32_t time_us)
+{
+    lcd_trace_entry_t *entry;
+
+    if (lcd_trace_paused)
+        return;
+    entry = &lcd_trace_ring[lcd_trace_head];
+    entry->time_us = time_us;
+    entry->i2c_port = handle->i2c_port;
+    entry->address = handle->address;
+    // Kept in the default pin order, the one lcd_trace_decode() knows
+    entry->data = lcd_encoding_canonical(lcd_encoding(handle), data);
+    entry->flags = flags;
+    if (++lcd_trace_head == CONFIG_LCD_TRACE_DEPTH)
+        lcd_trace_head = 0;
+    if (lcd_trace_held < CONFIG_LCD_TRACE_DEPTH)
+        lcd_trace_held++;
+    lcd_trace_total++;
+}
+
+void lcd_trace_record(const lcd_handle_t *handle, uint8_t data, uint8_t flags)
+{
+    uint32_t now = (uint32_t)esp_timer_get_time();
+
+    portENTER_CRITICAL(&lcd_trace_spinlock);
+    lcd_trace_append(handle, data, flags, now);
+    portEXIT_CRITICAL(&lcd_trace_spinlock);
+}
+
+void lcd_trace_record_run(const lcd_handle_t *handle, const uint8_t *data, size_t len, uint8_t flags,
+                          int64_t start_us)
+{
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+
+    for (size_t i = 0; i < len;)
+    {
+        size_t end = len - i > LCD_TRACE_CHUNK ? i + LCD_TRACE_CHUNK : len;
+
+        portENTER_CRITICAL(&lcd_trace_spinlock);
+        for (; i < end; ++i)
+            lcd_trace_append(handle, data[i], flags,
+                             (uint32_t)(start_us + elapsed_us * (int64_t)(i + 1) / (int64_t)len));
+        portEXIT_CRITICAL(&lcd_trace_spinlock);
+    }
+}
+
+esp_err_t lcd_trace_read(lcd_trace_entry_t *entries, size_t max, size_t *count)
+{
+    size_t n;
+    size_t copied = 0;
+    uint32_t end;
+    bool lapped = false;
+
+    ESP_RETURN_ON_FALSE(entries && count, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    portENTER_CRITICAL(&lcd_trace_spinlock);
+    end = lcd_trace_total;
+    n = lcd_trace_held < max ? lcd_trace_held : max;
+    portEXIT_CRITICAL(&lcd_trace_spinlock);
+
+    // The newest n entries as of the call, copied newest first into the end
+    // of entries. Recording goes on between chunks; an entry overwritten or
+    // cleared before it was copied ends the copy, and what was copied is
+    // still an unbroken run up to the same newest entry.
+    while (copied < n && !lapped)
+    {
+        size_t chunk = n - copied > LCD_TRACE_CHUNK ? LCD_TRACE_CHUNK : n - copied;
+        size_t age;
+
+        portENTER_CRITICAL(&lcd_trace_spinlock);
+        // Entries recorded since the one to copy next, counting itself
+        age = (uint32_t)(lcd_trace_total - end) + copied + 1;
+        if (age + chunk - 1 > lcd_trace_held)
+        {
+            chunk = age <= lcd_trace_held ? lcd_trace_held - age + 1 : 0;
+            lapped = true;
+        }
+        for (size_t i = 0; i < chunk; ++i)
+            entries[n - copied - 1 - i] =
+                lcd_trace_ring[(lcd_trace_head + 2 * CONFIG_LCD_TRACE_DEPTH - age - i) % CONFIG_LCD_TRACE_DEPTH];
+        portEXIT_CRITICAL(&lcd_trace_spinlock);
+        copied += chunk;
+    }
+    if (copied < n)
+        memmove(entries, &entries[n - copied], copied * sizeof(lcd_trace_entry_t));
+    *count = copied;
+    return ESP_OK;
+}
+
+void lcd_trace_pause(bool paused)
+{
+    portENTER_CRITICAL(&lcd_trace_spinlock);
+    lcd_trace_paused = paused;
+    portEXIT_CRITICAL(&lcd_trace_spinlock);
+}
+
+void lcd_trace_clear(void)
+{
+    portENTER_CRITICAL(&lcd_trace_spinlock);
+    lcd_trace_head = 0;
+    lcd_trace_held = 0;
+    portEXIT_CRITICAL(&lcd_trace_spinlock);
+}
+
+esp_err_t lcd_trace_dump(FILE *stream)
+{
+    esp_err_t ret = ESP_OK;
+    lcd_trace_entry_t *entries = NULL;
+    lcd_trace_device_t devices[LCD_TRACE_DEVICES] = {0};
+    size_t count = 0;
+    char meaning[64];
+
+    ESP_RETURN_ON_FALSE(stream, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    // Printing is slow, so work on a copy and keep recording meanwhile
+    entries = malloc(CONFIG_LCD_TRACE_DEPTH * sizeof(lcd_trace_entry_t));
+    ESP_RETURN_ON_FALSE(entries, ESP_ERR_NO_MEM, TAG, "Unable to allocate trace copy");
+    ESP_GOTO_ON_ERROR(
+        lcd_trace_read(entries, CONFIG_LCD_TRACE_DEPTH, &count),
+        err, TAG, "Error with lcd_trace_read()");
+
+    fprintf(stream, "time_us,port,addr,dir,byte,RS,RW,E,BL,D4,D5,D6,D7,meaning\n");
+    for (size_t i = 0; i < count; ++i)
+    {
+        const lcd_trace_entry_t *entry = &entries[i];
+        uint8_t d = entry->data;
+
+        lcd_trace_decode(lcd_trace_device(devices, entry), entry, meaning, sizeof(meaning));
+        // Relative to the oldest entry. Unsigned arithmetic survives the 32-bit wrap.
+        fprintf(stream, "%u,%u,0x%02x,%c,0x%02x,%d,%d,%d,%d,%d,%d,%d,%d,%s\n",
+                (unsigned)(entry->time_us - entries[0].time_us),
+                entry->i2c_port, entry->address,
+                (entry->flags & LCD_TRACE_READ) ? 'r' : 'w', d,
+                d & 1, (d >> 1) & 1, (d >> 2) & 1, (d >> 3) & 1,
+                (d >> 4) & 1, (d >> 5) & 1, (d >> 6) & 1, (d >> 7) & 1,
+                meaning);
+    }
+err:
+    free(entries);
+    return ret;
+}
+
+/**
+ * @brief Decoder state of the display an entry belongs to
+ *
+ * @details Displays beyond LCD_TRACE_DEVICES share the last slot and are
+ *          decoded as one, which garbles their meaning column but not the pins.
+ */
+static lcd_trace_device_t *lcd_trace_device(lcd_trace_device_t *devices, const lcd_trace_entry_t *entry)
+{
+    int i;
+
+    for (i = 0; i < LCD_TRACE_DEVICES - 1 && devices[i].used; ++i)
+    {
+        if (devices[i].i2c_port == entry->i2c_port && devices[i].address == entry->address)
+            return &devices[i];
+    }
+    if (!devices[i].used)
+    {
+        devices[i].used = true;
+        devices[i].i2c_port = entry->i2c_port;
+        devices[i].address = entry->address;
+    }
+    return &devices[i];
+}
+
+/**
+ * @brief Follow the controller through one expander byte and describe it
+ *
+ * @details The controller latches D4-D7 on the falling edge of E. In 8-bit
+ *          mode, as after power-up, each latch is a whole instruction whose
+ *          low four bits are not connected. A Function Set switches modes, so
+ *          the reset sequence brings the decoder in step just as it does the
+ *          controller.
+ */
+static void lcd_trace_decode(lcd_trace_device_t *device, const lcd_trace_entry_t *entry, char *meaning, size_t len)
+{
+    uint8_t d = entry->data;
+    bool enable = d & LCD_ENABLE;
+    uint8_t nibble = d >> 4;
+    uint8_t byte;
+    int n;
+
+    if (entry->flags & LCD_TRACE_ERROR)
+    {
+        snprintf(meaning, len, "bus error");
+        return;
+    }
+    if (entry->flags & LCD_TRACE_READ)
+    {
+        snprintf(meaning, len, "read D7-D4 0x%x", nibble);
+        return;
+    }
+    if (enable == device->enable)
+    {
+        // E held, as for a backlight change: nothing is latched
+        meaning[0] = '\0';
+        return;
+    }
+    device->enable = enable;
+    if (enable)
+    {
+        snprintf(meaning, len, "E rise");
+        return;
+    }
+    if (d & LCD_READ)
+    {
+        snprintf(meaning, len, "E fall read");
+        return;
+    }
+
+    if (device->eight_bit)
+        byte = nibble << 4;
+    else if (!device->half)
+    {
+        device->high = nibble;
+        device->half = true;
+        snprintf(meaning, len, "E fall high nibble 0x%x", nibble);
+        return;
+    }
+    else
+        byte = (device->high << 4) | nibble;
+    device->half = false;
+
+    if (device->eight_bit)
+        n = snprintf(meaning, len, "E fall 8-bit: ");
+    else
+        n = snprintf(meaning, len, "E fall low nibble 0x%x: ", nibble);
+    if (n > 0 && (size_t)n < len)
+        lcd_trace_describe(byte, d & LCD_WRITE, meaning + n, len - n);
+    if (!(d & LCD_WRITE) && (byte & 0xE0) == LCD_FUNCTION_SET)
+        device->eight_bit = byte & LCD_8BIT_MODE;
+}
+
+/**
+ * @brief Name the instruction or character a byte stands for
+ */
+static void lcd_trace_describe(uint8_t byte, bool data, char *meaning, size_t len)
+{
+    if (data)
+        // No commas in the meaning column, it is the last CSV field
+        snprintf(meaning, len, "data 0x%02x '%c'", byte,
+                 (byte >= 0x20 && byte < 0x7F && byte != ',') ? byte : '.');
+    else if (byte & LCD_SET_DDRAM_ADDR)
+        snprintf(meaning, len, "set DDRAM address 0x%02x", byte & 0x7F);
+    else if (byte & LCD_SET_CGRAM_ADDR)
+        snprintf(meaning, len, "set CGRAM address 0x%02x", byte & 0x3F);
+    else if (byte & LCD_FUNCTION_SET)
+        snprintf(meaning, len, "function set %s %s %s",
+                 (byte & LCD_8BIT_MODE) ? "8-bit" : "4-bit",
+                 (byte & LCD_2LINE) ? "2-line" : "1-line",
+                 (byte & LCD_5x10DOTS) ? "5x10" : "5x8");
+    else if (byte & LCD_CURSOR_OR_DISPLAY_SHIFT)
+        snprintf(meaning, len, "shift %s %s",
+                 (byte & LCD_DISPLAY_MOVE) ? "display" : "cursor",
+                 (byte & LCD_MOVE_RIGHT) ? "right" : "left");
+    else if (byte & LCD_DISPLAY_CONTROL)
+        snprintf(meaning, len, "display control D=%d C=%d B=%d",
+                 !!(byte & LCD_DISPLAY_ON), !!(byte & LCD_CURSOR_ON), !!(byte & LCD_BLINK_ON));
+    else if (byte & LCD_ENTRY_MODE_SET)
+        snprintf(meaning, len, "entry mode I/D=%d S=%d",
+                 !!(byte & LCD_ENTRY_INCREMENT), !!(byte & LCD_ENTRY_DISPLAY_SHIFT));
+    else if (byte & LCD_HOME)
+        snprintf(meaning, len, "return home");
+    else if (byte & LCD_CLEAR)
+        snprintf(meaning, len, "clear display");
+    else
+        snprintf(meaning, len, "instruction 0x00");
+}
+
+#else // CONFIG_LCD_TRACE
+
+esp_err_t lcd_trace_read(lcd_trace_entry_t *entries, size_t max, size_t *count)
+{
+    ESP_RETURN_ON_FALSE(entries && count, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    *count = 0;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void lcd_trace_pause(bool paused)
+{
+}
+
+void lcd_trace_clear(void)
+{
+}
+
+esp_err_t lcd_trace_dump(FILE *stream)
+{
+    ESP_RETURN_ON_FALSE(stream, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif // CONFIG_LCD_TRACE
@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+#if CONFIG_LCD_WARM_START
+#include "esp_system.h" // No reset reason on the linux target, where this is never enabled
+#endif
+#include "lcd.h"
+#include "hd44780.h"
+#include "hd44780_warm.h"
+
+// Records live in RTC memory that is not cleared at reset, so they survive
+// software resets, panics and watchdog resets but hold garbage after power
+// on. The magic number and CRC tell the two apart. A brownout or power-on
+// reset most likely reset the display as well, so those always take the
+// cold path whatever the records say.
+
+#if CONFIG_LCD_WARM_START
+
+static const char *TAG = "LCD Warm";
+
+static RTC_NOINIT_ATTR lcd_warm_t lcd_warm_records[CONFIG_LCD_WARM_START_SLOTS];
+static bool lcd_warm_claimed[CONFIG_LCD_WARM_START_SLOTS];
+static portMUX_TYPE lcd_warm_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t lcd_warm_crc(const lcd_warm_t *warm)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)warm, offsetof(lcd_warm_t, crc));
+}
+
+static bool lcd_warm_valid(const lcd_warm_t *warm)
+{
+    return warm->magic == LCD_WARM_MAGIC && warm->crc == lcd_warm_crc(warm);
+}
+
+esp_err_t lcd_warm_attach(lcd_handle_t *handle)
+{
+    esp_reset_reason_t reason = esp_reset_reason();
+    lcd_warm_t *warm = NULL;
+    int slot = -1;
+    bool found = false;
+
+    portENTER_CRITICAL(&lcd_warm_spinlock);
+    for (int i = 0; i < CONFIG_LCD_WARM_START_SLOTS && !found; ++i)
+    {
+        lcd_warm_t *rec = &lcd_warm_records[i];
+        if (lcd_warm_claimed[i])
+            continue;
+        if (lcd_warm_valid(rec))
+        {
+            if (rec->i2c_port == handle->i2c_port && rec->address == handle->address)
+            {
+                slot = i;
+                found = true;
+            }
+        }
+        else if (slot < 0)
+        {
+            slot = i;
+        }
+    }
+    if (slot >= 0)
+    {
+        lcd_warm_claimed[slot] = true;
+        warm = &lcd_warm_records[slot];
+    }
+    portEXIT_CRITICAL(&lcd_warm_spinlock);
+
+    if (!warm)
+    {
+        ESP_LOGW(TAG, "No free warm start record for LCD 0x%x", handle->address);
+        return ESP_ERR_NO_MEM;
+    }
+    handle->warm = warm;
+
+    if (found && reason != ESP_RST_POWERON && reason != ESP_RST_BROWNOUT &&
+        warm->columns == handle->columns && warm->rows == handle->rows)
+    {
+        return ESP_OK;
+    }
+
+    lcd_warm_invalidate(handle);
+    warm->i2c_port = handle->i2c_port;
+    warm->address = handle->address;
+    warm->columns = handle->columns;
+    warm->rows = handle->rows;
+    warm->reserved = 0;
+    warm->half_sent = 0;
+    return ESP_ERR_NOT_FOUND;
+}
+
+void lcd_warm_detach(lcd_handle_t *handle)
+{
+    lcd_warm_t *warm = handle->warm;
+
+    if (!warm)
+        return;
+    handle->warm = NULL;
+    portENTER_CRITICAL(&lcd_warm_spinlock);
+    lcd_warm_claimed[warm - lcd_warm_records] = false;
+    portEXIT_CRITICAL(&lcd_warm_spinlock);
+}
+
+void lcd_warm_save(const lcd_handle_t *handle)
+{
+    lcd_warm_t *warm = handle->warm;
+
+    if (!warm)
+        return;
+    warm->display_function = handle->hw_display_function;
+    warm->display_control = handle->hw_display_control;
+    warm->display_mode = handle->hw_display_mode;
+    warm->crc = lcd_warm_crc(warm);
+    warm->magic = LCD_WARM_MAGIC;
+}
+
+void lcd_warm_invalidate(const lcd_handle_t *handle)
+{
+    if (handle->warm)
+        handle->warm->magic = 0;
+}
+
+#else // CONFIG_LCD_WARM_START
+
+esp_err_t lcd_warm_attach(lcd_handle_t *handle)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void lcd_warm_detach(lcd_handle_t *handle)
+{
+}
+
+void lcd_warm_save(const lcd_handle_t *handle)
+{
+}
+
+void lcd_warm_invalidate(const lcd_handle_t *handle)
+{
+}
+
+#endif // CONFIG_LCD_WARM_START
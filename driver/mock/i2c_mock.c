@@ -0,0 +1,444 @@
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "driver/i2c.h"
+#include "i2c_mock.h"
+
+// A command link is kept as the list of operations it was built from and
+// carried out by i2c_master_cmd_begin(), which moves the virtual clock on by
+// the time the bus takes. One SCL period is counted for each start and stop
+// condition and nine for each byte, its acknowledge included. As in the real
+// driver, a mutex per port keeps transactions from several tasks apart.
+
+static const char *TAG = "I2C Mock";
+
+#define I2C_MOCK_MAX_OPS 32 /*!< Operations in one command link */
+
+typedef enum
+{
+    I2C_MOCK_OP_START,
+    I2C_MOCK_OP_STOP,
+    I2C_MOCK_OP_WRITE,
+    I2C_MOCK_OP_WRITE_BUF,
+    I2C_MOCK_OP_READ,
+} i2c_mock_op_type_t;
+
+typedef struct
+{
+    i2c_mock_op_type_t type;
+    bool ack_check;          /*!< Writes: a NACK aborts the transaction */
+    uint8_t data;            /*!< Writes: byte sent */
+    const uint8_t *buf;      /*!< Buffer writes: bytes sent, read when the link runs as by the real driver */
+    size_t len;              /*!< Buffer writes: number of bytes */
+    uint8_t *dest;           /*!< Reads: where the byte goes */
+} i2c_mock_op_t;
+
+typedef struct
+{
+    size_t count;
+    i2c_mock_op_t ops[I2C_MOCK_MAX_OPS];
+} i2c_mock_link_t;
+
+typedef struct
+{
+    bool used;
+    uint8_t address;
+    i2c_mock_device_t device;
+} i2c_mock_slot_t;
+
+typedef struct
+{
+    bool installed;
+    SemaphoreHandle_t lock;  /*!< Held for the length of a transaction */
+    uint32_t clk_speed;
+    uint32_t overhead_ns;
+    int sda_io_num;
+    int scl_io_num;
+    uint32_t scl_level;      /*!< Last level SCL was driven to through the GPIO driver */
+    uint8_t held_clocks;     /*!< SCL rising edges until SDA is released, 0 when the bus is free */
+    i2c_mock_stats_t stats;
+    i2c_mock_slot_t slots[I2C_MOCK_MAX_DEVICES];
+    i2c_mock_transaction_t log[I2C_MOCK_LOG_DEPTH];
+    size_t log_head;         /*!< Slot the next transaction goes to */
+    bool log_wrapped;        /*!< Every slot holds a transaction, the oldest at log_head */
+} i2c_mock_port_t;
+
+static i2c_mock_port_t i2c_mock_ports[I2C_NUM_MAX];
+
+void mock_clock_reset_timers(void); // mock_clock.c
+
+static esp_err_t i2c_mock_add(i2c_cmd_handle_t cmd_handle, const i2c_mock_op_t *op);
+static esp_err_t i2c_mock_run(i2c_mock_port_t *port, i2c_mock_link_t *link, i2c_mock_transaction_t *record);
+static i2c_mock_slot_t *i2c_mock_find(i2c_mock_port_t *port, uint8_t address);
+
+esp_err_t i2c_mock_attach(i2c_port_t port, uint8_t address, const i2c_mock_device_t *device)
+{
+    i2c_mock_slot_t *slot;
+
+    ESP_RETURN_ON_FALSE(port >= 0 && port < I2C_NUM_MAX && address < 0x80, ESP_ERR_INVALID_ARG, TAG,
+                        "Invalid argument");
+    slot = i2c_mock_find(&i2c_mock_ports[port], address);
+    for (int i = 0; !slot && i < I2C_MOCK_MAX_DEVICES; ++i)
+    {
+        if (!i2c_mock_ports[port].slots[i].used)
+            slot = &i2c_mock_ports[port].slots[i];
+    }
+    ESP_RETURN_ON_FALSE(slot, ESP_ERR_NO_MEM, TAG, "No room for another device on port %d", port);
+    slot->used = true;
+    slot->address = address;
+    if (device)
+        slot->device = *device;
+    else
+        memset(&slot->device, 0, sizeof(slot->device));
+    return ESP_OK;
+}
+
+esp_err_t i2c_mock_detach(i2c_port_t port, uint8_t address)
+{
+    i2c_mock_slot_t *slot;
+
+    ESP_RETURN_ON_FALSE(port >= 0 && port < I2C_NUM_MAX, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    slot = i2c_mock_find(&i2c_mock_ports[port], address);
+    ESP_RETURN_ON_FALSE(slot, ESP_ERR_NOT_FOUND, TAG, "No device at 0x%02x", address);
+    slot->used = false;
+    return ESP_OK;
+}
+
+esp_err_t i2c_mock_set_overhead_ns(i2c_port_t port, uint32_t overhead_ns)
+{
+    ESP_RETURN_ON_FALSE(port >= 0 && port < I2C_NUM_MAX, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    i2c_mock_ports[port].overhead_ns = overhead_ns;
+    return ESP_OK;
+}
+
+esp_err_t i2c_mock_get_stats(i2c_port_t port, i2c_mock_stats_t *stats, bool reset)
+{
+    ESP_RETURN_ON_FALSE(port >= 0 && port < I2C_NUM_MAX && stats, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    *stats = i2c_mock_ports[port].stats;
+    if (reset)
+        memset(&i2c_mock_ports[port].stats, 0, sizeof(i2c_mock_ports[port].stats));
+    return ESP_OK;
+}
+
+esp_err_t i2c_mock_get_log(i2c_port_t port, i2c_mock_transaction_t *entries, size_t max, size_t *count, bool clear)
+{
+    i2c_mock_port_t *p;
+    size_t n;
+    size_t first;
+
+    ESP_RETURN_ON_FALSE(port >= 0 && port < I2C_NUM_MAX && entries && count, ESP_ERR_INVALID_ARG, TAG,
+                        "Invalid argument");
+    p = &i2c_mock_ports[port];
+    n = p->log_wrapped ? I2C_MOCK_LOG_DEPTH : p->log_head;
+    if (n > max)
+        n = max;
+    // The newest n transactions, oldest first
+    first = (p->log_head + I2C_MOCK_LOG_DEPTH - n) % I2C_MOCK_LOG_DEPTH;
+    for (size_t i = 0; i < n; ++i)
+        entries[i] = p->log[(first + i) % I2C_MOCK_LOG_DEPTH];
+    *count = n;
+    if (clear)
+    {
+        p->log_head = 0;
+        p->log_wrapped = false;
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2c_mock_hold_sda(i2c_port_t port, uint8_t clocks)
+{
+    ESP_RETURN_ON_FALSE(port >= 0 && port < I2C_NUM_MAX, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    i2c_mock_ports[port].held_clocks = clocks;
+    return ESP_OK;
+}
+
+void i2c_mock_reset(void)
+{
+    for (int i = 0; i < I2C_NUM_MAX; ++i)
+    {
+        if (i2c_mock_ports[i].lock)
+            vSemaphoreDelete(i2c_mock_ports[i].lock);
+    }
+    memset(i2c_mock_ports, 0, sizeof(i2c_mock_ports));
+    mock_clock_reset_timers();
+}
+
+esp_err_t i2c_param_config(i2c_port_t i2c_num, const i2c_config_t *i2c_conf)
+{
+    ESP_RETURN_ON_FALSE(i2c_num >= 0 && i2c_num < I2C_NUM_MAX && i2c_conf, ESP_ERR_INVALID_ARG, TAG,
+                        "Invalid argument");
+    ESP_RETURN_ON_FALSE(i2c_conf->mode == I2C_MODE_MASTER, ESP_ERR_NOT_SUPPORTED, TAG, "Only master mode is mocked");
+    ESP_RETURN_ON_FALSE(i2c_conf->master.clk_speed > 0, ESP_ERR_INVALID_ARG, TAG, "Invalid clock speed");
+    i2c_mock_ports[i2c_num].clk_speed = i2c_conf->master.clk_speed;
+    i2c_mock_ports[i2c_num].sda_io_num = i2c_conf->sda_io_num;
+    i2c_mock_ports[i2c_num].scl_io_num = i2c_conf->scl_io_num;
+    return ESP_OK;
+}
+
+esp_err_t i2c_set_pin(i2c_port_t i2c_num, int sda_io_num, int scl_io_num, bool sda_pullup_en, bool scl_pullup_en,
+                      i2c_mode_t mode)
+{
+    ESP_RETURN_ON_FALSE(i2c_num >= 0 && i2c_num < I2C_NUM_MAX, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    i2c_mock_ports[i2c_num].sda_io_num = sda_io_num;
+    i2c_mock_ports[i2c_num].scl_io_num = scl_io_num;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    for (int i = 0; i < I2C_NUM_MAX; ++i)
+    {
+        i2c_mock_port_t *port = &i2c_mock_ports[i];
+
+        if (port->clk_speed && gpio_num == port->scl_io_num)
+        {
+            // The device shifts out a bit per rising edge
+            if (level && !port->scl_level && port->held_clocks)
+                port->held_clocks--;
+            port->scl_level = level;
+        }
+    }
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    for (int i = 0; i < I2C_NUM_MAX; ++i)
+    {
+        if (i2c_mock_ports[i].clk_speed && gpio_num == i2c_mock_ports[i].sda_io_num && i2c_mock_ports[i].held_clocks)
+            return 0;
+    }
+    return 1;
+}
+
+esp_err_t i2c_driver_install(i2c_port_t i2c_num, i2c_mode_t mode, size_t slv_rx_buf_len, size_t slv_tx_buf_len,
+                             int intr_alloc_flags)
+{
+    ESP_RETURN_ON_FALSE(i2c_num >= 0 && i2c_num < I2C_NUM_MAX, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(!i2c_mock_ports[i2c_num].installed, ESP_FAIL, TAG, "Driver already installed");
+    i2c_mock_ports[i2c_num].lock = xSemaphoreCreateMutex();
+    ESP_RETURN_ON_FALSE(i2c_mock_ports[i2c_num].lock, ESP_ERR_NO_MEM, TAG, "Unable to create port lock");
+    i2c_mock_ports[i2c_num].installed = true;
+    memset(&i2c_mock_ports[i2c_num].stats, 0, sizeof(i2c_mock_ports[i2c_num].stats));
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_delete(i2c_port_t i2c_num)
+{
+    ESP_RETURN_ON_FALSE(i2c_num >= 0 && i2c_num < I2C_NUM_MAX, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(i2c_mock_ports[i2c_num].installed, ESP_ERR_INVALID_STATE, TAG, "Driver not installed");
+    i2c_mock_ports[i2c_num].installed = false;
+    vSemaphoreDelete(i2c_mock_ports[i2c_num].lock);
+    i2c_mock_ports[i2c_num].lock = NULL;
+    return ESP_OK;
+}
+
+i2c_cmd_handle_t i2c_cmd_link_create(void)
+{
+    return calloc(1, sizeof(i2c_mock_link_t));
+}
+
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd_handle)
+{
+    free(cmd_handle);
+}
+
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd_handle)
+{
+    return i2c_mock_add(cmd_handle, &(i2c_mock_op_t){.type = I2C_MOCK_OP_START});
+}
+
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd_handle)
+{
+    return i2c_mock_add(cmd_handle, &(i2c_mock_op_t){.type = I2C_MOCK_OP_STOP});
+}
+
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd_handle, uint8_t data, bool ack_en)
+{
+    return i2c_mock_add(cmd_handle, &(i2c_mock_op_t){.type = I2C_MOCK_OP_WRITE, .ack_check = ack_en, .data = data});
+}
+
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd_handle, const uint8_t *data, size_t data_len, bool ack_en)
+{
+    esp_err_t ret = ESP_OK;
+
+    ESP_RETURN_ON_FALSE(data, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    // The real driver keeps the pointer rather than a copy
+    if (data_len > 1)
+        return i2c_mock_add(cmd_handle, &(i2c_mock_op_t){.type = I2C_MOCK_OP_WRITE_BUF, .ack_check = ack_en,
+                                                         .buf = data, .len = data_len});
+    for (size_t i = 0; i < data_len && ret == ESP_OK; ++i)
+        ret = i2c_master_write_byte(cmd_handle, data[i], ack_en);
+    return ret;
+}
+
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t cmd_handle, uint8_t *data, i2c_ack_type_t ack)
+{
+    ESP_RETURN_ON_FALSE(data && ack < I2C_MASTER_ACK_MAX, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    return i2c_mock_add(cmd_handle, &(i2c_mock_op_t){.type = I2C_MOCK_OP_READ, .dest = data});
+}
+
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd_handle, uint8_t *data, size_t data_len, i2c_ack_type_t ack)
+{
+    esp_err_t ret = ESP_OK;
+
+    ESP_RETURN_ON_FALSE(data && data_len, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    for (size_t i = 0; i < data_len && ret == ESP_OK; ++i)
+        ret = i2c_master_read_byte(cmd_handle, &data[i], ack);
+    return ret;
+}
+
+esp_err_t i2c_master_cmd_begin(i2c_port_t i2c_num, i2c_cmd_handle_t cmd_handle, TickType_t ticks_to_wait)
+{
+    esp_err_t ret;
+    i2c_mock_port_t *port;
+    i2c_mock_transaction_t record = {0};
+
+    ESP_RETURN_ON_FALSE(i2c_num >= 0 && i2c_num < I2C_NUM_MAX && cmd_handle, ESP_ERR_INVALID_ARG, TAG,
+                        "Invalid argument");
+    port = &i2c_mock_ports[i2c_num];
+    ESP_RETURN_ON_FALSE(port->installed, ESP_ERR_INVALID_STATE, TAG, "Driver not installed");
+    ESP_RETURN_ON_FALSE(port->clk_speed, ESP_ERR_INVALID_STATE, TAG, "Port not configured");
+    if (xSemaphoreTake(port->lock, ticks_to_wait) != pdTRUE)
+        return ESP_ERR_TIMEOUT;
+
+    if (port->held_clocks)
+    {
+        // No start condition gets through: the driver waits out its timeout
+        record.start_ns = mock_clock_now_ns();
+        record.result = ret = ESP_ERR_TIMEOUT;
+        port->stats.transactions++;
+        mock_clock_advance_ns((uint64_t)ticks_to_wait * portTICK_PERIOD_MS * 1000000);
+    }
+    else
+        ret = i2c_mock_run(port, cmd_handle, &record);
+    port->log[port->log_head] = record;
+    if (++port->log_head == I2C_MOCK_LOG_DEPTH)
+    {
+        port->log_head = 0;
+        port->log_wrapped = true;
+    }
+    xSemaphoreGive(port->lock);
+    return ret;
+}
+
+/**
+ * @brief Carry out a command link and let the time it takes pass. Port lock held.
+ */
+static esp_err_t i2c_mock_run(i2c_mock_port_t *port, i2c_mock_link_t *link, i2c_mock_transaction_t *record)
+{
+    esp_err_t ret = ESP_OK;
+    i2c_mock_slot_t *slot = NULL;
+    bool addressed = false; /*!< The next write is an address byte */
+    bool reading = false;
+    uint64_t start_ns = mock_clock_now_ns();
+    uint64_t period_ns = (1000000000ULL + port->clk_speed - 1) / port->clk_speed;
+    uint64_t clocks = 0;
+
+    record->start_ns = start_ns;
+    for (size_t i = 0; i < link->count && ret == ESP_OK; ++i)
+    {
+        i2c_mock_op_t *op = &link->ops[i];
+
+        switch (op->type)
+        {
+        case I2C_MOCK_OP_START:
+            clocks += 1;
+            addressed = true;
+            break;
+        case I2C_MOCK_OP_STOP:
+            clocks += 1;
+            slot = NULL;
+            break;
+        case I2C_MOCK_OP_WRITE:
+        case I2C_MOCK_OP_WRITE_BUF:
+        {
+            const uint8_t *bytes = op->type == I2C_MOCK_OP_WRITE ? &op->data : op->buf;
+            size_t len = op->type == I2C_MOCK_OP_WRITE ? 1 : op->len;
+
+            for (size_t b = 0; b < len && ret == ESP_OK; ++b)
+            {
+                clocks += 9;
+                port->stats.bytes++;
+                if (addressed)
+                {
+                    // Acknowledged by the device whose 7-bit address it carries
+                    addressed = false;
+                    reading = bytes[b] & 1;
+                    slot = i2c_mock_find(port, bytes[b] >> 1);
+                    if (!record->length && !record->address)
+                    {
+                        record->address = bytes[b] >> 1;
+                        record->read = reading;
+                    }
+                }
+                else
+                {
+                    if (record->length < I2C_MOCK_LOG_BYTES)
+                        record->data[record->length] = bytes[b];
+                    record->length++;
+                    if (!slot || reading)
+                        slot = NULL;
+                    else if (slot->device.write &&
+                             slot->device.write(slot->device.ctx, bytes[b], start_ns + clocks * period_ns) != ESP_OK)
+                        slot = NULL;
+                }
+                if (!slot && op->ack_check)
+                    ret = ESP_FAIL;
+            }
+            break;
+        }
+        case I2C_MOCK_OP_READ:
+            // Sampled as the address was acknowledged, so before these clocks
+            *op->dest = 0xFF;
+            if (slot && reading && slot->device.read)
+                slot->device.read(slot->device.ctx, op->dest, start_ns + clocks * period_ns);
+            if (record->length < I2C_MOCK_LOG_BYTES)
+                record->data[record->length] = *op->dest;
+            record->length++;
+            clocks += 9;
+            port->stats.bytes++;
+            break;
+        }
+    }
+    if (ret != ESP_OK)
+    {
+        // The master sends a stop after the NACK
+        clocks += 1;
+        port->stats.nacks++;
+    }
+    record->result = ret;
+
+    port->stats.transactions++;
+    port->stats.busy_ns += clocks * period_ns + port->overhead_ns;
+    mock_clock_advance_ns(clocks * period_ns + port->overhead_ns);
+    return ret;
+}
+
+static esp_err_t i2c_mock_add(i2c_cmd_handle_t cmd_handle, const i2c_mock_op_t *op)
+{
+    i2c_mock_link_t *link = cmd_handle;
+
+    ESP_RETURN_ON_FALSE(link, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(link->count < I2C_MOCK_MAX_OPS, ESP_ERR_NO_MEM, TAG, "Command link full");
+    link->ops[link->count++] = *op;
+    return ESP_OK;
+}
+
+static i2c_mock_slot_t *i2c_mock_find(i2c_mock_port_t *port, uint8_t address)
+{
+    for (int i = 0; i < I2C_MOCK_MAX_DEVICES; ++i)
+    {
+        if (port->slots[i].used && port->slots[i].address == address)
+            return &port->slots[i];
+    }
+    return NULL;
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/i2c.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Stand-in for the ESP-IDF I2C master driver and the clocks the driver
+// reads, for builds that run on a development machine. Transactions are
+// carried out against devices attached with i2c_mock_attach() and take the
+// time the bus would: start and stop conditions plus nine clocks per byte at
+// the configured SCL frequency, plus a fixed per-transaction overhead. Waits
+// return at once and only move the clock on, so code that mostly waits on
+// the bus runs far faster than on the device. Without a scheduler no other
+// time passes and runs are exact and repeatable however fast or loaded the
+// machine is. On the ESP-IDF linux target, where tasks also sleep on real
+// FreeRTOS ticks, real time is added, see mock_clock.c.
+
+#define I2C_MOCK_MAX_DEVICES 8 /*!< Devices attached to one port */
+#define I2C_MOCK_LOG_DEPTH 256 /*!< Transactions logged per port */
+#define I2C_MOCK_LOG_BYTES 4   /*!< Data bytes kept per logged transaction */
+
+/**
+ * @brief A device on a mocked bus
+ *
+ * @details Either callback may be NULL: the device then acknowledges writes
+ *          and returns 0xFF on reads, like a PCF8574 with nothing connected.
+ *          Times are on the virtual clock: a write takes effect when the
+ *          device acknowledges the data byte, a read is sampled when it
+ *          acknowledges its address.
+ */
+typedef struct
+{
+    esp_err_t (*write)(void *ctx, uint8_t data, uint64_t time_ns); /*!< A data byte was received. Return anything but ESP_OK to NACK it. */
+    esp_err_t (*read)(void *ctx, uint8_t *data, uint64_t time_ns); /*!< A data byte is requested */
+    void *ctx;                                                     /*!< Passed to the callbacks */
+} i2c_mock_device_t;
+
+/**
+ * @brief Traffic on one mocked port
+ */
+typedef struct
+{
+    uint32_t transactions; /*!< i2c_master_cmd_begin() calls carried out */
+    uint32_t bytes;        /*!< Bytes on the wire, address bytes included */
+    uint32_t nacks;        /*!< Transactions that ended on a NACK */
+    uint64_t busy_ns;      /*!< Time the bus was busy, overhead included */
+} i2c_mock_stats_t;
+
+/**
+ * @brief A transaction as logged by the mock
+ */
+typedef struct
+{
+    uint64_t start_ns;                  /*!< Virtual time the start condition was sent */
+    uint8_t address;                    /*!< 7-bit address of the first address byte */
+    bool read;                          /*!< Direction of the first address byte */
+    uint8_t length;                     /*!< Data bytes transferred, address bytes excluded */
+    uint8_t data[I2C_MOCK_LOG_BYTES];   /*!< The first of them, as written or read */
+    esp_err_t result;                   /*!< What i2c_master_cmd_begin() returned */
+} i2c_mock_transaction_t;
+
+/**
+ * @brief Put a device on a bus
+ *
+ * @param[in] device Copied. NULL attaches a device that only acknowledges.
+ *
+ * @return
+ *          - ESP_OK Success
+ *          - ESP_ERR_INVALID_ARG Invalid port or address
+ *          - ESP_ERR_NO_MEM The port already has I2C_MOCK_MAX_DEVICES devices
+ */
+esp_err_t i2c_mock_attach(i2c_port_t port, uint8_t address, const i2c_mock_device_t *device);
+
+/**
+ * @brief Take a device off a bus. Transactions addressed to it are NACKed from then on.
+ *
+ * @return
+ *          - ESP_OK Success
+ *          - ESP_ERR_INVALID_ARG Invalid port
+ *          - ESP_ERR_NOT_FOUND No device at that address
+ */
+esp_err_t i2c_mock_detach(i2c_port_t port, uint8_t address);
+
+/**
+ * @brief Set the time each transaction costs besides its clocks
+ *
+ * @details Models building the command link, starting the peripheral and
+ *          the completion interrupt. 0, the default, gives pure bus time.
+ */
+esp_err_t i2c_mock_set_overhead_ns(i2c_port_t port, uint32_t overhead_ns);
+
+/**
+ * @brief Leave SDA held low, as a device reset in the middle of a byte does
+ *
+ * @details Transactions on the port time out, taking ticks_to_wait on the
+ *          clock, until SCL has been clocked through the GPIO driver the
+ *          given number of times. The pins are those of i2c_param_config()
+ *          or i2c_set_pin().
+ *
+ * @param[in] clocks SCL rising edges the device waits for. 0 releases SDA at once.
+ */
+esp_err_t i2c_mock_hold_sda(i2c_port_t port, uint8_t clocks);
+
+/**
+ * @brief Traffic on a port since i2c_driver_install() or the last reset
+ */
+esp_err_t i2c_mock_get_stats(i2c_port_t port, i2c_mock_stats_t *stats, bool reset);
+
+/**
+ * @brief Latest transactions on a port, oldest first
+ *
+ * @param[out] entries Room for max transactions
+ * @param[out] count Transactions copied
+ * @param[in] clear Empty the log afterwards
+ */
+esp_err_t i2c_mock_get_log(i2c_port_t port, i2c_mock_transaction_t *entries, size_t max, size_t *count, bool clear);
+
+/**
+ * @brief Uninstall every port, detach every device and stop every timer
+ *
+ * @details The virtual clock keeps running.
+ */
+void i2c_mock_reset(void);
+
+/**
+ * @brief Current time on the virtual clock
+ */
+uint64_t mock_clock_now_ns(void);
+
+/**
+ * @brief Let time pass on the virtual clock
+ *
+ * @details esp_timer callbacks that fall due run on the way, each at the
+ *          time it was due. ets_delay_us() and the bus both end up here.
+ */
+void mock_clock_advance_ns(uint64_t ns);
+
+/**
+ * @brief Time the next armed esp_timer falls due
+ *
+ * @details For a port without other tasks, whose blocking waits can only be
+ *          ended by a timer callback.
+ *
+ * @param[out] alarm_ns Expiry on the virtual clock
+ *
+ * @return Whether a timer is armed. Timers already due, waiting for a
+ *         callback in progress to return, do not count.
+ */
+bool mock_clock_next_alarm_ns(uint64_t *alarm_ns);
+
+/**
+ * @brief Make waits take real time, or skip them again
+ *
+ * @details For driving real displays from the development machine, see
+ *          lcd_i2cdev_open(). The clock carries on from where it is and only
+ *          moves forward.
+ */
+void mock_clock_set_realtime(bool realtime);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Busy-wait on the virtual clock of i2c_mock.h: returns at once, us later.
+ */
+void ets_delay_us(uint32_t us);
+
+#ifdef __cplusplus
+}
+#endif
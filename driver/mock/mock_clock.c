@@ -0,0 +1,340 @@
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "rom/ets_sys.h"
+#include "sdkconfig.h"
+#include "i2c_mock.h"
+#include <time.h>
+#if CONFIG_IDF_TARGET_LINUX
+#include "freertos/task.h"
+#endif
+
+// The virtual clock starts at zero and moves when mock_clock_advance_ns() is
+// called. Armed timers are kept on a list; advancing the clock runs each one
+// that falls due, with the clock set to its expiry, before moving on.
+// Callbacks may themselves wait or re-arm timers. Time they spend moves the
+// clock on directly and any timer that falls due meanwhile runs once they
+// return, as with the single esp_timer task.
+//
+// On the ESP-IDF linux target tasks also sleep in real time, on FreeRTOS
+// ticks. So that code comparing the two clocks does not wait forever, the
+// clock there is real time plus every wait skipped so far, and a task fires
+// the timers that fall due while nobody waits. Without a scheduler, as in
+// host/port, the clock is purely virtual and runs are exactly repeatable.
+//
+// Real displays on a real bus, see driver/i2cdev, need their execution times
+// to pass. mock_clock_set_realtime() makes every wait sleep instead, so the
+// clock then only ever runs in real time.
+
+static const char *TAG = "Mock Clock";
+
+#define MOCK_CLOCK_TASK_PRIORITY 20 /*!< Above the driver's tasks, as the esp_timer task is */
+#define MOCK_CLOCK_TASK_STACK_SIZE 4096
+#define MOCK_CLOCK_SPIN_NS 100000 /*!< Waits shorter than this spin rather than sleep, as sleeps overshoot */
+
+struct esp_timer
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    bool armed;
+    uint64_t alarm_ns;
+    uint64_t period_ns; /*!< 0 for one-shot timers */
+    struct esp_timer *next;
+};
+
+static uint64_t mock_clock_skipped_ns; /*!< Virtual time, or on the linux target the waits skipped */
+static struct esp_timer *mock_clock_timers;
+static bool mock_clock_dispatching;
+static bool mock_clock_realtime;
+static portMUX_TYPE mock_clock_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+void mock_clock_reset_timers(void);
+
+static uint64_t mock_clock_monotonic_ns(void)
+{
+    static uint64_t start_ns;
+    struct timespec ts;
+    uint64_t now;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    now = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    if (!start_ns)
+        start_ns = now;
+    return now - start_ns;
+}
+
+#if CONFIG_IDF_TARGET_LINUX
+
+static bool mock_clock_task_started;
+
+static uint64_t mock_clock_real_ns(void)
+{
+    return mock_clock_monotonic_ns();
+}
+
+static void mock_clock_task(void *arg)
+{
+    for (;;)
+    {
+        vTaskDelay(1);
+        mock_clock_advance_ns(0);
+    }
+}
+
+#else
+
+static uint64_t mock_clock_real_ns(void)
+{
+    return mock_clock_realtime ? mock_clock_monotonic_ns() : 0;
+}
+
+#endif // CONFIG_IDF_TARGET_LINUX
+
+/**
+ * @brief Move the clock forward to ns, if it is not there yet. Spinlock held.
+ *
+ * @details In real time the spinlock is released while waiting.
+ */
+static void mock_clock_set(uint64_t ns)
+{
+    uint64_t now = mock_clock_skipped_ns + mock_clock_real_ns();
+
+    if (ns <= now)
+        return;
+    if (!mock_clock_realtime)
+    {
+        mock_clock_skipped_ns += ns - now;
+        return;
+    }
+    portEXIT_CRITICAL(&mock_clock_spinlock);
+    if (ns - now > MOCK_CLOCK_SPIN_NS)
+    {
+        uint64_t sleep_ns = ns - now - MOCK_CLOCK_SPIN_NS;
+        struct timespec ts = {.tv_sec = sleep_ns / 1000000000, .tv_nsec = sleep_ns % 1000000000};
+
+        nanosleep(&ts, NULL);
+    }
+    while (mock_clock_skipped_ns + mock_clock_real_ns() < ns)
+        ;
+    portENTER_CRITICAL(&mock_clock_spinlock);
+}
+
+void mock_clock_set_realtime(bool realtime)
+{
+    uint64_t now;
+    uint64_t real;
+
+    portENTER_CRITICAL(&mock_clock_spinlock);
+    // Carry on from the current time, or from real time if that is ahead
+    now = mock_clock_skipped_ns + mock_clock_real_ns();
+    mock_clock_realtime = realtime;
+    real = mock_clock_real_ns();
+    mock_clock_skipped_ns = now > real ? now - real : 0;
+    portEXIT_CRITICAL(&mock_clock_spinlock);
+}
+
+uint64_t mock_clock_now_ns(void)
+{
+    uint64_t now;
+
+    portENTER_CRITICAL(&mock_clock_spinlock);
+    now = mock_clock_skipped_ns + mock_clock_real_ns();
+    portEXIT_CRITICAL(&mock_clock_spinlock);
+    return now;
+}
+
+void mock_clock_advance_ns(uint64_t ns)
+{
+    uint64_t target;
+
+    portENTER_CRITICAL(&mock_clock_spinlock);
+    target = mock_clock_skipped_ns + mock_clock_real_ns() + ns;
+    if (mock_clock_dispatching)
+    {
+        mock_clock_set(target);
+        portEXIT_CRITICAL(&mock_clock_spinlock);
+        return;
+    }
+    mock_clock_dispatching = true;
+    for (;;)
+    {
+        struct esp_timer *due = NULL;
+        esp_timer_cb_t callback;
+        void *arg;
+        uint64_t alarm;
+        uint64_t now;
+
+        for (struct esp_timer *t = mock_clock_timers; t; t = t->next)
+        {
+            if (t->armed && t->alarm_ns <= target && (!due || t->alarm_ns < due->alarm_ns))
+                due = t;
+        }
+        if (!due)
+            break;
+        alarm = due->alarm_ns;
+        if (due->period_ns)
+            due->alarm_ns += due->period_ns;
+        else
+            due->armed = false;
+        callback = due->callback;
+        arg = due->arg;
+        mock_clock_set(alarm);
+        portEXIT_CRITICAL(&mock_clock_spinlock);
+        callback(arg);
+        portENTER_CRITICAL(&mock_clock_spinlock);
+        // A callback that waited past the target takes the clock with it
+        now = mock_clock_skipped_ns + mock_clock_real_ns();
+        if (now > target)
+            target = now;
+    }
+    mock_clock_set(target);
+    mock_clock_dispatching = false;
+    portEXIT_CRITICAL(&mock_clock_spinlock);
+}
+
+void mock_clock_reset_timers(void)
+{
+    portENTER_CRITICAL(&mock_clock_spinlock);
+    for (struct esp_timer *t = mock_clock_timers; t; t = t->next)
+        t->armed = false;
+    portEXIT_CRITICAL(&mock_clock_spinlock);
+}
+
+bool mock_clock_next_alarm_ns(uint64_t *alarm_ns)
+{
+    bool found = false;
+    uint64_t now;
+
+    portENTER_CRITICAL(&mock_clock_spinlock);
+    now = mock_clock_skipped_ns + mock_clock_real_ns();
+    for (struct esp_timer *t = mock_clock_timers; t; t = t->next)
+    {
+        if (t->armed && t->alarm_ns > now && (!found || t->alarm_ns < *alarm_ns))
+        {
+            *alarm_ns = t->alarm_ns;
+            found = true;
+        }
+    }
+    portEXIT_CRITICAL(&mock_clock_spinlock);
+    return found;
+}
+
+void ets_delay_us(uint32_t us)
+{
+    mock_clock_advance_ns((uint64_t)us * 1000);
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return mock_clock_now_ns() / 1000;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    struct esp_timer *timer;
+
+    ESP_RETURN_ON_FALSE(create_args && create_args->callback && out_handle, ESP_ERR_INVALID_ARG, TAG,
+                        "Invalid argument");
+    timer = calloc(1, sizeof(struct esp_timer));
+    ESP_RETURN_ON_FALSE(timer, ESP_ERR_NO_MEM, TAG, "Unable to allocate timer");
+    timer->callback = create_args->callback;
+    timer->arg = create_args->arg;
+#if CONFIG_IDF_TARGET_LINUX
+    if (!mock_clock_task_started)
+    {
+        mock_clock_task_started = true;
+        if (xTaskCreatePinnedToCore(mock_clock_task, "mock_clock", MOCK_CLOCK_TASK_STACK_SIZE, NULL,
+                                    MOCK_CLOCK_TASK_PRIORITY, NULL, tskNO_AFFINITY) != pdPASS)
+        {
+            mock_clock_task_started = false;
+            free(timer);
+            ESP_LOGE(TAG, "Unable to create timer task");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+#endif
+    portENTER_CRITICAL(&mock_clock_spinlock);
+    timer->next = mock_clock_timers;
+    mock_clock_timers = timer;
+    portEXIT_CRITICAL(&mock_clock_spinlock);
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    esp_err_t ret = ESP_OK;
+
+    ESP_RETURN_ON_FALSE(timer, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    portENTER_CRITICAL(&mock_clock_spinlock);
+    if (timer->armed)
+        ret = ESP_ERR_INVALID_STATE;
+    else
+    {
+        timer->armed = true;
+        timer->alarm_ns = mock_clock_skipped_ns + mock_clock_real_ns() + timeout_us * 1000;
+        timer->period_ns = 0;
+    }
+    portEXIT_CRITICAL(&mock_clock_spinlock);
+    return ret;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    esp_err_t ret = ESP_OK;
+
+    ESP_RETURN_ON_FALSE(timer && period, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    portENTER_CRITICAL(&mock_clock_spinlock);
+    if (timer->armed)
+        ret = ESP_ERR_INVALID_STATE;
+    else
+    {
+        timer->armed = true;
+        timer->period_ns = period * 1000;
+        timer->alarm_ns = mock_clock_skipped_ns + mock_clock_real_ns() + timer->period_ns;
+    }
+    portEXIT_CRITICAL(&mock_clock_spinlock);
+    return ret;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    esp_err_t ret = ESP_OK;
+
+    ESP_RETURN_ON_FALSE(timer, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    portENTER_CRITICAL(&mock_clock_spinlock);
+    if (!timer->armed)
+        ret = ESP_ERR_INVALID_STATE;
+    timer->armed = false;
+    portEXIT_CRITICAL(&mock_clock_spinlock);
+    return ret;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+
+    ESP_RETURN_ON_FALSE(timer, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    portENTER_CRITICAL(&mock_clock_spinlock);
+    for (struct esp_timer **p = &mock_clock_timers; !timer->armed && *p; p = &(*p)->next)
+    {
+        if (*p == timer)
+        {
+            *p = timer->next;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&mock_clock_spinlock);
+    if (ret == ESP_OK)
+        free(timer);
+    return ret;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return timer && timer->armed;
+}
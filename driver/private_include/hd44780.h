@@ -1,8 +1,11 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include "esp_err.h"
+#include "sdkconfig.h"
+#include "hd44780/fwd.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -25,9 +28,13 @@ extern "C"
 #define LCD_LINETHREE 0x14 /*!< DDRAM address for start of row 2 */
 #define LCD_LINEFOUR 0x54  /*!< DDRAM address for start of row 3 */
 
+// Expander pins of the default pin map. The driver takes them from the
+// handle's encoding, see hd44780_pinmap.h; these are for the trace.
 #define LCD_ENABLE 0x04
 #define LCD_COMMAND 0x00
 #define LCD_WRITE 0x01
+#define LCD_READ 0x02      /*!< RW line high, the controller drives the data lines */
+#define LCD_BUSY_FLAG 0x80 /*!< Busy flag in the status read by lcd_hw_read_status() */
 // #define Rs 0x01 /*!< Register select bit */
 
 // LCD instructions - refer Table 6 of Hitachi HD44780U datasheet
@@ -45,10 +52,209 @@ extern "C"
 #define LCD_BACKLIGHT_CONTROL_OFF 0x00 /*!< Backlight Control bitmask for backlight off */
 
 // LCD Delay times
-#define LCD_PRE_PULSE_DELAY_US 1000 /*!< Not sure what this corresponds to in datasheet, but it is necessary */
+#define LCD_PRE_PULSE_DELAY_US CONFIG_LCD_PRE_PULSE_DELAY_US /*!< Not sure what this corresponds to in datasheet, but it is necessary. Set with menuconfig. */
 #define LCD_STD_EXEC_TIME_US 40     /*!< The standard execution time for most instructions */
 #define LCD_HOME_EXEC_TIME_US 15200 /*!< Execution time for Return home instruction */
 #define LCD_BUSY_TIME_US 6          /*!< Delay between busy and counter, 1.5/f_osc = 5.(5)us  */
+#define LCD_POWER_ON_TIME_US 50000  /*!< Wait after power up before the first instruction, 40 ms (min) from Vcc at 2.7V */
+
+#define LCD_HW_STATE_UNKNOWN 0xFF /*!< Controller flag state not known, forces the instruction to be sent */
+
+// Internal helpers shared between the driver modules
+
+/**
+ * @brief Serialise bus access to the handle. No-op for handles without a lock.
+ */
+void lcd_lock(lcd_handle_t *handle);
+
+/**
+ * @brief Release the bus lock taken by lcd_lock()
+ */
+void lcd_unlock(lcd_handle_t *handle);
+
+/**
+ * @brief Wait until the controller has executed the last instruction sent
+ *        to it, as recorded in handle->busy_until_us
+ */
+void lcd_hw_wait_ready(const lcd_handle_t *handle);
+
+/**
+ * @brief True if the display function, control or entry mode flags of the
+ *        handle differ from what was last sent to the controller
+ */
+bool lcd_hw_state_pending(const lcd_handle_t *handle);
+
+/**
+ * @brief First of Function Set, Display Control and Entry Mode Set whose
+ *        flags in the handle differ from what the controller holds
+ *
+ * @return false if the controller holds every flag of the handle
+ */
+bool lcd_hw_state_next(const lcd_handle_t *handle, uint8_t *instruction);
+
+/**
+ * @brief Record what an instruction sent to the controller did to its
+ *        function, display control and entry mode flags
+ *
+ * @details Instructions that leave them alone are ignored.
+ */
+void lcd_hw_state_sent(lcd_handle_t *handle, uint8_t instruction);
+
+/**
+ * @brief Send Function Set, Display Control and Entry Mode Set, each only if
+ *        the flags in the handle differ from what the controller holds
+ */
+esp_err_t lcd_hw_apply_state(lcd_handle_t *handle);
+
+/**
+ * @brief One byte for one controller, sent with others by lcd_hw_transfer_many()
+ */
+typedef struct
+{
+    lcd_handle_t *handle; /*!< Controller the byte is for */
+    uint8_t data;         /*!< Instruction or data byte */
+    uint8_t mode;         /*!< LCD_COMMAND or LCD_WRITE */
+    uint32_t exec_us;     /*!< Execution time of the byte */
+    esp_err_t result;     /*!< ESP_OK to send the byte. Left as it is otherwise. */
+    bool admitted;        /*!< Set while the byte is under way, by lcd_hw_transfer_many() and the reset of lcd_init_many() */
+} lcd_hw_xfer_t;
+
+/**
+ * @brief Send one byte to each of several controllers, nibble by nibble in lockstep
+ *
+ * @details For each nibble the data lines of every controller are set, with
+ *          E low, then the pre-pulse settle time is waited once for all of
+ *          them, and then each controller is clocked once it is ready. The
+ *          settle time is the longest wait of a byte, so n displays take
+ *          little more than one. Pending state changes are not applied.
+ *          Entries whose result is not ESP_OK are skipped; the others get the
+ *          result of their transfer. The bus locks are taken in array order.
+ *
+ * @param[inout] xfers Bytes to send, one per controller
+ * @param[in] count Number of entries
+ */
+void lcd_hw_transfer_many(lcd_hw_xfer_t *xfers, size_t count);
+
+/**
+ * @brief lcd_init_many() without CONFIG_LCD_REFRESH_IN_INIT
+ *
+ * @details For the display manager, which enables the refresh scheduler with
+ *          its own configuration.
+ */
+esp_err_t lcd_hw_init(lcd_handle_t **handles, size_t count);
+
+/**
+ * @brief Send an instruction once the controller is ready
+ *
+ * @details Pending state changes are applied first. The execution time is not
+ *          waited for. It is recorded in the handle and honoured before the next
+ *          transfer to the same controller, so the bus is free for other displays
+ *          in the meantime.
+ *
+ * @param[in] instruction Instruction byte
+ * @param[in] exec_us Execution time of the instruction
+ */
+esp_err_t lcd_hw_command(lcd_handle_t *handle, uint8_t instruction, uint32_t exec_us);
+
+/**
+ * @brief Write one byte to DDRAM/CGRAM at the controller's address counter
+ *
+ * @details Does not update the cursor position held in the handle.
+ */
+esp_err_t lcd_hw_write_data(lcd_handle_t *handle, uint8_t data);
+
+/**
+ * @brief Set the controller's DDRAM address to the given column and row
+ *
+ * @details Does not update the cursor position held in the handle.
+ */
+esp_err_t lcd_hw_set_ddram_address(lcd_handle_t *handle, uint8_t column, uint8_t row);
+
+/**
+ * @brief Read the busy flag and address counter
+ *
+ * @details The controller must be in 4-bit mode and in nibble step. The
+ *          caller holds the bus lock.
+ *
+ * @param[out] status Busy flag (LCD_BUSY_FLAG) and 7-bit address counter
+ */
+esp_err_t lcd_hw_read_status(const lcd_handle_t *handle, uint8_t *status);
+
+/**
+ * @brief Write the backlight state alone to the expander, with E low
+ *
+ * @details The caller holds the bus lock.
+ */
+esp_err_t lcd_hw_write_backlight(lcd_handle_t *handle);
+
+/**
+ * @brief Backlight bit for the next byte written to the expander
+ *
+ * @details Follows the PWM phase when dimming is enabled. The byte written
+ *          carries any PWM edge not yet written.
+ */
+uint8_t lcd_backlight_bits(const lcd_handle_t *handle);
+
+/**
+ * @brief Write a PWM edge that fell while the bus lock was held and that no
+ *        byte has carried since. Called with the bus lock held.
+ */
+void lcd_backlight_pwm_sync(lcd_handle_t *handle);
+
+/**
+ * @brief Send a compiled run of expander bytes
+ *
+ * @details Waits for the controller to be ready first, and records the
+ *          execution time of the last byte. Without a settle time the run
+ *          goes out as one I2C transaction and must pace itself, see
+ *          lcd_screen_compile(). With one, the run is the bare sequences of
+ *          its instructions and goes out one write per nibble: the enable
+ *          pulse of the previous nibble and the data byte of this one, then
+ *          settle_us on the pacing timer, or the execution time before the
+ *          first nibble of an instruction if that is longer. The caller holds
+ *          the bus lock.
+ *
+ * @param[in] data Expander bytes
+ * @param[in] len Number of bytes
+ * @param[in] backlight Backlight line the run carries. Sent through a copy if
+ *                      the backlight is in the other state now.
+ * @param[in] wire_us Time the run takes on the bus, added to the transaction timeout
+ * @param[in] settle_us Time each nibble's data byte is held before its enable pulse, or 0
+ */
+esp_err_t lcd_hw_write_stream(lcd_handle_t *handle, const uint8_t *data, size_t len, uint8_t backlight,
+                              uint32_t wire_us, uint32_t settle_us);
+
+/**
+ * @brief DDRAM address of the first column of each row
+ */
+extern const uint8_t lcd_row_offsets[];
+
+/**
+ * @brief Send the Clear Display instruction
+ *
+ * @details Does not update the cursor position held in the handle.
+ */
+esp_err_t lcd_hw_clear(lcd_handle_t *handle);
+
+/**
+ * @brief Address the expander without changing its outputs, without logging
+ *
+ * @return
+ *          - ESP_OK                The expander acknowledged
+ *          - ESP_ERR_NOT_FOUND     It did not
+ *          - Otherwise, the bus error
+ */
+esp_err_t lcd_hw_probe(const lcd_handle_t *handle);
+
+/**
+ * @brief Reset the controller by instruction, set it up as the handle says,
+ *        clear it and put its address counter at the handle's cursor
+ *
+ * @details For a display that may have lost power. Waits out the power-on
+ *          time first. A handle with the refresh scheduler enabled redraws its
+ *          frame afterwards.
+ */
+esp_err_t lcd_hw_reset(lcd_handle_t *handle);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "hd44780/async.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define LCD_ASYNC_DONE 0x1     /*!< Operation completed */
+#define LCD_ASYNC_RELEASED 0x2 /*!< Token released by its owner */
+
+/**
+ * @brief Asynchronous operation token
+ *
+ * @details Tokens live in a static pool. An operation holds one reference per
+ *          queued command plus one for the producer while it is posting, and
+ *          completes when the last reference is dropped.
+ */
+struct lcd_async_op_t
+{
+    bool in_use;                       /*!< Taken from the pool */
+    atomic_uint state;                 /*!< LCD_ASYNC_DONE | LCD_ASYNC_RELEASED */
+    atomic_uint refs;                  /*!< Outstanding references */
+    atomic_int result;                 /*!< First error met, or ESP_OK */
+    lcd_async_completion_t completion; /*!< Completion signalling */
+    SemaphoreHandle_t done;            /*!< Given on completion, for lcd_async_wait() */
+    StaticSemaphore_t done_buffer;     /*!< Storage for done */
+};
+
+/**
+ * @brief Take a reference for a command about to be queued
+ */
+void lcd_async_ref(lcd_async_op_t *op);
+
+/**
+ * @brief Drop a reference, recording result if it is the first error
+ *
+ * @details The operation completes when the last reference is dropped.
+ */
+void lcd_async_complete(lcd_async_op_t *op, esp_err_t result);
+
+#ifdef __cplusplus
+}
+#endif
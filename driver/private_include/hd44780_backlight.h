@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "hd44780/backlight.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Software PWM state of a handle with backlight dimming enabled
+ */
+struct lcd_backlight_pwm_t
+{
+    lcd_backlight_pwm_config_t config; /*!< Configuration dimming was enabled with */
+    portMUX_TYPE spinlock;             /*!< Protects the fields up to closing */
+    esp_timer_handle_t timer;          /*!< One-shot timer placed on the next edge */
+    uint8_t level;                     /*!< Level of the current period */
+    uint8_t fade_from;                 /*!< Level at the start of the fade */
+    uint8_t fade_to;                   /*!< Level at the end of the fade, or the steady level */
+    int64_t fade_start_us;             /*!< Start of the fade */
+    uint32_t fade_us;                  /*!< Length of the fade, 0 when not fading */
+    uint32_t on_us;                    /*!< On time of the current period */
+    bool in_period;                    /*!< The next edge ends the on time of the current period */
+    bool running;                      /*!< The timer is armed */
+    bool closing;                      /*!< Set by lcd_backlight_pwm_disable(), stops re-arming. Written under lcd_backlight_mux too */
+    atomic_bool phase;                 /*!< Backlight line state the expander should show */
+    atomic_bool stale;                 /*!< phase changed and has not been written to the expander yet */
+    bool in_callback;                  /*!< The timer callback is executing, under lcd_backlight_mux */
+    SemaphoreHandle_t idle;            /*!< Given by a callback that leaves while closing is set */
+    TaskHandle_t task;                 /*!< Task writing edges that fall while the display is idle, or NULL */
+    SemaphoreHandle_t task_done;       /*!< Given by the task as it exits */
+    lcd_backlight_pwm_stats_t stats;   /*!< Bus cost since the last reset */
+    int64_t stats_start_us;            /*!< Time of the last statistics reset */
+};
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include "hd44780/fwd.h"
+#include "hd44780/error.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define LCD_ERROR_LOG_INTERVAL_US (CONFIG_LCD_ERROR_LOG_INTERVAL_MS * 1000LL) /*!< Shortest time between two logged failures of a display */
+
+/**
+ * @brief ESP_GOTO_ON_ERROR() without the log line, for the layers below the
+ *        public API. Needs esp_err_t ret in scope.
+ */
+#define LCD_GOTO_ON_ERROR(x, goto_tag) \
+    do                                 \
+    {                                  \
+        ret = (x);                     \
+        if (ret != ESP_OK)             \
+            goto goto_tag;             \
+    } while (0)
+
+/**
+ * @brief ESP_RETURN_ON_ERROR() without the log line
+ */
+#define LCD_RETURN_ON_ERROR(x)          \
+    do                                  \
+    {                                   \
+        esp_err_t err_rc_ = (x);        \
+        if (err_rc_ != ESP_OK)          \
+            return err_rc_;             \
+    } while (0)
+
+/**
+ * @brief Error context of a handle, part of its fault state
+ *
+ * @details Written with the handle's bus lock held.
+ */
+typedef struct
+{
+    lcd_error_t last;     /*!< The last failure recorded */
+    bool pending;         /*!< last is not reported yet, later failures are only counted */
+    bool in_instruction;  /*!< An instruction or character is being sent */
+    bool data;            /*!< It is a character */
+    uint8_t instruction;  /*!< The instruction or character */
+    uint32_t suppressed;  /*!< Reports not logged since the last one that was */
+    int64_t logged_us;    /*!< Time of the last logged report */
+} lcd_error_state_t;
+
+/**
+ * @brief Forget the failures of a handle
+ */
+void lcd_error_reset(lcd_handle_t *handle);
+
+/**
+ * @brief Note the instruction or character about to be sent, so a failure
+ *        can name it. Lock held.
+ *
+ * @param[in] mode LCD_COMMAND or LCD_WRITE
+ */
+void lcd_error_begin(const lcd_handle_t *handle, uint8_t instruction, uint8_t mode);
+
+/**
+ * @brief The instruction or character is sent, or has failed
+ */
+void lcd_error_end(const lcd_handle_t *handle);
+
+/**
+ * @brief Record a failure in the error context of a handle
+ *
+ * @details Costs a few stores and is only called on failure. Nothing is
+ *          logged here: the public call that fails reports it.
+ *
+ * @param[in] layer Where it failed
+ * @param[in] code What the layer returned
+ * @param[in] expander The expander byte involved, see lcd_error_t
+ */
+void lcd_error_record(const lcd_handle_t *handle, lcd_error_layer_t layer, esp_err_t code, uint8_t expander);
+
+/**
+ * @brief Log the failure recorded during a public call, rate limited
+ *
+ * @details Called where the call returns to the application. Does nothing
+ *          if nothing was recorded since the last report, such as for an
+ *          invalid argument already logged where it was found. A call that
+ *          succeeded anyway drops the record from the log.
+ *
+ * @param[in] handle LCD handle, may be NULL
+ * @param[in] api The call
+ * @param[in] result What the call returns
+ */
+void lcd_error_report(lcd_handle_t *handle, lcd_stats_api_t api, esp_err_t result);
+
+#ifdef __cplusplus
+}
+#endif
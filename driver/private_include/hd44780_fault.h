@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+#include "hd44780/fwd.h"
+#include "hd44780/fault.h"
+#include "hd44780_error.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define LCD_I2C_RETRIES CONFIG_LCD_I2C_RETRIES                            /*!< Times a failed transaction is sent again */
+#define LCD_REPROBE_INTERVAL_US (CONFIG_LCD_REPROBE_INTERVAL_MS * 1000LL) /*!< Time between probes of an offline display */
+#define LCD_I2C_BUS_WAIT_MS CONFIG_LCD_I2C_BUS_WAIT_MS                    /*!< Longest wait for another display's transaction on the port */
+
+/**
+ * @brief Failure count, offline state and error context of a handle
+ *
+ * @details Updated with the handle's bus lock held.
+ */
+struct lcd_fault_t
+{
+    uint8_t failures;        /*!< Transactions in a row that failed after their retries */
+    bool offline;            /*!< The error budget ran out, calls fail without using the bus */
+    bool reviving;           /*!< A probe or reset of the offline display is under way, so it may use the bus */
+    bool port_busy;          /*!< The last transaction timed out waiting for the port, not on the bus */
+    int64_t reprobe_us;      /*!< Time from which the offline display may be probed again */
+    lcd_error_state_t error; /*!< The failure behind the last failed call, see hd44780_error.h */
+};
+
+/**
+ * @brief Create the fault state of a handle, or bring an existing one back online
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_NO_MEM        Unable to allocate the state
+ */
+esp_err_t lcd_fault_create(lcd_handle_t *handle);
+
+/**
+ * @brief Delete the fault state of a handle
+ */
+void lcd_fault_free(lcd_handle_t *handle);
+
+/**
+ * @brief Timeout of one I2C transaction of the handle
+ */
+TickType_t lcd_fault_ticks(const lcd_handle_t *handle);
+
+/**
+ * @brief Wait for the I2C port of a handle, before a transaction on it
+ *
+ * @details Displays driven by the I2C driver take turns on their port through
+ *          a lock of this module, for up to CONFIG_LCD_I2C_BUS_WAIT_MS, so
+ *          the timeout of the transaction itself only covers the bus.
+ *
+ * @return
+ *          - ESP_OK                The port is the handle's until lcd_fault_port_give()
+ *          - ESP_ERR_TIMEOUT       Other displays kept the port, the display is not blamed
+ */
+esp_err_t lcd_fault_port_take(const lcd_handle_t *handle);
+
+/**
+ * @brief Hand the I2C port of a handle back after a transaction
+ */
+void lcd_fault_port_give(const lcd_handle_t *handle);
+
+/**
+ * @brief True when the display is offline and the bus must be left alone
+ */
+bool lcd_fault_offline(const lcd_handle_t *handle);
+
+/**
+ * @brief Let an instruction through to the display
+ *
+ * @details Called with the bus lock held, before each instruction. Probes an
+ *          offline display that is due for it, and resets it if it answers.
+ *
+ * @return
+ *          - ESP_OK                The display is online
+ *          - ESP_ERR_NOT_FOUND     It is offline, or has only just come back
+ */
+esp_err_t lcd_fault_admit(lcd_handle_t *handle);
+
+/**
+ * @brief Decide whether a failed transaction is sent again
+ *
+ * @details Counts the retry. The bus is only ever cleared by the re-probe of
+ *          an offline display, see CONFIG_LCD_BUS_RECOVERY.
+ *
+ * @param[in] result What the transaction returned
+ * @param[in] attempt Retries already made
+ *
+ * @return true to send the transaction again
+ */
+bool lcd_fault_retry(const lcd_handle_t *handle, esp_err_t result, uint8_t attempt);
+
+/**
+ * @brief Record the result of a run of transactions, taking the display
+ *        offline when its error budget runs out
+ *
+ * @details A transaction that timed out waiting for the port, see
+ *          lcd_fault_port_take(), does not count against the budget.
+ */
+void lcd_fault_result(const lcd_handle_t *handle, esp_err_t result);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "hd44780/fwd.h"
+#include "hd44780/glyphpack.h"
+#if CONFIG_LCD_GLYPH_PACK_PARTITION
+#include "esp_idf_version.h"
+#include "esp_partition.h"
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Layout of a glyph pack, as written by tools/lcd_glyph_pack.py. Every field
+// is little-endian, and every section starts on a 4-byte boundary.
+//
+//     header               16 bytes
+//     directory            set_count entries of 32 bytes
+//     set data             at the offset each entry gives
+//
+// Data of each type of set:
+//
+//     GLYPHS               glyphs * rows bitmap bytes
+//     BIG_DIGITS           glyphs * rows bitmap bytes, count symbol
+//                          characters, then width * height cells per symbol
+//     ANIMATION            count frames of glyphs * rows bitmap bytes
+//     ROM_MAP              256 character ROM codes
+
+#define LCD_GLYPH_PACK_MAGIC 0x4744434CUL /*!< "LCDG" */
+#define LCD_GLYPH_PACK_VERSION 1         /*!< Layout version written by the packer */
+
+#if CONFIG_LCD_GLYPH_PACK_PARTITION
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+typedef esp_partition_mmap_handle_t lcd_glyph_pack_mmap_t; /*!< Handle of a partition mapping */
+#define LCD_GLYPH_PACK_MMAP_DATA ESP_PARTITION_MMAP_DATA  /*!< Map into the data address space */
+#define lcd_glyph_pack_munmap esp_partition_munmap         /*!< Release a partition mapping */
+#else
+// Before ESP-IDF 5.1, partitions are mapped with the types of spi_flash
+typedef spi_flash_mmap_handle_t lcd_glyph_pack_mmap_t;
+#define LCD_GLYPH_PACK_MMAP_DATA SPI_FLASH_MMAP_DATA
+#define lcd_glyph_pack_munmap spi_flash_munmap
+#endif
+#endif
+
+/**
+ * @brief Header of a glyph pack
+ */
+typedef struct
+{
+    uint32_t magic;     /*!< LCD_GLYPH_PACK_MAGIC */
+    uint16_t version;   /*!< LCD_GLYPH_PACK_VERSION */
+    uint16_t set_count; /*!< Directory entries */
+    uint32_t size;      /*!< Bytes in the pack, header included */
+    uint32_t crc;       /*!< CRC32 of the size - 16 bytes after the header */
+} lcd_glyph_pack_header_t;
+
+/**
+ * @brief Directory entry of a glyph set
+ */
+typedef struct
+{
+    char name[LCD_GLYPH_NAME_LEN]; /*!< Name, NUL padded */
+    uint8_t type;                  /*!< lcd_glyph_set_type_t */
+    uint8_t rows;                  /*!< Rows of each glyph, 8 or 10, 0 for a ROM map */
+    uint8_t glyphs;                /*!< Glyphs of the set or of each frame */
+    uint8_t first;                 /*!< CGRAM location of the first glyph */
+    uint8_t width;                 /*!< Big digits: cells across each symbol */
+    uint8_t height;                /*!< Big digits: cells down each symbol */
+    uint16_t count;                /*!< Frames, symbols or 1 */
+    uint32_t offset;               /*!< Start of the set's data from the start of the pack */
+    uint32_t length;               /*!< Bytes of data */
+} lcd_glyph_pack_entry_t;
+
+_Static_assert(sizeof(lcd_glyph_pack_header_t) == 16, "Glyph pack header layout");
+_Static_assert(sizeof(lcd_glyph_pack_entry_t) == 32, "Glyph pack directory layout");
+
+/**
+ * @brief An open glyph pack
+ */
+struct lcd_glyph_pack_t
+{
+    const uint8_t *data;                   /*!< Start of the pack, in the flash cache or in memory */
+    const lcd_glyph_pack_entry_t *entries; /*!< Directory */
+    uint16_t set_count;                    /*!< Directory entries */
+#if CONFIG_LCD_GLYPH_PACK_PARTITION
+    bool mapped;                         /*!< data is a partition mapping, released on close */
+    lcd_glyph_pack_mmap_t mmap;          /*!< Handle of the mapping */
+#endif
+};
+
+#ifdef __cplusplus
+}
+#endif
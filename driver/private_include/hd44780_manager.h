@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/i2c.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "hd44780/handle.h"
+#include "hd44780/manager.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief A display owned by a manager
+ */
+typedef struct
+{
+    lcd_handle_t handle;  /*!< Handle returned to the application */
+    uint16_t budget;      /*!< Cells the display may send per round-robin turn */
+    uint32_t cells_sent;  /*!< Cells sent since the display was added */
+    uint32_t turns;       /*!< Turns in which the display sent at least one cell */
+    esp_err_t last_error; /*!< Result of the most recent flush */
+    bool active;          /*!< Slot in use and served by its bus task */
+} lcd_manager_display_t;
+
+/**
+ * @brief Scheduling state of one I2C port
+ */
+typedef struct
+{
+    lcd_manager_t *manager;  /*!< Manager the bus belongs to */
+    i2c_port_t port;         /*!< I2C controller served */
+    SemaphoreHandle_t lock;  /*!< Held by the bus task for a whole pass, and while displays are added or removed */
+    TaskHandle_t task;       /*!< Bus task, NULL until the first display on the port is added */
+    uint8_t next;            /*!< Display slot the next round starts at */
+    int64_t last_pass_us;    /*!< Time of the last flush pass */
+    volatile bool running;   /*!< Cleared to ask the bus task to exit */
+} lcd_manager_bus_t;
+
+struct lcd_manager_t
+{
+    lcd_manager_config_t config;                                /*!< Configuration the manager was created with */
+    SemaphoreHandle_t lock;                                     /*!< Serialises add, remove and delete */
+    lcd_manager_bus_t buses[I2C_NUM_MAX];                       /*!< One scheduler per I2C port */
+    lcd_manager_display_t displays[LCD_MANAGER_MAX_DISPLAYS];   /*!< Display registry */
+};
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+#include "hd44780/pacing.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define LCD_YIELD_THRESHOLD_US CONFIG_LCD_YIELD_THRESHOLD_US /*!< Waits from this length on block instead of spinning */
+
+#if CONFIG_IDF_TARGET_LINUX
+// Spinning on the mocked clock of driver/mock costs no time at all
+#define LCD_PACING_YIELD 0
+#else
+#define LCD_PACING_YIELD 1 /*!< Long waits may block the task */
+#endif
+
+/**
+ * @brief Wait timer of a handle
+ *
+ * @details Waits happen with the handle's bus lock held, or during lcd_init(),
+ *          so one timer and one semaphore per handle are enough.
+ */
+struct lcd_pacer_t
+{
+    esp_timer_handle_t timer;       /*!< One-shot timer ending a blocking wait */
+    SemaphoreHandle_t done;         /*!< Given by the timer, taken by the waiting task */
+    StaticSemaphore_t done_buffer;  /*!< Storage for done */
+    lcd_pacing_stats_t stats;       /*!< Statistics since the last reset */
+};
+
+/**
+ * @brief Create the wait timer of a handle, if it has none yet
+ */
+esp_err_t lcd_pacer_create(lcd_handle_t *handle);
+
+/**
+ * @brief Delete the wait timer of a handle
+ */
+void lcd_pacer_free(lcd_handle_t *handle);
+
+/**
+ * @brief Wait for a number of microseconds
+ *
+ * @details Spins below LCD_YIELD_THRESHOLD_US, before the scheduler runs,
+ *          when the handle has no wait timer, or on the linux target.
+ *          Otherwise blocks the calling task on the handle's wait timer.
+ */
+void lcd_delay_us(const lcd_handle_t *handle, uint32_t us);
+
+#ifdef __cplusplus
+}
+#endif
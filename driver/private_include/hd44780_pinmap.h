@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "hd44780/fwd.h"
+#include "hd44780/handle.h"
+#include "hd44780/pinmap.h"
+#include "hd44780.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define LCD_ENCODING_SEQ_LEN 6 /*!< Expander bytes that clock a byte into the controller */
+#define LCD_ENCODING_HIGH 0    /*!< Offset of the high nibble in a sequence */
+#define LCD_ENCODING_LOW 3     /*!< Offset of the low nibble in a sequence */
+
+/**
+ * @brief Expander bytes of a pin map
+ *
+ * @details seq holds the data lines and E of each byte value: the high
+ *          nibble, the same with E raised, the same with E dropped, then the
+ *          low nibble likewise. A nibble sent on its own, as in the reset
+ *          sequence, is the first half of the sequence of the nibble shifted
+ *          up. RS, RW and the backlight come from the call, and are ORed in.
+ */
+struct lcd_encoding_t
+{
+    uint8_t seq[256][LCD_ENCODING_SEQ_LEN]; /*!< Data lines and E of each byte value */
+    uint8_t mode[4];                        /*!< RS and RW lines, indexed by LCD_COMMAND, LCD_WRITE or LCD_READ */
+    uint8_t enable;                         /*!< E line */
+    uint8_t backlight;                      /*!< Backlight line */
+    uint8_t data[4];                        /*!< D4 to D7 */
+    bool remapped;                          /*!< Not the P0 to P7 order of LCD_ENABLE and friends, see lcd_encoding_canonical() */
+};
+
+/**
+ * @brief The menuconfig pin map, encoded at compile time
+ */
+extern const lcd_encoding_t lcd_encoding_config;
+
+/**
+ * @brief Encoding of a handle
+ *
+ * @details Handles that were never initialised, as lcd_probe() allows, use
+ *          the menuconfig pin map.
+ */
+static inline const lcd_encoding_t *lcd_encoding(const lcd_handle_t *handle)
+{
+    return handle->encoding ? handle->encoding : &lcd_encoding_config;
+}
+
+/**
+ * @brief The lines of an encoding, RS, RW, E, backlight and D4 to D7, to
+ *        tell whether two encodings are of the same wiring
+ */
+static inline void lcd_encoding_lines(const lcd_encoding_t *encoding, uint8_t lines[8])
+{
+    lines[0] = encoding->mode[LCD_WRITE];
+    lines[1] = encoding->mode[LCD_READ];
+    lines[2] = encoding->enable;
+    lines[3] = encoding->backlight;
+    for (int i = 0; i < 4; ++i)
+        lines[4 + i] = encoding->data[i];
+}
+
+/**
+ * @brief Point the handle at the encoding of its pin map, building it if it
+ *        is not the menuconfig one
+ *
+ * @return
+ *          - ESP_OK                Success
+ *          - ESP_ERR_INVALID_ARG   A pin out of range, or two lines on the same pin
+ *          - ESP_ERR_NO_MEM        Unable to allocate the encoding
+ */
+esp_err_t lcd_encoding_create(lcd_handle_t *handle);
+
+/**
+ * @brief Free an encoding built by lcd_encoding_create()
+ */
+void lcd_encoding_free(lcd_handle_t *handle);
+
+/**
+ * @brief D7 to D4 read from the expander pins, in bits 7 to 4
+ */
+uint8_t lcd_encoding_nibble(const lcd_encoding_t *encoding, uint8_t pins);
+
+/**
+ * @brief Expander pins moved to the P0 to P7 order of the default pin map
+ *
+ * @details For the trace, whose decoder knows that order only.
+ */
+uint8_t lcd_encoding_canonical(const lcd_encoding_t *encoding, uint8_t pins);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "hd44780/refresh.h"
+#include "hd44780.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define LCD_REFRESH_CLEAR_MIN_CELLS 4 /*!< Dirty cells from which a Clear Display instruction is used to blank the frame */
+
+/**
+ * @brief A run of dirty cells on one row, sent with a single address set
+ */
+typedef struct
+{
+    uint16_t start;   /*!< Index of the first cell */
+    uint8_t len;      /*!< Number of cells */
+    uint8_t priority; /*!< Highest priority of the cells in the run */
+} lcd_refresh_run_t;
+
+/**
+ * @brief Frame buffer and scheduling state of a handle with the refresh
+ *        scheduler enabled
+ *
+ * @details desired holds what the application last wrote, shown holds what
+ *          the display is known to contain. A cell is dirty while the two
+ *          differ, so repeated writes to a cell coalesce for free.
+ */
+struct lcd_refresh_t
+{
+    lcd_refresh_config_t config; /*!< Configuration the scheduler was enabled with */
+    portMUX_TYPE spinlock;       /*!< Protects desired, dirty_since, dirty_count and urgent */
+    uint16_t cells;              /*!< columns * rows */
+    char *desired;               /*!< Frame the application wants displayed */
+    char *shown;                 /*!< Frame the display currently holds */
+    char *snapshot;              /*!< Copy of desired taken at the start of a flush */
+    uint8_t *priority;           /*!< Per cell flush priority */
+    lcd_refresh_run_t *runs;     /*!< Scratch space for building the flush plan */
+    uint32_t *dirty_since;       /*!< Per cell time (ms) the cell became dirty */
+    uint16_t dirty_count;        /*!< Number of cells where desired != shown */
+    bool urgent;                 /*!< An urgent cell was written since the last flush */
+    int64_t last_flush_us;       /*!< Time of the last flush */
+    uint8_t placed_column;       /*!< Column the hardware cursor was last placed at */
+    uint8_t placed_row;          /*!< Row the hardware cursor was last placed at */
+    uint16_t nruns;              /*!< Runs in the plan of the flush in progress */
+    uint16_t run_index;          /*!< Run being sent by the flush in progress */
+    uint8_t run_offset;          /*!< Cells of the current run already sent */
+    bool addressed;              /*!< The address of the current run has been set */
+    bool disturbed;              /*!< The flush in progress moved the controller's address counter */
+    bool clear_pending;          /*!< Blank the display with a Clear Display instruction at the next flush */
+    uint16_t budget;             /*!< Cells the flush in progress may still send */
+    TaskHandle_t task;           /*!< Flush task owned by the scheduler, NULL if none */
+    SemaphoreHandle_t stopped;   /*!< Given by the flush task as it exits */
+    TaskHandle_t notify;         /*!< Task woken when the frame becomes dirty, NULL if none */
+    volatile bool running;       /*!< Cleared to ask the flush task to exit */
+};
+
+/**
+ * @brief Store a character at the handle's logical cursor position
+ *
+ * @details The cursor position in the handle is not advanced.
+ */
+esp_err_t lcd_refresh_put(lcd_handle_t *handle, char c);
+
+/**
+ * @brief Blank the whole frame buffer
+ */
+esp_err_t lcd_refresh_clear(lcd_handle_t *handle);
+
+/**
+ * @brief Forget what the display holds after it was cleared behind the
+ *        scheduler's back, so the whole frame is sent again
+ *
+ * @details Called with the bus lock held.
+ */
+void lcd_refresh_invalidate(lcd_handle_t *handle);
+
+/**
+ * @brief Take frame as both what the display holds and what the application
+ *        wants, after it was drawn behind the scheduler's back
+ *
+ * @details Called with the bus lock held, with the controller's address
+ *          counter at the handle's cursor.
+ */
+void lcd_refresh_adopt(lcd_handle_t *handle, const char *frame);
+
+/**
+ * @brief Start a flush of at most max_cells dirty cells, highest priority first
+ *
+ * @details Takes the handle's bus lock, which is held until lcd_refresh_end().
+ *          The flush is then advanced one bus instruction at a time with
+ *          lcd_refresh_step(), which lets a caller interleave the flushes of
+ *          several displays sharing a bus.
+ */
+void lcd_refresh_begin(lcd_handle_t *handle, uint16_t max_cells);
+
+/**
+ * @brief Send the next instruction of the flush started by lcd_refresh_begin()
+ *
+ * @details Waits for the controller to be ready first. Callers that want to
+ *          hide the wait check handle->busy_until_us before calling.
+ *
+ * @param[out] done Set when the flush has nothing more to send
+ * @param[out] sent Incremented when a cell was sent
+ *
+ * @return
+ *          - ESP_OK     Success
+ *          - ESP error code propagated from error source
+ */
+esp_err_t lcd_refresh_step(lcd_handle_t *handle, bool *done, uint16_t *sent);
+
+/**
+ * @brief Next instruction of the flush started by lcd_refresh_begin(), without sending it
+ *
+ * @details Lets a caller send the instructions of several displays together
+ *          with lcd_hw_transfer_many(). The instruction must be handed to
+ *          lcd_refresh_sent() before the next one is asked for.
+ *
+ * @param[out] xfer The instruction for the handle, with result ESP_OK
+ *
+ * @return false if the flush has nothing more to send
+ */
+bool lcd_refresh_next(lcd_handle_t *handle, lcd_hw_xfer_t *xfer);
+
+/**
+ * @brief Account for the instruction from lcd_refresh_next(), sent or failed
+ *
+ * @param[in] xfer The instruction, with the result of sending it
+ * @param[out] done Set when the flush has nothing more to send
+ * @param[out] sent Incremented when a cell was sent
+ */
+void lcd_refresh_sent(lcd_handle_t *handle, const lcd_hw_xfer_t *xfer, bool *done, uint16_t *sent);
+
+/**
+ * @brief Finish the flush started by lcd_refresh_begin() and release the bus lock
+ *
+ * @details Must be called even when lcd_refresh_step() failed.
+ */
+esp_err_t lcd_refresh_end(lcd_handle_t *handle);
+
+/**
+ * @brief Flush at most max_cells dirty cells, highest priority first
+ *
+ * @param[inout] handle LCD handle with the refresh scheduler enabled
+ * @param[in] max_cells Budget of cells to send in this call
+ * @param[out] sent Number of cells sent. May be NULL.
+ *
+ * @return
+ *          - ESP_OK     Success
+ *          - ESP error code propagated from error source
+ */
+esp_err_t lcd_refresh_flush_cells(lcd_handle_t *handle, uint16_t max_cells, uint16_t *sent);
+
+/**
+ * @brief Select the task woken when the frame becomes dirty or an urgent
+ *        cell is written
+ *
+ * @details Used by components that drive lcd_refresh_flush_cells() from their
+ *          own task instead of the scheduler's flush task.
+ */
+void lcd_refresh_set_notify(lcd_handle_t *handle, TaskHandle_t task);
+
+/**
+ * @brief Wake the task driving the flushes of the handle
+ */
+void lcd_refresh_wake(lcd_handle_t *handle);
+
+/**
+ * @brief True if a flush would send anything: dirty cells, a pending clear or
+ *        deferred display control and entry mode changes
+ */
+bool lcd_refresh_has_work(const lcd_handle_t *handle);
+
+/**
+ * @brief True if an urgent cell was written since the last flush
+ */
+bool lcd_refresh_is_urgent(const lcd_handle_t *handle);
+
+/**
+ * @brief Age in microseconds of the oldest change not yet on the display
+ *
+ * @return 0 if nothing is pending
+ */
+int64_t lcd_refresh_staleness_us(lcd_handle_t *handle);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "hd44780/fwd.h"
+#include "hd44780/screen.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define LCD_SCREEN_WIRE_CLOCKS 9 /*!< SCL periods of an expander byte within a transaction, acknowledge included */
+
+/**
+ * @brief A screen compiled by lcd_screen_compile()
+ *
+ * @details One allocation: the structure, then stream, frame and glyphs.
+ */
+struct lcd_screen_t
+{
+    uint8_t *stream;         /*!< Expander bytes drawing the screen, backlight line as in backlight */
+    size_t len;              /*!< Bytes in stream */
+    uint32_t wire_us;        /*!< Time the stream takes on the bus at the clock it was compiled for */
+    uint32_t settle_us;      /*!< Settle time waited before each enable pulse, 0 to send stream in one run */
+    char *frame;             /*!< columns * rows characters the screen leaves on the display */
+    uint8_t *glyphs;         /*!< glyph_count * glyph_len CGRAM bytes */
+    uint8_t glyph_count;     /*!< Glyphs loaded from CGRAM glyph 0 on */
+    uint8_t glyph_len;       /*!< Rows of a glyph, 8 or 10 */
+    uint8_t cgram_addresses; /*!< Set CGRAM Address instructions in stream */
+    uint8_t columns;         /*!< Geometry the screen is compiled for */
+    uint8_t rows;            /*!< Geometry the screen is compiled for */
+    uint8_t lines[8];        /*!< Wiring the screen is compiled for, see lcd_encoding_lines() */
+    uint8_t backlight;       /*!< Backlight line in stream, 0 or the line */
+    uint8_t display_control; /*!< Display on, with the cursor and blink of the screen */
+    uint8_t cursor_column;   /*!< Where the stream leaves the address counter */
+    uint8_t cursor_row;      /*!< Where the stream leaves the address counter */
+};
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "hd44780/service.h"
+#include "hd44780/async.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Operations understood by the display service task
+ */
+typedef enum
+{
+    LCD_CMD_WRITE_STR = 0, /*!< Write payload.str at the current cursor position */
+    LCD_CMD_WRITE_CHAR,    /*!< Write payload.c at the current cursor position */
+    LCD_CMD_SET_CURSOR,    /*!< Move the cursor to payload.cursor */
+    LCD_CMD_CLEAR,         /*!< Clear the display */
+    LCD_CMD_WRITE_CGRAM,   /*!< Write payload.cgram */
+    LCD_CMD_CALL,          /*!< Run payload.fn on the handle */
+} lcd_cmd_type_t;
+
+/**
+ * @brief A queued display command
+ *
+ * @details Kept small so that producers only copy a few bytes into the ring.
+ */
+typedef struct
+{
+    lcd_cmd_type_t type;  /*!< Operation to perform */
+    lcd_handle_t *handle; /*!< Target LCD handle */
+    lcd_async_op_t *op;   /*!< Operation completed by this command, or NULL */
+    union
+    {
+        struct
+        {
+            uint8_t len;                     /*!< Number of valid characters in text */
+            char text[LCD_SERVICE_TEXT_LEN]; /*!< Characters to write. Not NUL terminated. */
+        } str;
+        char c;
+        struct
+        {
+            uint8_t col;
+            uint8_t row;
+        } cursor;
+        struct
+        {
+            uint8_t location;
+            uint8_t charmap[10];
+        } cgram;
+        esp_err_t (*fn)(lcd_handle_t *handle);
+    } payload;
+} lcd_cmd_t;
+
+/**
+ * @brief Ring slot. The sequence number tells producers and the consumer
+ *        whether the slot is free or holds a published command.
+ */
+typedef struct
+{
+    atomic_uint sequence;
+    uint32_t group; /*!< Commands in the group this slot heads, counting itself. 0 past the head. */
+    lcd_cmd_t cmd;
+} lcd_service_slot_t;
+
+/**
+ * @brief Display service instance
+ */
+struct lcd_service_t
+{
+    lcd_service_config_t config; /*!< Configuration the service was created with */
+    lcd_service_slot_t *slots;   /*!< Ring storage */
+    lcd_cmd_t *batch;            /*!< Group the task is executing, copied out of the ring */
+    uint32_t mask;               /*!< Ring size - 1. Ring size is a power of two. */
+    atomic_uint enqueue_pos;     /*!< Next position producers will claim */
+    atomic_uint dequeue_pos;     /*!< Next position to be consumed */
+    atomic_uint dropped;         /*!< Commands discarded by the drop-oldest policy */
+    atomic_uint executing;       /*!< Non-zero while the task is running a dequeued command */
+    atomic_bool running;         /*!< Cleared to ask the task to exit */
+    atomic_uint waiters;         /*!< Producers and flushers sleeping on progress */
+    SemaphoreHandle_t progress;  /*!< Given when a group enters or leaves the ring while someone waits */
+    SemaphoreHandle_t stopped;   /*!< Given by the task as it exits */
+    TaskHandle_t task;           /*!< Service task */
+};
+
+/**
+ * @brief Queue a fully formed command, applying the configured overflow policy
+ *
+ * @param[in] service Service
+ * @param[in] cmd Command to copy into the ring
+ *
+ * @return
+ *          - ESP_OK                Command queued
+ *          - ESP_ERR_TIMEOUT       Queue full (LCD_SERVICE_OVERFLOW_BLOCK only)
+ */
+esp_err_t lcd_service_post(lcd_service_t *service, const lcd_cmd_t *cmd);
+
+/**
+ * @brief Queue a string write, split into commands of LCD_SERVICE_TEXT_LEN characters
+ *
+ * @details The commands form one group with first, if given: they are
+ *          queued, executed and dropped together. When op is set, every
+ *          string command takes a reference on it.
+ *
+ * @param[in] handle Attached LCD handle
+ * @param[in] first Command to run ahead of the string, e.g. a cursor move, or NULL
+ * @param[in] str NUL terminated string
+ * @param[in] op Operation completed by the string commands, or NULL
+ *
+ * @return
+ *          - ESP_OK                Every command queued
+ *          - ESP_ERR_INVALID_SIZE  The group needs more slots than the ring has
+ *          - ESP_ERR_TIMEOUT       Queue full (LCD_SERVICE_OVERFLOW_BLOCK only)
+ */
+esp_err_t lcd_service_post_str(lcd_handle_t *handle, const lcd_cmd_t *first, const char *str, lcd_async_op_t *op);
+
+#ifdef __cplusplus
+}
+#endif
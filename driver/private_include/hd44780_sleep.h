@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include "hd44780/fwd.h"
+#include "hd44780/sleep.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define LCD_SLEEP_MAGIC 0x4C43445AUL /*!< Marks a valid deep sleep snapshot */
+#define LCD_SLEEP_MAX_CELLS 80       /*!< Largest frame kept, 20 x 4 */
+#define LCD_SLEEP_CGRAM_LOCATIONS 8  /*!< CGRAM locations shadowed */
+#define LCD_SLEEP_CGRAM_ROWS 10      /*!< Bytes per location, enough for 5x10 fonts */
+
+/**
+ * @brief Display snapshot kept in RTC slow memory across deep sleep
+ *
+ * @details Everything from magic up to crc is covered by crc. A snapshot is
+ *          only valid from lcd_sleep_save() until the next lcd_init() on the
+ *          display, so a wake-up that skips lcd_sleep_save() starts cold.
+ */
+struct lcd_sleep_t
+{
+    uint32_t magic;                                                   /*!< LCD_SLEEP_MAGIC */
+    uint8_t i2c_port;                                                 /*!< I2C controller of the display */
+    uint8_t address;                                                  /*!< Address of the display */
+    uint8_t columns;                                                  /*!< Geometry of the display */
+    uint8_t rows;                                                     /*!< Geometry of the display */
+    uint8_t display_function;                                         /*!< Function Set flags of the handle and the controller */
+    uint8_t display_control;                                          /*!< Display Control flags of the handle and the controller */
+    uint8_t display_mode;                                             /*!< Entry Mode Set flags of the handle and the controller */
+    uint8_t cursor_column;                                            /*!< Logical cursor column */
+    uint8_t cursor_row;                                               /*!< Logical cursor row */
+    uint8_t backlight;                                                /*!< Backlight state */
+    bool frame_valid;                                                 /*!< frame holds the display content */
+    uint8_t cgram_valid;                                              /*!< One bit per CGRAM location held in cgram */
+    char frame[LCD_SLEEP_MAX_CELLS];                                  /*!< Display content, row by row */
+    uint8_t cgram[LCD_SLEEP_CGRAM_LOCATIONS][LCD_SLEEP_CGRAM_ROWS];   /*!< Shadow of the CGRAM content */
+    uint32_t crc;                                                     /*!< CRC32 of the fields above */
+    bool resumed;                                                     /*!< The handle was restored from this snapshot at the last lcd_init() */
+};
+
+/**
+ * @brief Find or claim the snapshot of a handle and link it
+ *
+ * @return
+ *          - ESP_OK                Woken from deep sleep with a valid snapshot of this display
+ *          - ESP_ERR_NOT_FOUND     No usable snapshot. A blank one is linked.
+ *          - ESP_ERR_NO_MEM        No free slot. The handle has none.
+ *          - ESP_ERR_NOT_SUPPORTED Deep sleep persistence disabled in menuconfig
+ */
+esp_err_t lcd_sleep_attach(lcd_handle_t *handle);
+
+/**
+ * @brief Unlink the snapshot of a handle and free its slot
+ */
+void lcd_sleep_detach(lcd_handle_t *handle);
+
+/**
+ * @brief Copy the snapshot into the handle and mark the snapshot used
+ */
+void lcd_sleep_restore(lcd_handle_t *handle);
+
+/**
+ * @brief Mark the snapshot of a handle unusable
+ */
+void lcd_sleep_invalidate(lcd_handle_t *handle);
+
+/**
+ * @brief Hand the preserved frame over to the refresh scheduler, once
+ *
+ * @param[out] frame columns * rows cells
+ *
+ * @return true if frame was filled from the snapshot
+ */
+bool lcd_sleep_take_frame(lcd_handle_t *handle, char *frame);
+
+/**
+ * @brief Whether a CGRAM location already holds charmap, per the shadow
+ */
+bool lcd_sleep_cgram_matches(const lcd_handle_t *handle, uint8_t location, const uint8_t *charmap, uint8_t len);
+
+/**
+ * @brief Record a CGRAM upload in the shadow
+ */
+void lcd_sleep_cgram_store(lcd_handle_t *handle, uint8_t location, const uint8_t *charmap, uint8_t len);
+
+/**
+ * @brief Drop the CGRAM shadow, after the controller lost or may have lost its CGRAM
+ */
+void lcd_sleep_cgram_forget(lcd_handle_t *handle);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+#include "hd44780/fwd.h"
+#include "hd44780/stats.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Performance counters of a handle
+ *
+ * @details The bus counters are updated with the handle's bus lock held. The
+ *          latency histograms are updated by the calling task after the lock
+ *          is released, so they are guarded by the spinlock.
+ */
+struct lcd_counters_t
+{
+    portMUX_TYPE spinlock; /*!< Guards stats against concurrent callers and readers */
+    lcd_stats_t stats;     /*!< Counters since the last reset */
+    int64_t start_us;      /*!< Time of the last reset */
+};
+
+/**
+ * @brief Create the counters of a handle, if it has none yet
+ *
+ * @return
+ *          - ESP_OK                Success, or statistics disabled in menuconfig
+ *          - ESP_ERR_NO_MEM        Unable to allocate the counters
+ */
+esp_err_t lcd_counters_create(lcd_handle_t *handle);
+
+/**
+ * @brief Delete the counters of a handle
+ */
+void lcd_counters_free(lcd_handle_t *handle);
+
+/**
+ * @brief Start timing a public API call
+ *
+ * @return The current time, or 0 when statistics are disabled
+ */
+int64_t lcd_stats_start(void);
+
+/**
+ * @brief Record the latency of a public API call started at start_us
+ */
+void lcd_stats_call(const lcd_handle_t *handle, lcd_stats_api_t api, int64_t start_us);
+
+/**
+ * @brief Record count I2C transactions started together at start_us and their result
+ */
+void lcd_stats_i2c(const lcd_handle_t *handle, esp_err_t result, int64_t start_us, uint32_t count);
+
+/**
+ * @brief Record one I2C transaction of len expander bytes, started at start_us
+ */
+void lcd_stats_i2c_bulk(const lcd_handle_t *handle, esp_err_t result, int64_t start_us, uint32_t len);
+
+/**
+ * @brief Record a transaction sent again after a failure
+ */
+void lcd_stats_retry(const lcd_handle_t *handle);
+
+/**
+ * @brief Record a byte sent to the instruction (LCD_COMMAND) or data (LCD_WRITE) register
+ */
+void lcd_stats_sent(const lcd_handle_t *handle, uint8_t data, uint8_t mode);
+
+/**
+ * @brief Record time spent waiting on the display
+ */
+void lcd_stats_wait(const lcd_handle_t *handle, int64_t us);
+
+#ifdef __cplusplus
+}
+#endif
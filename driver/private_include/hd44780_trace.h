@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include "hd44780/fwd.h"
+#include "hd44780/trace.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if CONFIG_LCD_TRACE
+
+/**
+ * @brief Record an expander byte written or read by a handle
+ *
+ * @param[in] flags LCD_TRACE_READ, LCD_TRACE_ERROR
+ */
+void lcd_trace_record(const lcd_handle_t *handle, uint8_t data, uint8_t flags);
+
+/**
+ * @brief Record a run of expander bytes written together since start_us
+ *
+ * @details The run's time is shared out evenly and each byte is stamped at
+ *          the end of its share, as if written on its own.
+ *
+ * @param[in] flags LCD_TRACE_ERROR
+ */
+void lcd_trace_record_run(const lcd_handle_t *handle, const uint8_t *data, size_t len, uint8_t flags,
+                          int64_t start_us);
+
+#else
+
+// Compiled out entirely, so a disabled trace costs nothing on the bus path
+static inline void lcd_trace_record(const lcd_handle_t *handle, uint8_t data, uint8_t flags)
+{
+}
+
+static inline void lcd_trace_record_run(const lcd_handle_t *handle, const uint8_t *data, size_t len, uint8_t flags,
+                                        int64_t start_us)
+{
+}
+
+#endif // CONFIG_LCD_TRACE
+
+#ifdef __cplusplus
+}
+#endif
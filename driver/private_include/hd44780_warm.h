@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include "hd44780/fwd.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define LCD_WARM_MAGIC 0x4C43442BUL /*!< Marks a warm start record written by this driver */
+
+/**
+ * @brief What a controller holds, kept across CPU resets in RTC memory
+ *
+ * @details An ESP32 reset does not reset the display. The record tells the
+ *          next boot how the controller was left, so lcd_init() can resume
+ *          it instead of running the reset-by-instruction sequence.
+ *          pending_data, pending_mode and half_sent change with every byte
+ *          and are not covered by crc.
+ */
+struct lcd_warm_t
+{
+    uint32_t magic;             /*!< LCD_WARM_MAGIC */
+    uint8_t i2c_port;           /*!< I2C controller of the display */
+    uint8_t address;            /*!< Address of the display */
+    uint8_t columns;            /*!< Geometry the display was initialised with */
+    uint8_t rows;               /*!< Geometry the display was initialised with */
+    uint8_t display_function;   /*!< Function Set flags held by the controller */
+    uint8_t display_control;    /*!< Display Control flags held by the controller */
+    uint8_t display_mode;       /*!< Entry Mode Set flags held by the controller */
+    uint8_t reserved;           /*!< Padding, kept zero */
+    uint32_t crc;               /*!< CRC32 of the fields above */
+    uint8_t pending_data;       /*!< Byte being sent */
+    uint8_t pending_mode;       /*!< Register pending_data is sent to */
+    volatile uint8_t half_sent; /*!< Only the high nibble of pending_data has been clocked in */
+};
+
+/**
+ * @brief Find or claim the warm start record of a handle and link it
+ *
+ * @return
+ *          - ESP_OK                A valid record for this display exists, the controller can be resumed
+ *          - ESP_ERR_NOT_FOUND     No usable record. A fresh one is linked and will be filled in.
+ *          - ESP_ERR_NO_MEM        No free record. The handle has none.
+ *          - ESP_ERR_NOT_SUPPORTED Warm start disabled in menuconfig
+ */
+esp_err_t lcd_warm_attach(lcd_handle_t *handle);
+
+/**
+ * @brief Unlink the record of a handle, leaving its content for the next boot
+ */
+void lcd_warm_detach(lcd_handle_t *handle);
+
+/**
+ * @brief Record the controller flags held in the handle's hw_display_* fields
+ */
+void lcd_warm_save(const lcd_handle_t *handle);
+
+/**
+ * @brief Mark the record of a handle as unusable for a warm start
+ */
+void lcd_warm_invalidate(const lcd_handle_t *handle);
+
+#ifdef __cplusplus
+}
+#endif
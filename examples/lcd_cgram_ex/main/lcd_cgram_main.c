@@ -5,13 +5,20 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "lcd.h"
+#if CONFIG_IDF_TARGET_LINUX
+#include "i2c_mock.h"
+#endif
 
 static const char *TAG = "lcd_cgram";
 
 static void initialise(void);
 static void lcd_demo(void);
+static void lcd_big_counter(void);
 
 lcd_handle_t lcd_handle = LCD_HANDLE_DEFAULT_CONFIG();
+static lcd_glyph_pack_t *glyph_pack;
+static lcd_glyph_set_t pieces;
+static lcd_glyph_set_t rom_map;
 
 void app_main(void)
 {
@@ -46,6 +53,10 @@ static void initialise(void)
              i2c_config.sda_pullup_en, i2c_config.scl_pullup_en,
              i2c_config.master.clk_speed / 1000.0);
     ESP_ERROR_CHECK(i2c_param_config(I2C_MASTER_NUM, &i2c_config));
+#if CONFIG_IDF_TARGET_LINUX
+    // No display on a development machine: put a device on the mocked bus that acknowledges everything
+    ESP_ERROR_CHECK(i2c_mock_attach(I2C_MASTER_NUM, LCD_ADDR, NULL));
+#endif
 
     // Modify default lcd_handle details
     lcd_handle.i2c_port = I2C_MASTER_NUM;
@@ -57,23 +68,38 @@ static void initialise(void)
     // Initialise LCD
     ESP_ERROR_CHECK(lcd_init(&lcd_handle));
 
-    uint8_t pieces[8][8] = {
-        {0x07, 0x0F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},
-        {0x1F, 0x1F, 0x1F, 0x00, 0x00, 0x00, 0x00, 0x00},
-        {0x1C, 0x1E, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},
-        {0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x0F, 0x07},
-        {0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F},
-        {0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1E, 0x1C},
-        {0x1F, 0x1F, 0x1F, 0x00, 0x00, 0x00, 0x1F, 0x1F},
-        {0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},
-    };
-
-    for (uint8_t i = 0; i < 8; ++i)
-        lcd_write_cgram(&lcd_handle, i, &pieces[i][0]);
+    // The glyphs are read from the "glyphs" partition, written from glyphs.json at build time
+    if (lcd_glyph_pack_open("glyphs", &glyph_pack) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "No glyph pack, flash it with idf.py flash");
+        return;
+    }
+    ESP_ERROR_CHECK(lcd_glyph_pack_find(glyph_pack, "pieces", &pieces));
+    ESP_ERROR_CHECK(lcd_glyph_pack_find(glyph_pack, "a00", &rom_map));
+    ESP_ERROR_CHECK(lcd_glyph_set_load(&lcd_handle, &pieces, 0));
 
     return;
 }
 
+/**
+ * @brief Count up in big digits, as many as fit across the display
+ */
+static void lcd_big_counter(void)
+{
+    uint8_t digits = lcd_handle.columns / (pieces.width + 1);
+    char number[8];
+
+    if (digits > sizeof(number) - 1)
+        digits = sizeof(number) - 1;
+    for (int count = 0; count <= 20; ++count)
+    {
+        snprintf(number, sizeof(number), "%*d", digits, count);
+        for (uint8_t i = 0; i < digits; ++i)
+            lcd_glyph_set_write_big(&lcd_handle, &pieces, number[i], i * (pieces.width + 1), 0);
+        vTaskDelay(pdMS_TO_TICKS(250));
+    }
+}
+
 /**
  * @brief Demonstrate the LCD
  */
@@ -101,6 +127,16 @@ static void lcd_demo(void)
 
     vTaskDelay(pdMS_TO_TICKS(1000));
 
+    if (glyph_pack)
+    {
+        ESP_LOGI(TAG, "Big digits and Latin-1 text from the glyph pack");
+        lcd_clear_screen(&lcd_handle);
+        lcd_big_counter();
+        lcd_clear_screen(&lcd_handle);
+        lcd_glyph_set_write_str(&lcd_handle, &rom_map, "25°C Grüße");
+        vTaskDelay(pdMS_TO_TICKS(1000));
+    }
+
     lcd_no_backlight(&lcd_handle);
     ESP_LOGI(TAG, "LCD Demo finished");
 }
@@ -5,6 +5,9 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "lcd.h"
+#if CONFIG_IDF_TARGET_LINUX
+#include "i2c_mock.h"
+#endif
 
 static const char *TAG = "lcd_example";
 
@@ -46,6 +49,10 @@ static void initialise(void)
              i2c_config.sda_pullup_en, i2c_config.scl_pullup_en,
              i2c_config.master.clk_speed / 1000.0);
     ESP_ERROR_CHECK(i2c_param_config(I2C_MASTER_NUM, &i2c_config));
+#if CONFIG_IDF_TARGET_LINUX
+    // No display on a development machine: put a device on the mocked bus that acknowledges everything
+    ESP_ERROR_CHECK(i2c_mock_attach(I2C_MASTER_NUM, LCD_ADDR, NULL));
+#endif
 
     // Modify default lcd_handle details
     lcd_handle.i2c_port = I2C_MASTER_NUM;
@@ -7,9 +7,14 @@
    CONDITIONS OF ANY KIND, either express or implied.
 */
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "argtable3/argtable3.h"
 #include "esp_console.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "lcd.h"
 
 // I2C Tools defines
@@ -23,9 +28,14 @@
 #define NACK_VAL 0x1                /*!< I2C nack value */
 // end I2C Tools defines
 
+#define LCD_BENCH_DEFAULT_DURATION_MS 2000 /*!< Run time of each workload unless given */
+#define LCD_BENCH_MAX_SAMPLES 2048         /*!< Call latencies kept for the percentiles */
+#define LCD_BENCH_MAX_COLUMNS 40           /*!< Longest DDRAM line of an HD44780 */
+
 static const char *TAG = "cmd_lcd_tools";
 
 static lcd_handle_t lcd_handle = LCD_HANDLE_DEFAULT_CONFIG();
+static uint32_t i2c_frequency = I2C_MASTER_FREQ_HZ;
 
 static esp_err_t lcd_set_port(int port, lcd_handle_t *handle)
 {
@@ -46,7 +56,7 @@ static esp_err_t i2c_master_driver_initialize(void)
         .sda_pullup_en = GPIO_PULLUP_ENABLE,
         .scl_io_num = I2C_MASTER_SCL_IO,
         .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = I2C_MASTER_FREQ_HZ,
+        .master.clk_speed = i2c_frequency,
         // .clk_flags = 0,          /*!< Optional, you can use I2C_SCLK_SRC_FLAG_* flags to choose i2c source clock here. */
     };
     return i2c_param_config(lcd_handle.i2c_port, &conf);
@@ -58,6 +68,7 @@ static struct
     struct arg_int *address;
     struct arg_int *columns;
     struct arg_int *rows;
+    struct arg_int *frequency;
     struct arg_end *end;
 } lcd_config_args;
 
@@ -84,6 +95,18 @@ static int do_lcd_config_cmd(int argc, char **argv)
     lcd_handle.columns = lcd_config_args.columns->ival[0];
     /* Check "rows" option */
     lcd_handle.rows = lcd_config_args.rows->ival[0];
+    /* Check "--freq" option */
+    if (lcd_config_args.frequency->count)
+    {
+        i2c_frequency = lcd_config_args.frequency->ival[0];
+        // Takes effect at once if the driver is already installed
+        if (i2c_master_driver_initialize() != ESP_OK)
+        {
+            printf("Unable to set the I2C clock frequency.\n");
+            fflush(stdout);
+            return 1;
+        }
+    }
     return 0;
 }
 
@@ -93,6 +116,7 @@ static void register_lcd_config(void)
     lcd_config_args.address = arg_int1(NULL, "address", "<0xaddr>", "Set the address of the LCD on the I2C bus");
     lcd_config_args.columns = arg_int1(NULL, "columns", "<columns>", "Set the number of columns of the LCD");
     lcd_config_args.rows = arg_int1(NULL, "rows", "<rows>", "Set the number of rows of the LCD");
+    lcd_config_args.frequency = arg_int0(NULL, "freq", "<Hz>", "Set the I2C clock frequency");
     lcd_config_args.end = arg_end(2);
     const esp_console_cmd_t lcd_config_cmd = {
         .command = "lcd_config",
@@ -704,6 +728,451 @@ static void register_lcd_write_str(void)
     ESP_ERROR_CHECK(esp_console_cmd_register(&lcd_write_str_cmd));
 }
 
+static struct
+{
+    struct arg_lit *clear;
+    struct arg_lit *pause;
+    struct arg_lit *resume;
+    struct arg_end *end;
+} lcd_trace_args;
+
+static int do_lcd_trace_cmd(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&lcd_trace_args);
+    if (nerrors != 0)
+    {
+        arg_print_errors(stderr, lcd_trace_args.end, argv[0]);
+        return 0;
+    }
+
+    if (lcd_trace_args.pause->count)
+    {
+        lcd_trace_pause(true);
+        return 0;
+    }
+    if (lcd_trace_args.resume->count)
+    {
+        lcd_trace_pause(false);
+        return 0;
+    }
+    if (lcd_trace_args.clear->count)
+    {
+        lcd_trace_clear();
+        return 0;
+    }
+    if (lcd_trace_dump(stdout) != ESP_OK)
+    {
+        printf("Trace not available. Enable it with menuconfig.\n");
+        fflush(stdout);
+        return 1;
+    }
+    fflush(stdout);
+    return 0;
+}
+
+static void register_lcd_trace(void)
+{
+    lcd_trace_args.clear = arg_lit0(NULL, "clear", "Discard the recorded bytes");
+    lcd_trace_args.pause = arg_lit0(NULL, "pause", "Stop recording");
+    lcd_trace_args.resume = arg_lit0(NULL, "resume", "Restart recording");
+    lcd_trace_args.end = arg_end(2);
+    const esp_console_cmd_t lcd_trace_cmd = {
+        .command = "lcd_trace",
+        .help = "Dump the wire trace of expander bytes as CSV",
+        .hint = NULL,
+        .func = &do_lcd_trace_cmd,
+        .argtable = &lcd_trace_args};
+    ESP_ERROR_CHECK(esp_console_cmd_register(&lcd_trace_cmd));
+}
+
+typedef struct
+{
+    uint32_t frames;                              /*!< Workload iterations completed */
+    uint32_t chars;                               /*!< Characters written to DDRAM or CGRAM */
+    uint32_t calls;                               /*!< Driver calls timed */
+    uint32_t samples[LCD_BENCH_MAX_SAMPLES];      /*!< Latencies of a uniform sample of the calls, in us */
+    uint64_t busy_us;                             /*!< Time spent inside the driver */
+} lcd_bench_t;
+
+typedef struct
+{
+    const char *name;
+    void (*setup)(void);                          /*!< Untimed preparation, may be NULL */
+    esp_err_t (*frame)(lcd_bench_t *bench, uint32_t frame);
+} lcd_bench_workload_t;
+
+static lcd_bench_t lcd_bench;
+
+/**
+ * @brief Account for a driver call that started at start_us
+ *
+ * @details Keeps a reservoir sample of the latencies so that percentiles of
+ *          long runs cost no more memory than short ones.
+ */
+static esp_err_t lcd_bench_end_call(lcd_bench_t *bench, int64_t start_us, esp_err_t ret)
+{
+    uint32_t latency_us = esp_timer_get_time() - start_us;
+
+    bench->busy_us += latency_us;
+    if (bench->calls < LCD_BENCH_MAX_SAMPLES)
+        bench->samples[bench->calls] = latency_us;
+    else
+    {
+        uint32_t slot = (uint32_t)rand() % (bench->calls + 1);
+        if (slot < LCD_BENCH_MAX_SAMPLES)
+            bench->samples[slot] = latency_us;
+    }
+    bench->calls++;
+    return ret;
+}
+
+/**
+ * @brief Write every row of the display from the home position
+ */
+static void lcd_bench_fill_rows(char first)
+{
+    char line[LCD_BENCH_MAX_COLUMNS + 1];
+    uint8_t columns = lcd_handle.columns < LCD_BENCH_MAX_COLUMNS ? lcd_handle.columns : LCD_BENCH_MAX_COLUMNS;
+
+    for (uint8_t row = 0; row < lcd_handle.rows; ++row)
+    {
+        for (uint8_t col = 0; col < columns; ++col)
+            line[col] = first + (row + col) % 26;
+        line[columns] = '\0';
+        lcd_set_cursor(&lcd_handle, 0, row);
+        lcd_write_str(&lcd_handle, line);
+    }
+}
+
+/**
+ * @brief Rewrite the whole screen, one string per row
+ */
+static esp_err_t lcd_bench_fill_frame(lcd_bench_t *bench, uint32_t frame)
+{
+    char line[LCD_BENCH_MAX_COLUMNS + 1];
+    uint8_t columns = lcd_handle.columns < LCD_BENCH_MAX_COLUMNS ? lcd_handle.columns : LCD_BENCH_MAX_COLUMNS;
+    esp_err_t ret;
+    int64_t start_us;
+
+    for (uint8_t row = 0; row < lcd_handle.rows; ++row)
+    {
+        for (uint8_t col = 0; col < columns; ++col)
+            line[col] = 'A' + (frame + row + col) % 26;
+        line[columns] = '\0';
+        start_us = esp_timer_get_time();
+        ret = lcd_bench_end_call(bench, start_us, lcd_set_cursor(&lcd_handle, 0, row));
+        if (ret != ESP_OK)
+            return ret;
+        start_us = esp_timer_get_time();
+        ret = lcd_bench_end_call(bench, start_us, lcd_write_str(&lcd_handle, line));
+        if (ret != ESP_OK)
+            return ret;
+        bench->chars += columns;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Update as many randomly chosen cells as the screen has, one character each
+ */
+static esp_err_t lcd_bench_random_frame(lcd_bench_t *bench, uint32_t frame)
+{
+    uint32_t cells = lcd_handle.columns * lcd_handle.rows;
+    esp_err_t ret;
+    int64_t start_us;
+
+    for (uint32_t i = 0; i < cells; ++i)
+    {
+        uint8_t col = (uint32_t)rand() % lcd_handle.columns;
+        uint8_t row = (uint32_t)rand() % lcd_handle.rows;
+        char c = ' ' + (uint32_t)rand() % ('~' - ' ' + 1);
+
+        start_us = esp_timer_get_time();
+        ret = lcd_bench_end_call(bench, start_us, lcd_set_cursor(&lcd_handle, col, row));
+        if (ret != ESP_OK)
+            return ret;
+        start_us = esp_timer_get_time();
+        ret = lcd_bench_end_call(bench, start_us, lcd_write_char(&lcd_handle, c));
+        if (ret != ESP_OK)
+            return ret;
+        bench->chars++;
+    }
+    return ESP_OK;
+}
+
+static void lcd_bench_scroll_setup(void)
+{
+    lcd_bench_fill_rows('a');
+}
+
+/**
+ * @brief Shift the whole display one column left, as a marquee does
+ */
+static esp_err_t lcd_bench_scroll_frame(lcd_bench_t *bench, uint32_t frame)
+{
+    int64_t start_us = esp_timer_get_time();
+
+    return lcd_bench_end_call(bench, start_us, lcd_display_shift_left(&lcd_handle));
+}
+
+static void lcd_bench_cgram_setup(void)
+{
+    // Codes 8 to 15 show CGRAM locations 0 to 7, without writing a NUL
+    lcd_set_cursor(&lcd_handle, 0, 0);
+    for (char c = 8; c < 16; ++c)
+        lcd_write_char(&lcd_handle, c);
+}
+
+/**
+ * @brief Redefine all eight custom characters as bars of rising height
+ */
+static esp_err_t lcd_bench_cgram_frame(lcd_bench_t *bench, uint32_t frame)
+{
+    uint8_t charmap[8];
+    esp_err_t ret;
+    int64_t start_us;
+
+    for (uint8_t location = 0; location < 8; ++location)
+    {
+        uint8_t height = (frame + location) % 9;
+
+        for (uint8_t i = 0; i < sizeof(charmap); ++i)
+            charmap[i] = (8 - i <= height) ? 0x1F : 0x00;
+        start_us = esp_timer_get_time();
+        ret = lcd_bench_end_call(bench, start_us, lcd_write_cgram(&lcd_handle, location, charmap));
+        if (ret != ESP_OK)
+            return ret;
+        bench->chars += sizeof(charmap);
+    }
+    return ESP_OK;
+}
+
+static const lcd_bench_workload_t lcd_bench_workloads[] = {
+    {"fill", NULL, lcd_bench_fill_frame},
+    {"random", NULL, lcd_bench_random_frame},
+    {"scroll", lcd_bench_scroll_setup, lcd_bench_scroll_frame},
+    {"cgram", lcd_bench_cgram_setup, lcd_bench_cgram_frame},
+};
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+
+#ifdef configRUN_TIME_COUNTER_TYPE
+typedef configRUN_TIME_COUNTER_TYPE lcd_bench_run_time_t;
+#else
+typedef uint32_t lcd_bench_run_time_t;
+#endif
+
+/**
+ * @brief Run time of the idle tasks, the run time counter and the number of cores
+ */
+static bool lcd_bench_idle_time(lcd_bench_run_time_t *idle, lcd_bench_run_time_t *total, uint32_t *cores)
+{
+    UBaseType_t count = uxTaskGetNumberOfTasks() + 4;
+    TaskStatus_t *tasks = malloc(count * sizeof(TaskStatus_t));
+
+    if (!tasks)
+        return false;
+    count = uxTaskGetSystemState(tasks, count, total);
+    *idle = 0;
+    *cores = 0;
+    for (UBaseType_t i = 0; i < count; ++i)
+    {
+        if (strncmp(tasks[i].pcTaskName, "IDLE", 4) == 0)
+        {
+            *idle += tasks[i].ulRunTimeCounter;
+            (*cores)++;
+        }
+    }
+    free(tasks);
+    return count && *cores;
+}
+
+#endif // CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+
+static int lcd_bench_compare(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Run one workload for duration_ms and print a row of results
+ */
+static esp_err_t lcd_bench_run(const lcd_bench_workload_t *workload, uint32_t duration_ms, bool refresh)
+{
+    lcd_bench_t *bench = &lcd_bench;
+    lcd_stats_t stats;
+    bool have_stats;
+    esp_err_t ret = ESP_OK;
+    int64_t start_us, elapsed_us;
+    uint32_t samples;
+    char i2c_rate[12] = "n/a";
+    char cpu[8] = "n/a";
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    lcd_bench_run_time_t idle_start = 0, idle_end = 0, total_start = 0, total_end = 0;
+    uint32_t cores = 0;
+    bool have_cpu;
+#endif
+
+    if (refresh)
+    {
+        lcd_refresh_config_t config = LCD_REFRESH_DEFAULT_CONFIG();
+        ret = lcd_refresh_enable(&lcd_handle, &config);
+        if (ret != ESP_OK)
+            return ret;
+    }
+    else
+    {
+        ret = lcd_clear_screen(&lcd_handle);
+        if (ret != ESP_OK)
+            return ret;
+    }
+    if (workload->setup)
+        workload->setup();
+    if (refresh)
+        lcd_refresh_flush(&lcd_handle);
+    memset(bench, 0, sizeof(lcd_bench_t));
+
+    have_stats = lcd_get_stats(&lcd_handle, &stats, true) == ESP_OK;
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    have_cpu = lcd_bench_idle_time(&idle_start, &total_start, &cores);
+#endif
+    start_us = esp_timer_get_time();
+    do
+    {
+        ret = workload->frame(bench, bench->frames);
+        if (ret != ESP_OK)
+            break;
+        bench->frames++;
+    } while (esp_timer_get_time() - start_us < (int64_t)duration_ms * 1000);
+    // Buffered writes only count once they are on the display
+    if (refresh && ret == ESP_OK)
+        ret = lcd_refresh_flush(&lcd_handle);
+    elapsed_us = esp_timer_get_time() - start_us;
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    have_cpu = have_cpu && lcd_bench_idle_time(&idle_end, &total_end, &cores);
+    if (have_cpu && total_end != total_start)
+    {
+        uint64_t idle = (lcd_bench_run_time_t)(idle_end - idle_start);
+        uint64_t total = (uint64_t)(lcd_bench_run_time_t)(total_end - total_start) * cores;
+        snprintf(cpu, sizeof(cpu), "%.1f", idle < total ? 100.0 * (total - idle) / total : 0.0);
+    }
+#endif
+    if (have_stats && lcd_get_stats(&lcd_handle, &stats, false) == ESP_OK)
+        snprintf(i2c_rate, sizeof(i2c_rate), "%.0f", stats.i2c_transactions * 1e6 / elapsed_us);
+
+    if (workload->frame == lcd_bench_scroll_frame)
+        lcd_home(&lcd_handle);
+    if (refresh)
+        lcd_refresh_disable(&lcd_handle);
+    if (ret != ESP_OK)
+        return ret;
+
+    samples = bench->calls < LCD_BENCH_MAX_SAMPLES ? bench->calls : LCD_BENCH_MAX_SAMPLES;
+    qsort(bench->samples, samples, sizeof(uint32_t), lcd_bench_compare);
+    printf("%-8s %7u %9.1f %9.1f %8.1f %7u %7u %8s %6s %6.1f\n",
+           workload->name, (unsigned)bench->frames,
+           bench->frames * 1e6 / elapsed_us, bench->chars * 1e6 / elapsed_us, bench->calls * 1e6 / elapsed_us,
+           samples ? (unsigned)bench->samples[samples / 2] : 0,
+           samples ? (unsigned)bench->samples[(samples * 99) / 100] : 0,
+           i2c_rate, cpu, 100.0 * bench->busy_us / elapsed_us);
+    fflush(stdout);
+    return ESP_OK;
+}
+
+static struct
+{
+    struct arg_str *workload;
+    struct arg_int *duration;
+    struct arg_lit *refresh;
+    struct arg_end *end;
+} lcd_bench_args;
+
+static int do_lcd_bench_cmd(int argc, char **argv)
+{
+    const char *name = "all";
+    uint32_t duration_ms = LCD_BENCH_DEFAULT_DURATION_MS;
+    bool refresh = false;
+    bool found = false;
+
+    int nerrors = arg_parse(argc, argv, (void **)&lcd_bench_args);
+    if (nerrors != 0)
+    {
+        arg_print_errors(stderr, lcd_bench_args.end, argv[0]);
+        return 0;
+    }
+
+    /* Check "--workload" option */
+    if (lcd_bench_args.workload->count)
+        name = lcd_bench_args.workload->sval[0];
+    /* Check "--duration" option */
+    if (lcd_bench_args.duration->count)
+    {
+        if (lcd_bench_args.duration->ival[0] <= 0)
+        {
+            printf("Duration must be positive\n");
+            fflush(stdout);
+            return 1;
+        }
+        duration_ms = lcd_bench_args.duration->ival[0];
+    }
+    /* Check "--refresh" option */
+    refresh = lcd_bench_args.refresh->count;
+
+    if (!lcd_handle.initialized || !lcd_handle.columns || !lcd_handle.rows)
+    {
+        printf("LCD not initialised. Run lcd_init first.\n");
+        fflush(stdout);
+        return 1;
+    }
+
+    printf("%ux%u LCD at 0x%02x, I2C %u Hz, %s, %u ms per workload\n",
+           lcd_handle.columns, lcd_handle.rows, lcd_handle.address, (unsigned)i2c_frequency,
+           refresh ? "refresh scheduler" : "direct writes", (unsigned)duration_ms);
+    printf("%-8s %7s %9s %9s %8s %7s %7s %8s %6s %6s\n",
+           "workload", "frames", "frames/s", "chars/s", "calls/s", "p50 us", "p99 us", "i2c/s", "cpu %", "drv %");
+    srand(1);
+    for (size_t i = 0; i < sizeof(lcd_bench_workloads) / sizeof(lcd_bench_workloads[0]); ++i)
+    {
+        const lcd_bench_workload_t *workload = &lcd_bench_workloads[i];
+
+        if (strcmp(name, "all") != 0 && strcmp(name, workload->name) != 0)
+            continue;
+        found = true;
+        esp_err_t ret = lcd_bench_run(workload, duration_ms, refresh);
+        if (ret != ESP_OK)
+        {
+            printf("Workload %s failed: %s\n", workload->name, esp_err_to_name(ret));
+            fflush(stdout);
+            return 1;
+        }
+    }
+    if (!found)
+    {
+        printf("Unknown workload: %s\n", name);
+        fflush(stdout);
+        return 1;
+    }
+    return 0;
+}
+
+static void register_lcd_bench(void)
+{
+    lcd_bench_args.workload = arg_str0("w", "workload", "<fill|random|scroll|cgram|all>", "Workload to run, all by default");
+    lcd_bench_args.duration = arg_int0("d", "duration", "<ms>", "Run time of each workload, 2000 ms by default");
+    lcd_bench_args.refresh = arg_lit0(NULL, "refresh", "Write through the refresh scheduler");
+    lcd_bench_args.end = arg_end(2);
+    const esp_console_cmd_t lcd_bench_cmd = {
+        .command = "lcd_bench",
+        .help = "Measure the throughput and call latency of standard workloads",
+        .hint = NULL,
+        .func = &do_lcd_bench_cmd,
+        .argtable = &lcd_bench_args};
+    ESP_ERROR_CHECK(esp_console_cmd_register(&lcd_bench_cmd));
+}
+
 void register_lcd_tools(void)
 {
     register_lcd_config();
@@ -729,4 +1198,6 @@ void register_lcd_tools(void)
     register_lcd_shift_r();
     register_lcd_l_to_r();
     register_lcd_r_to_l();
+    register_lcd_trace();
+    register_lcd_bench();
 }
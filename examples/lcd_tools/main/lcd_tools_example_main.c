@@ -93,6 +93,8 @@ void app_main(void)
     printf(" |  22. Try 'lcd_shift_r' to shift the display right.         |\n");
     printf(" |  23. Try 'lcd_l_to_r' set the text direction left to right.|\n");
     printf(" |  24. Try 'lcd_r_to_l' set the text direction right to left.|\n");
+    printf(" |  25. Try 'lcd_trace' to dump the bytes sent to the LCD.    |\n");
+    printf(" |  26. Try 'lcd_bench' to measure the LCD throughput.        |\n");
     printf(" |                                                            |\n");
     printf(" ==============================================================\n\n");
 
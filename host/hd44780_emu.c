@@ -0,0 +1,335 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hd44780_emu.h"
+
+// Expander pins
+#define PIN_RS 0x01
+#define PIN_RW 0x02
+#define PIN_E 0x04
+#define PIN_DATA 0xF0
+
+// Datasheet timing (HD44780U, VCC = 4.5 to 5.5 V)
+#define T_PW_EH_NS 450   /*!< Enable pulse width, high level */
+#define T_CYC_E_NS 1000  /*!< Enable cycle time */
+#define EXEC_US 37       /*!< Most instructions and RAM writes at 270 kHz */
+#define EXEC_HOME_US 1520 /*!< Clear Display and Return Home at 270 kHz */
+#define INIT_FIRST_US 4100 /*!< Wait after the first Function Set of the reset sequence */
+#define INIT_SECOND_US 100 /*!< Wait after the second */
+
+static const char *violation_names[HD44780_EMU_VIOLATION_TYPES] = {
+    [HD44780_EMU_BUSY] = "busy",
+    [HD44780_EMU_SETUP] = "setup",
+    [HD44780_EMU_HOLD] = "hold",
+    [HD44780_EMU_PULSE] = "pulse",
+    [HD44780_EMU_CYCLE] = "cycle",
+};
+
+static void violation(hd44780_emu_t *emu, hd44780_emu_violation_t type, uint64_t time_ns, const char *fmt, ...)
+{
+    char text[64];
+    va_list args;
+
+    va_start(args, fmt);
+    vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+
+    emu->violations[type]++;
+    if (emu->message_count < HD44780_EMU_MAX_VIOLATIONS)
+    {
+        snprintf(emu->messages[emu->message_count++], sizeof(emu->messages[0]),
+                 "%llu ns: %s: %s", (unsigned long long)time_ns, violation_names[type], text);
+    }
+    if (emu->strict)
+    {
+        fprintf(stderr, "hd44780_emu: %llu ns: %s violation: %s\n",
+                (unsigned long long)time_ns, violation_names[type], text);
+        abort();
+    }
+}
+
+static uint64_t exec_ns(const hd44780_emu_t *emu, uint32_t us)
+{
+    return (uint64_t)us * 1000 * 270 / emu->fosc_khz;
+}
+
+static size_t line_length(const hd44780_emu_t *emu)
+{
+    return emu->two_line ? 40 : 80;
+}
+
+/**
+ * @brief DDRAM cell the address counter points at
+ */
+static size_t ddram_index(const hd44780_emu_t *emu, uint8_t ac)
+{
+    if (!emu->two_line)
+        return ac % 80;
+    // 0x28-0x3F and 0x68-0x7F do not exist in 2-line mode
+    return ((ac & 0x40) ? 40 : 0) + (ac & 0x3F) % 40;
+}
+
+static void move_ac(hd44780_emu_t *emu, bool increment)
+{
+    if (emu->ac_cgram)
+        emu->ac = (emu->ac + (increment ? 1 : -1)) & 0x3F;
+    else if (!emu->two_line)
+        emu->ac = increment ? (emu->ac + 1) % 80 : (emu->ac + 79) % 80;
+    else if (increment)
+        emu->ac = emu->ac == 0x27 ? 0x40 : emu->ac == 0x67 ? 0x00 : emu->ac + 1;
+    else
+        emu->ac = emu->ac == 0x00 ? 0x67 : emu->ac == 0x40 ? 0x27 : emu->ac - 1;
+}
+
+static void shift_display(hd44780_emu_t *emu, bool left)
+{
+    size_t len = line_length(emu);
+
+    emu->shift = (emu->shift + (left ? 1 : len - 1)) % len;
+}
+
+static uint8_t ram_read(const hd44780_emu_t *emu)
+{
+    if (emu->ac_cgram)
+        return emu->cgram[emu->ac & 0x3F];
+    return emu->ddram[ddram_index(emu, emu->ac)];
+}
+
+/**
+ * @brief Carry out an instruction or RAM write and set the busy time
+ */
+static void execute(hd44780_emu_t *emu, uint8_t value, bool data, uint64_t time_ns)
+{
+    uint32_t us = EXEC_US;
+
+    if (data)
+    {
+        if (emu->ac_cgram)
+            emu->cgram[emu->ac & 0x3F] = value;
+        else
+            emu->ddram[ddram_index(emu, emu->ac)] = value;
+        move_ac(emu, emu->increment);
+        if (emu->entry_shift && !emu->ac_cgram)
+            shift_display(emu, emu->increment);
+        emu->data_writes++;
+    }
+    else if (value & 0x80) // Set DDRAM Address
+    {
+        emu->ac = value & 0x7F;
+        emu->ac_cgram = false;
+    }
+    else if (value & 0x40) // Set CGRAM Address
+    {
+        emu->ac = value & 0x3F;
+        emu->ac_cgram = true;
+    }
+    else if (value & 0x20) // Function Set
+    {
+        bool eight_bit = value & 0x10;
+
+        // The reset sequence waits are longer than the normal execution time
+        if (emu->eight_bit)
+        {
+            if (emu->init_step == 0)
+                us = INIT_FIRST_US;
+            else if (emu->init_step == 1)
+                us = INIT_SECOND_US;
+            emu->init_step++;
+        }
+        if (eight_bit != emu->eight_bit)
+            emu->half = false;
+        emu->eight_bit = eight_bit;
+        emu->two_line = value & 0x08;
+        emu->font_5x10 = value & 0x04;
+        emu->shift %= line_length(emu);
+    }
+    else if (value & 0x10) // Cursor or Display Shift
+    {
+        if (value & 0x08)
+            shift_display(emu, !(value & 0x04));
+        else
+            move_ac(emu, value & 0x04);
+    }
+    else if (value & 0x08) // Display On/Off Control
+    {
+        emu->display_on = value & 0x04;
+        emu->cursor_on = value & 0x02;
+        emu->blink_on = value & 0x01;
+    }
+    else if (value & 0x04) // Entry Mode Set
+    {
+        emu->increment = value & 0x02;
+        emu->entry_shift = value & 0x01;
+    }
+    else if (value & 0x02) // Return Home
+    {
+        emu->ac = 0;
+        emu->ac_cgram = false;
+        emu->shift = 0;
+        us = EXEC_HOME_US;
+    }
+    else if (value & 0x01) // Clear Display
+    {
+        memset(emu->ddram, ' ', sizeof(emu->ddram));
+        emu->ac = 0;
+        emu->ac_cgram = false;
+        emu->shift = 0;
+        emu->increment = true;
+        us = EXEC_HOME_US;
+    }
+    if (!data)
+        emu->instructions++;
+    emu->busy_until_ns = time_ns + exec_ns(emu, us);
+}
+
+/**
+ * @brief The controller latches D4-D7 on the falling edge of E
+ *
+ * @param[in] pins Expander pins while E was high
+ */
+static void latch(hd44780_emu_t *emu, uint8_t pins, uint64_t time_ns)
+{
+    uint8_t nibble = pins >> 4;
+    bool rs = pins & PIN_RS;
+
+    if (pins & PIN_RW)
+    {
+        // End of a read. Data reads move the address counter once per byte.
+        if (!emu->eight_bit && !emu->half)
+        {
+            emu->half = true;
+            return;
+        }
+        emu->half = false;
+        if (rs)
+            move_ac(emu, emu->increment);
+        return;
+    }
+
+    if (time_ns < emu->busy_until_ns)
+    {
+        violation(emu, HD44780_EMU_BUSY, time_ns, "%s nibble 0x%x %llu ns early",
+                  rs ? "data" : "instruction", nibble,
+                  (unsigned long long)(emu->busy_until_ns - time_ns));
+    }
+
+    if (emu->eight_bit)
+    {
+        // D0-D3 are not connected and read as low
+        execute(emu, nibble << 4, rs, time_ns);
+    }
+    else if (!emu->half)
+    {
+        emu->high = nibble;
+        emu->half = true;
+    }
+    else
+    {
+        emu->half = false;
+        execute(emu, (emu->high << 4) | nibble, rs, time_ns);
+    }
+}
+
+void hd44780_emu_init(hd44780_emu_t *emu, uint8_t columns, uint8_t rows)
+{
+    memset(emu, 0, sizeof(*emu));
+    emu->columns = columns;
+    emu->rows = rows;
+    emu->fosc_khz = 270;
+    emu->eight_bit = true;
+    emu->increment = true;
+    memset(emu->ddram, ' ', sizeof(emu->ddram));
+}
+
+int hd44780_emu_write(hd44780_emu_t *emu, uint8_t pins, uint64_t time_ns)
+{
+    uint8_t prev = emu->latch;
+    uint32_t before = hd44780_emu_violation_count(emu);
+    bool e_was = prev & PIN_E;
+    bool e_is = pins & PIN_E;
+
+    emu->latch = pins;
+    emu->last_ns = time_ns;
+    emu->writes++;
+
+    if (!e_was && e_is)
+    {
+        if ((prev ^ pins) & (PIN_RS | PIN_RW))
+            violation(emu, HD44780_EMU_SETUP, time_ns, "RS/RW changed with E rising, 0x%02x -> 0x%02x", prev, pins);
+        if (emu->e_rise_ns && time_ns - emu->e_rise_ns < T_CYC_E_NS)
+            violation(emu, HD44780_EMU_CYCLE, time_ns, "E cycle %llu ns",
+                      (unsigned long long)(time_ns - emu->e_rise_ns));
+        emu->e_rise_ns = time_ns;
+    }
+    else if (e_was)
+    {
+        if ((prev ^ pins) & (PIN_RS | PIN_RW | PIN_DATA))
+            violation(emu, HD44780_EMU_HOLD, time_ns, "lines changed with E high, 0x%02x -> 0x%02x", prev, pins);
+        if (!e_is)
+        {
+            if (time_ns - emu->e_rise_ns < T_PW_EH_NS)
+                violation(emu, HD44780_EMU_PULSE, time_ns, "E high for %llu ns",
+                          (unsigned long long)(time_ns - emu->e_rise_ns));
+            latch(emu, prev, time_ns);
+        }
+    }
+    return hd44780_emu_violation_count(emu) - before;
+}
+
+uint8_t hd44780_emu_read(hd44780_emu_t *emu, uint64_t time_ns)
+{
+    uint8_t value;
+    uint8_t nibble;
+
+    emu->reads++;
+    if ((emu->latch & (PIN_RW | PIN_E)) != (PIN_RW | PIN_E))
+        return emu->latch;
+
+    if (emu->latch & PIN_RS)
+        value = ram_read(emu);
+    else
+        value = (time_ns < emu->busy_until_ns ? 0x80 : 0x00) | (emu->ac & 0x7F);
+    nibble = (emu->eight_bit || !emu->half) ? value >> 4 : value & 0x0F;
+    // Quasi-bidirectional pins: the controller can only pull a high pin low
+    return emu->latch & ((nibble << 4) | 0x0F);
+}
+
+uint8_t hd44780_emu_char_at(const hd44780_emu_t *emu, uint8_t column, uint8_t row)
+{
+    size_t len = line_length(emu);
+
+    if (emu->two_line)
+    {
+        // Rows 2 and 3 of 4-row glass continue rows 0 and 1 of the controller
+        size_t pos = (column + (row / 2) * emu->columns + emu->shift) % len;
+        return emu->ddram[(row % 2) * 40 + pos];
+    }
+    return emu->ddram[(row * emu->columns + column + emu->shift) % len];
+}
+
+void hd44780_emu_render(const hd44780_emu_t *emu, char *out)
+{
+    for (uint8_t row = 0; row < emu->rows; ++row)
+    {
+        for (uint8_t col = 0; col < emu->columns; ++col)
+        {
+            uint8_t c = hd44780_emu_char_at(emu, col, row);
+
+            if (!emu->display_on)
+                c = ' ';
+            *out++ = (c >= 0x20 && c < 0x7F) ? c : '?';
+        }
+        *out++ = '\n';
+    }
+    *out = '\0';
+}
+
+uint32_t hd44780_emu_violation_count(const hd44780_emu_t *emu)
+{
+    uint32_t total = 0;
+
+    for (int i = 0; i < HD44780_EMU_VIOLATION_TYPES; ++i)
+        total += emu->violations[i];
+    return total;
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Emulation of a PCF8574 I2C expander driving an HD44780 controller in the
+// wiring the driver assumes: P0 = RS, P1 = RW, P2 = E, P3 = backlight,
+// P4-P7 = D4-D7. It consumes the expander bytes exactly as they appear on
+// the wire, with the time each one took effect, and checks them against the
+// HD44780U datasheet timing.
+
+#define HD44780_EMU_DDRAM_SIZE 80 /*!< Bytes of display data RAM */
+#define HD44780_EMU_CGRAM_SIZE 64 /*!< Bytes of character generator RAM */
+#define HD44780_EMU_MAX_VIOLATIONS 16 /*!< Violation messages kept */
+
+/**
+ * @brief Kinds of protocol and timing violations detected
+ */
+typedef enum
+{
+    HD44780_EMU_BUSY,     /*!< Instruction or data latched while the controller was busy */
+    HD44780_EMU_SETUP,    /*!< RS or RW changed in the same write that raised E */
+    HD44780_EMU_HOLD,     /*!< RS, RW or D4-D7 changed while E was high, or as E fell */
+    HD44780_EMU_PULSE,    /*!< E high for less than 450 ns */
+    HD44780_EMU_CYCLE,    /*!< E rising edges less than 1000 ns apart */
+    HD44780_EMU_VIOLATION_TYPES,
+} hd44780_emu_violation_t;
+
+/**
+ * @brief State of the emulated expander and controller
+ *
+ * @details Fields are public so tests can inspect them, but are only
+ *          changed through the functions below.
+ */
+typedef struct
+{
+    // Configuration
+    uint8_t columns;         /*!< Visible columns of the glass */
+    uint8_t rows;            /*!< Visible rows of the glass */
+    uint32_t fosc_khz;       /*!< Controller oscillator, 270 kHz nominal. Execution times scale with it. */
+    bool strict;             /*!< abort() on the first violation */
+
+    // PCF8574
+    uint8_t latch;           /*!< Last byte written to the expander */
+    uint64_t last_ns;        /*!< Time of the last byte */
+
+    // HD44780 interface
+    bool eight_bit;          /*!< Interface data length. The controller powers up in 8-bit mode. */
+    bool half;               /*!< The first nibble of a 4-bit transfer has been taken */
+    uint8_t high;            /*!< That first nibble */
+    uint64_t e_rise_ns;      /*!< Time of the last rising edge of E */
+    int init_step;           /*!< Instructions taken since power-on while still in 8-bit mode */
+    uint64_t busy_until_ns;  /*!< Time the last instruction completes */
+
+    // HD44780 registers
+    uint8_t ddram[HD44780_EMU_DDRAM_SIZE];
+    uint8_t cgram[HD44780_EMU_CGRAM_SIZE];
+    uint8_t ac;              /*!< Address counter */
+    bool ac_cgram;           /*!< The address counter points into CGRAM */
+    bool increment;          /*!< Entry mode I/D */
+    bool entry_shift;        /*!< Entry mode S */
+    bool display_on;
+    bool cursor_on;
+    bool blink_on;
+    bool two_line;
+    bool font_5x10;
+    uint8_t shift;           /*!< Display shift, in positions to the left */
+
+    // Accounting
+    uint32_t writes;         /*!< Expander bytes written */
+    uint32_t reads;          /*!< Expander bytes read */
+    uint32_t instructions;   /*!< Instructions executed */
+    uint32_t data_writes;    /*!< Bytes written to DDRAM or CGRAM */
+    uint32_t violations[HD44780_EMU_VIOLATION_TYPES];
+    char messages[HD44780_EMU_MAX_VIOLATIONS][96]; /*!< First violations, described */
+    size_t message_count;
+} hd44780_emu_t;
+
+/**
+ * @brief Power the emulated display on
+ *
+ * @details The controller comes up as after its internal reset: 8-bit
+ *          interface, one line, display off, increment, DDRAM cleared to
+ *          spaces. CGRAM holds random data on real parts and is zeroed here.
+ *
+ * @param[out] emu Emulator state
+ * @param[in] columns Visible columns
+ * @param[in] rows Visible rows
+ */
+void hd44780_emu_init(hd44780_emu_t *emu, uint8_t columns, uint8_t rows);
+
+/**
+ * @brief An expander byte written at time_ns
+ *
+ * @return Number of violations it caused
+ */
+int hd44780_emu_write(hd44780_emu_t *emu, uint8_t pins, uint64_t time_ns);
+
+/**
+ * @brief An expander byte read at time_ns
+ *
+ * @details D4-D7 read back as the controller drives them while RW and E are
+ *          high: the busy flag and address counter with RS low, RAM data with
+ *          RS high. The other pins read back as latched. A data read moves
+ *          the address counter on the falling edge of E that ends it.
+ *
+ * @return The byte the expander returns
+ */
+uint8_t hd44780_emu_read(hd44780_emu_t *emu, uint64_t time_ns);
+
+/**
+ * @brief The character code shown at a position of the glass
+ */
+uint8_t hd44780_emu_char_at(const hd44780_emu_t *emu, uint8_t column, uint8_t row);
+
+/**
+ * @brief Render the glass as rows of text
+ *
+ * @details Codes outside printable ASCII, CGRAM glyphs among them, are shown
+ *          as '?'. Nothing is shown while the display is off.
+ *
+ * @param[out] out rows lines of columns characters, each ending in '\n', then a '\0'.
+ *                 Needs rows * (columns + 1) + 1 bytes.
+ */
+void hd44780_emu_render(const hd44780_emu_t *emu, char *out);
+
+/**
+ * @brief Total of all violation counters
+ */
+uint32_t hd44780_emu_violation_count(const hd44780_emu_t *emu);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,691 @@
+// Runs the driver against the mocked I2C bus with an emulated display on it
+// and reports, for a few representative workloads at each bus clock, the
+// transactions, the bytes on the wire and the time taken on the virtual
+// clock, settle times and execution waits included. Results go to stdout as
+// JSON; logs and failures go to stderr. cpu_pct is the share of that time
+// the CPU spent spinning in waits, from lcd_pacing_get_stats(); waits at or
+// above the yield threshold block on a timer, as on the target, and leave
+// the CPU free.
+//
+//     lcd_bench [-n iterations] [-o overhead_ns] [-b] [-m]
+//
+// -b adds the bus cost of backlight dimming at a few levels, on an idle
+// display and on one rewriting a line back to back, as read from
+// lcd_backlight_pwm_get_stats() over a second of virtual time.
+//
+// -m adds the aggregate throughput of 1, 2, 4 and 8 displays on one bus,
+// each rewritten in full every iteration through a display manager.
+//
+// The exit status is 1 if the emulator saw a timing violation or a display
+// did not end up showing what was written, 2 on usage errors.
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "driver/i2c.h"
+#include "esp_timer.h"
+#include "i2c_mock.h"
+#include "lcd.h"
+#include "hd44780_emu.h"
+
+#define BENCH_PORT I2C_NUM_0
+#define CGRAM_ALIAS 8 /*!< Codes 8-15 show CGRAM glyphs 0-7 and, unlike 0, fit in a C string */
+
+// Glyphs of the big digits, and each digit as 3 x 2 cells of them
+#define LT (CGRAM_ALIAS + 0)
+#define UB (CGRAM_ALIAS + 1)
+#define RT (CGRAM_ALIAS + 2)
+#define LL (CGRAM_ALIAS + 3)
+#define LB (CGRAM_ALIAS + 4)
+#define LR (CGRAM_ALIAS + 5)
+#define UMB (CGRAM_ALIAS + 6)
+#define LMB (CGRAM_ALIAS + 7)
+#define FB 0xFF /*!< Full block in the character ROM */
+
+static uint8_t big_glyphs[8][8] = {
+    {0x07, 0x0F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},
+    {0x1F, 0x1F, 0x1F, 0x00, 0x00, 0x00, 0x00, 0x00},
+    {0x1C, 0x1E, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},
+    {0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x0F, 0x07},
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F},
+    {0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1E, 0x1C},
+    {0x1F, 0x1F, 0x1F, 0x00, 0x00, 0x00, 0x1F, 0x1F},
+    {0x1F, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F},
+};
+
+static const uint8_t big_digits[10][2][3] = {
+    {{LT, UB, RT}, {LL, LB, LR}},
+    {{UB, RT, ' '}, {LB, FB, LB}},
+    {{UMB, UMB, RT}, {LL, LB, LB}},
+    {{UMB, UMB, RT}, {LB, LB, LR}},
+    {{LL, LB, FB}, {' ', ' ', FB}},
+    {{LL, UMB, UMB}, {LB, LB, LR}},
+    {{LT, UMB, UMB}, {LL, LB, LR}},
+    {{UB, UB, RT}, {' ', LT, ' '}},
+    {{LT, UMB, RT}, {LL, LB, LR}},
+    {{LT, UMB, RT}, {' ', ' ', FB}},
+};
+
+typedef struct
+{
+    lcd_handle_t handle;
+    hd44780_emu_t emu;
+    bool verified; /*!< Every check of the glass so far passed */
+    uint32_t clock_hz;
+    lcd_screen_t *menus[2];
+} bench_t;
+
+typedef struct
+{
+    const char *name;
+    esp_err_t (*setup)(bench_t *bench);
+    esp_err_t (*run)(bench_t *bench, int iteration);
+} workload_t;
+
+static esp_err_t bench_emu_write(void *ctx, uint8_t data, uint64_t time_ns)
+{
+    hd44780_emu_write(ctx, data, time_ns);
+    return ESP_OK;
+}
+
+static esp_err_t bench_emu_read(void *ctx, uint8_t *data, uint64_t time_ns)
+{
+    *data = hd44780_emu_read(ctx, time_ns);
+    return ESP_OK;
+}
+
+/**
+ * @brief Compare cells of the glass with what should be there
+ */
+static void check(bench_t *bench, uint8_t column, uint8_t row, const char *expected)
+{
+    for (size_t i = 0; expected[i]; ++i)
+    {
+        uint8_t code = hd44780_emu_char_at(&bench->emu, column + i, row);
+
+        if (code != (uint8_t)expected[i])
+        {
+            fprintf(stderr, "row %u column %zu shows 0x%02x, expected 0x%02x\n",
+                    row, column + i, code, (uint8_t)expected[i]);
+            bench->verified = false;
+            return;
+        }
+    }
+}
+
+static esp_err_t clear_setup(bench_t *bench)
+{
+    return lcd_clear_screen(&bench->handle);
+}
+
+static esp_err_t single_char_run(bench_t *bench, int iteration)
+{
+    char c = 'A' + iteration % 26;
+    uint8_t column = bench->handle.cursor_column;
+    uint8_t row = bench->handle.cursor_row;
+    esp_err_t ret = lcd_write_char(&bench->handle, c);
+
+    check(bench, column, row, (char[]){c, '\0'});
+    return ret;
+}
+
+static esp_err_t line_run(bench_t *bench, int iteration)
+{
+    char line[LCD_COLUMNS + 1];
+    uint8_t row = iteration % bench->handle.rows;
+    esp_err_t ret;
+
+    for (int i = 0; i < bench->handle.columns; ++i)
+        line[i] = 'a' + (iteration + i) % 26;
+    line[bench->handle.columns] = '\0';
+    if ((ret = lcd_set_cursor(&bench->handle, 0, row)) != ESP_OK ||
+        (ret = lcd_write_str(&bench->handle, line)) != ESP_OK)
+        return ret;
+    check(bench, 0, row, line);
+    return ESP_OK;
+}
+
+static esp_err_t screen_run(bench_t *bench, int iteration)
+{
+    char lines[4][LCD_COLUMNS + 1];
+    esp_err_t ret;
+
+    for (uint8_t row = 0; row < bench->handle.rows; ++row)
+    {
+        snprintf(lines[row], sizeof(lines[row]), "Frame %6u row %u  ", (unsigned)iteration % 1000000, (unsigned)row % 10);
+        lines[row][bench->handle.columns] = '\0';
+        if ((ret = lcd_set_cursor(&bench->handle, 0, row)) != ESP_OK ||
+            (ret = lcd_write_str(&bench->handle, lines[row])) != ESP_OK)
+            return ret;
+    }
+    for (uint8_t row = 0; row < bench->handle.rows; ++row)
+        check(bench, 0, row, lines[row]);
+    return ESP_OK;
+}
+
+static esp_err_t big_digit_setup(bench_t *bench)
+{
+    esp_err_t ret;
+
+    if ((ret = lcd_clear_screen(&bench->handle)) != ESP_OK)
+        return ret;
+    for (uint8_t i = 0; i < 8; ++i)
+    {
+        if ((ret = lcd_write_cgram(&bench->handle, i, big_glyphs[i])) != ESP_OK)
+            return ret;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Redraw a four digit counter in full, as an application would each second
+ */
+static esp_err_t big_digit_run(bench_t *bench, int iteration)
+{
+    char rows[2][4 * 4];
+    int value = iteration % 10000;
+    esp_err_t ret;
+
+    for (int digit = 0; digit < 4; ++digit)
+    {
+        int d = value / (digit == 0 ? 1000 : digit == 1 ? 100 : digit == 2 ? 10 : 1) % 10;
+
+        for (int row = 0; row < 2; ++row)
+        {
+            memcpy(&rows[row][digit * 4], big_digits[d][row], 3);
+            rows[row][digit * 4 + 3] = ' ';
+        }
+    }
+    for (int row = 0; row < 2; ++row)
+    {
+        rows[row][sizeof(rows[row]) - 1] = '\0';
+        if ((ret = lcd_set_cursor(&bench->handle, 0, row)) != ESP_OK ||
+            (ret = lcd_write_str(&bench->handle, rows[row])) != ESP_OK)
+            return ret;
+    }
+    for (int row = 0; row < 2; ++row)
+        check(bench, 0, row, rows[row]);
+    return ESP_OK;
+}
+
+static esp_err_t cgram_setup(bench_t *bench)
+{
+    esp_err_t ret;
+
+    if ((ret = lcd_clear_screen(&bench->handle)) != ESP_OK)
+        return ret;
+    return lcd_write_char(&bench->handle, CGRAM_ALIAS);
+}
+
+/**
+ * @brief One frame of a bar filling a cell from the bottom, drawn by rewriting the glyph it shows
+ */
+static esp_err_t cgram_run(bench_t *bench, int iteration)
+{
+    uint8_t glyph[8];
+    int level = iteration % 9;
+    esp_err_t ret;
+
+    for (int i = 0; i < 8; ++i)
+        glyph[i] = (8 - i <= level) ? 0x1F : 0x00;
+    if ((ret = lcd_write_cgram(&bench->handle, 0, glyph)) != ESP_OK)
+        return ret;
+    if (memcmp(bench->emu.cgram, glyph, sizeof(glyph)) != 0)
+    {
+        fprintf(stderr, "CGRAM glyph 0 differs from frame %d\n", iteration);
+        bench->verified = false;
+    }
+    return ESP_OK;
+}
+
+static const lcd_screen_desc_t menu_descs[2] = {
+    {
+        .lines = {"== Main menu =======", "> Settings", "  Network", "  About"},
+        .cursor_column = 0,
+        .cursor_row = 1,
+    },
+    {
+        .lines = {"== Settings ========", "> Backlight    [on]", "  Contrast     [50]", "  Back"},
+        .glyphs = &big_glyphs[0][0],
+        .glyph_count = 8,
+        .cursor_column = 0,
+        .cursor_row = 1,
+        .blink = true,
+    },
+};
+
+static esp_err_t menu_setup(bench_t *bench)
+{
+    esp_err_t ret = ESP_OK;
+
+    for (int i = 0; i < 2 && ret == ESP_OK; ++i)
+    {
+        lcd_screen_desc_t desc = menu_descs[i];
+
+        desc.clk_speed = bench->clock_hz;
+        ret = lcd_screen_compile(&bench->handle, &desc, &bench->menus[i]);
+    }
+    return ret;
+}
+
+/**
+ * @brief Switch between two menu pages compiled beforehand, as a menu does on a key press
+ */
+static esp_err_t menu_run(bench_t *bench, int iteration)
+{
+    const lcd_screen_desc_t *desc = &menu_descs[iteration % 2];
+    esp_err_t ret = lcd_screen_show(&bench->handle, bench->menus[iteration % 2]);
+
+    if (ret != ESP_OK)
+        return ret;
+    for (uint8_t row = 0; row < bench->handle.rows; ++row)
+        check(bench, 0, row, desc->lines[row]);
+    if (desc->glyph_count && memcmp(bench->emu.cgram, desc->glyphs, desc->glyph_count * 8) != 0)
+    {
+        fprintf(stderr, "CGRAM differs from menu %d\n", iteration % 2);
+        bench->verified = false;
+    }
+    return ESP_OK;
+}
+
+static const workload_t workloads[] = {
+    {"single_char", clear_setup, single_char_run},
+    {"line_20", clear_setup, line_run},
+    {"screen_20x4", clear_setup, screen_run},
+    {"big_digit_counter", big_digit_setup, big_digit_run},
+    {"cgram_animation", cgram_setup, cgram_run},
+    {"menu_screen_20x4", menu_setup, menu_run},
+};
+
+static const uint32_t clocks_hz[] = {100000, 400000, 1000000};
+static const uint8_t backlight_levels[] = {0, 1, 64, 128, 192, 254, 255};
+
+static const int multi_counts[] = {1, 2, 4, 8};
+
+#define MULTI_BASE_ADDR 0x20 /*!< First PCF8574 address; the displays take the ones after it */
+#define BACKLIGHT_SPAN_US 1000000
+#define BACKLIGHT_POLL_US 10 /*!< How late the idle edges are written, standing in for the dimming task */
+
+static void print_result(const char *name, uint32_t clock_hz, int iterations, const i2c_mock_stats_t *stats,
+                         uint64_t elapsed_ns, bench_t *bench, bool first)
+{
+    lcd_pacing_stats_t pacing = {0};
+
+    lcd_pacing_get_stats(&bench->handle, &pacing, true);
+    printf("%s\n    {\"workload\": \"%s\", \"clock_hz\": %u, \"iterations\": %d, "
+           "\"transactions\": %u, \"wire_bytes\": %u, \"bus_us\": %.3f, \"elapsed_us\": %.3f, "
+           "\"transactions_per_iteration\": %.2f, \"us_per_iteration\": %.3f, "
+           "\"controller_bytes\": %u, \"spin_us\": %.3f, \"yields\": %u, \"yield_us\": %.3f, \"cpu_pct\": %.1f, "
+           "\"violations\": %u, \"verified\": %s}",
+           first ? "" : ",", name, clock_hz, iterations,
+           stats->transactions, stats->bytes, stats->busy_ns / 1000.0, elapsed_ns / 1000.0,
+           (double)stats->transactions / iterations, elapsed_ns / 1000.0 / iterations,
+           pacing.bytes, (double)pacing.spin_us, pacing.yields, (double)pacing.yield_us,
+           elapsed_ns ? pacing.spin_us * 100000.0 / elapsed_ns : 0.0,
+           hd44780_emu_violation_count(&bench->emu), bench->verified ? "true" : "false");
+}
+
+/**
+ * @brief Bring up a fresh bus with an emulated display on it
+ */
+static void bench_reset(bench_t *bench, uint32_t clock_hz, uint32_t overhead_ns)
+{
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = CONFIG_SDA_GPIO,
+        .scl_io_num = CONFIG_SCL_GPIO,
+        .master.clk_speed = clock_hz,
+    };
+
+    for (int i = 0; i < 2; ++i)
+        lcd_screen_free(bench->menus[i]);
+    i2c_mock_reset();
+    memset(bench, 0, sizeof(*bench));
+    bench->clock_hz = clock_hz;
+    hd44780_emu_init(&bench->emu, LCD_COLUMNS, LCD_ROWS);
+    bench->verified = true;
+    ESP_ERROR_CHECK(i2c_param_config(BENCH_PORT, &conf));
+    ESP_ERROR_CHECK(i2c_driver_install(BENCH_PORT, conf.mode, 0, 0, 0));
+    ESP_ERROR_CHECK(i2c_mock_set_overhead_ns(BENCH_PORT, overhead_ns));
+    ESP_ERROR_CHECK(i2c_mock_attach(BENCH_PORT, LCD_ADDR, &(i2c_mock_device_t){
+        .write = bench_emu_write,
+        .read = bench_emu_read,
+        .ctx = &bench->emu,
+    }));
+    bench->handle = (lcd_handle_t)LCD_HANDLE_DEFAULT_CONFIG();
+    bench->handle.i2c_port = BENCH_PORT;
+}
+
+/**
+ * @brief Bring up a fresh bus and display, then run every workload on it
+ *
+ * @return Whether every workload ran, verified and without violations
+ */
+static bool bench_clock(uint32_t clock_hz, uint32_t overhead_ns, int iterations, bool *first)
+{
+    static bench_t bench;
+    i2c_mock_stats_t stats;
+    uint64_t start_ns;
+    bool ok = true;
+
+    bench_reset(&bench, clock_hz, overhead_ns);
+    start_ns = mock_clock_now_ns();
+    if (lcd_init(&bench.handle) != ESP_OK)
+    {
+        fprintf(stderr, "lcd_init() failed at %u Hz\n", clock_hz);
+        return false;
+    }
+    i2c_mock_get_stats(BENCH_PORT, &stats, true);
+    print_result("init", clock_hz, 1, &stats, mock_clock_now_ns() - start_ns, &bench, *first);
+    *first = false;
+
+    for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); ++w)
+    {
+        const workload_t *workload = &workloads[w];
+        esp_err_t ret = ESP_OK;
+
+        // Setup is not measured
+        if (workload->setup && workload->setup(&bench) != ESP_OK)
+            ret = ESP_FAIL;
+        i2c_mock_get_stats(BENCH_PORT, &stats, true);
+        lcd_pacing_get_stats(&bench.handle, &(lcd_pacing_stats_t){0}, true);
+        start_ns = mock_clock_now_ns();
+        for (int i = 0; i < iterations && ret == ESP_OK; ++i)
+            ret = workload->run(&bench, i);
+        i2c_mock_get_stats(BENCH_PORT, &stats, true);
+        if (ret != ESP_OK)
+        {
+            fprintf(stderr, "%s failed at %u Hz: %s\n", workload->name, clock_hz, esp_err_to_name(ret));
+            ok = false;
+        }
+        print_result(workload->name, clock_hz, iterations, &stats, mock_clock_now_ns() - start_ns, &bench, false);
+    }
+    for (size_t m = 0; m < bench.emu.message_count; ++m)
+        fprintf(stderr, "%u Hz: %s\n", clock_hz, bench.emu.messages[m]);
+    return ok && bench.verified && !hd44780_emu_violation_count(&bench.emu);
+}
+
+/**
+ * @brief Dim the backlight for a second at one level and report what it cost
+ *
+ * @details There is no task on the host: idle edges are written by polling
+ *          lcd_backlight_pwm_flush(), busy ones ride on the line rewrites.
+ */
+static bool bench_backlight_level(bench_t *bench, uint8_t level, bool busy, bool *first)
+{
+    lcd_backlight_pwm_config_t config = LCD_BACKLIGHT_PWM_DEFAULT_CONFIG();
+    lcd_backlight_pwm_stats_t stats;
+    esp_err_t ret;
+    int iteration = 0;
+
+    config.level = level;
+    config.create_task = false;
+    if ((ret = lcd_backlight_pwm_enable(&bench->handle, &config)) != ESP_OK)
+    {
+        fprintf(stderr, "lcd_backlight_pwm_enable() failed at %u Hz: %s\n", bench->clock_hz, esp_err_to_name(ret));
+        return false;
+    }
+    // Let the first period start before measuring
+    mock_clock_advance_ns(config.period_us * 1000ull);
+    lcd_backlight_pwm_flush(&bench->handle);
+    lcd_backlight_pwm_get_stats(&bench->handle, &stats, true);
+    int64_t end_us = esp_timer_get_time() + BACKLIGHT_SPAN_US;
+    while (esp_timer_get_time() < end_us && ret == ESP_OK)
+    {
+        if (busy)
+            ret = line_run(bench, iteration++);
+        else
+            mock_clock_advance_ns(BACKLIGHT_POLL_US * 1000);
+        if (ret == ESP_OK)
+            ret = lcd_backlight_pwm_flush(&bench->handle);
+    }
+    lcd_backlight_pwm_get_stats(&bench->handle, &stats, false);
+    if (ret == ESP_OK)
+        ret = lcd_backlight_pwm_disable(&bench->handle);
+    if (ret != ESP_OK)
+        fprintf(stderr, "backlight %u failed at %u Hz: %s\n", level, bench->clock_hz, esp_err_to_name(ret));
+
+    printf("%s\n    {\"clock_hz\": %u, \"level\": %u, \"load\": \"%s\", \"period_us\": %u, "
+           "\"edges\": %u, \"writes\": %u, \"piggybacked\": %u, \"bus_us\": %.3f, \"elapsed_us\": %.3f, "
+           "\"bus_share\": %.4f}",
+           *first ? "" : ",", bench->clock_hz, level, busy ? "line_20" : "idle", (unsigned)config.period_us,
+           stats.edges, stats.writes, stats.piggybacked, (double)stats.bus_us, (double)stats.elapsed_us,
+           (double)stats.bus_us / stats.elapsed_us);
+    *first = false;
+    return ret == ESP_OK;
+}
+
+/**
+ * @brief Measure the bus cost of backlight dimming at each level on a fresh display
+ */
+static bool bench_backlight(uint32_t clock_hz, uint32_t overhead_ns, bool *first)
+{
+    static bench_t bench;
+    bool ok = true;
+
+    bench_reset(&bench, clock_hz, overhead_ns);
+    if (lcd_init(&bench.handle) != ESP_OK)
+    {
+        fprintf(stderr, "lcd_init() failed at %u Hz\n", clock_hz);
+        return false;
+    }
+    for (int busy = 0; busy < 2; ++busy)
+    {
+        for (size_t l = 0; l < sizeof(backlight_levels); ++l)
+            ok &= bench_backlight_level(&bench, backlight_levels[l], busy, first);
+    }
+    for (size_t m = 0; m < bench.emu.message_count; ++m)
+        fprintf(stderr, "%u Hz: %s\n", clock_hz, bench.emu.messages[m]);
+    return ok && bench.verified && !hd44780_emu_violation_count(&bench.emu);
+}
+
+/**
+ * @brief Rewrite every cell of several displays on one bus through a display manager
+ *
+ * @details There is no task on the host: the manager is created without bus
+ *          tasks and each iteration ends with lcd_manager_flush().
+ */
+static bool bench_multi_count(uint32_t clock_hz, uint32_t overhead_ns, int count, int iterations, bool *first)
+{
+    static hd44780_emu_t emus[I2C_MOCK_MAX_DEVICES];
+    lcd_handle_t *handles[I2C_MOCK_MAX_DEVICES];
+    lcd_manager_config_t manager_config = LCD_MANAGER_DEFAULT_CONFIG();
+    lcd_manager_t *manager;
+    i2c_mock_stats_t stats;
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = CONFIG_SDA_GPIO,
+        .scl_io_num = CONFIG_SCL_GPIO,
+        .master.clk_speed = clock_hz,
+    };
+    uint32_t violations = 0;
+    bool verified = true;
+    uint64_t start_ns;
+    uint64_t elapsed_ns;
+    esp_err_t ret;
+
+    i2c_mock_reset();
+    ESP_ERROR_CHECK(i2c_param_config(BENCH_PORT, &conf));
+    ESP_ERROR_CHECK(i2c_driver_install(BENCH_PORT, conf.mode, 0, 0, 0));
+    ESP_ERROR_CHECK(i2c_mock_set_overhead_ns(BENCH_PORT, overhead_ns));
+    for (int d = 0; d < count; ++d)
+    {
+        hd44780_emu_init(&emus[d], LCD_COLUMNS, LCD_ROWS);
+        ESP_ERROR_CHECK(i2c_mock_attach(BENCH_PORT, MULTI_BASE_ADDR + d, &(i2c_mock_device_t){
+            .write = bench_emu_write,
+            .read = bench_emu_read,
+            .ctx = &emus[d],
+        }));
+    }
+    manager_config.create_task = false;
+    ESP_ERROR_CHECK(lcd_manager_create(&manager_config, &manager));
+    for (int d = 0; d < count; ++d)
+    {
+        lcd_handle_t config = LCD_HANDLE_DEFAULT_CONFIG();
+
+        config.i2c_port = BENCH_PORT;
+        config.address = MULTI_BASE_ADDR + d;
+        if ((ret = lcd_manager_add(manager, &config, 0, &handles[d])) != ESP_OK)
+        {
+            fprintf(stderr, "lcd_manager_add() failed at %u Hz: %s\n", clock_hz, esp_err_to_name(ret));
+            lcd_manager_delete(manager);
+            return false;
+        }
+    }
+
+    // Setup is not measured
+    i2c_mock_get_stats(BENCH_PORT, &stats, true);
+    start_ns = mock_clock_now_ns();
+    ret = ESP_OK;
+    for (int i = 0; i < iterations && ret == ESP_OK; ++i)
+    {
+        for (int d = 0; d < count && ret == ESP_OK; ++d)
+        {
+            for (uint8_t row = 0; row < handles[d]->rows && ret == ESP_OK; ++row)
+            {
+                char line[LCD_COLUMNS + 1];
+
+                for (int c = 0; c < handles[d]->columns; ++c)
+                    line[c] = 'a' + (i + d + row + c) % 26;
+                line[handles[d]->columns] = '\0';
+                if ((ret = lcd_set_cursor(handles[d], 0, row)) == ESP_OK)
+                    ret = lcd_write_str(handles[d], line);
+            }
+        }
+        if (ret == ESP_OK)
+            ret = lcd_manager_flush(manager, BENCH_PORT);
+        for (int d = 0; d < count && ret == ESP_OK && verified; ++d)
+        {
+            for (uint8_t row = 0; row < LCD_ROWS; ++row)
+            {
+                for (int c = 0; c < LCD_COLUMNS; ++c)
+                {
+                    uint8_t code = hd44780_emu_char_at(&emus[d], c, row);
+
+                    if (code != 'a' + (i + d + row + c) % 26)
+                    {
+                        fprintf(stderr, "display %d row %u column %d shows 0x%02x after iteration %d\n",
+                                d, row, c, code, i);
+                        verified = false;
+                    }
+                }
+            }
+        }
+    }
+    elapsed_ns = mock_clock_now_ns() - start_ns;
+    i2c_mock_get_stats(BENCH_PORT, &stats, true);
+    if (ret != ESP_OK)
+        fprintf(stderr, "%d displays failed at %u Hz: %s\n", count, clock_hz, esp_err_to_name(ret));
+    lcd_manager_delete(manager);
+
+    for (int d = 0; d < count; ++d)
+    {
+        violations += hd44780_emu_violation_count(&emus[d]);
+        for (size_t m = 0; m < emus[d].message_count; ++m)
+            fprintf(stderr, "%u Hz, display %d: %s\n", clock_hz, d, emus[d].messages[m]);
+    }
+    uint32_t chars = (uint32_t)count * LCD_COLUMNS * LCD_ROWS * iterations;
+    printf("%s\n    {\"clock_hz\": %u, \"displays\": %d, \"iterations\": %d, \"chars\": %u, "
+           "\"transactions\": %u, \"elapsed_us\": %.3f, \"chars_per_s\": %.0f, "
+           "\"violations\": %u, \"verified\": %s}",
+           *first ? "" : ",", clock_hz, count, iterations, chars, stats.transactions, elapsed_ns / 1000.0,
+           elapsed_ns ? chars * 1e9 / elapsed_ns : 0.0, violations, verified ? "true" : "false");
+    *first = false;
+    return ret == ESP_OK && verified && !violations;
+}
+
+/**
+ * @brief Measure the aggregate throughput of each number of displays on a fresh bus
+ */
+static bool bench_multi(uint32_t clock_hz, uint32_t overhead_ns, int iterations, bool *first)
+{
+    bool ok = true;
+
+    for (size_t n = 0; n < sizeof(multi_counts) / sizeof(multi_counts[0]); ++n)
+        ok &= bench_multi_count(clock_hz, overhead_ns, multi_counts[n], iterations, first);
+    return ok;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-n iterations] [-o overhead_ns] [-b] [-m]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = 20;
+    long overhead_ns = 0;
+    bool first = true;
+    bool backlight = false;
+    bool multi = false;
+    int status = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:o:bmh")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            iterations = atoi(optarg);
+            break;
+        case 'o':
+            overhead_ns = atol(optarg);
+            break;
+        case 'b':
+            backlight = true;
+            break;
+        case 'm':
+            multi = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (iterations < 1 || overhead_ns < 0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    printf("{\n  \"config\": {\"columns\": %d, \"rows\": %d, \"pre_pulse_delay_us\": %d, "
+           "\"yield_threshold_us\": %d, \"overhead_ns\": %ld, \"defer_control\": %s},\n  \"results\": [",
+           LCD_COLUMNS, LCD_ROWS, CONFIG_LCD_PRE_PULSE_DELAY_US, CONFIG_LCD_YIELD_THRESHOLD_US, overhead_ns,
+#if CONFIG_LCD_DEFER_CONTROL
+           "true"
+#else
+           "false"
+#endif
+    );
+    for (size_t c = 0; c < sizeof(clocks_hz) / sizeof(clocks_hz[0]); ++c)
+    {
+        if (!bench_clock(clocks_hz[c], overhead_ns, iterations, &first))
+            status = 1;
+    }
+    printf("\n  ]");
+    if (backlight)
+    {
+        first = true;
+        printf(",\n  \"backlight\": [");
+        for (size_t c = 0; c < sizeof(clocks_hz) / sizeof(clocks_hz[0]); ++c)
+        {
+            if (!bench_backlight(clocks_hz[c], overhead_ns, &first))
+                status = 1;
+        }
+        printf("\n  ]");
+    }
+    if (multi)
+    {
+        first = true;
+        printf(",\n  \"multi_display\": [");
+        for (size_t c = 0; c < sizeof(clocks_hz) / sizeof(clocks_hz[0]); ++c)
+        {
+            if (!bench_multi(clocks_hz[c], overhead_ns, iterations, &first))
+                status = 1;
+        }
+        printf("\n  ]");
+    }
+    printf("\n}\n");
+    return status;
+}
@@ -0,0 +1,151 @@
+// Replays a wire trace printed by lcd_trace_dump() through the emulator and
+// shows what each display ends up showing, along with every timing violation
+// found on the way.
+//
+//     lcd_replay [-c columns] [-r rows] [-f fosc_khz] [-s] [trace.csv]
+//
+// The trace is read from standard input when no file is given. The exit
+// status is 1 if any violation or read mismatch was found, 2 on usage errors.
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hd44780_emu.h"
+
+#define MAX_DISPLAYS 16
+
+typedef struct
+{
+    unsigned port;
+    unsigned address;
+    uint32_t mismatches; /*!< Recorded reads that differ from what the emulator returns */
+    hd44780_emu_t emu;
+} display_t;
+
+static display_t displays[MAX_DISPLAYS];
+static int display_count;
+
+static display_t *find_display(unsigned port, unsigned address, uint8_t columns, uint8_t rows)
+{
+    for (int i = 0; i < display_count; ++i)
+    {
+        if (displays[i].port == port && displays[i].address == address)
+            return &displays[i];
+    }
+    if (display_count == MAX_DISPLAYS)
+        return NULL;
+    display_t *display = &displays[display_count++];
+    display->port = port;
+    display->address = address;
+    hd44780_emu_init(&display->emu, columns, rows);
+    return display;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-c columns] [-r rows] [-f fosc_khz] [-s] [trace.csv]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    int columns = 20;
+    int rows = 4;
+    int fosc_khz = 270;
+    bool strict = false;
+    FILE *in = stdin;
+    char line[256];
+    unsigned long line_number = 0;
+    int status = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:r:f:sh")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c':
+            columns = atoi(optarg);
+            break;
+        case 'r':
+            rows = atoi(optarg);
+            break;
+        case 'f':
+            fosc_khz = atoi(optarg);
+            break;
+        case 's':
+            strict = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (columns < 1 || columns > 40 || rows < 1 || rows > 4 || fosc_khz < 1)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    if (optind < argc && !(in = fopen(argv[optind], "r")))
+    {
+        perror(argv[optind]);
+        return 2;
+    }
+
+    while (fgets(line, sizeof(line), in))
+    {
+        unsigned long time_us;
+        unsigned port, address, byte;
+        char dir;
+        display_t *display;
+
+        ++line_number;
+        // Skips the header and log lines mixed in from the console
+        if (sscanf(line, "%lu,%u,%x,%c,%x,", &time_us, &port, &address, &dir, &byte) != 5)
+            continue;
+        display = find_display(port, address, columns, rows);
+        if (!display)
+        {
+            fprintf(stderr, "line %lu: more than %d displays, ignored\n", line_number, MAX_DISPLAYS);
+            continue;
+        }
+        display->emu.fosc_khz = fosc_khz;
+        display->emu.strict = strict;
+        if (strstr(line, "bus error"))
+            continue;
+        if (dir == 'r')
+        {
+            uint8_t value = hd44780_emu_read(&display->emu, (uint64_t)time_us * 1000);
+
+            if (value != byte)
+            {
+                display->mismatches++;
+                fprintf(stderr, "line %lu: read 0x%02x, emulator returns 0x%02x\n", line_number, byte, value);
+            }
+            continue;
+        }
+        hd44780_emu_write(&display->emu, byte, (uint64_t)time_us * 1000);
+    }
+    if (in != stdin)
+        fclose(in);
+
+    for (int i = 0; i < display_count; ++i)
+    {
+        display_t *display = &displays[i];
+        hd44780_emu_t *emu = &display->emu;
+        char screen[4 * 41 + 1];
+
+        hd44780_emu_render(emu, screen);
+        printf("port %u address 0x%02x: %u writes, %u reads, %u instructions, %u data bytes\n",
+               display->port, display->address, emu->writes, emu->reads, emu->instructions, emu->data_writes);
+        printf("%s", screen);
+        printf("violations: busy %u, setup %u, hold %u, pulse %u, cycle %u; read mismatches %u\n",
+               emu->violations[HD44780_EMU_BUSY], emu->violations[HD44780_EMU_SETUP],
+               emu->violations[HD44780_EMU_HOLD], emu->violations[HD44780_EMU_PULSE],
+               emu->violations[HD44780_EMU_CYCLE], display->mismatches);
+        for (size_t m = 0; m < emu->message_count; ++m)
+            printf("  %s\n", emu->messages[m]);
+        if (hd44780_emu_violation_count(emu) || display->mismatches)
+            status = 1;
+    }
+    return status;
+}
@@ -0,0 +1,297 @@
+// Drives the command ring of the display service on the development machine.
+// The port has no tasks, so each service is created without one and the
+// test runs the queued commands with lcd_service_flush(), or through
+// lcd_service_detach(), where the service task would. Two emulated displays
+// on the mocked bus show what was executed; operation tokens show what was
+// dropped or discarded.
+//
+//     lcd_service_test
+//
+// Each check that fails is printed to stderr. The exit status is 1 if any
+// did.
+
+#include <stdio.h>
+#include <string.h>
+#include "driver/i2c.h"
+#include "esp_timer.h"
+#include "i2c_mock.h"
+#include "lcd.h"
+#include "hd44780_emu.h"
+
+#define TEST_PORT I2C_NUM_0
+
+typedef struct
+{
+    lcd_handle_t handle;
+    hd44780_emu_t emu;
+} display_t;
+
+static display_t displays[2];
+static lcd_service_t *service;
+static int failures;
+
+#define CHECK(cond)                                                                   \
+    do                                                                                \
+    {                                                                                 \
+        if (!(cond))                                                                  \
+        {                                                                             \
+            fprintf(stderr, "%s:%d: %s: check failed: %s\n", __FILE__, __LINE__,      \
+                    __func__, #cond);                                                 \
+            failures++;                                                               \
+        }                                                                             \
+    } while (0)
+
+static esp_err_t test_emu_write(void *ctx, uint8_t data, uint64_t time_ns)
+{
+    hd44780_emu_write(ctx, data, time_ns);
+    return ESP_OK;
+}
+
+static esp_err_t test_emu_read(void *ctx, uint8_t *data, uint64_t time_ns)
+{
+    *data = hd44780_emu_read(ctx, time_ns);
+    return ESP_OK;
+}
+
+/**
+ * @brief Whether the glass shows expected from column on, padded with blanks
+ *        to the end of the row
+ */
+static bool shows(const display_t *display, uint8_t row, uint8_t column, const char *expected)
+{
+    size_t len = strlen(expected);
+
+    for (uint8_t c = 0; c < display->handle.columns; ++c)
+    {
+        uint8_t want = (c >= column && (size_t)(c - column) < len) ? (uint8_t)expected[c - column] : ' ';
+
+        if (hd44780_emu_char_at(&display->emu, c, row) != want)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Fresh displays, each attached to a new service without a task
+ */
+static void setup(uint16_t queue_depth, lcd_service_overflow_t overflow)
+{
+    lcd_service_config_t config = LCD_SERVICE_DEFAULT_CONFIG();
+    i2c_config_t i2c = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = CONFIG_SDA_GPIO,
+        .scl_io_num = CONFIG_SCL_GPIO,
+        .master.clk_speed = 400000,
+    };
+
+    i2c_mock_reset();
+    ESP_ERROR_CHECK(i2c_param_config(TEST_PORT, &i2c));
+    ESP_ERROR_CHECK(i2c_driver_install(TEST_PORT, i2c.mode, 0, 0, 0));
+    for (size_t i = 0; i < sizeof(displays) / sizeof(displays[0]); ++i)
+    {
+        display_t *display = &displays[i];
+
+        display->handle = (lcd_handle_t)LCD_HANDLE_DEFAULT_CONFIG();
+        display->handle.i2c_port = TEST_PORT;
+        display->handle.address = 0x20 + i;
+        display->handle.columns = 20;
+        display->handle.rows = 4;
+        hd44780_emu_init(&display->emu, display->handle.columns, display->handle.rows);
+        display->emu.strict = true;
+        ESP_ERROR_CHECK(i2c_mock_attach(TEST_PORT, display->handle.address,
+                                        &(i2c_mock_device_t){.write = test_emu_write,
+                                                             .read = test_emu_read,
+                                                             .ctx = &display->emu}));
+        ESP_ERROR_CHECK(lcd_init(&display->handle));
+    }
+
+    config.queue_depth = queue_depth;
+    config.overflow = overflow;
+    config.block_timeout_ms = 10;
+    config.create_task = false;
+    ESP_ERROR_CHECK(lcd_service_create(&config, &service));
+    for (size_t i = 0; i < sizeof(displays) / sizeof(displays[0]); ++i)
+        ESP_ERROR_CHECK(lcd_service_attach(service, &displays[i].handle));
+}
+
+static void teardown(void)
+{
+    for (size_t i = 0; i < sizeof(displays) / sizeof(displays[0]); ++i)
+    {
+        if (displays[i].handle.service)
+            CHECK(lcd_service_detach(&displays[i].handle, 0) == ESP_OK);
+    }
+    if (service)
+        ESP_ERROR_CHECK(lcd_service_delete(service));
+    service = NULL;
+    for (size_t i = 0; i < sizeof(displays) / sizeof(displays[0]); ++i)
+        CHECK(hd44780_emu_violation_count(&displays[i].emu) == 0);
+    i2c_mock_reset();
+}
+
+/**
+ * @brief Commands run in the order they were queued, and only when flushed
+ */
+static void test_order(void)
+{
+    display_t *a = &displays[0];
+
+    setup(8, LCD_SERVICE_OVERFLOW_DROP_OLDEST);
+    CHECK(lcd_service_write_str_at(&a->handle, 2, 0, "ring") == ESP_OK);
+    CHECK(lcd_service_write_char(&a->handle, '!') == ESP_OK);
+    CHECK(lcd_service_set_cursor(&a->handle, 0, 1) == ESP_OK);
+    CHECK(lcd_service_write_str(&a->handle, "buffer") == ESP_OK);
+    CHECK(shows(a, 0, 0, ""));
+    CHECK(lcd_service_flush(service, 0) == ESP_OK);
+    CHECK(shows(a, 0, 2, "ring!"));
+    CHECK(shows(a, 1, 0, "buffer"));
+    CHECK(lcd_service_get_dropped(service) == 0);
+    teardown();
+}
+
+/**
+ * @brief A full ring makes room by dropping its oldest commands, and their
+ *        tokens say so
+ */
+static void test_drop_oldest(void)
+{
+    display_t *a = &displays[0];
+    lcd_async_op_t *ops[6];
+
+    setup(4, LCD_SERVICE_OVERFLOW_DROP_OLDEST);
+    CHECK(lcd_service_set_cursor(&a->handle, 0, 2) == ESP_OK);
+    CHECK(lcd_service_flush(service, 0) == ESP_OK);
+    for (int i = 0; i < 6; ++i)
+        CHECK(lcd_write_str_async(&a->handle, (char[]){'a' + i, '\0'}, NULL, &ops[i]) == ESP_OK);
+    CHECK(lcd_service_get_dropped(service) == 2);
+    CHECK(lcd_async_wait(ops[0], 0) == ESP_ERR_NO_MEM);
+    CHECK(lcd_async_wait(ops[1], 0) == ESP_ERR_NO_MEM);
+    CHECK(lcd_async_wait(ops[2], 0) == ESP_ERR_TIMEOUT);
+    CHECK(lcd_service_flush(service, 0) == ESP_OK);
+    for (int i = 2; i < 6; ++i)
+        CHECK(lcd_async_wait(ops[i], 0) == ESP_OK);
+    CHECK(shows(a, 2, 0, "cdef"));
+    for (int i = 0; i < 6; ++i)
+        lcd_async_release(ops[i]);
+    teardown();
+}
+
+/**
+ * @brief A cursor move and its text are dropped together, never apart
+ */
+static void test_group(void)
+{
+    display_t *a = &displays[0];
+
+    setup(4, LCD_SERVICE_OVERFLOW_DROP_OLDEST);
+    CHECK(lcd_service_write_str_at(&a->handle, 0, 0, "first") == ESP_OK);
+    CHECK(lcd_service_write_str_at(&a->handle, 0, 1, "second") == ESP_OK);
+    // The ring is full: the whole first group makes room, not just its cursor move
+    CHECK(lcd_service_write_char(&a->handle, '!') == ESP_OK);
+    CHECK(lcd_service_get_dropped(service) == 2);
+    CHECK(lcd_service_flush(service, 0) == ESP_OK);
+    CHECK(shows(a, 0, 0, ""));
+    CHECK(shows(a, 1, 0, "second!"));
+
+    // A string longer than LCD_SERVICE_TEXT_LEN is one group with its cursor move
+    CHECK(lcd_service_write_str_at(&a->handle, 0, 2, "abcdefghijklmnopqrstuvwxyz") == ESP_OK);
+    CHECK(lcd_service_write_str_at(&a->handle, 0, 3, "x") == ESP_OK);
+    CHECK(lcd_service_get_dropped(service) == 5);
+    CHECK(lcd_service_flush(service, 0) == ESP_OK);
+    CHECK(shows(a, 2, 0, ""));
+    CHECK(shows(a, 3, 0, "x"));
+
+    // Larger than the ring, so never queued
+    CHECK(lcd_service_write_str_at(&a->handle, 0, 0,
+                                   "abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz") ==
+          ESP_ERR_INVALID_SIZE);
+    teardown();
+}
+
+/**
+ * @brief With the block policy a producer that finds no room gives up after
+ *        block_timeout_ms, and its token carries the timeout
+ */
+static void test_block(void)
+{
+    display_t *a = &displays[0];
+    lcd_async_op_t *op;
+    int64_t start_us;
+
+    setup(2, LCD_SERVICE_OVERFLOW_BLOCK);
+    CHECK(lcd_service_write_char(&a->handle, 'a') == ESP_OK);
+    CHECK(lcd_service_write_char(&a->handle, 'b') == ESP_OK);
+    start_us = esp_timer_get_time();
+    CHECK(lcd_service_write_char(&a->handle, 'c') == ESP_ERR_TIMEOUT);
+    CHECK(esp_timer_get_time() - start_us >= 10000);
+    CHECK(lcd_clear_screen_async(&a->handle, NULL, &op) == ESP_OK);
+    CHECK(lcd_async_wait(op, 0) == ESP_ERR_TIMEOUT);
+    lcd_async_release(op);
+    CHECK(lcd_service_get_dropped(service) == 0);
+    CHECK(lcd_service_flush(service, 0) == ESP_OK);
+    CHECK(shows(a, 0, 0, "ab"));
+    teardown();
+}
+
+/**
+ * @brief Detaching a display waits for its own commands only
+ */
+static void test_detach(void)
+{
+    display_t *a = &displays[0];
+    display_t *b = &displays[1];
+
+    setup(8, LCD_SERVICE_OVERFLOW_DROP_OLDEST);
+    CHECK(lcd_service_write_str_at(&b->handle, 0, 0, "before") == ESP_OK);
+    CHECK(lcd_service_write_str_at(&a->handle, 0, 0, "mine") == ESP_OK);
+    CHECK(lcd_service_write_str_at(&b->handle, 0, 1, "after") == ESP_OK);
+    CHECK(lcd_service_detach(&a->handle, 0) == ESP_OK);
+    CHECK(!a->handle.service);
+    CHECK(shows(a, 0, 0, "mine"));
+    CHECK(shows(b, 0, 0, "before"));
+    // Still queued: the detach did not wait for the whole service
+    CHECK(shows(b, 1, 0, ""));
+    CHECK(lcd_service_write_char(&a->handle, 'x') == ESP_ERR_INVALID_STATE);
+    CHECK(lcd_service_flush(service, 0) == ESP_OK);
+    CHECK(shows(b, 1, 0, "after"));
+    teardown();
+}
+
+/**
+ * @brief Deleting the service discards what is still queued, and the tokens
+ *        say so
+ */
+static void test_delete(void)
+{
+    display_t *a = &displays[0];
+    lcd_async_op_t *op;
+
+    setup(8, LCD_SERVICE_OVERFLOW_DROP_OLDEST);
+    CHECK(lcd_write_str_async(&a->handle, "lost", NULL, &op) == ESP_OK);
+    // The handle is not used afterwards, so it need not be detached
+    a->handle.service = NULL;
+    displays[1].handle.service = NULL;
+    ESP_ERROR_CHECK(lcd_service_delete(service));
+    service = NULL;
+    CHECK(lcd_async_wait(op, 0) == ESP_ERR_INVALID_STATE);
+    lcd_async_release(op);
+    CHECK(shows(a, 0, 0, ""));
+    teardown();
+}
+
+int main(void)
+{
+    test_order();
+    test_drop_oldest();
+    test_group();
+    test_block();
+    test_detach();
+    test_delete();
+    if (failures)
+    {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("All service checks passed\n");
+    return 0;
+}
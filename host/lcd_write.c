@@ -0,0 +1,99 @@
+// Writes text to a display on a Linux I2C bus, through the driver and the
+// i2c-dev transport of driver/i2cdev.
+//
+//     lcd_write [-c columns] [-r rows] [-s] device address [line...]
+//
+// Each line goes to the next row, starting from the top. -s prints the
+// driver's performance counters afterwards. The exit status is 1 if the
+// display could not be driven, 2 on usage errors.
+//
+// Without a display, the kernel's i2c-stub stands in for one:
+//
+//     modprobe i2c-stub chip_addr=0x27
+//     lcd_write /dev/i2c-N 0x27 "Hello"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "lcd.h"
+#include "lcd_i2cdev.h"
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-c columns] [-r rows] [-s] device address [line...]\n", name);
+}
+
+static void print_stats(lcd_handle_t *handle)
+{
+    lcd_stats_t stats;
+
+    if (lcd_get_stats(handle, &stats, false) != ESP_OK)
+    {
+        fprintf(stderr, "Performance counters not available\n");
+        return;
+    }
+    printf("i2c_transactions %u\nwire_bytes %u\nchars %u\nnacks %u\nbus_errors %u\nretries %u\n"
+           "transmit_us %llu\nwait_us %llu\nelapsed_us %llu\n",
+           (unsigned)stats.i2c_transactions, (unsigned)stats.wire_bytes, (unsigned)stats.chars,
+           (unsigned)stats.nacks, (unsigned)stats.bus_errors, (unsigned)stats.retries,
+           (unsigned long long)stats.transmit_us,
+           (unsigned long long)stats.wait_us, (unsigned long long)stats.elapsed_us);
+}
+
+int main(int argc, char **argv)
+{
+    lcd_handle_t handle = LCD_HANDLE_DEFAULT_CONFIG();
+    lcd_transport_t *transport = NULL;
+    bool stats = false;
+    int status = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:r:sh")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c':
+            handle.columns = atoi(optarg);
+            break;
+        case 'r':
+            handle.rows = atoi(optarg);
+            break;
+        case 's':
+            stats = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (argc - optind < 2)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    handle.address = strtoul(argv[optind + 1], NULL, 0);
+
+    if (lcd_i2cdev_open(argv[optind], &transport) != ESP_OK)
+        return 1;
+    handle.transport = transport;
+    if (lcd_init(&handle) != ESP_OK)
+    {
+        fprintf(stderr, "Unable to initialise the LCD at 0x%02x on %s\n", handle.address, argv[optind]);
+        status = 1;
+        goto close;
+    }
+    for (int i = optind + 2, row = 0; i < argc && row < handle.rows; ++i, ++row)
+    {
+        if (lcd_set_cursor(&handle, 0, row) != ESP_OK || lcd_write_str(&handle, argv[i]) != ESP_OK)
+        {
+            fprintf(stderr, "Unable to write row %d\n", row);
+            status = 1;
+            break;
+        }
+    }
+    if (stats)
+        print_stats(&handle);
+close:
+    lcd_i2cdev_close(transport);
+    return status;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+// No RTC memory or IRAM on a development machine: ordinary variables and code
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct QueueDefinition *SemaphoreHandle_t;
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t max;
+    uint8_t kind;
+    bool is_static;
+} StaticSemaphore_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *pxSemaphoreBuffer);
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void);
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore);
+
+/**
+ * @brief Take at once if available. Otherwise nothing can give it meanwhile:
+ *        the virtual clock moves on by the timeout and pdFALSE is returned.
+ *        Waiting forever for a semaphore that is not available is a deadlock and aborts.
+ */
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore);
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t xMutex, TickType_t xBlockTime);
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t xMutex);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,151 @@
+#pragma once
+
+// The Kconfig defaults of the component, for host builds that have no
+// menuconfig. Each value can be overridden on the compiler command line,
+// e.g. -DCONFIG_LCD_PRE_PULSE_DELAY_US=0. Boolean options that default to
+// off are left undefined, as in a generated sdkconfig.h, and are turned on
+// with -DCONFIG_<NAME>=1.
+
+#ifndef CONFIG_HARDWARE_I2C_PORT0
+#define CONFIG_HARDWARE_I2C_PORT0 1
+#endif
+#ifndef CONFIG_I2C_CLK_FREQ
+#define CONFIG_I2C_CLK_FREQ 100000
+#endif
+#ifndef CONFIG_SDA_GPIO
+#define CONFIG_SDA_GPIO 18
+#endif
+#ifndef CONFIG_SCL_GPIO
+#define CONFIG_SCL_GPIO 19
+#endif
+#ifndef CONFIG_LCD_ADDR
+#define CONFIG_LCD_ADDR 0x3f
+#endif
+#ifndef CONFIG_LCD_ROWS
+#define CONFIG_LCD_ROWS 4
+#endif
+#ifndef CONFIG_LCD_COLUMNS
+#define CONFIG_LCD_COLUMNS 20
+#endif
+#ifndef CONFIG_LCD_BACKLIGHT_OFF
+#define CONFIG_LCD_BACKLIGHT_ON 1
+#endif
+
+#ifndef CONFIG_LCD_WARM_START_SLOTS
+#define CONFIG_LCD_WARM_START_SLOTS 8
+#endif
+#ifndef CONFIG_LCD_SLEEP_SLOTS
+#define CONFIG_LCD_SLEEP_SLOTS 2
+#endif
+#ifndef CONFIG_LCD_TRACE_DEPTH
+#define CONFIG_LCD_TRACE_DEPTH 1024
+#endif
+
+#ifndef CONFIG_LCD_PIN_RS
+#define CONFIG_LCD_PIN_RS 0
+#endif
+#ifndef CONFIG_LCD_PIN_RW
+#define CONFIG_LCD_PIN_RW 1
+#endif
+#ifndef CONFIG_LCD_PIN_E
+#define CONFIG_LCD_PIN_E 2
+#endif
+#ifndef CONFIG_LCD_PIN_BL
+#define CONFIG_LCD_PIN_BL 3
+#endif
+#ifndef CONFIG_LCD_PIN_D4
+#define CONFIG_LCD_PIN_D4 4
+#endif
+#ifndef CONFIG_LCD_PIN_D5
+#define CONFIG_LCD_PIN_D5 5
+#endif
+#ifndef CONFIG_LCD_PIN_D6
+#define CONFIG_LCD_PIN_D6 6
+#endif
+#ifndef CONFIG_LCD_PIN_D7
+#define CONFIG_LCD_PIN_D7 7
+#endif
+#ifndef CONFIG_LCD_PRE_PULSE_DELAY_US
+#define CONFIG_LCD_PRE_PULSE_DELAY_US 1000
+#endif
+#ifndef CONFIG_LCD_YIELD_THRESHOLD_US
+#define CONFIG_LCD_YIELD_THRESHOLD_US 200
+#endif
+#ifndef CONFIG_LCD_I2C_TIMEOUT_MS
+#define CONFIG_LCD_I2C_TIMEOUT_MS 50
+#endif
+#ifndef CONFIG_LCD_I2C_BUS_WAIT_MS
+#define CONFIG_LCD_I2C_BUS_WAIT_MS 1000
+#endif
+#ifndef CONFIG_LCD_I2C_RETRIES
+#define CONFIG_LCD_I2C_RETRIES 1
+#endif
+#ifndef CONFIG_LCD_ERROR_BUDGET
+#define CONFIG_LCD_ERROR_BUDGET 3
+#endif
+#ifndef CONFIG_LCD_REPROBE_INTERVAL_MS
+#define CONFIG_LCD_REPROBE_INTERVAL_MS 1000
+#endif
+#ifndef CONFIG_LCD_BUS_RECOVERY
+#define CONFIG_LCD_BUS_RECOVERY 1
+#endif
+#ifndef CONFIG_LCD_ERROR_LOG_INTERVAL_MS
+#define CONFIG_LCD_ERROR_LOG_INTERVAL_MS 1000
+#endif
+#ifndef CONFIG_LCD_BACKLIGHT_PWM_PERIOD_US
+#define CONFIG_LCD_BACKLIGHT_PWM_PERIOD_US 5000
+#endif
+#ifndef CONFIG_LCD_BACKLIGHT_TASK_PRIORITY
+#define CONFIG_LCD_BACKLIGHT_TASK_PRIORITY 4
+#endif
+#ifndef CONFIG_LCD_BACKLIGHT_TASK_STACK_SIZE
+#define CONFIG_LCD_BACKLIGHT_TASK_STACK_SIZE 2560
+#endif
+
+#ifndef CONFIG_LCD_SERVICE_QUEUE_DEPTH
+#define CONFIG_LCD_SERVICE_QUEUE_DEPTH 32
+#endif
+#ifndef CONFIG_LCD_SERVICE_OVERFLOW_BLOCK
+#define CONFIG_LCD_SERVICE_OVERFLOW_DROP_OLDEST 1
+#endif
+#ifndef CONFIG_LCD_SERVICE_BLOCK_TIMEOUT_MS
+#define CONFIG_LCD_SERVICE_BLOCK_TIMEOUT_MS 100
+#endif
+#ifndef CONFIG_LCD_SERVICE_TASK_CORE
+#define CONFIG_LCD_SERVICE_TASK_CORE -1
+#endif
+#ifndef CONFIG_LCD_SERVICE_TASK_PRIORITY
+#define CONFIG_LCD_SERVICE_TASK_PRIORITY 5
+#endif
+#ifndef CONFIG_LCD_SERVICE_TASK_STACK_SIZE
+#define CONFIG_LCD_SERVICE_TASK_STACK_SIZE 3072
+#endif
+#ifndef CONFIG_LCD_ASYNC_MAX_OPS
+#define CONFIG_LCD_ASYNC_MAX_OPS 16
+#endif
+
+#ifndef CONFIG_LCD_REFRESH_MAX_FPS
+#define CONFIG_LCD_REFRESH_MAX_FPS 20
+#endif
+#ifndef CONFIG_LCD_REFRESH_URGENT_PRIORITY
+#define CONFIG_LCD_REFRESH_URGENT_PRIORITY 200
+#endif
+#ifndef CONFIG_LCD_REFRESH_TASK_PRIORITY
+#define CONFIG_LCD_REFRESH_TASK_PRIORITY 4
+#endif
+#ifndef CONFIG_LCD_REFRESH_TASK_STACK_SIZE
+#define CONFIG_LCD_REFRESH_TASK_STACK_SIZE 3072
+#endif
+
+#ifndef CONFIG_LCD_MANAGER_MAX_DISPLAYS
+#define CONFIG_LCD_MANAGER_MAX_DISPLAYS 16
+#endif
+#ifndef CONFIG_LCD_MANAGER_DISPLAY_BUDGET
+#define CONFIG_LCD_MANAGER_DISPLAY_BUDGET 20
+#endif
+#ifndef CONFIG_LCD_MANAGER_TASK_PRIORITY
+#define CONFIG_LCD_MANAGER_TASK_PRIORITY 4
+#endif
+#ifndef CONFIG_LCD_MANAGER_TASK_STACK_SIZE
+#define CONFIG_LCD_MANAGER_TASK_STACK_SIZE 3072
+#endif
@@ -0,0 +1,283 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "i2c_mock.h"
+
+// The services of ESP-IDF and FreeRTOS the driver uses, reduced to what a
+// single thread on a development machine needs. Time is the virtual clock
+// of driver/mock, so nothing here ever sleeps.
+
+#define PORT_SEMAPHORE_BINARY 0
+#define PORT_SEMAPHORE_COUNTING 1
+#define PORT_SEMAPHORE_MUTEX 2
+#define PORT_SEMAPHORE_RECURSIVE 3
+
+struct QueueDefinition
+{
+    StaticSemaphore_t state;
+};
+
+static esp_log_level_t port_log_level = ESP_LOG_WARN;
+
+static SemaphoreHandle_t port_semaphore_init(StaticSemaphore_t *buffer, uint8_t kind, uint32_t max, uint32_t count,
+                                             bool is_static);
+static BaseType_t port_semaphore_wait(SemaphoreHandle_t xSemaphore, TickType_t ticks);
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code)
+    {
+    case ESP_OK:
+        return "ESP_OK";
+    case ESP_FAIL:
+        return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:
+        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+        return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+        return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:
+        return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:
+        return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:
+        return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:
+        return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE:
+        return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_CRC:
+        return "ESP_ERR_INVALID_CRC";
+    case ESP_ERR_INVALID_VERSION:
+        return "ESP_ERR_INVALID_VERSION";
+    case ESP_ERR_INVALID_MAC:
+        return "ESP_ERR_INVALID_MAC";
+    case ESP_ERR_NOT_FINISHED:
+        return "ESP_ERR_NOT_FINISHED";
+    case ESP_ERR_NOT_ALLOWED:
+        return "ESP_ERR_NOT_ALLOWED";
+    default:
+        return "UNKNOWN ERROR";
+    }
+}
+
+void _esp_error_check_failed(esp_err_t rc, const char *file, int line, const char *function, const char *expression)
+{
+    fprintf(stderr, "ESP_ERROR_CHECK failed: esp_err_t 0x%x (%s) at %s:%d\nfunction: %s\nexpression: %s\n",
+            rc, esp_err_to_name(rc), file, line, function, expression);
+    abort();
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    port_log_level = level;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    static const char letters[] = "NEWIDV";
+    va_list args;
+
+    if (level > port_log_level)
+        return;
+    fprintf(stderr, "%c (%llu) %s: ", letters[level], (unsigned long long)(mock_clock_now_ns() / 1000000), tag);
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+esp_reset_reason_t esp_reset_reason(void)
+{
+    return ESP_RST_POWERON;
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len)
+{
+    crc = ~crc;
+    while (len--)
+    {
+        crc ^= *buf++;
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char *pcName, uint32_t usStackDepth,
+                                   void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pvCreatedTask,
+                                   BaseType_t xCoreID)
+{
+    return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete)
+{
+}
+
+void vTaskDelay(TickType_t xTicksToDelay)
+{
+    mock_clock_advance_ns((uint64_t)xTicksToDelay * portTICK_PERIOD_MS * 1000000);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(mock_clock_now_ns() / ((uint64_t)portTICK_PERIOD_MS * 1000000));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    // Any non-NULL value: there is only the one task
+    return (TaskHandle_t)&port_log_level;
+}
+
+BaseType_t xTaskGetSchedulerState(void)
+{
+    // The one task may block: a timer callback is what wakes it, see port_semaphore_wait()
+    return taskSCHEDULER_RUNNING;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t xTaskToNotify, uint32_t ulValue, eNotifyAction eAction)
+{
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify)
+{
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+    // Notifications are not delivered: nothing ends the wait early
+    port_semaphore_wait(NULL, xTicksToWait);
+    return 0;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t ulBitsToClearOnEntry, uint32_t ulBitsToClearOnExit, uint32_t *pulNotificationValue,
+                           TickType_t xTicksToWait)
+{
+    if (pulNotificationValue)
+        *pulNotificationValue = 0;
+    return port_semaphore_wait(NULL, xTicksToWait);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return port_semaphore_init(malloc(sizeof(StaticSemaphore_t)), PORT_SEMAPHORE_BINARY, 1, 0, false);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *pxSemaphoreBuffer)
+{
+    return port_semaphore_init(pxSemaphoreBuffer, PORT_SEMAPHORE_BINARY, 1, 0, true);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount)
+{
+    return port_semaphore_init(malloc(sizeof(StaticSemaphore_t)), PORT_SEMAPHORE_COUNTING, uxMaxCount,
+                               uxInitialCount, false);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return port_semaphore_init(malloc(sizeof(StaticSemaphore_t)), PORT_SEMAPHORE_MUTEX, 1, 1, false);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void)
+{
+    // count is the nesting depth, max unused
+    return port_semaphore_init(malloc(sizeof(StaticSemaphore_t)), PORT_SEMAPHORE_RECURSIVE, 0, 0, false);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore)
+{
+    if (xSemaphore && !xSemaphore->state.is_static)
+        free(xSemaphore);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime)
+{
+    if (xSemaphore->state.count)
+    {
+        xSemaphore->state.count--;
+        return pdTRUE;
+    }
+    return port_semaphore_wait(xSemaphore, xBlockTime);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore)
+{
+    if (xSemaphore->state.count >= xSemaphore->state.max)
+        return pdFALSE;
+    xSemaphore->state.count++;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t xMutex, TickType_t xBlockTime)
+{
+    // The one task always holds it already or can take it
+    xMutex->state.count++;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t xMutex)
+{
+    if (!xMutex->state.count)
+        return pdFALSE;
+    xMutex->state.count--;
+    return pdTRUE;
+}
+
+static SemaphoreHandle_t port_semaphore_init(StaticSemaphore_t *buffer, uint8_t kind, uint32_t max, uint32_t count,
+                                             bool is_static)
+{
+    if (!buffer)
+        return NULL;
+    buffer->kind = kind;
+    buffer->max = max;
+    buffer->count = count;
+    buffer->is_static = is_static;
+    return (SemaphoreHandle_t)buffer;
+}
+
+/**
+ * @brief Block on something only another task or a timer could provide
+ *
+ * @details There is no other task, so time passes from one timer expiry to
+ *          the next until a callback gives the semaphore or the wait is over.
+ *          A NULL semaphore is never given.
+ */
+static BaseType_t port_semaphore_wait(SemaphoreHandle_t xSemaphore, TickType_t ticks)
+{
+    uint64_t deadline = mock_clock_now_ns() + (uint64_t)ticks * portTICK_PERIOD_MS * 1000000;
+    uint64_t alarm;
+
+    while (!xSemaphore || !xSemaphore->state.count)
+    {
+        uint64_t now = mock_clock_now_ns();
+
+        if (mock_clock_next_alarm_ns(&alarm) && (ticks == portMAX_DELAY || alarm <= deadline))
+        {
+            mock_clock_advance_ns(alarm - now);
+            continue;
+        }
+        if (ticks == portMAX_DELAY)
+        {
+            fprintf(stderr, "port: blocked forever with no other task to wake it\n");
+            abort();
+        }
+        mock_clock_advance_ns(deadline > now ? deadline - now : 0);
+        if (!xSemaphore || !xSemaphore->state.count)
+            return pdFALSE;
+    }
+    xSemaphore->state.count--;
+    return pdTRUE;
+}
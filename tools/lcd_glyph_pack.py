@@ -0,0 +1,214 @@
+#!/usr/bin/env python3
+"""Write glyph packs for lcd_glyph_pack_open().
+
+A glyph pack holds CGRAM glyph sets, big digits, animations and character
+ROM maps for HD44780 displays. It is flashed into a data partition of its
+own and read in place by the driver, so the artwork costs no RAM and can be
+changed without rebuilding the application:
+
+    lcd_glyph_pack.py glyphs.json -o glyphs.bin
+    parttool.py write_partition --partition-name glyphs --input glyphs.bin
+
+The sets are described in JSON:
+
+    {
+        "sets": [
+            {"name": "arrows", "type": "glyphs", "first": 0,
+             "glyphs": [["..#..", ".###.", "#.#.#", "..#..", "..#..", "..#..", "..#..", "....."]]},
+            {"name": "digits", "type": "big_digits", "width": 3, "height": 2,
+             "glyphs": [...], "symbols": {"0": [[0, 1, 2], [3, 4, 5]], ...}},
+            {"name": "spinner", "type": "animation", "first": 7,
+             "frames": [[glyph], [glyph], ...]},
+            {"name": "a00", "type": "rom_map", "map": {"°": 223, "ü": 245}}
+        ]
+    }
+
+A glyph is a list of rows, 8 of them, or 10 with "rows": 10. A row is either
+a number, bit 4 being the leftmost dot, or five characters where "#" is a dot
+that is on. Glyphs are loaded into CGRAM from location "first" on, 0 by
+default. The cells of a big digit symbol are character codes, 0 to 7 for
+the CGRAM glyphs, or one-character strings such as " ". A ROM map gives the
+character ROM code of a Latin-1 character; characters it leaves out are
+written as they are. Use --list to show what a pack holds.
+
+The layout is described in driver/private_include/hd44780_glyphpack.h.
+"""
+
+import argparse
+import json
+import struct
+import sys
+import zlib
+
+MAGIC = 0x4744434C  # "LCDG"
+VERSION = 1
+HEADER = struct.Struct("<IHHII")
+ENTRY = struct.Struct("<16sBBBBBBHII")
+NAME_LEN = 16
+CGRAM_LOCATIONS = 8
+
+TYPES = {"glyphs": 1, "big_digits": 2, "animation": 3, "rom_map": 4}
+TYPE_NAMES = {value: name for name, value in TYPES.items()}
+
+
+class PackError(Exception):
+    pass
+
+
+def code(value, what):
+    """A character code given as a number or a one-character string."""
+    if isinstance(value, str):
+        if len(value) != 1 or ord(value) > 0xFF:
+            raise PackError(f"{what}: {value!r} is not one Latin-1 character")
+        return ord(value)
+    if isinstance(value, int) and 0 <= value <= 0xFF:
+        return value
+    raise PackError(f"{what}: {value!r} is not a character code")
+
+
+def glyph(rows, count, what):
+    if len(rows) != count:
+        raise PackError(f"{what}: {len(rows)} rows, expected {count}")
+    out = bytearray()
+    for i, row in enumerate(rows):
+        if isinstance(row, str):
+            if len(row) != 5 or set(row) - set("#."):
+                raise PackError(f"{what}, row {i}: {row!r} is not five of '#' and '.'")
+            row = int(row.replace("#", "1").replace(".", "0"), 2)
+        if not isinstance(row, int) or not 0 <= row <= 0x1F:
+            raise PackError(f"{what}, row {i}: {row!r} is not five dots")
+        out.append(row)
+    return bytes(out)
+
+
+def glyphs(items, rows, first, what):
+    if not items:
+        raise PackError(f"{what}: no glyphs")
+    if first + len(items) > CGRAM_LOCATIONS:
+        raise PackError(f"{what}: {len(items)} glyphs from location {first} do not fit in CGRAM")
+    return b"".join(glyph(g, rows, f"{what}, glyph {i}") for i, g in enumerate(items))
+
+
+def encode_set(desc):
+    """Directory fields and data of one set."""
+    name = desc.get("name", "")
+    kind = desc.get("type")
+    if not name or len(name.encode()) >= NAME_LEN:
+        raise PackError(f"set {name!r}: names are 1 to {NAME_LEN - 1} bytes")
+    if kind not in TYPES:
+        raise PackError(f"set {name}: type must be one of {', '.join(TYPES)}")
+    rows = desc.get("rows", 8)
+    first = desc.get("first", 0)
+    if rows not in (8, 10):
+        raise PackError(f"set {name}: rows must be 8 or 10")
+    fields = {"type": TYPES[kind], "rows": rows, "glyphs": 0, "first": first, "width": 0, "height": 0, "count": 1}
+
+    if kind == "glyphs":
+        data = glyphs(desc.get("glyphs"), rows, first, f"set {name}")
+        fields["glyphs"] = len(desc["glyphs"])
+    elif kind == "big_digits":
+        width, height = desc.get("width", 0), desc.get("height", 0)
+        symbols = desc.get("symbols") or {}
+        if not 1 <= width <= 20 or not 1 <= height <= 4:
+            raise PackError(f"set {name}: width and height must fit a display")
+        if not symbols:
+            raise PackError(f"set {name}: no symbols")
+        data = bytearray(glyphs(desc.get("glyphs"), rows, first, f"set {name}"))
+        cells = bytearray()
+        for symbol, grid in symbols.items():
+            data.append(code(symbol, f"set {name}, symbol"))
+            if len(grid) != height or any(len(line) != width for line in grid):
+                raise PackError(f"set {name}, symbol {symbol!r}: expected {height} rows of {width} cells")
+            cells += bytes(code(cell, f"set {name}, symbol {symbol!r}") for line in grid for cell in line)
+        data = bytes(data + cells)
+        fields.update(glyphs=len(desc["glyphs"]), width=width, height=height, count=len(symbols))
+    elif kind == "animation":
+        frames = desc.get("frames") or []
+        if not frames or any(len(frame) != len(frames[0]) for frame in frames):
+            raise PackError(f"set {name}: frames must all have the same number of glyphs")
+        data = b"".join(glyphs(frame, rows, first, f"set {name}, frame {i}") for i, frame in enumerate(frames))
+        fields.update(glyphs=len(frames[0]), count=len(frames))
+    else:
+        table = bytearray(range(256))
+        for key, value in (desc.get("map") or {}).items():
+            source = int(key, 0) if key.lower().startswith("0x") else code(key, f"set {name}, map")
+            table[source] = code(value, f"set {name}, map of {key!r}")
+        data = bytes(table)
+        fields.update(rows=0, first=0)
+    return name, fields, data
+
+
+def pack(sets):
+    names = [s.get("name") for s in sets]
+    duplicates = {n for n in names if names.count(n) > 1}
+    if duplicates:
+        raise PackError(f"sets named more than once: {', '.join(sorted(duplicates))}")
+
+    directory = bytearray()
+    body = bytearray()
+    offset = HEADER.size + ENTRY.size * len(sets)
+    for desc in sets:
+        name, fields, data = encode_set(desc)
+        directory += ENTRY.pack(name.encode(), fields["type"], fields["rows"], fields["glyphs"], fields["first"],
+                                fields["width"], fields["height"], fields["count"], offset + len(body), len(data))
+        body += data
+        body += bytes(-len(body) % 4)
+    payload = bytes(directory + body)
+    return HEADER.pack(MAGIC, VERSION, len(sets), HEADER.size + len(payload), zlib.crc32(payload)) + payload
+
+
+def describe(data):
+    magic, version, count, size, crc = HEADER.unpack_from(data)
+    if magic != MAGIC or version != VERSION:
+        raise PackError(f"not a glyph pack of version {VERSION}")
+    if size > len(data) or zlib.crc32(data[HEADER.size:size]) != crc:
+        raise PackError("glyph pack truncated or corrupt")
+    print(f"{size} bytes, {count} sets")
+    for i in range(count):
+        name, kind, rows, nglyphs, first, width, height, n, offset, length = \
+            ENTRY.unpack_from(data, HEADER.size + i * ENTRY.size)
+        name = name.rstrip(b"\0").decode()
+        kind = TYPE_NAMES.get(kind, kind)
+        line = f"  {name:<15} {kind:<10} {length:5} bytes at {offset:#06x}"
+        if kind == "big_digits":
+            symbols = data[offset + nglyphs * rows:offset + nglyphs * rows + n].decode("latin-1")
+            line += f", {nglyphs} glyphs from {first}, {width}x{height} symbols {symbols!r}"
+        elif kind == "animation":
+            line += f", {n} frames of {nglyphs} glyphs from {first}"
+        elif kind == "glyphs":
+            line += f", {nglyphs} glyphs from {first}"
+        print(line)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", help="JSON description of the sets, or a pack with --list")
+    parser.add_argument("-o", "--output", help="glyph pack to write")
+    parser.add_argument("-s", "--size", type=lambda s: int(s, 0),
+                        help="partition size, the pack is padded with 0xFF to it and must fit")
+    parser.add_argument("-l", "--list", action="store_true", help="list the sets of a glyph pack")
+    args = parser.parse_args()
+
+    try:
+        if args.list:
+            with open(args.input, "rb") as f:
+                describe(f.read())
+            return 0
+        if not args.output:
+            parser.error("an output file is needed, see -o")
+        with open(args.input, encoding="utf-8") as f:
+            data = pack(json.load(f).get("sets", []))
+        if args.size is not None:
+            if len(data) > args.size:
+                raise PackError(f"pack of {len(data)} bytes larger than the partition, {args.size} bytes")
+            data += b"\xff" * (args.size - len(data))
+        with open(args.output, "wb") as f:
+            f.write(data)
+    except (OSError, ValueError, PackError) as e:
+        print(f"{parser.prog}: {e}", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())